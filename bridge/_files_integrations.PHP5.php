@@ -10,7 +10,6 @@ return [
     __DIR__ . '/../src/Integrations/Integrations/CodeIgniter/V2/CodeIgniterIntegration.PHP5.php',
     __DIR__ . '/../src/Integrations/Integrations/Web/WebIntegration.php',
     __DIR__ . '/../src/Integrations/Integrations/IntegrationsLoader.php',
-    __DIR__ . '/../src/Integrations/Integrations/PDO/PDOIntegration.php',
     __DIR__ . '/../src/Integrations/Integrations/PHPRedis/PHPRedisIntegration.php',
     __DIR__ . '/../src/Integrations/Integrations/Predis/PredisIntegration.php',
     __DIR__ . '/../src/Integrations/Integrations/Eloquent/EloquentIntegration.php',
@@ -0,0 +1,219 @@
+#include "ddsketch.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// values below are counted as zeros, far below the nanosecond durations the sketches are made for
+#define DATADOG_PHP_DDSKETCH_MIN_VALUE 1e-9
+
+static double datadog_php_ddsketch_gamma(void) {
+    return (1 + DATADOG_PHP_DDSKETCH_RELATIVE_ACCURACY) / (1 - DATADOG_PHP_DDSKETCH_RELATIVE_ACCURACY);
+}
+
+static int32_t datadog_php_ddsketch_index(double value) {
+    return (int32_t)floor(log(value) / log(datadog_php_ddsketch_gamma()));
+}
+
+static double datadog_php_ddsketch_value(int32_t index) {
+    return pow(datadog_php_ddsketch_gamma(), index) * (1 + DATADOG_PHP_DDSKETCH_RELATIVE_ACCURACY);
+}
+
+void datadog_php_ddsketch_ctor(datadog_php_ddsketch *sketch) {
+    sketch->bins = NULL;
+    sketch->offset = 0;
+    sketch->bin_count = 0;
+    sketch->zero_count = 0;
+    sketch->count = 0;
+}
+
+void datadog_php_ddsketch_dtor(datadog_php_ddsketch *sketch) {
+    free(sketch->bins);
+    datadog_php_ddsketch_ctor(sketch);
+}
+
+// Makes the bins cover the indexes [low, high], collapsing the lowest ones if that is too many
+static bool datadog_php_ddsketch_cover(datadog_php_ddsketch *sketch, int32_t low, int32_t high) {
+    int32_t old_high = sketch->offset + (int32_t)sketch->bin_count - 1;
+    if (sketch->bin_count && low >= sketch->offset && high <= old_high) {
+        return true;
+    }
+
+    int32_t new_low = low, new_high = high;
+    if (sketch->bin_count) {
+        new_low = low < sketch->offset ? low : sketch->offset;
+        new_high = high > old_high ? high : old_high;
+    }
+    if ((int64_t)new_high - new_low >= DATADOG_PHP_DDSKETCH_MAX_BINS) {
+        if (sketch->bin_count && sketch->offset == new_high - DATADOG_PHP_DDSKETCH_MAX_BINS + 1) {
+            // already collapsed, lower indexes go into the lowest bin
+            return true;
+        }
+        new_low = new_high - DATADOG_PHP_DDSKETCH_MAX_BINS + 1;
+    }
+
+    uint32_t bin_count = (uint32_t)(new_high - new_low + 1);
+    uint64_t *bins = calloc(bin_count, sizeof(*bins));
+    if (!bins) {
+        return false;
+    }
+    for (uint32_t i = 0; i < sketch->bin_count; ++i) {
+        int32_t index = sketch->offset + (int32_t)i;
+        bins[(index < new_low ? new_low : index) - new_low] += sketch->bins[i];
+    }
+
+    free(sketch->bins);
+    sketch->bins = bins;
+    sketch->offset = new_low;
+    sketch->bin_count = bin_count;
+    return true;
+}
+
+static uint64_t *datadog_php_ddsketch_bin(datadog_php_ddsketch *sketch, int32_t index) {
+    return &sketch->bins[(index < sketch->offset ? sketch->offset : index) - sketch->offset];
+}
+
+bool datadog_php_ddsketch_add(datadog_php_ddsketch *sketch, double value) {
+    // also catches NaN
+    if (!(value >= DATADOG_PHP_DDSKETCH_MIN_VALUE)) {
+        ++sketch->zero_count;
+        ++sketch->count;
+        return true;
+    }
+
+    int32_t index = datadog_php_ddsketch_index(value);
+    if (!datadog_php_ddsketch_cover(sketch, index, index)) {
+        return false;
+    }
+    ++*datadog_php_ddsketch_bin(sketch, index);
+    ++sketch->count;
+    return true;
+}
+
+bool datadog_php_ddsketch_merge(datadog_php_ddsketch *dst, const datadog_php_ddsketch *src) {
+    if (src->bin_count) {
+        if (!datadog_php_ddsketch_cover(dst, src->offset, src->offset + (int32_t)src->bin_count - 1)) {
+            return false;
+        }
+        for (uint32_t i = 0; i < src->bin_count; ++i) {
+            *datadog_php_ddsketch_bin(dst, src->offset + (int32_t)i) += src->bins[i];
+        }
+    }
+    dst->zero_count += src->zero_count;
+    dst->count += src->count;
+    return true;
+}
+
+double datadog_php_ddsketch_quantile(const datadog_php_ddsketch *sketch, double q) {
+    if (!sketch->count) {
+        return 0;
+    }
+
+    double rank = q * (double)(sketch->count - 1);
+    uint64_t seen = sketch->zero_count;
+    if ((double)seen > rank) {
+        return 0;
+    }
+    for (uint32_t i = 0; i < sketch->bin_count; ++i) {
+        seen += sketch->bins[i];
+        if ((double)seen > rank) {
+            return datadog_php_ddsketch_value(sketch->offset + (int32_t)i);
+        }
+    }
+    return datadog_php_ddsketch_value(sketch->offset + (int32_t)sketch->bin_count - 1);
+}
+
+/* The protobuf messages, from sketches-go's ddsketch.proto:
+ *   DDSketch { IndexMapping mapping = 1; Store positiveValues = 2; Store negativeValues = 3; double zeroCount = 4; }
+ *   IndexMapping { double gamma = 1; double indexOffset = 2; Interpolation interpolation = 3; }
+ *   Store { map<sint32, double> binCounts = 1; repeated double contiguousBinCounts = 2;
+ *           sint32 contiguousBinIndexOffset = 3; }
+ * Fields with default values are omitted, as protobuf encoders do.
+ */
+#define DATADOG_PHP_PB_LEN(field) (char)((field) << 3 | 2)
+#define DATADOG_PHP_PB_FIXED64(field) (char)((field) << 3 | 1)
+#define DATADOG_PHP_PB_VARINT(field) (char)((field) << 3 | 0)
+
+typedef struct {
+    char *buffer;
+    size_t size, position;
+} datadog_php_pb_writer;
+
+static void datadog_php_pb_byte(datadog_php_pb_writer *writer, char byte) {
+    if (writer->position < writer->size) {
+        writer->buffer[writer->position] = byte;
+    }
+    ++writer->position;
+}
+
+static void datadog_php_pb_varint(datadog_php_pb_writer *writer, uint64_t value) {
+    while (value >= 0x80) {
+        datadog_php_pb_byte(writer, (char)(value | 0x80));
+        value >>= 7;
+    }
+    datadog_php_pb_byte(writer, (char)value);
+}
+
+static void datadog_php_pb_double(datadog_php_pb_writer *writer, double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    for (int i = 0; i < 8; ++i) {
+        datadog_php_pb_byte(writer, (char)(bits >> (8 * i)));
+    }
+}
+
+static size_t datadog_php_pb_varint_size(uint64_t value) {
+    size_t size = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        ++size;
+    }
+    return size;
+}
+
+size_t datadog_php_ddsketch_encode(const datadog_php_ddsketch *sketch, char *buffer, size_t size) {
+    datadog_php_pb_writer writer = {.buffer = buffer, .size = size, .position = 0};
+
+    datadog_php_pb_byte(&writer, DATADOG_PHP_PB_LEN(1));
+    datadog_php_pb_varint(&writer, 1 + 8);
+    datadog_php_pb_byte(&writer, DATADOG_PHP_PB_FIXED64(1));
+    datadog_php_pb_double(&writer, datadog_php_ddsketch_gamma());
+
+    // the dense bins, without the empty ones at either end
+    uint32_t first = 0, last = sketch->bin_count;
+    while (first < last && !sketch->bins[first]) {
+        ++first;
+    }
+    while (last > first && !sketch->bins[last - 1]) {
+        --last;
+    }
+    if (first < last) {
+        int32_t offset = sketch->offset + (int32_t)first;
+        uint32_t zigzag_offset = ((uint32_t)offset << 1) ^ (offset < 0 ? UINT32_MAX : 0);
+        uint32_t counts = last - first;
+        size_t counts_size = (size_t)counts * 8;
+        size_t store_size = 1 + datadog_php_pb_varint_size(counts_size) + counts_size;
+        if (offset) {
+            store_size += 1 + datadog_php_pb_varint_size(zigzag_offset);
+        }
+
+        datadog_php_pb_byte(&writer, DATADOG_PHP_PB_LEN(2));
+        datadog_php_pb_varint(&writer, store_size);
+        datadog_php_pb_byte(&writer, DATADOG_PHP_PB_LEN(2));
+        datadog_php_pb_varint(&writer, counts_size);
+        for (uint32_t i = first; i < last; ++i) {
+            datadog_php_pb_double(&writer, (double)sketch->bins[i]);
+        }
+        if (offset) {
+            datadog_php_pb_byte(&writer, DATADOG_PHP_PB_VARINT(3));
+            datadog_php_pb_varint(&writer, zigzag_offset);
+        }
+    }
+
+    if (sketch->zero_count) {
+        datadog_php_pb_byte(&writer, DATADOG_PHP_PB_FIXED64(4));
+        datadog_php_pb_double(&writer, (double)sketch->zero_count);
+    }
+
+    return writer.position;
+}
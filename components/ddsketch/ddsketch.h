@@ -0,0 +1,62 @@
+#ifndef DATADOG_PHP_DDSKETCH_H
+#define DATADOG_PHP_DDSKETCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A DDSketch is a quantile sketch with relative-error guarantees: every value
+ * is counted in the bin of index floor(log_gamma(value)), so that any quantile
+ * is known within DATADOG_PHP_DDSKETCH_RELATIVE_ACCURACY of its true value.
+ * The mapping is the logarithmic one of the sketches-go library, which is
+ * what the agent uses to decode the latency distributions of the client-side
+ * stats.
+ *
+ * Only positive values are supported, values too small to be indexed are
+ * counted as zeros. The bins are stored densely between the lowest and the
+ * highest index seen, which stays small for latencies: nanosecond durations
+ * up to an hour fit in less than 1500 bins. Past
+ * DATADOG_PHP_DDSKETCH_MAX_BINS, the lowest bins are collapsed together.
+ */
+typedef struct datadog_php_ddsketch {
+    uint64_t *bins;  // counts of the indexes [offset, offset + bin_count)
+    int32_t offset;
+    uint32_t bin_count;
+    uint64_t zero_count;
+    uint64_t count;
+} datadog_php_ddsketch;
+
+#define DATADOG_PHP_DDSKETCH_RELATIVE_ACCURACY 0.01
+#define DATADOG_PHP_DDSKETCH_MAX_BINS 2048
+
+void datadog_php_ddsketch_ctor(datadog_php_ddsketch *sketch);
+void datadog_php_ddsketch_dtor(datadog_php_ddsketch *sketch);
+
+/**
+ * Counts `value` once. Returns false if the bins could not grow, the sketch is
+ * left unchanged in that case.
+ */
+bool datadog_php_ddsketch_add(datadog_php_ddsketch *sketch, double value);
+
+/**
+ * Adds all the counts of `src` to `dst`. Returns false if the bins of `dst`
+ * could not grow, it is left unchanged in that case.
+ */
+bool datadog_php_ddsketch_merge(datadog_php_ddsketch *dst, const datadog_php_ddsketch *src);
+
+/**
+ * Returns the value at quantile `q` (between 0 and 1), or 0 if the sketch is
+ * empty.
+ */
+double datadog_php_ddsketch_quantile(const datadog_php_ddsketch *sketch, double q);
+
+/**
+ * Encodes the sketch as the DDSketch protobuf message of the sketches-go
+ * library, which the agent decodes. Returns the number of bytes needed; the
+ * message is only written if that fits into `size`, so that a first call
+ * with a size of 0 tells how much to allocate.
+ */
+size_t datadog_php_ddsketch_encode(const datadog_php_ddsketch *sketch, char *buffer, size_t size);
+
+#endif  // DATADOG_PHP_DDSKETCH_H
@@ -0,0 +1,135 @@
+extern "C" {
+#include <components/ddsketch/ddsketch.h>
+}
+
+#include <catch2/catch.hpp>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+static void check_relative(double actual, double expected) {
+    CHECK(std::fabs(actual - expected) <= expected * DATADOG_PHP_DDSKETCH_RELATIVE_ACCURACY);
+}
+
+TEST_CASE("ddsketch empty", "[ddsketch]") {
+    datadog_php_ddsketch sketch;
+    datadog_php_ddsketch_ctor(&sketch);
+    CHECK(sketch.count == 0);
+    CHECK(datadog_php_ddsketch_quantile(&sketch, 0.5) == 0);
+    // only the index mapping
+    CHECK(datadog_php_ddsketch_encode(&sketch, nullptr, 0) == 11);
+    datadog_php_ddsketch_dtor(&sketch);
+}
+
+TEST_CASE("ddsketch quantiles are within the relative accuracy", "[ddsketch]") {
+    datadog_php_ddsketch sketch;
+    datadog_php_ddsketch_ctor(&sketch);
+    for (int i = 1; i <= 1000; ++i) {
+        REQUIRE(datadog_php_ddsketch_add(&sketch, i * 1000000.));
+    }
+    CHECK(sketch.count == 1000);
+    CHECK(sketch.zero_count == 0);
+
+    check_relative(datadog_php_ddsketch_quantile(&sketch, 0), 1000000.);
+    check_relative(datadog_php_ddsketch_quantile(&sketch, 0.5), 500000000.);
+    check_relative(datadog_php_ddsketch_quantile(&sketch, 0.99), 990000000.);
+    check_relative(datadog_php_ddsketch_quantile(&sketch, 1), 1000000000.);
+
+    datadog_php_ddsketch_dtor(&sketch);
+}
+
+TEST_CASE("ddsketch counts zeros", "[ddsketch]") {
+    datadog_php_ddsketch sketch;
+    datadog_php_ddsketch_ctor(&sketch);
+    REQUIRE(datadog_php_ddsketch_add(&sketch, 0));
+    REQUIRE(datadog_php_ddsketch_add(&sketch, -5));
+    REQUIRE(datadog_php_ddsketch_add(&sketch, 10));
+    CHECK(sketch.count == 3);
+    CHECK(sketch.zero_count == 2);
+    CHECK(datadog_php_ddsketch_quantile(&sketch, 0.5) == 0);
+    check_relative(datadog_php_ddsketch_quantile(&sketch, 1), 10);
+    datadog_php_ddsketch_dtor(&sketch);
+}
+
+TEST_CASE("ddsketch merge", "[ddsketch]") {
+    datadog_php_ddsketch a, b, all;
+    datadog_php_ddsketch_ctor(&a);
+    datadog_php_ddsketch_ctor(&b);
+    datadog_php_ddsketch_ctor(&all);
+    for (int i = 1; i <= 100; ++i) {
+        REQUIRE(datadog_php_ddsketch_add(i % 2 ? &a : &b, i * 37.));
+        REQUIRE(datadog_php_ddsketch_add(&all, i * 37.));
+    }
+    REQUIRE(datadog_php_ddsketch_add(&b, 0));
+    REQUIRE(datadog_php_ddsketch_add(&all, 0));
+
+    REQUIRE(datadog_php_ddsketch_merge(&a, &b));
+    CHECK(a.count == all.count);
+    CHECK(a.zero_count == all.zero_count);
+    for (double q = 0; q <= 1; q += 0.125) {
+        CHECK(datadog_php_ddsketch_quantile(&a, q) == datadog_php_ddsketch_quantile(&all, q));
+    }
+
+    datadog_php_ddsketch_dtor(&a);
+    datadog_php_ddsketch_dtor(&b);
+    datadog_php_ddsketch_dtor(&all);
+}
+
+TEST_CASE("ddsketch collapses the lowest bins", "[ddsketch]") {
+    datadog_php_ddsketch sketch;
+    datadog_php_ddsketch_ctor(&sketch);
+    REQUIRE(datadog_php_ddsketch_add(&sketch, 1e-6));
+    REQUIRE(datadog_php_ddsketch_add(&sketch, 1e300));
+    REQUIRE(datadog_php_ddsketch_add(&sketch, 1e-3));
+    CHECK(sketch.count == 3);
+    CHECK(sketch.bin_count == DATADOG_PHP_DDSKETCH_MAX_BINS);
+    check_relative(datadog_php_ddsketch_quantile(&sketch, 1), 1e300);
+    datadog_php_ddsketch_dtor(&sketch);
+}
+
+TEST_CASE("ddsketch protobuf encoding", "[ddsketch]") {
+    datadog_php_ddsketch sketch;
+    datadog_php_ddsketch_ctor(&sketch);
+    REQUIRE(datadog_php_ddsketch_add(&sketch, 1));
+    REQUIRE(datadog_php_ddsketch_add(&sketch, 1));
+    REQUIRE(datadog_php_ddsketch_add(&sketch, 0));
+
+    size_t size = datadog_php_ddsketch_encode(&sketch, nullptr, 0);
+    // mapping, store with a single bin at index 0, zero count
+    REQUIRE(size == 11 + 12 + 9);
+    std::vector<char> buffer(size);
+    REQUIRE(datadog_php_ddsketch_encode(&sketch, buffer.data(), size) == size);
+
+    CHECK(buffer[0] == 0x0A);
+    CHECK(buffer[1] == 9);
+    CHECK(buffer[2] == 0x09);
+    double gamma;
+    memcpy(&gamma, &buffer[3], sizeof(gamma));
+    CHECK(gamma == Approx(1.01 / 0.99));
+
+    CHECK(buffer[11] == 0x12);
+    CHECK(buffer[12] == 10);
+    CHECK(buffer[13] == 0x12);
+    CHECK(buffer[14] == 8);
+    double count;
+    memcpy(&count, &buffer[15], sizeof(count));
+    CHECK(count == 2);
+
+    CHECK(buffer[23] == 0x21);
+    memcpy(&count, &buffer[24], sizeof(count));
+    CHECK(count == 1);
+
+    // a negative offset is zigzag encoded: 2 * |index| - 1
+    datadog_php_ddsketch_dtor(&sketch);
+    datadog_php_ddsketch_ctor(&sketch);
+    REQUIRE(datadog_php_ddsketch_add(&sketch, 0.99));
+    size = datadog_php_ddsketch_encode(&sketch, nullptr, 0);
+    REQUIRE(size == 11 + 14);
+    buffer.resize(size);
+    datadog_php_ddsketch_encode(&sketch, buffer.data(), size);
+    CHECK(buffer[12] == 12);
+    CHECK(buffer[23] == 0x18);
+    CHECK(buffer[24] == 1);
+
+    datadog_php_ddsketch_dtor(&sketch);
+}
@@ -0,0 +1,273 @@
+#include "sql_quantizer.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#define DATADOG_PHP_SQL_NO_MATCH SIZE_MAX
+
+// Parentheses nested deeper than this are never treated as lists
+#define DATADOG_PHP_SQL_MAX_DEPTH 64
+
+typedef struct {
+    char *buf;
+    size_t len;
+    // whitespace or a comment was skipped since the last token
+    bool space;
+    // the open parentheses, bit n is set if the one at depth n + 1 holds an IN (...) or VALUES (...) list
+    uint32_t depth;
+    uint64_t lists;
+    // the end of the last ')' closing a VALUES (...) group, 0 if there is none
+    size_t values_close_end;
+    // bit n is set if the parenthesis at depth n + 1 is a VALUES (...) group
+    uint64_t values;
+} datadog_php_sql_output;
+
+static bool datadog_php_sql_is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+static bool datadog_php_sql_is_digit(char c) { return c >= '0' && c <= '9'; }
+
+static bool datadog_php_sql_is_ident(char c) {
+    // bytes >= 0x80 are parts of multibyte identifiers
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || datadog_php_sql_is_digit(c) || c == '_' || c == '$' ||
+           (unsigned char)c >= 0x80;
+}
+
+static void datadog_php_sql_begin_token(datadog_php_sql_output *out) {
+    if (out->space && out->len) {
+        out->buf[out->len++] = ' ';
+    }
+    out->space = false;
+}
+
+static void datadog_php_sql_emit(datadog_php_sql_output *out, const char *str, size_t len) {
+    datadog_php_sql_begin_token(out);
+    memcpy(out->buf + out->len, str, len);
+    out->len += len;
+}
+
+/* Matches `pattern` against the output ending at `pos`, allowing a space before each of its characters. Returns the
+ * position of the first matched character. */
+static size_t datadog_php_sql_match_back(const datadog_php_sql_output *out, size_t pos, const char *pattern) {
+    for (size_t i = strlen(pattern); i--;) {
+        if (pos && out->buf[pos - 1] == ' ') {
+            --pos;
+        }
+        if (!pos || out->buf[pos - 1] != pattern[i]) {
+            return DATADOG_PHP_SQL_NO_MATCH;
+        }
+        --pos;
+    }
+    return pos;
+}
+
+static bool datadog_php_sql_in_paren(const datadog_php_sql_output *out, uint64_t parens) {
+    return out->depth && out->depth <= DATADOG_PHP_SQL_MAX_DEPTH && (parens >> (out->depth - 1) & 1);
+}
+
+// Whether the output ends with the keyword, case-insensitively and possibly followed by a space
+static bool datadog_php_sql_ends_with_keyword(const datadog_php_sql_output *out, const char *keyword) {
+    size_t len = strlen(keyword), pos = out->len;
+    if (pos && out->buf[pos - 1] == ' ') {
+        --pos;
+    }
+    if (pos < len || (pos > len && datadog_php_sql_is_ident(out->buf[pos - len - 1]))) {
+        return false;
+    }
+    for (size_t i = 0; i < len; ++i) {
+        if ((out->buf[pos - len + i] | 0x20) != keyword[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void datadog_php_sql_emit_placeholder(datadog_php_sql_output *out) {
+    datadog_php_sql_begin_token(out);
+
+    // "IN (?, ?)" becomes "IN (?)", other lists of values like "SELECT ?, ?" or "LIMIT ?, ?" are kept
+    if (datadog_php_sql_in_paren(out, out->lists)) {
+        size_t previous = datadog_php_sql_match_back(out, out->len, "?,");
+        if (previous != DATADOG_PHP_SQL_NO_MATCH) {
+            out->len = previous + 1;
+            return;
+        }
+    }
+
+    out->buf[out->len++] = '?';
+}
+
+static void datadog_php_sql_emit_open(datadog_php_sql_output *out) {
+    bool values = datadog_php_sql_ends_with_keyword(out, "values");
+    // the next group of a VALUES (...), (...) list
+    if (!values && out->values_close_end) {
+        size_t previous_close = datadog_php_sql_match_back(out, out->len, "),");
+        values = previous_close != DATADOG_PHP_SQL_NO_MATCH && previous_close + 1 == out->values_close_end;
+    }
+    bool list = values || datadog_php_sql_ends_with_keyword(out, "in");
+
+    datadog_php_sql_begin_token(out);
+    out->buf[out->len++] = '(';
+
+    if (++out->depth <= DATADOG_PHP_SQL_MAX_DEPTH) {
+        uint64_t bit = UINT64_C(1) << (out->depth - 1);
+        out->lists = list ? out->lists | bit : out->lists & ~bit;
+        out->values = values ? out->values | bit : out->values & ~bit;
+    }
+}
+
+static void datadog_php_sql_emit_close(datadog_php_sql_output *out) {
+    datadog_php_sql_begin_token(out);
+
+    bool values = datadog_php_sql_in_paren(out, out->values);
+    if (out->depth) {
+        --out->depth;
+    }
+
+    if (values) {
+        // "VALUES (?), (?)" becomes "VALUES (?)"
+        size_t group = datadog_php_sql_match_back(out, out->len, "(?");
+        if (group != DATADOG_PHP_SQL_NO_MATCH) {
+            size_t previous_close = datadog_php_sql_match_back(out, group, "),");
+            if (previous_close != DATADOG_PHP_SQL_NO_MATCH && previous_close + 1 == out->values_close_end &&
+                datadog_php_sql_match_back(out, previous_close, "(?") != DATADOG_PHP_SQL_NO_MATCH) {
+                out->len = previous_close + 1;
+                return;
+            }
+        }
+    }
+
+    out->buf[out->len++] = ')';
+    out->values_close_end = values ? out->len : out->values_close_end;
+}
+
+// Returns the end of the quoted string starting at `str`; the quote is escaped by doubling it, or by a backslash
+static const char *datadog_php_sql_skip_quoted(const char *str, const char *end, char quote, bool backslash) {
+    const char *p = str + 1;
+    while (p < end) {
+        if (backslash && *p == '\\' && p + 1 < end) {
+            p += 2;
+        } else if (*p == quote) {
+            if (p + 1 < end && p[1] == quote) {
+                p += 2;
+            } else {
+                return p + 1;
+            }
+        } else {
+            ++p;
+        }
+    }
+    return end;
+}
+
+static const char *datadog_php_sql_skip_number(const char *str, const char *end) {
+    const char *p = str;
+    if (end - p > 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) {
+        p += 2;
+    } else {
+        while (p < end && (datadog_php_sql_is_digit(*p) || *p == '.')) {
+            ++p;
+        }
+        bool exponent_sign = p + 2 < end && (p[1] == '+' || p[1] == '-') && datadog_php_sql_is_digit(p[2]);
+        if (p + 1 < end && (*p == 'e' || *p == 'E') && (datadog_php_sql_is_digit(p[1]) || exponent_sign)) {
+            p += 2;
+        }
+    }
+    // hex digits, exponent digits and type suffixes
+    while (p < end && datadog_php_sql_is_ident(*p)) {
+        ++p;
+    }
+    return p;
+}
+
+// Returns the end of the $1 placeholder or the $tag$...$tag$ string starting at `str`, or NULL if there is none
+static const char *datadog_php_sql_skip_dollar(const char *str, const char *end) {
+    const char *p = str + 1;
+    if (p < end && datadog_php_sql_is_digit(*p)) {
+        while (p < end && datadog_php_sql_is_digit(*p)) {
+            ++p;
+        }
+        return p;
+    }
+
+    while (p < end && *p != '$' && datadog_php_sql_is_ident(*p)) {
+        ++p;
+    }
+    if (p == end || *p != '$') {
+        return NULL;
+    }
+
+    size_t tag_len = (size_t)(p - str) + 1;
+    for (p = p + 1; (size_t)(end - p) >= tag_len; ++p) {
+        if (memcmp(p, str, tag_len) == 0) {
+            return p + tag_len;
+        }
+    }
+    return NULL;
+}
+
+size_t datadog_php_sql_quantize(datadog_php_string_view sql, char *out) {
+    datadog_php_sql_output output = {.buf = out, .len = 0, .space = false, .depth = 0, .lists = 0,
+                                     .values_close_end = 0, .values = 0};
+    const char *s = sql.ptr, *end = sql.ptr + sql.len, *dollar_end;
+
+    while (s < end) {
+        char c = *s;
+        if (datadog_php_sql_is_space(c)) {
+            output.space = true;
+            ++s;
+        } else if (c == '-' && s + 1 < end && s[1] == '-') {
+            const char *eol = memchr(s, '\n', end - s);
+            s = eol ? eol + 1 : end;
+            output.space = true;
+        } else if (c == '/' && s + 1 < end && s[1] == '*') {
+            const char *p = s + 2;
+            while (p + 1 < end && !(p[0] == '*' && p[1] == '/')) {
+                ++p;
+            }
+            s = p + 1 < end ? p + 2 : end;
+            output.space = true;
+        } else if (c == '\'') {
+            s = datadog_php_sql_skip_quoted(s, end, '\'', true);
+            datadog_php_sql_emit_placeholder(&output);
+        } else if (c == '"' || c == '`') {
+            const char *p = datadog_php_sql_skip_quoted(s, end, c, false);
+            datadog_php_sql_emit(&output, s, p - s);
+            s = p;
+        } else if (datadog_php_sql_is_digit(c) ||
+                   (c == '.' && s + 1 < end && datadog_php_sql_is_digit(s[1]) &&
+                    (output.space || !output.len || !datadog_php_sql_is_ident(output.buf[output.len - 1])))) {
+            s = datadog_php_sql_skip_number(s, end);
+            datadog_php_sql_emit_placeholder(&output);
+        } else if (c == '$' && (dollar_end = datadog_php_sql_skip_dollar(s, end))) {
+            s = dollar_end;
+            datadog_php_sql_emit_placeholder(&output);
+        } else if (datadog_php_sql_is_ident(c)) {
+            const char *ident = s;
+            while (s < end && datadog_php_sql_is_ident(*s)) {
+                ++s;
+            }
+            // E'...', N'...', X'...' and B'...': the prefix goes along with the literal
+            if (s - ident == 1 && s < end && *s == '\'' && strchr("EeNnXxBb", *ident)) {
+                continue;
+            }
+            datadog_php_sql_emit(&output, ident, s - ident);
+        } else if (c == '?') {
+            datadog_php_sql_emit_placeholder(&output);
+            ++s;
+        } else if (c == '(') {
+            datadog_php_sql_emit_open(&output);
+            ++s;
+        } else if (c == ')') {
+            datadog_php_sql_emit_close(&output);
+            ++s;
+        } else {
+            datadog_php_sql_emit(&output, s, 1);
+            ++s;
+        }
+    }
+
+    return output.len;
+}
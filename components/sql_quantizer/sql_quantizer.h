@@ -0,0 +1,26 @@
+#ifndef DATADOG_PHP_SQL_QUANTIZER_H
+#define DATADOG_PHP_SQL_QUANTIZER_H
+
+#include <components/string_view/string_view.h>
+#include <stddef.h>
+
+/**
+ * Quantizes the SQL statement `sql` into `out` in a single pass, so that
+ * statements which only differ by their literal values end up equal:
+ *   - string and numeric literals become `?`, as do `$1` style placeholders
+ *     and dollar-quoted strings;
+ *   - placeholder lists directly inside `IN (...)` and `VALUES (...)`
+ *     collapse into a single one, e.g. `IN (?, ?, ?)` becomes `IN (?)`, as
+ *     do repeated groups such as `VALUES (?), (?)`; other lists, like
+ *     `SELECT ?, ?` or `LIMIT ?, ?`, are kept;
+ *   - comments and runs of whitespace become a single space, leading and
+ *     trailing whitespace is removed.
+ * Identifiers, including quoted ones, keywords and operators are kept as is.
+ *
+ * The quantized statement is never longer than the original one: `out` must
+ * have room for at least `sql.len` bytes. It is not NUL-terminated. Returns
+ * its length.
+ */
+size_t datadog_php_sql_quantize(datadog_php_string_view sql, char *out);
+
+#endif  // DATADOG_PHP_SQL_QUANTIZER_H
@@ -0,0 +1,74 @@
+extern "C" {
+#include <components/sql_quantizer/sql_quantizer.h>
+}
+
+#include <catch2/catch.hpp>
+#include <string>
+#include <vector>
+
+static std::string quantize(const std::string &sql) {
+    std::vector<char> out(sql.size() + 1);
+    datadog_php_string_view view = {sql.size(), sql.c_str()};
+    size_t len = datadog_php_sql_quantize(view, out.data());
+    REQUIRE(len <= sql.size());
+    return std::string(out.data(), len);
+}
+
+TEST_CASE("sql_quantizer keeps statements without literals", "[sql_quantizer]") {
+    CHECK(quantize("") == "");
+    CHECK(quantize("SELECT * FROM users") == "SELECT * FROM users");
+    CHECK(quantize("SELECT a.id, b.name FROM a JOIN b ON a.id = b.a_id") ==
+          "SELECT a.id, b.name FROM a JOIN b ON a.id = b.a_id");
+    CHECK(quantize("SELECT col1, t2.col$ FROM table2 t2") == "SELECT col1, t2.col$ FROM table2 t2");
+}
+
+TEST_CASE("sql_quantizer normalizes whitespace and comments", "[sql_quantizer]") {
+    CHECK(quantize("  SELECT\n\t*\r\n  FROM   users  ") == "SELECT * FROM users");
+    CHECK(quantize("SELECT /* hint */ * FROM users -- trailing\nWHERE 1") == "SELECT * FROM users WHERE ?");
+    CHECK(quantize("SELECT * FROM users /* unterminated") == "SELECT * FROM users");
+    CHECK(quantize("-- only a comment") == "");
+}
+
+TEST_CASE("sql_quantizer replaces literals", "[sql_quantizer]") {
+    CHECK(quantize("SELECT * FROM users WHERE id = 42") == "SELECT * FROM users WHERE id = ?");
+    CHECK(quantize("SELECT * FROM users WHERE name = 'O''Brien' AND x = 'a\\'b'") ==
+          "SELECT * FROM users WHERE name = ? AND x = ?");
+    CHECK(quantize("SELECT 1.5, .5e-3, 0xFF, -7, 2E10") == "SELECT ?, ?, ?, -?, ?");
+    CHECK(quantize("SELECT E'\\n', N'x', X'ff'") == "SELECT ?, ?, ?");
+    CHECK(quantize("SELECT $$ it's $$, $fn$ body $fn$") == "SELECT ?, ?");
+    CHECK(quantize("SELECT * FROM t WHERE a = $1 AND b = $2") == "SELECT * FROM t WHERE a = ? AND b = ?");
+    CHECK(quantize("SELECT * FROM t WHERE s = 'unterminated") == "SELECT * FROM t WHERE s = ?");
+}
+
+TEST_CASE("sql_quantizer keeps quoted identifiers", "[sql_quantizer]") {
+    CHECK(quantize("SELECT \"Col 1\" FROM `my table` WHERE `1` = 1") ==
+          "SELECT \"Col 1\" FROM `my table` WHERE `1` = ?");
+    CHECK(quantize("SELECT \"a\"\"b\" FROM t") == "SELECT \"a\"\"b\" FROM t");
+}
+
+TEST_CASE("sql_quantizer collapses lists", "[sql_quantizer]") {
+    CHECK(quantize("SELECT * FROM t WHERE id IN (1, 2, 3)") == "SELECT * FROM t WHERE id IN (?)");
+    CHECK(quantize("SELECT * FROM t WHERE id IN ( ?,?, ? )") == "SELECT * FROM t WHERE id IN ( ? )");
+    CHECK(quantize("INSERT INTO t (a, b) VALUES (1, 'x'), (2, 'y'),(3, 'z')") == "INSERT INTO t (a, b) VALUES (?)");
+    CHECK(quantize("UPDATE t SET a = 1, b = 'x' WHERE c = 2") == "UPDATE t SET a = ?, b = ? WHERE c = ?");
+    CHECK(quantize("SELECT f(1), g(2)") == "SELECT f(?), g(?)");
+    CHECK(quantize("SELECT * FROM t WHERE a in(1,2) AND b NOT IN (SELECT c FROM u WHERE d IN (3, 4))") ==
+          "SELECT * FROM t WHERE a in(?) AND b NOT IN (SELECT c FROM u WHERE d IN (?))");
+    CHECK(quantize("INSERT INTO t VALUES (f(1, 2), 3), (f(4, 5), 6)") ==
+          "INSERT INTO t VALUES (f(?, ?), ?), (f(?, ?), ?)");
+}
+
+TEST_CASE("sql_quantizer keeps lists outside of IN and VALUES", "[sql_quantizer]") {
+    CHECK(quantize("SELECT 1, 2") == "SELECT ?, ?");
+    CHECK(quantize("SELECT 1, 2, 'a' FROM t") == "SELECT ?, ?, ? FROM t");
+    CHECK(quantize("SELECT * FROM t LIMIT 10, 20") == "SELECT * FROM t LIMIT ?, ?");
+    CHECK(quantize("SELECT * FROM t LIMIT 10") != quantize("SELECT * FROM t LIMIT 10, 20"));
+    CHECK(quantize("SELECT * FROM t WHERE (a, b) = (1, 2)") == "SELECT * FROM t WHERE (a, b) = (?, ?)");
+    CHECK(quantize("SELECT * FROM t WHERE x = (1), (2)") == "SELECT * FROM t WHERE x = (?), (?)");
+    CHECK(quantize("SELECT * FROM login (1, 2)") == "SELECT * FROM login (?, ?)");
+}
+
+TEST_CASE("sql_quantizer maps equivalent statements together", "[sql_quantizer]") {
+    CHECK(quantize("SELECT * FROM t WHERE id IN (1, 2)") == quantize("SELECT * FROM t WHERE id IN (3,4,5,6)"));
+    CHECK(quantize("INSERT INTO t VALUES (1, 'a')") == quantize("INSERT INTO t VALUES (2, 'b'), (3, 'c')"));
+}
@@ -0,0 +1,118 @@
+#include "string_table.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static uint32_t datadog_php_string_table_hash(datadog_php_string_view str) {
+    // FNV-1a, the strings are mostly short tag names and values
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < str.len; ++i) {
+        hash ^= (unsigned char)str.ptr[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static bool datadog_php_string_table_rehash(datadog_php_string_table *table, uint32_t bucket_count) {
+    uint32_t *buckets = calloc(bucket_count, sizeof(uint32_t));
+    if (!buckets) {
+        return false;
+    }
+
+    uint32_t mask = bucket_count - 1;
+    for (uint32_t i = 0; i < table->count; ++i) {
+        uint32_t bucket = table->hashes[i] & mask;
+        while (buckets[bucket]) {
+            bucket = (bucket + 1) & mask;
+        }
+        buckets[bucket] = i + 1;
+    }
+
+    free(table->buckets);
+    table->buckets = buckets;
+    table->bucket_mask = mask;
+    return true;
+}
+
+static bool datadog_php_string_table_reserve(datadog_php_string_table *table, uint32_t capacity) {
+    if (capacity <= table->capacity) {
+        return true;
+    }
+
+    datadog_php_string_view *strings = realloc(table->strings, capacity * sizeof(*strings));
+    if (!strings) {
+        return false;
+    }
+    table->strings = strings;
+
+    uint32_t *hashes = realloc(table->hashes, capacity * sizeof(*hashes));
+    if (!hashes) {
+        return false;
+    }
+    table->hashes = hashes;
+
+    // keep the load factor at or below 1/2
+    uint32_t bucket_count = 16;
+    while (bucket_count < capacity * 2) {
+        bucket_count *= 2;
+    }
+    // the capacity only grows with the buckets, or interning would fill them up and probe forever
+    if (!datadog_php_string_table_rehash(table, bucket_count)) {
+        return false;
+    }
+    table->capacity = capacity;
+    return true;
+}
+
+bool datadog_php_string_table_ctor(datadog_php_string_table *table, uint32_t capacity) {
+    *table = (datadog_php_string_table){0};
+    return datadog_php_string_table_reserve(table, capacity < 8 ? 8 : capacity);
+}
+
+void datadog_php_string_table_dtor(datadog_php_string_table *table) {
+    free(table->strings);
+    free(table->hashes);
+    free(table->buckets);
+    *table = (datadog_php_string_table){0};
+}
+
+void datadog_php_string_table_clear(datadog_php_string_table *table) {
+    if (table->count && table->buckets) {
+        memset(table->buckets, 0, (table->bucket_mask + 1) * sizeof(uint32_t));
+    }
+    table->count = 0;
+}
+
+uint32_t datadog_php_string_table_intern(datadog_php_string_table *table, datadog_php_string_view str) {
+    uint32_t hash = datadog_php_string_table_hash(str);
+
+    if (table->buckets) {
+        uint32_t bucket = hash & table->bucket_mask;
+        uint32_t entry;
+        while ((entry = table->buckets[bucket])) {
+            if (table->hashes[entry - 1] == hash && datadog_php_string_view_equal(table->strings[entry - 1], str)) {
+                return entry - 1;
+            }
+            bucket = (bucket + 1) & table->bucket_mask;
+        }
+    }
+
+    if (table->count == table->capacity) {
+        if (table->capacity > UINT32_MAX / 4 ||
+            !datadog_php_string_table_reserve(table, table->capacity ? table->capacity * 2 : 8)) {
+            return DATADOG_PHP_STRING_TABLE_INVALID_INDEX;
+        }
+    }
+
+    uint32_t index = table->count++;
+    table->strings[index] = str;
+    table->hashes[index] = hash;
+
+    uint32_t bucket = hash & table->bucket_mask;
+    while (table->buckets[bucket]) {
+        bucket = (bucket + 1) & table->bucket_mask;
+    }
+    table->buckets[bucket] = index + 1;
+
+    return index;
+}
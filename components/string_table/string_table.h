@@ -0,0 +1,50 @@
+#ifndef DATADOG_PHP_STRING_TABLE_H
+#define DATADOG_PHP_STRING_TABLE_H
+
+#include <components/string_view/string_view.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * A string table assigns every distinct string a dense index, in insertion
+ * order. It is meant for payload encodings which refer to strings by their
+ * position in a dictionary, such as the agent's v0.5 trace format.
+ *
+ * The table does NOT copy the strings; the interned views must stay valid
+ * until the table is cleared or destroyed.
+ */
+typedef struct datadog_php_string_table {
+    datadog_php_string_view *strings;
+    uint32_t *hashes;
+    uint32_t count, capacity;
+
+    // open addressing; holds index + 1 of the string, 0 is an empty bucket
+    uint32_t *buckets;
+    uint32_t bucket_mask;
+} datadog_php_string_table;
+
+#define DATADOG_PHP_STRING_TABLE_INVALID_INDEX UINT32_MAX
+
+/**
+ * Initializes an empty table with room for at least `capacity` strings before
+ * it needs to grow. Returns false if the allocation failed; the table may still
+ * be destroyed in that case.
+ */
+bool datadog_php_string_table_ctor(datadog_php_string_table *table, uint32_t capacity);
+
+void datadog_php_string_table_dtor(datadog_php_string_table *table);
+
+/**
+ * Forgets all the interned strings while keeping the allocated memory around
+ * for the next use.
+ */
+void datadog_php_string_table_clear(datadog_php_string_table *table);
+
+/**
+ * Returns the index of `str`, adding it to the table first if it was not
+ * interned yet. Returns DATADOG_PHP_STRING_TABLE_INVALID_INDEX if the table
+ * could not grow.
+ */
+uint32_t datadog_php_string_table_intern(datadog_php_string_table *table, datadog_php_string_view str);
+
+#endif  // DATADOG_PHP_STRING_TABLE_H
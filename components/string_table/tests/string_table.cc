@@ -0,0 +1,84 @@
+extern "C" {
+#include <components/string_table/string_table.h>
+}
+
+#include <catch2/catch.hpp>
+#include <cstring>
+#include <string>
+#include <vector>
+
+TEST_CASE("string_table empty", "[string_table]") {
+    datadog_php_string_table table;
+    REQUIRE(datadog_php_string_table_ctor(&table, 0));
+    REQUIRE(table.count == 0);
+    datadog_php_string_table_dtor(&table);
+}
+
+TEST_CASE("string_table dedupes", "[string_table]") {
+    datadog_php_string_table table;
+    REQUIRE(datadog_php_string_table_ctor(&table, 4));
+
+    datadog_php_string_view empty = DATADOG_PHP_STRING_VIEW_INIT;
+    datadog_php_string_view service = DATADOG_PHP_STRING_VIEW_LITERAL("service");
+    datadog_php_string_view http_url = DATADOG_PHP_STRING_VIEW_LITERAL("http.url");
+
+    CHECK(datadog_php_string_table_intern(&table, empty) == 0);
+    CHECK(datadog_php_string_table_intern(&table, service) == 1);
+    CHECK(datadog_php_string_table_intern(&table, http_url) == 2);
+
+    // same contents from a different buffer
+    const char buffer[] = "service";
+    datadog_php_string_view service_copy = {sizeof(buffer) - 1, buffer};
+    CHECK(datadog_php_string_table_intern(&table, service_copy) == 1);
+    CHECK(datadog_php_string_table_intern(&table, empty) == 0);
+    CHECK(datadog_php_string_table_intern(&table, http_url) == 2);
+
+    REQUIRE(table.count == 3);
+    CHECK(datadog_php_string_view_equal(table.strings[1], service));
+
+    datadog_php_string_table_dtor(&table);
+}
+
+TEST_CASE("string_table grows", "[string_table]") {
+    datadog_php_string_table table;
+    REQUIRE(datadog_php_string_table_ctor(&table, 0));
+
+    std::vector<std::string> strings;
+    for (int i = 0; i < 10000; ++i) {
+        strings.push_back("tag." + std::to_string(i));
+    }
+
+    for (uint32_t i = 0; i < strings.size(); ++i) {
+        datadog_php_string_view str = {strings[i].size(), strings[i].c_str()};
+        REQUIRE(datadog_php_string_table_intern(&table, str) == i);
+    }
+    REQUIRE(table.count == strings.size());
+
+    for (uint32_t i = 0; i < strings.size(); ++i) {
+        datadog_php_string_view str = {strings[i].size(), strings[i].c_str()};
+        REQUIRE(datadog_php_string_table_intern(&table, str) == i);
+    }
+    REQUIRE(table.count == strings.size());
+
+    datadog_php_string_table_dtor(&table);
+}
+
+TEST_CASE("string_table clear", "[string_table]") {
+    datadog_php_string_table table;
+    REQUIRE(datadog_php_string_table_ctor(&table, 2));
+
+    datadog_php_string_view a = DATADOG_PHP_STRING_VIEW_LITERAL("a");
+    datadog_php_string_view b = DATADOG_PHP_STRING_VIEW_LITERAL("b");
+
+    CHECK(datadog_php_string_table_intern(&table, a) == 0);
+    CHECK(datadog_php_string_table_intern(&table, b) == 1);
+
+    datadog_php_string_table_clear(&table);
+    REQUIRE(table.count == 0);
+
+    CHECK(datadog_php_string_table_intern(&table, b) == 0);
+    CHECK(datadog_php_string_table_intern(&table, a) == 1);
+    CHECK(datadog_php_string_table_intern(&table, b) == 0);
+
+    datadog_php_string_table_dtor(&table);
+}
@@ -44,7 +44,10 @@ if test "$PHP_DDTRACE" != "no"; then
 
   DD_TRACE_COMPONENT_SOURCES="\
     components/container_id/container_id.c \
+    components/ddsketch/ddsketch.c \
     components/sapi/sapi.c \
+    components/sql_quantizer/sql_quantizer.c \
+    components/string_table/string_table.c \
     components/string_view/string_view.c \
     components/uuid/uuid.c \
   "
@@ -112,10 +115,14 @@ if test "$PHP_DDTRACE" != "no"; then
     ext/handlers_exception.c \
     ext/handlers_internal.c \
     ext/handlers_pcntl.c \
+    ext/integrations/dbm.c \
     ext/integrations/integrations.c \
+    ext/integrations/native.c \
+    ext/integrations/pdo_dsn.c \
     ext/ip_extraction.c \
     ext/logging.c \
     ext/memory_limit.c \
+    ext/object_store.c \
     ext/limiter/limiter.c \
     ext/priority_sampling/priority_sampling.c \
     ext/profiling.c \
@@ -124,6 +131,7 @@ if test "$PHP_DDTRACE" != "no"; then
     ext/serializer.c \
     ext/signals.c \
     ext/span.c \
+    ext/sql_quantization.c \
     ext/startup_logging.c \
     ext/tracer_tag_propagation/tracer_tag_propagation.c \
     ext/hook/uhook.c \
@@ -156,6 +164,10 @@ if test "$PHP_DDTRACE" != "no"; then
     [PHP_ADD_LIBRARY(curl, , EXTRA_LDFLAGS)],
     [AC_MSG_ERROR([cannot find or include curl])])
 
+  PHP_CHECK_LIBRARY(z, deflateInit2_,
+    [PHP_ADD_LIBRARY(z, , EXTRA_LDFLAGS)],
+    [AC_MSG_ERROR([cannot find or include zlib])])
+
   AC_CHECK_HEADER(time.h, [], [AC_MSG_ERROR([Cannot find or include time.h])])
 
   if test "$ext_shared" = "yes"; then
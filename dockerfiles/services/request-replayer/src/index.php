@@ -59,7 +59,19 @@ switch ($_SERVER['REQUEST_URI']) {
         }
 
         $raw = file_get_contents('php://input');
-        if (isset($headers['Content-Type']) && $headers['Content-Type'] === 'application/msgpack') {
+        if (isset($headers['Content-Encoding']) && $headers['Content-Encoding'] === 'gzip') {
+            $raw = gzdecode($raw);
+            if ($raw === false) {
+                logRequest('Cannot decode gzip-encoded request body');
+                exit();
+            }
+        }
+        if (isset($headers['Content-Type']) && $headers['Content-Type'] === 'application/msgpack'
+            && strpos($_SERVER['REQUEST_URI'], '/stats') !== false) {
+            // Client-side stats carry binary sketches, which are not valid UTF-8 and cannot be JSON encoded
+            $unpacker = new BufferUnpacker($raw);
+            $body = json_encode($unpacker->unpack(), JSON_PARTIAL_OUTPUT_ON_ERROR);
+        } elseif (isset($headers['Content-Type']) && $headers['Content-Type'] === 'application/msgpack') {
             // We unpack in two phases:
             //  1) using UnpackOptions::BIGINT_AS_GMP and only asserting that trace_id, span_id and parent_id are either
             //     integers (when <= PHP_INT_MAX) or GMP (when > PHP_INT_MAX);
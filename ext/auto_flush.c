@@ -10,55 +10,45 @@
 ZEND_RESULT_CODE ddtrace_flush_tracer(bool force_on_startup, bool collect_cycles) {
     bool success = true;
 
-    zval trace, traces;
-    array_init(&trace);
-    if (collect_cycles) {
-        ddtrace_serialize_closed_spans_with_cycle(&trace);
-    } else {
-        ddtrace_serialize_closed_spans(&trace);
+    // Spans are encoded straight into msgpack; they are released even if the payload ends up not being sent
+    char *payload;
+    size_t size, num_spans, limit = get_global_DD_TRACE_AGENT_MAX_PAYLOAD_SIZE();
+    if (!ddtrace_serialize_closed_spans_into_c_string(collect_cycles, &payload, &size, &num_spans)) {
+        return FAILURE;
     }
 
+    // The stats of the spans are counted during serialization, the writer sends them along with the traces
+    ddtrace_coms_stats_submit(&DDTRACE_G(stats_shard));
+
     // Prevent traces from requests not executing any PHP code:
     // PG(during_request_startup) will only be set to 0 upon execution of any PHP code.
     // e.g. php-fpm call with uri pointing to non-existing file, fpm status page, ...
     if (!force_on_startup && PG(during_request_startup)) {
-        zend_array_destroy(Z_ARR(trace));
+        free(payload);
         return SUCCESS;
     }
 
-    if (zend_hash_num_elements(Z_ARR(trace)) == 0) {
-        zend_array_destroy(Z_ARR(trace));
+    if (num_spans == 0) {
+        free(payload);
         ddtrace_log_debug("No finished traces to be sent to the agent");
         return SUCCESS;
     }
 
-    // background sender only wants a singular trace
-    array_init(&traces);
-    zend_hash_index_add(Z_ARR(traces), 0, &trace);
-
-    char *payload;
-    size_t size, limit = get_global_DD_TRACE_AGENT_MAX_PAYLOAD_SIZE();
-    if (ddtrace_serialize_simple_array_into_c_string(&traces, &payload, &size)) {
-        if (size > limit) {
-            ddtrace_log_errf("Agent request payload of %zu bytes exceeds configured %zu byte limit; dropping request", size, limit);
-            success = false;
-        } else {
-            success = ddtrace_send_traces_via_thread(1, payload, size);
-            if (success) {
-                char *url = ddtrace_agent_url();
-                ddtrace_log_debugf("Flushing trace of size %d to send-queue for %s",
-                                   zend_hash_num_elements(Z_ARR(trace)), url);
-                free(url);
-            }
-            dd_prepare_for_new_trace();
-        }
-
-        free(payload);
-    } else {
+    if (size > limit) {
+        ddtrace_log_errf("Agent request payload of %zu bytes exceeds configured %zu byte limit; dropping request", size, limit);
         success = false;
+    } else {
+        // background sender only wants a singular trace
+        success = ddtrace_send_traces_via_thread(1, payload, size);
+        if (success) {
+            char *url = ddtrace_agent_url();
+            ddtrace_log_debugf("Flushing trace of size %zu to send-queue for %s", num_spans, url);
+            free(url);
+        }
+        dd_prepare_for_new_trace();
     }
 
-    zval_ptr_dtor(&traces);
+    free(payload);
 
     return success ? SUCCESS : FAILURE;
 }
@@ -9,6 +9,9 @@
 #include <sys/time.h>
 #include <time.h>
 #include <unistd.h>
+#include <zlib.h>
+#include <components/ddsketch/ddsketch.h>
+#include <components/string_table/string_table.h>
 
 // For reasons it doesn't find asprintf() if this isn't included later...
 #include "coms.h"
@@ -33,286 +36,442 @@
 #include "logging.h"
 #include "mpack/mpack.h"
 
-extern inline bool ddtrace_coms_is_stack_unused(ddtrace_coms_stack_t *stack);
-extern inline bool ddtrace_coms_is_stack_free(ddtrace_coms_stack_t *stack);
-
 typedef uint32_t group_id_t;
 
-#define GROUP_ID_PROCESSED (1UL << 31UL)
+/* Every backlog entry used to be a buffer holding many traces; it now accounts for this many trace slots. */
+#define DDTRACE_COMS_SLOTS_PER_BACKLOG_ENTRY 256
 
-ddtrace_coms_state_t ddtrace_coms_globals = {.stacks = NULL};
+ddtrace_coms_state_t ddtrace_coms_globals = {.slots = NULL};
 
 static bool _dd_is_memory_pressure_high(void) {
-    ddtrace_coms_stack_t *stack = atomic_load(&ddtrace_coms_globals.current_stack);
-    if (stack) {
-        int64_t used = (((double)atomic_load(&stack->position) / (double)stack->size) * 100);
-        return used > get_global_DD_TRACE_BETA_HIGH_MEMORY_PRESSURE_PERCENT();
-    } else {
-        return false;
-    }
+    size_t queued = atomic_load(&ddtrace_coms_globals.queued_bytes);
+    int64_t used = (((double)queued / (double)ddtrace_coms_globals.initial_stack_size) * 100);
+    return used > get_global_DD_TRACE_BETA_HIGH_MEMORY_PRESSURE_PERCENT();
 }
 
-/* Is called internally in the context of the PHP thread and actually attempts at storing the payload to send. If
- * there is not enough memory left in the currently active stack, it does not attempt to generate a new stack, instead
- * it returns a `ENOMEM` code that should be read by the invoker that can manually decide to ask for a larger stack.
+/* Is called by the PHP threads. Claims the next free slot with a single CAS on the enqueue position, so producers
+ * never wait on each other nor on the writer. Returns false if the queue is full, the payload is then not taken over.
  */
-static uint32_t _dd_store_data(group_id_t group_id, const char *src, size_t size) {
-    ddtrace_coms_stack_t *stack = atomic_load(&ddtrace_coms_globals.current_stack);
-    if (stack == NULL) {
-        // no stack to save data to
-        return ENOMEM;
+static bool _dd_coms_enqueue(char *data, size_t size) {
+    ddtrace_coms_queue_slot_t *slots = ddtrace_coms_globals.slots;
+    if (!slots) {
+        return false;
     }
 
-    size_t size_to_alloc = size + sizeof(size_t) + sizeof(group_id_t);
+    size_t mask = ddtrace_coms_globals.capacity - 1;
+    size_t position = atomic_load_explicit(&ddtrace_coms_globals.enqueue_position, memory_order_relaxed);
+    ddtrace_coms_queue_slot_t *slot;
+    for (;;) {
+        slot = &slots[position & mask];
+        size_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)sequence - (intptr_t)position;
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&ddtrace_coms_globals.enqueue_position, &position, position + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false;  // the writer has not consumed this slot yet: full
+        } else {
+            position = atomic_load_explicit(&ddtrace_coms_globals.enqueue_position, memory_order_relaxed);
+        }
+    }
 
-    atomic_fetch_add(&stack->refcount, 1);
+    slot->data = data;
+    slot->size = size;
+    atomic_store_explicit(&slot->sequence, position + 1, memory_order_release);
+    return true;
+}
 
-    size_t position = atomic_fetch_add(&stack->position, size_to_alloc);
-    if ((position + size_to_alloc) > stack->size) {
-        // allocation failed
-        atomic_fetch_sub(&stack->refcount, 1);
-        return ENOMEM;
+/* Only ever called from a single thread at a time: the writer, or the PHP thread after the writer is gone. */
+static bool _dd_coms_dequeue(char **data, size_t *size) {
+    ddtrace_coms_queue_slot_t *slots = ddtrace_coms_globals.slots;
+    if (!slots) {
+        return false;
     }
 
-    memcpy(stack->data + position, &size, sizeof(size_t));
-    position += sizeof(size_t);
+    size_t position = ddtrace_coms_globals.dequeue_position;
+    ddtrace_coms_queue_slot_t *slot = &slots[position & (ddtrace_coms_globals.capacity - 1)];
+    size_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+    if ((intptr_t)sequence - (intptr_t)(position + 1) < 0) {
+        return false;  // empty, or the producer of this slot is not done yet
+    }
 
-    memcpy(stack->data + position, &group_id, sizeof(group_id_t));
-    position += sizeof(group_id_t);
+    *data = slot->data;
+    *size = slot->size;
+    slot->data = NULL;
+    ddtrace_coms_globals.dequeue_position = position + 1;
+    atomic_store_explicit(&slot->sequence, position + ddtrace_coms_globals.capacity, memory_order_release);
 
-    memcpy(stack->data + position, src, size);
+    atomic_fetch_sub(&ddtrace_coms_globals.queued_bytes, *size);
+    return true;
+}
 
-    atomic_fetch_add(&stack->bytes_written, size_to_alloc);
-    atomic_fetch_sub(&stack->refcount, 1);
-    return 0;
+static void _dd_coms_account_dropped(size_t size) {
+    atomic_fetch_add(&ddtrace_coms_globals.dropped_traces, 1);
+    atomic_fetch_add(&ddtrace_coms_globals.dropped_bytes, size);
 }
 
-/* Allocates a new stack of the minimum possible size. Only if `min_size` (which is the size required by the user to
- * fit in a given payload) is larger than the currently active stack size, then new sizes are attempted attemptiong
- * to double at each iteration, up to `DDTRACE_COMS_STACK_MAX_SIZE`.
- * The rationale behind this is that once we know that at least one single trace can be larger than X bytes, then
- * all the subsequent stacks are allocated at least as large as that size.
+/* Client-side stats {{{
+ * The PHP threads count their spans into a shard of their own, without any synchronization, and push it onto the
+ * ddtrace_coms_globals.stats_shards stack once done with it. The writer merges the shards into a single one per
+ * bucket of time and sends the buckets which are over to the agent.
  */
-static ddtrace_coms_stack_t *_dd_new_stack(size_t min_size) {
-    size_t initial_size = atomic_load(&ddtrace_coms_globals.stack_size);
-    size_t size = initial_size;
-    while (min_size > size && size <= (ddtrace_coms_globals.max_payload_size/2)) {
-        size *= 2;
-    }
-    if (size != initial_size) {
-        // If we fail to update the global twice in a row, we can just rely on dynamic size allocation in the future
-        int i = 2;
-        while (!atomic_compare_exchange_weak(&ddtrace_coms_globals.stack_size, &initial_size, size) && i--) {
-            if (initial_size > size) {
-                size = initial_size;
-                break;
-            }
-        };
-    }
-    ddtrace_coms_stack_t *stack = calloc(1, sizeof(ddtrace_coms_stack_t));
-    stack->size = size;
-    stack->data = calloc(1, size);
-
-    return stack;
-}
+#define DD_STATS_BUCKET_DURATION UINT64_C(10000000000)
+#define DD_STATS_MAX_PENDING_SHARDS 1024
+#define DD_STATS_INITIAL_GROUP_CAPACITY 16
+
+// what the spans are aggregated by
+struct _dd_stats_key_t {
+    datadog_php_string_view service, name, resource, type;
+    uint32_t http_status_code;
+    bool synthetics;
+};
 
-static void _dd_coms_free_stack(ddtrace_coms_stack_t *stack) {
-    free(stack->data);
-    free(stack);
-}
+struct _dd_stats_group_t {
+    struct _dd_stats_key_t key;
+    uint32_t hash;
+    uint64_t hits, errors, top_level_hits, duration;
+    datadog_php_ddsketch ok_summary, error_summary;
+    char strings[];  // the key strings are copied here
+};
 
-static void _dd_recycle_stack(ddtrace_coms_stack_t *stack) {
-    char *data = stack->data;
-    size_t size = stack->size;
+struct ddtrace_coms_stats_shard_t {
+    ddtrace_coms_stats_shard_t *next;
+    uint64_t bucket_start;
+    // open addressing with linear probing, the capacity is a power of two
+    struct _dd_stats_group_t **groups;
+    uint32_t group_count, group_capacity;
+};
 
-    memset(stack, 0, sizeof(ddtrace_coms_stack_t));
-    memset(data, 0, size);
+static uint32_t _dd_stats_hash_bytes(uint32_t hash, const void *data, size_t size) {
+    // FNV-1a
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= ((const unsigned char *)data)[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
 
-    stack->data = data;
-    stack->size = size;
+static uint32_t _dd_stats_key_hash(const struct _dd_stats_key_t *key) {
+    uint32_t hash = 2166136261u;
+    hash = _dd_stats_hash_bytes(hash, key->service.ptr, key->service.len);
+    hash = _dd_stats_hash_bytes(hash, key->name.ptr, key->name.len);
+    hash = _dd_stats_hash_bytes(hash, key->resource.ptr, key->resource.len);
+    hash = _dd_stats_hash_bytes(hash, key->type.ptr, key->type.len);
+    hash = _dd_stats_hash_bytes(hash, &key->http_status_code, sizeof(key->http_status_code));
+    return _dd_stats_hash_bytes(hash, &key->synthetics, sizeof(key->synthetics));
 }
 
-static void (*_dd_ptr_at_exit_callback)(void) = 0;
+static bool _dd_stats_string_equals(datadog_php_string_view a, datadog_php_string_view b) {
+    return a.len == b.len && memcmp(a.ptr, b.ptr, a.len) == 0;
+}
 
-static void _dd_at_exit_callback() { ddtrace_coms_flush_shutdown_writer_synchronous(); }
+static bool _dd_stats_key_equals(const struct _dd_stats_key_t *a, const struct _dd_stats_key_t *b) {
+    return a->http_status_code == b->http_status_code && a->synthetics == b->synthetics &&
+           _dd_stats_string_equals(a->service, b->service) && _dd_stats_string_equals(a->name, b->name) &&
+           _dd_stats_string_equals(a->resource, b->resource) && _dd_stats_string_equals(a->type, b->type);
+}
 
-static void _dd_at_exit_hook() {
-    if (_dd_ptr_at_exit_callback) {
-        _dd_ptr_at_exit_callback();
+static ddtrace_coms_stats_shard_t *_dd_stats_shard_alloc(uint64_t bucket_start) {
+    ddtrace_coms_stats_shard_t *shard = calloc(1, sizeof(*shard));
+    if (!shard) {
+        return NULL;
     }
+    shard->groups = calloc(DD_STATS_INITIAL_GROUP_CAPACITY, sizeof(*shard->groups));
+    if (!shard->groups) {
+        free(shard);
+        return NULL;
+    }
+    shard->group_capacity = DD_STATS_INITIAL_GROUP_CAPACITY;
+    shard->bucket_start = bucket_start;
+    return shard;
 }
 
-bool ddtrace_coms_minit(size_t initial_stack_size, size_t max_stack_size, size_t max_backlog_size) {
-    ddtrace_coms_globals.initial_stack_size = initial_stack_size;
-    ddtrace_coms_globals.max_payload_size = max_stack_size;
-    ddtrace_coms_globals.max_backlog_size = max_backlog_size;
-
-    atomic_store(&ddtrace_coms_globals.stack_size, initial_stack_size);
-
-    ddtrace_coms_stack_t *stack = _dd_new_stack(initial_stack_size);
-    if (!ddtrace_coms_globals.stacks) {
-        ddtrace_coms_globals.stacks = calloc(max_backlog_size, sizeof(ddtrace_coms_stack_t *));
+void ddtrace_coms_stats_shard_free(ddtrace_coms_stats_shard_t *shard) {
+    for (uint32_t i = 0; i < shard->group_capacity; ++i) {
+        struct _dd_stats_group_t *group = shard->groups[i];
+        if (group) {
+            datadog_php_ddsketch_dtor(&group->ok_summary);
+            datadog_php_ddsketch_dtor(&group->error_summary);
+            free(group);
+        }
     }
+    free(shard->groups);
+    free(shard);
+}
 
-    atomic_store(&ddtrace_coms_globals.next_group_id, 1);
-    atomic_store(&ddtrace_coms_globals.current_stack, stack);
+static void _dd_stats_shard_list_free(ddtrace_coms_stats_shard_t *shard) {
+    while (shard) {
+        ddtrace_coms_stats_shard_t *next = shard->next;
+        ddtrace_coms_stats_shard_free(shard);
+        shard = next;
+    }
+}
 
-    _dd_ptr_at_exit_callback = _dd_at_exit_callback;
-    atexit(_dd_at_exit_hook);
+static struct _dd_stats_group_t **_dd_stats_shard_slot(ddtrace_coms_stats_shard_t *shard,
+                                                       const struct _dd_stats_key_t *key, uint32_t hash) {
+    uint32_t mask = shard->group_capacity - 1;
+    for (uint32_t i = hash & mask;; i = (i + 1) & mask) {
+        struct _dd_stats_group_t *group = shard->groups[i];
+        if (!group || (group->hash == hash && _dd_stats_key_equals(&group->key, key))) {
+            return &shard->groups[i];
+        }
+    }
+}
 
-    if (curl_global_init(CURL_GLOBAL_DEFAULT) != CURLE_OK) {
+static bool _dd_stats_shard_grow(ddtrace_coms_stats_shard_t *shard) {
+    uint32_t capacity = shard->group_capacity * 2;
+    struct _dd_stats_group_t **groups = calloc(capacity, sizeof(*groups));
+    if (!groups) {
         return false;
     }
-
+    for (uint32_t i = 0; i < shard->group_capacity; ++i) {
+        struct _dd_stats_group_t *group = shard->groups[i];
+        if (group) {
+            uint32_t slot = group->hash & (capacity - 1);
+            while (groups[slot]) {
+                slot = (slot + 1) & (capacity - 1);
+            }
+            groups[slot] = group;
+        }
+    }
+    free(shard->groups);
+    shard->groups = groups;
+    shard->group_capacity = capacity;
     return true;
 }
 
-void ddtrace_coms_mshutdown(void) { _dd_ptr_at_exit_callback = NULL; }
+static datadog_php_string_view _dd_stats_copy_string(char **buffer, datadog_php_string_view str) {
+    datadog_php_string_view copy = {str.len, *buffer};
+    memcpy(*buffer, str.ptr, str.len);
+    *buffer += str.len;
+    return copy;
+}
 
-static void _dd_coms_stack_shutdown(void) {
-    ddtrace_coms_stack_t *current_stack = atomic_load(&ddtrace_coms_globals.current_stack);
-    if (current_stack) {
-        if (current_stack->data) {
-            free(current_stack->data);
+// Returns the group of `key`, creating it if needed, or NULL on allocation failure
+static struct _dd_stats_group_t *_dd_stats_shard_group(ddtrace_coms_stats_shard_t *shard,
+                                                       const struct _dd_stats_key_t *key, uint32_t hash) {
+    struct _dd_stats_group_t **slot = _dd_stats_shard_slot(shard, key, hash);
+    if (*slot) {
+        return *slot;
+    }
+
+    // keep the load factor at most 1/2
+    if ((shard->group_count + 1) * 2 > shard->group_capacity) {
+        if (!_dd_stats_shard_grow(shard)) {
+            return NULL;
         }
-        free(current_stack);
-        ddtrace_coms_globals.current_stack = NULL;
+        slot = _dd_stats_shard_slot(shard, key, hash);
+    }
+
+    size_t strings_size = key->service.len + key->name.len + key->resource.len + key->type.len;
+    struct _dd_stats_group_t *group = calloc(1, sizeof(*group) + strings_size);
+    if (!group) {
+        return NULL;
+    }
+    char *strings = group->strings;
+    group->key.service = _dd_stats_copy_string(&strings, key->service);
+    group->key.name = _dd_stats_copy_string(&strings, key->name);
+    group->key.resource = _dd_stats_copy_string(&strings, key->resource);
+    group->key.type = _dd_stats_copy_string(&strings, key->type);
+    group->key.http_status_code = key->http_status_code;
+    group->key.synthetics = key->synthetics;
+    group->hash = hash;
+    datadog_php_ddsketch_ctor(&group->ok_summary);
+    datadog_php_ddsketch_ctor(&group->error_summary);
+
+    *slot = group;
+    ++shard->group_count;
+    return group;
+}
+
+void ddtrace_coms_stats_record(ddtrace_coms_stats_shard_t **shard, const ddtrace_coms_stats_span_t *span) {
+    uint64_t bucket_start = span->end - span->end % DD_STATS_BUCKET_DURATION;
+    if (*shard && (*shard)->bucket_start != bucket_start) {
+        ddtrace_coms_stats_submit(shard);
     }
-    if (ddtrace_coms_globals.stacks) {
-        free(ddtrace_coms_globals.stacks);
-        ddtrace_coms_globals.stacks = NULL;
+    if (!*shard && !(*shard = _dd_stats_shard_alloc(bucket_start))) {
+        return;
     }
-}
 
-#if 0
-static void printf_stack_info(ddtrace_coms_stack_t *stack) {
-    printf("stack (%p) refcount: (%d) bytes_written: (%lu)\n", stack, atomic_load(&stack->refcount),
-           atomic_load(&stack->bytes_written));
+    struct _dd_stats_key_t key = {
+        .service = span->service,
+        .name = span->name,
+        .resource = span->resource,
+        .type = span->type,
+        .http_status_code = span->http_status_code,
+        .synthetics = span->synthetics,
+    };
+    struct _dd_stats_group_t *group = _dd_stats_shard_group(*shard, &key, _dd_stats_key_hash(&key));
+    if (!group) {
+        return;
+    }
+
+    ++group->hits;
+    group->errors += span->error;
+    group->top_level_hits += span->top_level;
+    group->duration += span->duration;
+    datadog_php_ddsketch_add(span->error ? &group->error_summary : &group->ok_summary, (double)span->duration);
 }
-#endif
 
-static void _dd_unsafe_store_or_discard_stack(ddtrace_coms_stack_t *stack) {
-    for (size_t i = 0; i < ddtrace_coms_globals.max_backlog_size; i++) {
-        ddtrace_coms_stack_t *stack_tmp = ddtrace_coms_globals.stacks[i];
-        if (stack_tmp == stack) {
-            return;
-        }
+void ddtrace_coms_stats_submit(ddtrace_coms_stats_shard_t **shard) {
+    ddtrace_coms_stats_shard_t *submitted = *shard;
+    if (!submitted) {
+        return;
+    }
+    *shard = NULL;
 
-        if (stack_tmp == NULL) {
-            ddtrace_coms_globals.stacks[i] = stack;
-            return;
-        }
+    // the writer may not be running, do not pile up shards forever then
+    if (atomic_fetch_add(&ddtrace_coms_globals.stats_shard_count, 1) >= DD_STATS_MAX_PENDING_SHARDS) {
+        atomic_fetch_sub(&ddtrace_coms_globals.stats_shard_count, 1);
+        ddtrace_coms_stats_shard_free(submitted);
+        return;
     }
 
-    _dd_coms_free_stack(stack);
+    submitted->next = atomic_load(&ddtrace_coms_globals.stats_shards);
+    while (!atomic_compare_exchange_weak(&ddtrace_coms_globals.stats_shards, &submitted->next, submitted)) {
+    }
 }
 
-static void _dd_unsafe_cleanup_dirty_stack_area(void) {
-    ddtrace_coms_stack_t *current_stack = atomic_load(&ddtrace_coms_globals.current_stack);
-    if (!ddtrace_coms_globals.tmp_stack) {
+// Moves the counts of `shard` into the bucket covering the same time in `buckets`, a list sorted by time
+static void _dd_stats_merge_shard(ddtrace_coms_stats_shard_t **buckets, ddtrace_coms_stats_shard_t *shard) {
+    while (*buckets && (*buckets)->bucket_start < shard->bucket_start) {
+        buckets = &(*buckets)->next;
+    }
+    if (!*buckets || (*buckets)->bucket_start != shard->bucket_start) {
+        // the first shard of its bucket becomes the bucket
+        shard->next = *buckets;
+        *buckets = shard;
         return;
     }
 
-    if (ddtrace_coms_globals.tmp_stack != current_stack) {
-        ddtrace_coms_stack_t *stack = ddtrace_coms_globals.tmp_stack;
-
-        atomic_store(&stack->refcount, 0);
-        _dd_unsafe_store_or_discard_stack(stack);
+    ddtrace_coms_stats_shard_t *bucket = *buckets;
+    for (uint32_t i = 0; i < shard->group_capacity; ++i) {
+        struct _dd_stats_group_t *group = shard->groups[i], *target;
+        if (group && (target = _dd_stats_shard_group(bucket, &group->key, group->hash))) {
+            target->hits += group->hits;
+            target->errors += group->errors;
+            target->top_level_hits += group->top_level_hits;
+            target->duration += group->duration;
+            datadog_php_ddsketch_merge(&target->ok_summary, &group->ok_summary);
+            datadog_php_ddsketch_merge(&target->error_summary, &group->error_summary);
+        }
     }
-    ddtrace_coms_globals.tmp_stack = NULL;
+    ddtrace_coms_stats_shard_free(shard);
 }
 
-/* Stores the global current stack (if any) into the global `stacks` array. The writer will pick from this array when
- * sending payloads to the backend. This function is invoked when a global current stack is "filled enough" to be sent
- * to the backend.
- * This function has a side effect: it tries to save memory by using as the "next" global current stack one of the
- * stacks in the global `stack` array mentioned above. This is possible if a payload contained in one of the elements of
- * the array has already been sent to the backend and, as a consequence, that element is ready for reuse. Keep in mind
- * that in order to be ready for reuse it has to be at least of size `min_size`.
- * It is possible that the global current stack is set to `NULL` by this function. In this case it means that there were
- * no available existing stacks that could store `min_size` bytes and it is the invoker's own responsibility to allocate
- * a new stack of the desired size and assign it to the global current stack.
- */
-static void _dd_unsafe_store_or_swap_current_stack_for_empty_stack(size_t min_size) {
-    _dd_unsafe_cleanup_dirty_stack_area();
+// Is called by the writer to take over all the submitted shards
+static void _dd_stats_collect_shards(ddtrace_coms_stats_shard_t **buckets) {
+    ddtrace_coms_stats_shard_t *shard = atomic_exchange(&ddtrace_coms_globals.stats_shards, NULL);
+    while (shard) {
+        ddtrace_coms_stats_shard_t *next = shard->next;
+        atomic_fetch_sub(&ddtrace_coms_globals.stats_shard_count, 1);
+        _dd_stats_merge_shard(buckets, shard);
+        shard = next;
+    }
+}
+/* }}} */
 
-    // store the temp variable if we ever need to recover it
-    ddtrace_coms_stack_t **current_stack = &ddtrace_coms_globals.tmp_stack;
+static void (*_dd_ptr_at_exit_callback)(void) = 0;
 
-    *current_stack = atomic_load(&ddtrace_coms_globals.current_stack);
+static void _dd_at_exit_callback() { ddtrace_coms_flush_shutdown_writer_synchronous(); }
 
-    if (*current_stack && (*current_stack)->size >= min_size && ddtrace_coms_is_stack_free(*current_stack)) {
-        *current_stack = NULL;
-        return;  // stack is empty and unusued - no need to swap it out
+static void _dd_at_exit_hook() {
+    if (_dd_ptr_at_exit_callback) {
+        _dd_ptr_at_exit_callback();
     }
+}
 
-    if (*current_stack) {
-        // try to swap out current stack for an empty stack
-        for (size_t i = 0; i < ddtrace_coms_globals.max_backlog_size; i++) {
-            ddtrace_coms_stack_t *stack_tmp = ddtrace_coms_globals.stacks[i];
-            if (stack_tmp && stack_tmp->size >= min_size && ddtrace_coms_is_stack_free(stack_tmp)) {
-                // order is important due to ability to restore state on thread restart
-                _dd_recycle_stack(stack_tmp);
-                atomic_store(&ddtrace_coms_globals.current_stack, stack_tmp);
-                ddtrace_coms_globals.stacks[i] = *current_stack;
+bool ddtrace_coms_minit(size_t initial_stack_size, size_t max_payload_size, size_t max_backlog_size) {
+    ddtrace_coms_globals.initial_stack_size = initial_stack_size;
+    ddtrace_coms_globals.max_payload_size = max_payload_size;
+    ddtrace_coms_globals.max_backlog_size = max_backlog_size;
 
-                *current_stack = NULL;
-                break;
-            }
+    // Allow for at least one full agent request worth of traces to be queued
+    ddtrace_coms_globals.max_queued_bytes = initial_stack_size * max_backlog_size;
+    if (ddtrace_coms_globals.max_queued_bytes < max_payload_size) {
+        ddtrace_coms_globals.max_queued_bytes = max_payload_size;
+    }
+
+    if (!ddtrace_coms_globals.slots) {
+        size_t capacity = 1;
+        while (capacity < (max_backlog_size ? max_backlog_size : 1) * DDTRACE_COMS_SLOTS_PER_BACKLOG_ENTRY) {
+            capacity <<= 1;
+        }
+        ddtrace_coms_globals.slots = calloc(capacity, sizeof(ddtrace_coms_queue_slot_t));
+        ddtrace_coms_globals.capacity = capacity;
+        for (size_t i = 0; i < capacity; ++i) {
+            atomic_init(&ddtrace_coms_globals.slots[i].sequence, i);
         }
+        atomic_store(&ddtrace_coms_globals.enqueue_position, 0);
+        ddtrace_coms_globals.dequeue_position = 0;
+        atomic_store(&ddtrace_coms_globals.queued_bytes, 0);
     }
 
-    // if we couldn't swap for a empty stack lets store it
-    if (*current_stack) {
-        for (size_t i = 0; i < ddtrace_coms_globals.max_backlog_size; i++) {
-            ddtrace_coms_stack_t *stack_tmp = ddtrace_coms_globals.stacks[i];
-            if (!stack_tmp) {
-                atomic_store(&ddtrace_coms_globals.current_stack, NULL);
-                ddtrace_coms_globals.stacks[i] = *current_stack;
-                *current_stack = NULL;
+    atomic_store(&ddtrace_coms_globals.dropped_traces, 0);
+    atomic_store(&ddtrace_coms_globals.dropped_bytes, 0);
+    atomic_store(&ddtrace_coms_globals.next_group_id, 1);
 
-                break;
-            }
-        }
+    _dd_ptr_at_exit_callback = _dd_at_exit_callback;
+    atexit(_dd_at_exit_hook);
+
+    if (curl_global_init(CURL_GLOBAL_DEFAULT) != CURLE_OK) {
+        return false;
     }
 
-    *current_stack = NULL;
+    return true;
 }
 
-static bool _dd_coms_unsafe_rotate_stack(bool attempt_allocate_new, size_t min_size) {
-    _dd_unsafe_store_or_swap_current_stack_for_empty_stack(min_size);
-
-    ddtrace_coms_stack_t *current_stack = atomic_load(&ddtrace_coms_globals.current_stack);
+void ddtrace_coms_mshutdown(void) { _dd_ptr_at_exit_callback = NULL; }
 
-    /* In this case we are reusing a stack (from the global `stacks` array) that has been already sent and was
-     * recycled, and `current_stack` is just a pointer to one of `<global>.stacks[i]`.
-     */
-    if (current_stack && current_stack->size >= min_size && ddtrace_coms_is_stack_free(current_stack)) {
-        return true;
+static void _dd_coms_queue_shutdown(void) {
+    char *data;
+    size_t size;
+    while (_dd_coms_dequeue(&data, &size)) {
+        free(data);
     }
 
-    /* In this case it wasn't possible to reuse an existing stack, for one of two reasons:
-     *   1. All the N currently allocated stacks (with N <= `DDTRACE_COMS_STACKS_BACKLOG_SIZE`) are filled and waiting
-     *      to be sent by the writer; or
-     *   2. None of the available stacks in the global `stacks` array that could be reused has size >= `min_size`.
-     */
-    if (!current_stack) {
-        if (attempt_allocate_new) {
-            ddtrace_coms_stack_t **next_stack = &ddtrace_coms_globals.tmp_stack;
-            *next_stack = _dd_new_stack(min_size);
-            atomic_store(&ddtrace_coms_globals.current_stack, *next_stack);
-            *next_stack = NULL;
-            return true;
-        }
-    }
+    free(ddtrace_coms_globals.slots);
+    ddtrace_coms_globals.slots = NULL;
 
-    // we couldn't store old stack or allocate a new one so we cannot provide new empty stack
-    return false;
+    _dd_stats_shard_list_free(atomic_exchange(&ddtrace_coms_globals.stats_shards, NULL));
+    atomic_store(&ddtrace_coms_globals.stats_shard_count, 0);
 }
 
+/* The traces sent in a single request to the agent. The read callback streams them straight from their buffers. */
+struct _trace_batch_t {
+    struct {
+        char *data;
+        size_t size;
+    } * traces;
+    size_t count, capacity, total_bytes;
+
+    bool header_written;
+    size_t trace, position;
+
+    // gzip state, only used with DD_TRACE_AGENT_COMPRESSION_ENABLED
+    z_stream zstream;
+    bool zstream_initialized, compression_finished;
+    char array_header[5];
+};
+
+// string dictionary and scratch space to transcode batches into the v0.5 format
+struct _dd_v05_encoder_t {
+    datadog_php_string_table strings;
+    struct {
+        uint32_t key, value;
+    } * meta;
+    struct {
+        uint32_t key;
+        double value;
+    } * metrics;
+    uint32_t meta_capacity, metrics_capacity;
+};
+
 struct _writer_thread_variables_t {
     pthread_t self;
-    pthread_mutex_t interval_flush_mutex, finished_flush_mutex, stack_rotation_mutex;
+    pthread_mutex_t interval_flush_mutex, finished_flush_mutex;
     pthread_mutex_t writer_shutdown_signal_mutex;
     pthread_cond_t writer_shutdown_signal_condition;
     pthread_cond_t interval_flush_condition, finished_flush_condition;
@@ -320,8 +479,23 @@ struct _writer_thread_variables_t {
 
 struct _writer_loop_data_t {
     CURL *curl;
+    pid_t curl_pid;
     _Atomic(struct curl_slist *)headers;
-    ddtrace_coms_stack_t *tmp_stack;
+    // last element of the headers list, owned by the writer and rewritten in place for every request
+    struct curl_slist trace_count_header;
+    char trace_count_header_buffer[64];
+    struct _trace_batch_t batch;
+    char *pending_data;
+    size_t pending_size;
+    struct _dd_v05_encoder_t v05_encoder;
+    bool url_v05;
+    // the client-side stats merged from the submitted shards, one per bucket and sorted by time
+    ddtrace_coms_stats_shard_t *stats_buckets;
+    uint64_t stats_sequence;
+    // kept like curl, so that the stats reuse their own connection to the agent
+    CURL *stats_curl;
+    pid_t stats_curl_pid;
+    struct curl_slist *stats_headers;
 
     struct _writer_thread_variables_t *thread;
 
@@ -329,8 +503,8 @@ struct _writer_loop_data_t {
 
     _Atomic(bool) running, starting_up;
     _Atomic(pid_t) current_pid;
-    _Atomic(bool) shutdown_when_idle, suspended, sending, allocate_new_stacks;
-    _Atomic(uint32_t) flush_interval, request_counter, flush_processed_stacks_total, writer_cycle,
+    _Atomic(bool) shutdown_when_idle, suspended, sending, flush_stats;
+    _Atomic(uint32_t) flush_interval, request_counter, flush_processed_batches_total, writer_cycle,
         requests_since_last_flush;
 };
 
@@ -340,23 +514,14 @@ static struct _writer_loop_data_t global_writer = {.thread = NULL,
                                                    .current_pid = ATOMIC_VAR_INIT(0),
                                                    .shutdown_when_idle = ATOMIC_VAR_INIT(0),
                                                    .suspended = ATOMIC_VAR_INIT(0),
-                                                   .allocate_new_stacks = ATOMIC_VAR_INIT(0),
                                                    .sending = ATOMIC_VAR_INIT(0)};
 
 static struct _writer_loop_data_t *_dd_get_writer() { return &global_writer; }
 
-static bool ddtrace_coms_threadsafe_rotate_stack(bool attempt_allocate_new, size_t min_size) {
-    struct _writer_loop_data_t *writer = _dd_get_writer();
-    bool rv = false;
-    if (writer->thread) {
-        pthread_mutex_lock(&writer->thread->stack_rotation_mutex);
-        rv = _dd_coms_unsafe_rotate_stack(attempt_allocate_new, min_size);
-        pthread_mutex_unlock(&writer->thread->stack_rotation_mutex);
-    }
-    return rv;
-}
-
 bool ddtrace_coms_buffer_data(uint32_t group_id, const char *data, size_t size) {
+    // Every payload is a complete trace with its own slot, there is nothing to regroup anymore
+    UNUSED(group_id);
+
     if (!data || size > ddtrace_coms_globals.max_payload_size) {
         return false;
     }
@@ -368,32 +533,38 @@ bool ddtrace_coms_buffer_data(uint32_t group_id, const char *data, size_t size)
         }
     }
 
-    uint32_t store_result = _dd_store_data(group_id, data, size);
+    size_t queued = atomic_fetch_add(&ddtrace_coms_globals.queued_bytes, size);
+    if (queued > 0 && queued + size > ddtrace_coms_globals.max_queued_bytes) {
+        atomic_fetch_sub(&ddtrace_coms_globals.queued_bytes, size);
+        _dd_coms_account_dropped(size);
+        ddtrace_coms_trigger_writer_flush();
+        return false;
+    }
 
-    if (_dd_is_memory_pressure_high()) {
+    char *copy = malloc(size);
+    if (!copy) {
+        atomic_fetch_sub(&ddtrace_coms_globals.queued_bytes, size);
+        _dd_coms_account_dropped(size);
+        return false;
+    }
+    memcpy(copy, data, size);
+    if (!_dd_coms_enqueue(copy, size)) {
+        free(copy);
+        atomic_fetch_sub(&ddtrace_coms_globals.queued_bytes, size);
+        _dd_coms_account_dropped(size);
         ddtrace_coms_trigger_writer_flush();
+        return false;
     }
 
-    if (store_result == ENOMEM) {
-        size_t padding = 2;
-        ddtrace_coms_threadsafe_rotate_stack(true, size + padding);
+    if (_dd_is_memory_pressure_high()) {
         ddtrace_coms_trigger_writer_flush();
-        store_result = _dd_store_data(group_id, data, size);
     }
 
-    return store_result == 0;
+    return true;
 }
 
 group_id_t ddtrace_coms_next_group_id(void) { return atomic_fetch_add(&ddtrace_coms_globals.next_group_id, 1); }
 
-struct _grouped_stack_t {
-    size_t position, total_bytes, total_groups;
-    size_t bytes_to_write;
-
-    char *dest_data;
-    size_t dest_size;
-};
-
 static size_t _dd_write_array_header(char *buffer, size_t buffer_size, size_t position, uint32_t array_size) {
     size_t free_space = buffer_size - position;
     char *data = buffer + position;
@@ -419,245 +590,391 @@ static size_t _dd_write_array_header(char *buffer, size_t buffer_size, size_t po
     return 0;
 }
 
-static size_t _dd_write_to_buffer(char *buffer, size_t buffer_size, size_t position, struct _grouped_stack_t *read) {
-    size_t write_size = read->bytes_to_write;
-    if (write_size > 0) {
-        if (write_size > (buffer_size - position)) {
-            write_size = buffer_size - position;
-        }
-        if (write_size > (read->total_bytes - read->position)) {
-            write_size = read->total_bytes - read->position;
-        }
+static size_t _dd_coms_read_callback(char *buffer, size_t size, size_t nitems, void *userdata) {
+    if (!userdata) {
+        return 0;
+    }
+    struct _trace_batch_t *read = userdata;
 
-        memcpy(buffer + position, read->dest_data + read->position, write_size);
+    size_t written = 0;
+    size_t buffer_size = size * nitems;
 
-        read->position += write_size;
-        read->bytes_to_write -= write_size;
+    if (!read->header_written) {
+        written += _dd_write_array_header(buffer, buffer_size, written, read->count);
+        read->header_written = true;
     }
 
-    return write_size;
-}
-
-static bool _dd_ensure_correct_dest_capacity(struct _grouped_stack_t *dest, size_t position, size_t write_size) {
-    size_t requested_size = position + write_size;
+    while (written < buffer_size && read->trace < read->count) {
+        size_t remaining = read->traces[read->trace].size - read->position;
+        size_t write_size = buffer_size - written;
+        if (write_size > remaining) {
+            write_size = remaining;
+        }
 
-    if (requested_size > dest->dest_size) {
-        requested_size += requested_size / 10;  // addd 10% to reduce possible reallocations on next data chunk
+        memcpy(buffer + written, read->traces[read->trace].data + read->position, write_size);
+        written += write_size;
+        read->position += write_size;
 
-        char *new_ptr = realloc(dest->dest_data, requested_size);
-        if (new_ptr) {
-            dest->dest_data = new_ptr;
-            dest->dest_size = requested_size;
-        } else {
-            return false;
+        if (read->position == read->traces[read->trace].size) {
+            ++read->trace;
+            read->position = 0;
         }
     }
 
-    return true;
+    return written;
 }
 
-static void _dd_write_metadata(struct _grouped_stack_t *dest, size_t position, size_t elements_in_group,
-                               size_t bytes_in_group) {
-    _dd_ensure_correct_dest_capacity(dest, position, sizeof(size_t) * 2);
+/* Same stream as _dd_coms_read_callback, deflated on the fly: the trace buffers are fed to zlib as they are, so the
+ * uncompressed payload is never copied into an intermediate buffer.
+ */
+static size_t _dd_coms_read_gzip_callback(char *buffer, size_t size, size_t nitems, void *userdata) {
+    if (!userdata) {
+        return 0;
+    }
+    struct _trace_batch_t *read = userdata;
+    z_stream *stream = &read->zstream;
+
+    stream->next_out = (Bytef *)buffer;
+    stream->avail_out = (uInt)(size * nitems);
+
+    while (stream->avail_out > 0 && !read->compression_finished) {
+        if (stream->avail_in == 0) {
+            if (!read->header_written) {
+                stream->next_in = (Bytef *)read->array_header;
+                stream->avail_in = (uInt)_dd_write_array_header(read->array_header, sizeof(read->array_header), 0,
+                                                                read->count);
+                read->header_written = true;
+            } else if (read->trace < read->count) {
+                stream->next_in = (Bytef *)read->traces[read->trace].data;
+                stream->avail_in = (uInt)read->traces[read->trace].size;
+                ++read->trace;
+            }
+        }
 
-    memcpy(dest->dest_data + position, &elements_in_group, sizeof(size_t));
-    position += sizeof(size_t);
-    memcpy(dest->dest_data + position, &bytes_in_group, sizeof(size_t));
-}
+        int flush = read->header_written && read->trace == read->count ? Z_FINISH : Z_NO_FLUSH;
+        int ret = deflate(stream, flush);
+        if (ret == Z_STREAM_END) {
+            read->compression_finished = true;
+        } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+            ddtrace_bgs_logf("[bgs] gzip compression failed (%d) - aborting the current request\n", ret);
+            return CURL_READFUNC_ABORT;
+        }
+    }
 
-static void _dd_read_metadata(struct _grouped_stack_t *dest, size_t position, size_t *elements_in_group,
-                              size_t *bytes_in_group) {
-    memcpy(elements_in_group, dest->dest_data + position, sizeof(size_t));
+    return (size * nitems) - stream->avail_out;
+}
 
-    position += sizeof(size_t);
-    memcpy(bytes_in_group, dest->dest_data + position, sizeof(size_t));
+static bool _dd_batch_start_compression(struct _trace_batch_t *batch) {
+    int ret;
+    if (batch->zstream_initialized) {
+        ret = deflateReset(&batch->zstream);
+    } else {
+        batch->zstream = (z_stream){0};
+        // windowBits + 16 selects the gzip wrapper; the fastest level already shrinks msgpack traces a lot and keeps
+        // the writer thread cheap
+        ret = deflateInit2(&batch->zstream, Z_BEST_SPEED, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+        batch->zstream_initialized = ret == Z_OK;
+    }
+    batch->compression_finished = false;
+    return ret == Z_OK;
 }
 
-static size_t _dd_coms_read_callback(char *buffer, size_t size, size_t nitems, void *userdata) {
-    if (!userdata) {
-        return 0;
+// Takes ownership of data, which is dropped if the batch cannot grow
+static bool _dd_batch_append(struct _trace_batch_t *batch, char *data, size_t size) {
+    if (batch->count == batch->capacity) {
+        size_t capacity = batch->capacity ? batch->capacity * 2 : 16;
+        void *traces = realloc(batch->traces, capacity * sizeof(*batch->traces));
+        if (!traces) {
+            free(data);
+            _dd_coms_account_dropped(size);
+            return false;
+        }
+        batch->traces = traces;
+        batch->capacity = capacity;
     }
-    struct _grouped_stack_t *read = userdata;
-
-    size_t written = 0;
-    size_t buffer_size = size * nitems;
+    batch->traces[batch->count].data = data;
+    batch->traces[batch->count].size = size;
+    ++batch->count;
+    batch->total_bytes += size;
+    return true;
+}
 
-    if (read->total_groups > 0) {
-        written += _dd_write_array_header(buffer, buffer_size, written, read->total_groups);
-        read->total_groups = 0;
+/* Takes traces off the queue until the next one would push the request over the max payload size. That trace is kept
+ * in `pending` for the next batch, as the queue does not allow peeking.
+ */
+static bool _dd_batch_fill(struct _trace_batch_t *batch, char **pending_data, size_t *pending_size) {
+    if (*pending_data) {
+        _dd_batch_append(batch, *pending_data, *pending_size);
+        *pending_data = NULL;
     }
 
-    // write the remainder from previous iteration
-    written += _dd_write_to_buffer(buffer, buffer_size, written, read);
-
-    while (written < buffer_size) {
-        // safe read size  check position + metadata
-        if ((read->position + sizeof(size_t) * 2) > read->total_bytes) {
+    char *data;
+    size_t size;
+    while (_dd_coms_dequeue(&data, &size)) {
+        if (batch->count > 0 && batch->total_bytes + size > ddtrace_coms_globals.max_payload_size) {
+            *pending_data = data;
+            *pending_size = size;
             break;
         }
-        size_t num_elements = 0;
+        _dd_batch_append(batch, data, size);
+    }
 
-        _dd_read_metadata(read, read->position, &num_elements, &read->bytes_to_write);
-        if (read->bytes_to_write == 0) {
-            break;
-        }
-        // written += _dd_write_array_header(buffer, buffer_size, written, num_elements);
-        read->position += sizeof(size_t) * 2;
+    return batch->count > 0;
+}
 
-        written += _dd_write_to_buffer(buffer, buffer_size, written, read);
+static void _dd_batch_reset(struct _trace_batch_t *batch) {
+    for (size_t i = 0; i < batch->count; ++i) {
+        free(batch->traces[i].data);
     }
+    batch->count = 0;
+    batch->total_bytes = 0;
+    batch->header_written = false;
+    batch->trace = 0;
+    batch->position = 0;
+}
 
-    return written;
+static void _dd_batch_free(struct _trace_batch_t *batch) {
+    _dd_batch_reset(batch);
+    if (batch->zstream_initialized) {
+        deflateEnd(&batch->zstream);
+        batch->zstream_initialized = false;
+    }
+    free(batch->traces);
+    batch->traces = NULL;
+    batch->capacity = 0;
 }
 
-struct _entry_t {
-    size_t size;
-    group_id_t group_id;
-    size_t next_entry_offset;
-    char *data;
-    char *raw_entry;
+/* The agent's v0.5 format replaces every string of the payload by its index in a dictionary sent upfront:
+ *   [[string, ...], [[[service, name, resource, trace_id, span_id, parent_id, start, duration, error, {meta},
+ *   {metrics}, type], ...], ...]]
+ * The traces are encoded in v0.4 by the PHP threads, they are transcoded here for a whole batch at once so that the
+ * dictionary is shared by all the traces of a request.
+ */
+struct _dd_v05_span_t {
+    uint32_t service, name, resource, type;
+    uint64_t trace_id, span_id, parent_id;
+    int64_t start, duration;
+    int32_t error;
+    uint32_t meta_count, metrics_count;
 };
 
-static struct _entry_t _dd_create_entry(ddtrace_coms_stack_t *stack, size_t position) {
-    struct _entry_t rv = {.size = 0, .group_id = 0, .data = NULL, .next_entry_offset = 0};
-    size_t bytes_written = atomic_load(&stack->bytes_written);
-
-    if ((position + sizeof(size_t) + sizeof(group_id_t)) > bytes_written) {
-        // wrong size available skip this entry
-        return rv;
+static uint32_t _dd_v05_expect_string(struct _dd_v05_encoder_t *encoder, mpack_reader_t *reader) {
+    mpack_tag_t tag = mpack_read_tag(reader);
+    if (mpack_tag_type(&tag) != mpack_type_str) {
+        mpack_reader_flag_error(reader, mpack_error_type);
+        return 0;
     }
-    rv.raw_entry = stack->data + position;  // set pointer to beginning of the whole entry containing metadata
-
-    memcpy(&rv.size, stack->data + position, sizeof(size_t));
-    position += sizeof(size_t);
-
-    memcpy(&rv.group_id, stack->data + position, sizeof(group_id_t));
-    position += sizeof(group_id_t);
-
-    if (rv.size > 0 && (rv.size + position) <= bytes_written) {
-        // size is valid - save entry
-        rv.data = stack->data + position;
-        rv.next_entry_offset = sizeof(size_t) + sizeof(group_id_t) + rv.size;
+    uint32_t len = mpack_tag_str_length(&tag);
+    const char *ptr = mpack_read_bytes_inplace(reader, len);
+    mpack_done_str(reader);
+    if (mpack_reader_error(reader) != mpack_ok) {
+        return 0;
     }
-    return rv;
-}
-
-static void _dd_mark_entry_as_processed(struct _entry_t *entry) {
-    group_id_t processed_special_id = GROUP_ID_PROCESSED;
-    memcpy(entry->raw_entry + sizeof(size_t), &processed_special_id, sizeof(group_id_t));
-}
 
-static size_t _dd_append_entry(struct _entry_t *entry, struct _grouped_stack_t *dest, size_t position) {
-    if (_dd_ensure_correct_dest_capacity(dest, position, entry->size)) {
-        memcpy(dest->dest_data + position, entry->data, entry->size);
-        return entry->size;
-    } else {
+    // the views point into the trace buffers, which outlive the string table of the batch
+    datadog_php_string_view str = {len, ptr ? ptr : ""};
+    uint32_t index = datadog_php_string_table_intern(&encoder->strings, str);
+    if (index == DATADOG_PHP_STRING_TABLE_INVALID_INDEX) {
+        mpack_reader_flag_error(reader, mpack_error_memory);
         return 0;
     }
+    return index;
 }
 
-static void _dd_msgpack_group_stack_by_id(ddtrace_coms_stack_t *stack, struct _grouped_stack_t *dest) {
-    // perform an insertion sort by group_id
-    uint32_t current_group_id = 0;
-    struct _entry_t first_entry = _dd_create_entry(stack, 0);
-    dest->total_bytes = 0;
-    dest->total_groups = 0;
-
-    if (!first_entry.data) {
-        return;  // no entries
+static bool _dd_v05_reserve(void **data, uint32_t *capacity, uint32_t count, size_t element_size) {
+    if (count > *capacity) {
+        void *grown = realloc(*data, count * element_size);
+        if (!grown) {
+            return false;
+        }
+        *data = grown;
+        *capacity = count;
     }
+    return true;
+}
 
-    struct _entry_t next_group_entry = first_entry;
-
-    current_group_id = first_entry.group_id;
-    dest->total_groups++;
-    size_t current_src_beginning = 0, next_src_beginning = 0, group_dest_beginning_position = 0;
-
-    size_t bytes_written = atomic_load(&stack->bytes_written);
+static bool _dd_v05_transcode_span(struct _dd_v05_encoder_t *encoder, mpack_reader_t *reader, mpack_writer_t *writer) {
+    // unset strings are the empty string, which is interned first
+    struct _dd_v05_span_t span = {0};
 
-    while (current_src_beginning < bytes_written) {
-        size_t current_src_position = current_src_beginning;
-        size_t group_dest_position = group_dest_beginning_position;
+    uint32_t fields = mpack_expect_map(reader);
+    for (uint32_t i = 0; i < fields && mpack_reader_error(reader) == mpack_ok; ++i) {
+        char key[16];
+        size_t key_len = mpack_expect_str_buf(reader, key, sizeof(key));
+        if (mpack_reader_error(reader) != mpack_ok) {
+            // also covers unknown keys longer than any field name
+            return false;
+        }
 
-        // group metadata
-        size_t elements_in_group = 0;
-        size_t bytes_in_group = 0;
-        group_dest_position += sizeof(size_t) * 2;  // leave place for group meta data
-        size_t i = 0;
-        while (current_src_position < bytes_written) {
-            struct _entry_t entry = _dd_create_entry(stack, current_src_position);
-            i++;
-            if (entry.size == 0) {
-                break;
+#define DD_V05_KEY_IS(name) (key_len == sizeof(name) - 1 && memcmp(key, name, sizeof(name) - 1) == 0)
+        if (DD_V05_KEY_IS("trace_id")) {
+            span.trace_id = mpack_expect_u64(reader);
+        } else if (DD_V05_KEY_IS("span_id")) {
+            span.span_id = mpack_expect_u64(reader);
+        } else if (DD_V05_KEY_IS("parent_id")) {
+            span.parent_id = mpack_expect_u64(reader);
+        } else if (DD_V05_KEY_IS("start")) {
+            span.start = mpack_expect_i64(reader);
+        } else if (DD_V05_KEY_IS("duration")) {
+            span.duration = mpack_expect_i64(reader);
+        } else if (DD_V05_KEY_IS("error")) {
+            span.error = mpack_expect_i32(reader);
+        } else if (DD_V05_KEY_IS("name")) {
+            span.name = _dd_v05_expect_string(encoder, reader);
+        } else if (DD_V05_KEY_IS("resource")) {
+            span.resource = _dd_v05_expect_string(encoder, reader);
+        } else if (DD_V05_KEY_IS("service")) {
+            span.service = _dd_v05_expect_string(encoder, reader);
+        } else if (DD_V05_KEY_IS("type")) {
+            span.type = _dd_v05_expect_string(encoder, reader);
+        } else if (DD_V05_KEY_IS("meta")) {
+            span.meta_count = mpack_expect_map(reader);
+            if (!_dd_v05_reserve((void **)&encoder->meta, &encoder->meta_capacity, span.meta_count,
+                                 sizeof(*encoder->meta))) {
+                mpack_reader_flag_error(reader, mpack_error_memory);
+                return false;
             }
-
-            if (entry.group_id == current_group_id) {
-                size_t copied = _dd_append_entry(&entry, dest, group_dest_position);
-                if (copied > 0) {
-                    _dd_mark_entry_as_processed(&entry);
-                    elements_in_group++;
-                    group_dest_position += copied;
-                    bytes_in_group += copied;
-                }
-            } else if (next_group_entry.group_id == current_group_id && entry.group_id != GROUP_ID_PROCESSED) {
-                dest->total_groups++;  // add unique group count
-                next_group_entry = entry;
-                next_src_beginning = current_src_position;
+            for (uint32_t j = 0; j < span.meta_count && mpack_reader_error(reader) == mpack_ok; ++j) {
+                encoder->meta[j].key = _dd_v05_expect_string(encoder, reader);
+                encoder->meta[j].value = _dd_v05_expect_string(encoder, reader);
+            }
+            mpack_done_map(reader);
+        } else if (DD_V05_KEY_IS("metrics")) {
+            span.metrics_count = mpack_expect_map(reader);
+            if (!_dd_v05_reserve((void **)&encoder->metrics, &encoder->metrics_capacity, span.metrics_count,
+                                 sizeof(*encoder->metrics))) {
+                mpack_reader_flag_error(reader, mpack_error_memory);
+                return false;
             }
-            current_src_position += entry.next_entry_offset;
+            for (uint32_t j = 0; j < span.metrics_count && mpack_reader_error(reader) == mpack_ok; ++j) {
+                encoder->metrics[j].key = _dd_v05_expect_string(encoder, reader);
+                encoder->metrics[j].value = mpack_expect_double(reader);
+            }
+            mpack_done_map(reader);
+        } else {
+            // e.g. meta_struct, which cannot be represented in v0.5
+            mpack_reader_flag_error(reader, mpack_error_data);
+            return false;
         }
+#undef DD_V05_KEY_IS
+    }
+    mpack_done_map(reader);
 
-        _dd_write_metadata(dest, group_dest_beginning_position, elements_in_group, bytes_in_group);
-        group_dest_beginning_position = group_dest_position;
+    if (mpack_reader_error(reader) != mpack_ok) {
+        return false;
+    }
 
-        // no new groups - exit loop
-        if (next_group_entry.group_id == current_group_id) {
-            break;
-        }
+    mpack_start_array(writer, 12);
+    mpack_write_u32(writer, span.service);
+    mpack_write_u32(writer, span.name);
+    mpack_write_u32(writer, span.resource);
+    mpack_write_u64(writer, span.trace_id);
+    mpack_write_u64(writer, span.span_id);
+    mpack_write_u64(writer, span.parent_id);
+    mpack_write_i64(writer, span.start);
+    mpack_write_i64(writer, span.duration);
+    mpack_write_i32(writer, span.error);
+    mpack_start_map(writer, span.meta_count);
+    for (uint32_t j = 0; j < span.meta_count; ++j) {
+        mpack_write_u32(writer, encoder->meta[j].key);
+        mpack_write_u32(writer, encoder->meta[j].value);
+    }
+    mpack_finish_map(writer);
+    mpack_start_map(writer, span.metrics_count);
+    for (uint32_t j = 0; j < span.metrics_count; ++j) {
+        mpack_write_u32(writer, encoder->metrics[j].key);
+        mpack_write_double(writer, encoder->metrics[j].value);
+    }
+    mpack_finish_map(writer);
+    mpack_write_u32(writer, span.type);
+    mpack_finish_array(writer);
 
-        current_group_id = next_group_entry.group_id;
-        current_src_beginning = next_src_beginning;
-    }
-    dest->total_bytes = group_dest_beginning_position;  // save total bytes count after conversion
+    return true;
 }
 
-static void *_dd_init_read_userdata(ddtrace_coms_stack_t *stack) {
-    size_t total_bytes = atomic_load(&stack->bytes_written);
+/* On success the traces of the batch are replaced by the v0.5 payload, which is then streamed as is. On failure the
+ * batch is left untouched and is sent in v0.4.
+ */
+static bool _dd_v05_transcode_batch(struct _dd_v05_encoder_t *encoder, struct _trace_batch_t *batch) {
+    if (!encoder->strings.buckets && !datadog_php_string_table_ctor(&encoder->strings, 256)) {
+        return false;
+    }
+    datadog_php_string_table_clear(&encoder->strings);
+    datadog_php_string_table_intern(&encoder->strings, (datadog_php_string_view)DATADOG_PHP_STRING_VIEW_INIT);
 
-    struct _grouped_stack_t *readstack = calloc(1, sizeof(struct _grouped_stack_t));
-    readstack->total_bytes = total_bytes;
-    readstack->dest_size = atomic_load(&stack->bytes_written) + 2000;
-    readstack->dest_data = malloc(readstack->dest_size);
+    char *body_data;
+    size_t body_size;
+    mpack_writer_t body;
+    mpack_writer_init_growable(&body, &body_data, &body_size);
+    mpack_start_array(&body, batch->count);
 
-    _dd_msgpack_group_stack_by_id(stack, readstack);
+    bool success = true;
+    for (size_t i = 0; success && i < batch->count; ++i) {
+        mpack_reader_t reader;
+        mpack_reader_init_data(&reader, batch->traces[i].data, batch->traces[i].size);
 
-    return readstack;
-}
+        uint32_t spans = mpack_expect_array(&reader);
+        mpack_start_array(&body, spans);
+        for (uint32_t j = 0; success && j < spans; ++j) {
+            success = _dd_v05_transcode_span(encoder, &reader, &body);
+        }
+        if (success) {
+            mpack_done_array(&reader);
+            mpack_finish_array(&body);
+        }
+        success = mpack_reader_destroy(&reader) == mpack_ok && success;
+    }
 
-static void _dd_deinit_read_userdata(void *userdata) {
-    struct _grouped_stack_t *data = userdata;
-    if (data->dest_data) {
-        free(data->dest_data);
+    if (success) {
+        mpack_finish_array(&body);
+    } else {
+        // abandons the unfinished arrays
+        mpack_writer_flag_error(&body, mpack_error_data);
     }
-    free(userdata);
-}
+    if (mpack_writer_destroy(&body) != mpack_ok || !success) {
+        free(body_data);
+        return false;
+    }
+
+    char *payload_data;
+    size_t payload_size;
+    mpack_writer_t payload;
+    mpack_writer_init_growable(&payload, &payload_data, &payload_size);
+    mpack_start_array(&payload, 2);
+    mpack_start_array(&payload, encoder->strings.count);
+    for (uint32_t i = 0; i < encoder->strings.count; ++i) {
+        mpack_write_str(&payload, encoder->strings.strings[i].ptr, encoder->strings.strings[i].len);
+    }
+    mpack_finish_array(&payload);
+    mpack_write_object_bytes(&payload, body_data, body_size);
+    mpack_finish_array(&payload);
+    free(body_data);
 
-static ddtrace_coms_stack_t *_dd_coms_attempt_acquire_stack(void) {
-    ddtrace_coms_stack_t *stack = NULL;
+    // the string table views point into the trace buffers, drop them before freeing
+    datadog_php_string_table_clear(&encoder->strings);
 
-    for (size_t i = 0; i < ddtrace_coms_globals.max_backlog_size; i++) {
-        ddtrace_coms_stack_t *stack_tmp = ddtrace_coms_globals.stacks[i];
-        if (stack_tmp && atomic_load(&stack_tmp->refcount) == 0 && atomic_load(&stack_tmp->bytes_written) > 0) {
-            stack = stack_tmp;
-            ddtrace_coms_globals.stacks[i] = NULL;
-            break;
-        }
+    if (mpack_writer_destroy(&payload) != mpack_ok) {
+        free(payload_data);
+        return false;
     }
 
-    return stack;
+    _dd_batch_reset(batch);
+    _dd_batch_append(batch, payload_data, payload_size);
+    // the payload is complete, it must not be prefixed by the array header of the traces
+    batch->header_written = true;
+
+    return true;
+}
+
+static void _dd_v05_encoder_free(struct _dd_v05_encoder_t *encoder) {
+    datadog_php_string_table_dtor(&encoder->strings);
+    free(encoder->meta);
+    free(encoder->metrics);
+    *encoder = (struct _dd_v05_encoder_t){0};
 }
 
 #define TRACE_PATH_STR "/v0.4/traces"
+#define TRACE_V05_PATH_STR "/v0.5/traces"
 #define HOST_V6_FORMAT_STR "http://[%s]:%u"
 #define HOST_V4_FORMAT_STR "http://%s:%u"
 #define DEFAULT_UDS_PATH "/var/run/datadog/apm.socket"
@@ -754,7 +1071,7 @@ char *ddtrace_agent_url(void) {
     return formatted_url;
 }
 
-void ddtrace_curl_set_hostname(CURL *curl) {
+static void _dd_curl_set_hostname_path(CURL *curl, const char *path) {
     char *url = ddtrace_agent_url();
     if (url && url[0]) {
         char *http_url = url;
@@ -762,15 +1079,17 @@ void ddtrace_curl_set_hostname(CURL *curl) {
             curl_easy_setopt(curl, CURLOPT_UNIX_SOCKET_PATH, url + 7);
             http_url = "http://localhost";
         }
-        size_t agent_url_len = strlen(http_url) + sizeof(TRACE_PATH_STR);
+        size_t agent_url_len = strlen(http_url) + strlen(path) + 1;
         char *agent_url = malloc(agent_url_len);
-        sprintf(agent_url, "%s%s", http_url, TRACE_PATH_STR);
+        sprintf(agent_url, "%s%s", http_url, path);
         curl_easy_setopt(curl, CURLOPT_URL, agent_url);
         free(agent_url);
     }
     free(url);
 }
 
+void ddtrace_curl_set_hostname(CURL *curl) { _dd_curl_set_hostname_path(curl, TRACE_PATH_STR); }
+
 static struct timespec _dd_deadline_in_ms(uint32_t ms) {
     struct timespec deadline;
     struct timeval now;
@@ -798,69 +1117,346 @@ static size_t _dd_dummy_write_callback(char *ptr, size_t size, size_t nmemb, voi
 static void _dd_curl_reset_headers(struct _writer_loop_data_t *writer) {
     struct curl_slist *headers = atomic_exchange(&writer->headers, NULL);
     if (headers) {
-        curl_slist_free_all(headers);
+        // the trace count header is embedded in the writer, detach it before letting curl free the list
+        for (struct curl_slist *current = headers; current; current = current->next) {
+            if (current->next == &writer->trace_count_header) {
+                current->next = NULL;
+                break;
+            }
+        }
+        if (headers != &writer->trace_count_header) {
+            curl_slist_free_all(headers);
+        }
     }
 }
 
 #define DD_TRACE_COUNT_HEADER "X-Datadog-Trace-Count: "
 
-static void _dd_curl_set_headers(struct _writer_loop_data_t *writer, size_t trace_count) {
+static void _dd_curl_init_headers(struct _writer_loop_data_t *writer) {
     struct curl_slist *headers = NULL;
     for (struct curl_slist *current = dd_agent_curl_headers; current; current = current->next) {
         headers = curl_slist_append(headers, current->data);
     }
     headers = curl_slist_append(headers, "Transfer-Encoding: chunked");
     headers = curl_slist_append(headers, "Content-Type: application/msgpack");
-
-    char buffer[64];
-    int bytes_written = snprintf(buffer, sizeof buffer, DD_TRACE_COUNT_HEADER "%zu", trace_count);
-    if (bytes_written > ((int)sizeof(DD_TRACE_COUNT_HEADER)) - 1 && bytes_written < ((int)sizeof buffer)) {
-        headers = curl_slist_append(headers, buffer);
+    if (get_global_DD_TRACE_AGENT_COMPRESSION_ENABLED()) {
+        headers = curl_slist_append(headers, "Content-Encoding: gzip");
+    }
+    // the agent must not compute the stats again from the traces
+    if (get_global_DD_TRACE_STATS_COMPUTATION_ENABLED()) {
+        headers = curl_slist_append(headers, "Datadog-Client-Computed-Stats: yes");
     }
 
-    _dd_curl_reset_headers(writer);
+    writer->trace_count_header.data = writer->trace_count_header_buffer;
+    writer->trace_count_header.next = NULL;
+    strcpy(writer->trace_count_header_buffer, DD_TRACE_COUNT_HEADER "0");
+
+    if (headers) {
+        struct curl_slist *last = headers;
+        while (last->next) {
+            last = last->next;
+        }
+        last->next = &writer->trace_count_header;
+    } else {
+        headers = &writer->trace_count_header;
+    }
 
     curl_easy_setopt(writer->curl, CURLOPT_HTTPHEADER, headers);
     writer->headers = headers;
 }
 
-static void _dd_curl_send_stack(struct _writer_loop_data_t *writer, ddtrace_coms_stack_t *stack) {
+static void _dd_curl_set_trace_count(struct _writer_loop_data_t *writer, size_t trace_count) {
+    // curl serializes the header list on every request, so updating the buffer in place is enough
+    snprintf(writer->trace_count_header_buffer, sizeof writer->trace_count_header_buffer, DD_TRACE_COUNT_HEADER "%zu",
+             trace_count);
+}
+
+static void _dd_curl_cleanup(struct _writer_loop_data_t *writer) {
+    CURL *curl = writer->curl;
+    writer->curl = NULL;
+    if (curl) {
+        curl_easy_cleanup(curl);
+    }
+    _dd_curl_reset_headers(writer);
+}
+
+// The handle is kept for the whole lifetime of the writer so that libcurl can reuse the agent connection
+// between flushes; it is only recreated after a failed request or when running in a forked child
+static bool _dd_curl_ensure_handle(struct _writer_loop_data_t *writer) {
+    pid_t pid = getpid();
+    if (writer->curl && writer->curl_pid == pid) {
+        return true;
+    }
+
+    _dd_curl_cleanup(writer);
+
+    writer->curl = curl_easy_init();
     if (!writer->curl) {
-        ddtrace_bgs_logf("[bgs] no curl session - dropping the current stack.\n", NULL);
+        return false;
+    }
+    writer->curl_pid = pid;
+
+    curl_easy_setopt(writer->curl, CURLOPT_READFUNCTION, get_global_DD_TRACE_AGENT_COMPRESSION_ENABLED()
+                                                            ? _dd_coms_read_gzip_callback
+                                                            : _dd_coms_read_callback);
+    curl_easy_setopt(writer->curl, CURLOPT_WRITEFUNCTION, _dd_dummy_write_callback);
+    // as per https://curl.se/libcurl/c/threadsafe.html
+    // Also note that the docs mention potential SIGPIPEs, which may occur with OpenSSL:
+    // We can ignore that for now as we don't do TLS traffic to the agent currently
+    curl_easy_setopt(writer->curl, CURLOPT_NOSIGNAL, 1);
+    curl_easy_setopt(writer->curl, CURLOPT_TCP_KEEPALIVE, 1L);
+
+    ddtrace_curl_set_hostname(writer->curl);
+    writer->url_v05 = false;
+    ddtrace_curl_set_timeout(writer->curl);
+    ddtrace_curl_set_connect_timeout(writer->curl);
+
+    curl_easy_setopt(writer->curl, CURLOPT_UPLOAD, 1);
+    curl_easy_setopt(writer->curl, CURLOPT_VERBOSE, (long)get_global_DD_TRACE_AGENT_DEBUG_VERBOSE_CURL());
+
+    _dd_curl_init_headers(writer);
+
+    return true;
+}
+
+static void _dd_curl_send_batch(struct _writer_loop_data_t *writer, struct _trace_batch_t *batch) {
+    if (!_dd_curl_ensure_handle(writer)) {
+        ddtrace_bgs_logf("[bgs] no curl session - dropping the current batch.\n", NULL);
+        return;
+    }
+
+    // the header carries the number of traces, whichever way they are encoded
+    _dd_curl_set_trace_count(writer, batch->count);
+
+    bool v05 = get_global_DD_TRACE_API_VERSION() == DD_TRACE_API_VERSION_V05 &&
+               _dd_v05_transcode_batch(&writer->v05_encoder, batch);
+    if (v05 != writer->url_v05) {
+        _dd_curl_set_hostname_path(writer->curl, v05 ? TRACE_V05_PATH_STR : TRACE_PATH_STR);
+        writer->url_v05 = v05;
     }
 
-    if (writer->curl) {
-        CURLcode res;
+    if (get_global_DD_TRACE_AGENT_COMPRESSION_ENABLED() && !_dd_batch_start_compression(batch)) {
+        ddtrace_bgs_logf("[bgs] cannot initialize gzip compression - dropping the current batch.\n", NULL);
+        return;
+    }
 
-        void *read_data = _dd_init_read_userdata(stack);
-        struct _grouped_stack_t *kData = read_data;
-        _dd_curl_set_headers(writer, kData->total_groups);
-        curl_easy_setopt(writer->curl, CURLOPT_READDATA, read_data);
-        ddtrace_curl_set_hostname(writer->curl);
-        ddtrace_curl_set_timeout(writer->curl);
-        ddtrace_curl_set_connect_timeout(writer->curl);
+    CURLcode res;
 
-        curl_easy_setopt(writer->curl, CURLOPT_UPLOAD, 1);
-        curl_easy_setopt(writer->curl, CURLOPT_VERBOSE, (long)get_global_DD_TRACE_AGENT_DEBUG_VERBOSE_CURL());
+    curl_easy_setopt(writer->curl, CURLOPT_READDATA, batch);
 
-        res = curl_easy_perform(writer->curl);
+    res = curl_easy_perform(writer->curl);
 
-        if (res != CURLE_OK) {
-            ddtrace_bgs_logf("[bgs] curl_easy_perform() failed: %s\n", curl_easy_strerror(res));
-        } else if (get_global_DD_TRACE_DEBUG_CURL_OUTPUT()) {
-            double uploaded;
+    if (res != CURLE_OK) {
+        ddtrace_bgs_logf("[bgs] curl_easy_perform() failed: %s\n", curl_easy_strerror(res));
+        // start over with a fresh connection on the next request
+        _dd_curl_cleanup(writer);
+    } else if (get_global_DD_TRACE_DEBUG_CURL_OUTPUT()) {
+        double uploaded;
 // only deprecated on relatively new libcurl versions
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wdeprecated-declarations"
-            curl_easy_getinfo(writer->curl, CURLINFO_SIZE_UPLOAD, &uploaded);
+        curl_easy_getinfo(writer->curl, CURLINFO_SIZE_UPLOAD, &uploaded);
 #pragma GCC diagnostic pop
-            ddtrace_bgs_logf("[bgs] uploaded %.0f bytes\n", uploaded);
+        ddtrace_bgs_logf("[bgs] uploaded %.0f bytes\n", uploaded);
+    }
+}
+
+#define STATS_PATH_STR "/v0.6/stats"
+
+static void _dd_stats_write_string(mpack_writer_t *writer, const char *key, datadog_php_string_view value) {
+    mpack_write_cstr(writer, key);
+    mpack_write_str(writer, value.ptr, (uint32_t)value.len);
+}
+
+static void _dd_stats_write_zend_string(mpack_writer_t *writer, const char *key, zend_string *value) {
+    mpack_write_cstr(writer, key);
+    mpack_write_str(writer, ZSTR_VAL(value), (uint32_t)ZSTR_LEN(value));
+}
+
+static void _dd_stats_write_sketch(mpack_writer_t *writer, const char *key, const datadog_php_ddsketch *sketch) {
+    char buffer[512];
+    size_t size = datadog_php_ddsketch_encode(sketch, buffer, sizeof buffer);
+    char *encoded = size <= sizeof buffer ? buffer : malloc(size);
+    mpack_write_cstr(writer, key);
+    if (!encoded) {
+        mpack_write_bin(writer, "", 0);
+        return;
+    }
+    if (encoded != buffer) {
+        datadog_php_ddsketch_encode(sketch, encoded, size);
+    }
+    mpack_write_bin(writer, encoded, (uint32_t)size);
+    if (encoded != buffer) {
+        free(encoded);
+    }
+}
+
+// Encodes the buckets as a ClientStatsPayload of the agent
+static bool _dd_stats_encode(struct _writer_loop_data_t *writer, ddtrace_coms_stats_shard_t *buckets, char **data,
+                             size_t *size) {
+    mpack_writer_t payload;
+    mpack_writer_init_growable(&payload, data, size);
+
+    uint32_t bucket_count = 0;
+    for (ddtrace_coms_stats_shard_t *bucket = buckets; bucket; bucket = bucket->next) {
+        ++bucket_count;
+    }
+
+    mpack_start_map(&payload, 9);
+    _dd_stats_write_string(&payload, "Hostname", (datadog_php_string_view){0, ""});
+    _dd_stats_write_zend_string(&payload, "Env", get_global_DD_ENV());
+    _dd_stats_write_zend_string(&payload, "Version", get_global_DD_VERSION());
+    _dd_stats_write_string(&payload, "Lang", (datadog_php_string_view){sizeof("php") - 1, "php"});
+    _dd_stats_write_string(&payload, "TracerVersion",
+                           (datadog_php_string_view){sizeof(PHP_DDTRACE_VERSION) - 1, PHP_DDTRACE_VERSION});
+    _dd_stats_write_string(&payload, "RuntimeID", (datadog_php_string_view){0, ""});
+    mpack_write_cstr(&payload, "Sequence");
+    mpack_write_u64(&payload, ++writer->stats_sequence);
+    _dd_stats_write_zend_string(&payload, "Service", get_global_DD_SERVICE());
+
+    mpack_write_cstr(&payload, "Stats");
+    mpack_start_array(&payload, bucket_count);
+    for (ddtrace_coms_stats_shard_t *bucket = buckets; bucket; bucket = bucket->next) {
+        mpack_start_map(&payload, 3);
+        mpack_write_cstr(&payload, "Start");
+        mpack_write_u64(&payload, bucket->bucket_start);
+        mpack_write_cstr(&payload, "Duration");
+        mpack_write_u64(&payload, DD_STATS_BUCKET_DURATION);
+
+        mpack_write_cstr(&payload, "Stats");
+        mpack_start_array(&payload, bucket->group_count);
+        for (uint32_t i = 0; i < bucket->group_capacity; ++i) {
+            struct _dd_stats_group_t *group = bucket->groups[i];
+            if (!group) {
+                continue;
+            }
+            mpack_start_map(&payload, 13);
+            _dd_stats_write_string(&payload, "Service", group->key.service);
+            _dd_stats_write_string(&payload, "Name", group->key.name);
+            _dd_stats_write_string(&payload, "Resource", group->key.resource);
+            mpack_write_cstr(&payload, "HTTPStatusCode");
+            mpack_write_u32(&payload, group->key.http_status_code);
+            _dd_stats_write_string(&payload, "Type", group->key.type);
+            _dd_stats_write_string(&payload, "DBType", (datadog_php_string_view){0, ""});
+            mpack_write_cstr(&payload, "Hits");
+            mpack_write_u64(&payload, group->hits);
+            mpack_write_cstr(&payload, "Errors");
+            mpack_write_u64(&payload, group->errors);
+            mpack_write_cstr(&payload, "Duration");
+            mpack_write_u64(&payload, group->duration);
+            _dd_stats_write_sketch(&payload, "OkSummary", &group->ok_summary);
+            _dd_stats_write_sketch(&payload, "ErrorSummary", &group->error_summary);
+            mpack_write_cstr(&payload, "Synthetics");
+            mpack_write_bool(&payload, group->key.synthetics);
+            mpack_write_cstr(&payload, "TopLevelHits");
+            mpack_write_u64(&payload, group->top_level_hits);
+            mpack_finish_map(&payload);
         }
+        mpack_finish_array(&payload);
+        mpack_finish_map(&payload);
+    }
+    mpack_finish_array(&payload);
+    mpack_finish_map(&payload);
+
+    return mpack_writer_destroy(&payload) == mpack_ok;
+}
+
+static void _dd_stats_curl_cleanup(struct _writer_loop_data_t *writer) {
+    if (writer->stats_curl) {
+        curl_easy_cleanup(writer->stats_curl);
+        writer->stats_curl = NULL;
+    }
+    if (writer->stats_headers) {
+        curl_slist_free_all(writer->stats_headers);
+        writer->stats_headers = NULL;
+    }
+}
+
+// The stats go through their own handle, the one of the traces is set up for streaming uploads
+static bool _dd_stats_curl_ensure_handle(struct _writer_loop_data_t *writer) {
+    pid_t pid = getpid();
+    if (writer->stats_curl && writer->stats_curl_pid == pid) {
+        return true;
+    }
+
+    _dd_stats_curl_cleanup(writer);
+
+    writer->stats_curl = curl_easy_init();
+    if (!writer->stats_curl) {
+        return false;
+    }
+    writer->stats_curl_pid = pid;
+
+    for (struct curl_slist *current = dd_agent_curl_headers; current; current = current->next) {
+        writer->stats_headers = curl_slist_append(writer->stats_headers, current->data);
+    }
+    writer->stats_headers = curl_slist_append(writer->stats_headers, "Content-Type: application/msgpack");
+
+    CURL *curl = writer->stats_curl;
+    _dd_curl_set_hostname_path(curl, STATS_PATH_STR);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, writer->stats_headers);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, _dd_dummy_write_callback);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    ddtrace_curl_set_timeout(curl);
+    ddtrace_curl_set_connect_timeout(curl);
+    curl_easy_setopt(curl, CURLOPT_VERBOSE, (long)get_global_DD_TRACE_AGENT_DEBUG_VERBOSE_CURL());
+
+    return true;
+}
+
+static void _dd_stats_send(struct _writer_loop_data_t *writer, ddtrace_coms_stats_shard_t *buckets) {
+    char *data = NULL;
+    size_t size = 0;
+    if (!_dd_stats_encode(writer, buckets, &data, &size)) {
+        ddtrace_bgs_logf("[bgs] cannot encode the stats - dropping them.\n", NULL);
+        free(data);
+        return;
+    }
+
+    if (!_dd_stats_curl_ensure_handle(writer)) {
+        ddtrace_bgs_logf("[bgs] no curl session - dropping the stats.\n", NULL);
+        free(data);
+        return;
+    }
+
+    curl_easy_setopt(writer->stats_curl, CURLOPT_POSTFIELDS, data);
+    curl_easy_setopt(writer->stats_curl, CURLOPT_POSTFIELDSIZE, (long)size);
 
-        _dd_deinit_read_userdata(read_data);
-        _dd_curl_reset_headers(writer);
+    CURLcode res = curl_easy_perform(writer->stats_curl);
+    if (res != CURLE_OK) {
+        ddtrace_bgs_logf("[bgs] curl_easy_perform() failed for the stats: %s\n", curl_easy_strerror(res));
+        // start over with a fresh connection on the next flush
+        _dd_stats_curl_cleanup(writer);
     }
+
+    free(data);
 }
+
+// Sends the buckets which are over, or all of them when `all` is set, e.g. before the writer exits
+static void _dd_stats_flush(struct _writer_loop_data_t *writer, bool all) {
+    _dd_stats_collect_shards(&writer->stats_buckets);
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    uint64_t now_ns = (uint64_t)now.tv_sec * UINT64_C(1000000000) + (uint64_t)now.tv_nsec;
+
+    ddtrace_coms_stats_shard_t *done = writer->stats_buckets, **end = &writer->stats_buckets;
+    while (*end && (all || (*end)->bucket_start + DD_STATS_BUCKET_DURATION <= now_ns)) {
+        end = &(*end)->next;
+    }
+    if (end == &writer->stats_buckets) {
+        return;
+    }
+    writer->stats_buckets = *end;
+    *end = NULL;
+
+    if (atomic_load(&writer->sending)) {
+        _dd_stats_send(writer, done);
+    }
+    _dd_stats_shard_list_free(done);
+}
+
 static void _dd_signal_writer_started(struct _writer_loop_data_t *writer) {
     if (writer->thread) {
         // at the moment no actual signal is sent but we will set a threadsafe state variable
@@ -965,55 +1561,42 @@ static void *_dd_writer_loop(void *_) {
 
         atomic_store(&writer->requests_since_last_flush, 0);
 
-        ddtrace_coms_stack_t **stack = &writer->tmp_stack;
-        ddtrace_coms_threadsafe_rotate_stack(atomic_load(&writer->allocate_new_stacks),
-                                             ddtrace_coms_globals.initial_stack_size);
-
-        uint32_t processed_stacks = 0;
-        if (!*stack) {
-            *stack = _dd_coms_attempt_acquire_stack();
+        uint32_t dropped_traces = atomic_exchange(&ddtrace_coms_globals.dropped_traces, 0);
+        if (dropped_traces > 0) {
+            size_t dropped_bytes = atomic_exchange(&ddtrace_coms_globals.dropped_bytes, 0);
+            ddtrace_bgs_logf("[bgs] dropped %u traces (%zu bytes) as the queue was full\n", dropped_traces, dropped_bytes);
         }
 
-        // initializing a curl client only for this iteration
-        writer->curl = curl_easy_init();
-        curl_easy_setopt(writer->curl, CURLOPT_READFUNCTION, _dd_coms_read_callback);
-        curl_easy_setopt(writer->curl, CURLOPT_WRITEFUNCTION, _dd_dummy_write_callback);
-        // as per https://curl.se/libcurl/c/threadsafe.html
-        // Also note that the docs mention potential SIGPIPEs, which may occur with OpenSSL:
-        // We can ignore that for now as we don't do TLS traffic to the agent currently
-        curl_easy_setopt(writer->curl, CURLOPT_NOSIGNAL, 1);
-
-        while (*stack) {
-            processed_stacks++;
+        uint32_t processed_batches = 0;
+
+        while (_dd_batch_fill(&writer->batch, &writer->pending_data, &writer->pending_size)) {
+            processed_batches++;
             if (atomic_load(&writer->sending)) {
-                _dd_curl_send_stack(writer, *stack);
+                _dd_curl_send_batch(writer, &writer->batch);
             }
-
-            ddtrace_coms_stack_t *to_free = *stack;
-            // successfully sent stack is no longer needed
-            // ensure no one will refernce freed stack when thread restarts after fork
-            *stack = NULL;
-            _dd_coms_free_stack(to_free);
-
-            *stack = _dd_coms_attempt_acquire_stack();
+            _dd_batch_reset(&writer->batch);
         }
 
-        CURL *curl = writer->curl;
-        writer->curl = NULL;
-        curl_easy_cleanup(curl);
-
-        if (processed_stacks > 0) {
-            atomic_fetch_add(&writer->flush_processed_stacks_total, processed_stacks);
+        if (processed_batches > 0) {
+            atomic_fetch_add(&writer->flush_processed_batches_total, processed_batches);
         } else if (atomic_load(&writer->shutdown_when_idle)) {
             running = false;
         }
 
+        // the agent merges partial buckets, so everything is sent before exiting or when asked for a flush
+        _dd_stats_flush(writer, !running || atomic_exchange(&writer->flush_stats, false));
+
         _dd_signal_data_processed(writer);
     } while (running);
 
-    _dd_curl_reset_headers(writer);
+    _dd_curl_cleanup(writer);
+    _dd_stats_curl_cleanup(writer);
 
-    _dd_coms_stack_shutdown();
+    _dd_batch_free(&writer->batch);
+    _dd_v05_encoder_free(&writer->v05_encoder);
+    _dd_stats_shard_list_free(writer->stats_buckets);
+    writer->stats_buckets = NULL;
+    _dd_coms_queue_shutdown();
 
     pthread_cleanup_pop(1);
 
@@ -1031,8 +1614,6 @@ bool ddtrace_coms_set_writer_send_on_flush(bool send) {
 static void _dd_writer_set_shutdown_state(struct _writer_loop_data_t *writer) {
     // spin the writer without waiting to speedup processing time
     atomic_store(&writer->flush_interval, 0);
-    // stop allocating new stacks on flush
-    atomic_store(&writer->allocate_new_stacks, false);
     // make the writer exit once it finishes the processing
     atomic_store(&writer->shutdown_when_idle, true);
 }
@@ -1040,7 +1621,6 @@ static void _dd_writer_set_shutdown_state(struct _writer_loop_data_t *writer) {
 static void _dd_writer_set_operational_state(struct _writer_loop_data_t *writer) {
     atomic_store(&writer->sending, true);
     atomic_store(&writer->flush_interval, get_global_DD_TRACE_AGENT_FLUSH_INTERVAL());
-    atomic_store(&writer->allocate_new_stacks, true);
     atomic_store(&writer->shutdown_when_idle, false);
 }
 
@@ -1048,7 +1628,6 @@ static struct _writer_thread_variables_t *_dd_create_thread_variables() {
     struct _writer_thread_variables_t *thread = calloc(1, sizeof(struct _writer_thread_variables_t));
     pthread_mutex_init(&thread->interval_flush_mutex, NULL);
     pthread_mutex_init(&thread->finished_flush_mutex, NULL);
-    pthread_mutex_init(&thread->stack_rotation_mutex, NULL);
 
     pthread_mutex_init(&thread->writer_shutdown_signal_mutex, NULL);
     pthread_cond_init(&thread->writer_shutdown_signal_condition, NULL);
@@ -1098,11 +1677,9 @@ void ddtrace_coms_kill_background_sender(void) {
 void ddtrace_coms_clean_background_sender_after_fork(void) {
     struct _writer_loop_data_t *writer = _dd_get_writer();
     ddtrace_coms_kill_background_sender();
-    _dd_curl_reset_headers(writer);
-    curl_easy_cleanup(writer->curl);
-    writer->curl = NULL;
-    _dd_unsafe_cleanup_dirty_stack_area();
-    _dd_coms_stack_shutdown();
+    _dd_curl_cleanup(writer);
+    _dd_stats_curl_cleanup(writer);
+    _dd_coms_queue_shutdown();
     global_writer = (struct _writer_loop_data_t){0};
     ddtrace_coms_minit(ddtrace_coms_globals.initial_stack_size, ddtrace_coms_globals.max_payload_size, ddtrace_coms_globals.max_backlog_size);
 }
@@ -1212,11 +1789,12 @@ bool ddtrace_coms_flush_shutdown_writer_synchronous(void) {
 bool ddtrace_coms_synchronous_flush(uint32_t timeout) {
     struct _writer_loop_data_t *writer = _dd_get_writer();
     uint32_t previous_writer_cycle = atomic_load(&writer->writer_cycle);
-    uint32_t previous_processed_stacks_total = atomic_load(&writer->flush_processed_stacks_total);
+    uint32_t previous_processed_batches_total = atomic_load(&writer->flush_processed_batches_total);
     int64_t old_flush_interval = atomic_load(&writer->flush_interval);
 
     // ensure we immediately flush all data
     atomic_store(&writer->flush_interval, 0);
+    atomic_store(&writer->flush_stats, true);
 
     pthread_mutex_lock(&writer->thread->finished_flush_mutex);
     ddtrace_coms_trigger_writer_flush();
@@ -1235,10 +1813,10 @@ bool ddtrace_coms_synchronous_flush(uint32_t timeout) {
     // restore the flush interval
     atomic_store(&writer->flush_interval, old_flush_interval);
 
-    uint32_t processed_stacks_total =
-        atomic_load(&writer->flush_processed_stacks_total) - previous_processed_stacks_total;
+    uint32_t processed_batches_total =
+        atomic_load(&writer->flush_processed_batches_total) - previous_processed_batches_total;
 
-    return processed_stacks_total > 0;
+    return processed_batches_total > 0;
 }
 
 bool ddtrace_in_writer_thread(void) {
@@ -1281,46 +1859,44 @@ uint32_t ddtrace_coms_test_writers(void) {
         pthread_join(thread[i], &ptr);
     }
     printf("written %lu\n",
-           DDTRACE_NUMBER_OF_DATA_TO_WRITE * threads * (sizeof(DDTRACE_DATA_TO_WRITE) - 1 + sizeof(size_t)));
+           DDTRACE_NUMBER_OF_DATA_TO_WRITE * threads * (sizeof(DDTRACE_DATA_TO_WRITE) - 1));
     fflush(stdout);
     free(thread);
 
     return 1;
 }
 
-uint32_t ddtrace_coms_test_consumer(void) {
-    if (!_dd_coms_unsafe_rotate_stack(true, atomic_load(&ddtrace_coms_globals.stack_size))) {
-        printf("error rotating stacks");
+/* The queue has a single consumer, the writer thread. The test consumers dequeue from the PHP thread, so they park the
+ * writer first: once its cycle counter moved past the suspension, it is done with the queue until it is resumed.
+ */
+static void _dd_test_suspend_writer(struct _writer_loop_data_t *writer) {
+    atomic_store(&writer->suspended, true);
+    uint32_t cycle = atomic_load(&writer->writer_cycle);
+    while (writer->thread && atomic_load(&writer->running) && atomic_load(&writer->writer_cycle) == cycle) {
+        ddtrace_coms_trigger_writer_flush();
+        usleep(1000);
     }
+}
 
-    for (size_t i = 0; i < ddtrace_coms_globals.max_backlog_size; i++) {
-        ddtrace_coms_stack_t *stack = ddtrace_coms_globals.stacks[i];
-        if (!stack) continue;
-
-        if (!ddtrace_coms_is_stack_unused(stack)) {
-            continue;
-        }
-
-        size_t bytes_written = atomic_load(&stack->bytes_written);
-
-        size_t position = 0;
+static void _dd_test_resume_writer(struct _writer_loop_data_t *writer) { atomic_store(&writer->suspended, false); }
 
-        while (position < bytes_written) {
-            size_t size = 0;
-            memcpy(&size, stack->data + position, sizeof(size_t));
+uint32_t ddtrace_coms_test_consumer(void) {
+    struct _writer_loop_data_t *writer = _dd_get_writer();
+    _dd_test_suspend_writer(writer);
 
-            position += sizeof(size_t) + sizeof(uint32_t);
-            if (size == 0) {
-            }
-            char *data = stack->data + position;
-            position += size;
-            if (strncmp(data, "0123456789", sizeof("0123456789") - 1) != 0) {
-                printf("%.*s\n", (int)size, data);
-            }
+    char *data;
+    size_t size, bytes_read = 0;
+    while (_dd_coms_dequeue(&data, &size)) {
+        if (strncmp(data, "0123456789", sizeof("0123456789") - 1) != 0) {
+            printf("%.*s\n", (int)size, data);
         }
-        printf("bytes_written %lu\n", bytes_written);
+        bytes_read += size;
+        free(data);
     }
+    printf("bytes_read %zu\n", bytes_read);
+    printf("dropped %u\n", atomic_load(&ddtrace_coms_globals.dropped_traces));
 
+    _dd_test_resume_writer(writer);
     return 1;
 }
 
@@ -1343,17 +1919,20 @@ uint32_t ddtrace_coms_test_consumer(void) {
     } while (0)
 
 uint32_t ddtrace_coms_test_msgpack_consumer(void) {
-    _dd_coms_unsafe_rotate_stack(true, atomic_load(&ddtrace_coms_globals.stack_size));
+    struct _writer_loop_data_t *writer = _dd_get_writer();
+    _dd_test_suspend_writer(writer);
 
-    ddtrace_coms_stack_t *stack = _dd_coms_attempt_acquire_stack();
-    if (!stack) {
+    struct _trace_batch_t batch = {0};
+    char *pending_data = NULL;
+    size_t pending_size = 0;
+    if (!_dd_batch_fill(&batch, &pending_data, &pending_size)) {
+        _dd_test_resume_writer(writer);
         return 0;
     }
-    void *userdata = _dd_init_read_userdata(stack);
 
     char *data = calloc(100000, 1);
 
-    size_t written = _dd_coms_read_callback(data, 1, 1000, userdata);
+    size_t written = _dd_coms_read_callback(data, 1, 1000, &batch);
     if (written > 0) {
         PRINT_PRINTABLE("", 0, data[0]);
         for (size_t i = 1; i < written; i++) {
@@ -1364,8 +1943,9 @@ uint32_t ddtrace_coms_test_msgpack_consumer(void) {
     printf("\n");
 
     free(data);
-    _dd_deinit_read_userdata(userdata);
-    _dd_coms_free_stack(stack);
+    free(pending_data);
+    _dd_batch_free(&batch);
+    _dd_test_resume_writer(writer);
     return 1;
 }
 /* }}} */
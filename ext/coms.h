@@ -1,36 +1,43 @@
 #ifndef DD_COMS_H
 #define DD_COMS_H
 
+#include <components/string_view/string_view.h>
 #include <curl/curl.h>
 #include <stdatomic.h>
 #include <stdbool.h>
 #include <stdint.h>
 
-typedef struct ddtrace_coms_stack_t {
+typedef struct ddtrace_coms_stats_shard_t ddtrace_coms_stats_shard_t;
+
+/* A slot of the trace queue. `sequence` tells producers and the consumer whose turn it is to use the slot, see
+ * Dmitry Vyukov's bounded MPMC queue. Only the writer thread consumes, so the dequeue side needs no atomics.
+ */
+typedef struct ddtrace_coms_queue_slot_t {
+    _Atomic(size_t) sequence;
     size_t size;
-    _Atomic(size_t) position;
-    _Atomic(size_t) bytes_written;
-    _Atomic(int32_t) refcount;
     char *data;
-} ddtrace_coms_stack_t;
+} ddtrace_coms_queue_slot_t;
 
 typedef struct ddtrace_coms_state_t {
-    // This is the current stack where new incoming payloads are written to.
-    _Atomic(ddtrace_coms_stack_t *) current_stack;
-    ddtrace_coms_stack_t *tmp_stack;
-    /* An array of `DDTRACE_COMS_STACKS_BACKLOG_SIZE` stacks. Different stacks can have different size.
-     * Stacks that are accessed through this array are not for write. They are either empty, if their content has been
-     * sent and the stack is ready to be reused, or filled with data ready to be sent at the next writer iteration.
+    /* A bounded multi-producer single-consumer ring of msgpack-encoded traces. Each slot holds exactly one trace,
+     * owned by the queue from enqueue until the writer has sent it.
      */
-    ddtrace_coms_stack_t **stacks;
-    _Atomic(uint32_t) next_group_id;
-    /* The size of the `current_stack`. Note that `current_stack` and `stack_size` are not changed in a 'transaction',
-     * so, with the current implementation, they have to be manually kept in sync.
+    ddtrace_coms_queue_slot_t *slots;
+    size_t capacity;  // power of two
+    _Atomic(size_t) enqueue_position;
+    size_t dequeue_position;
+
+    /* The sum of the sizes of all the queued traces. Bounded by `max_queued_bytes`, which is what provides
+     * backpressure: when the writer does not keep up, new traces are dropped and accounted for instead.
      */
-    atomic_size_t stack_size;
+    atomic_size_t queued_bytes;
+    _Atomic(uint32_t) dropped_traces;
+    atomic_size_t dropped_bytes;
+
+    _Atomic(uint32_t) next_group_id;
 
     /*
-     * The initial buffer size, from DD_TRACE
+     * The amount of queued bytes after which the writer is woken early, from DD_TRACE_AGENT_STACK_INITIAL_SIZE
      */
     size_t initial_stack_size;
     /*
@@ -38,16 +45,17 @@ typedef struct ddtrace_coms_state_t {
      */
     size_t max_payload_size;
     /*
-     * The maximum backlog size, from DD_TRACE_AGENT_MAX_BACKLOG_SIZE
+     * The maximum backlog size, from DD_TRACE_AGENT_STACK_BACKLOG
      */
     size_t max_backlog_size;
-} ddtrace_coms_state_t;
+    size_t max_queued_bytes;
 
-inline bool ddtrace_coms_is_stack_unused(ddtrace_coms_stack_t *stack) { return atomic_load(&stack->refcount) == 0; }
-
-inline bool ddtrace_coms_is_stack_free(ddtrace_coms_stack_t *stack) {
-    return ddtrace_coms_is_stack_unused(stack) && atomic_load(&stack->bytes_written) == 0;
-}
+    /* The client-side stats shards handed over by the PHP threads, a lock-free stack which the writer empties at
+     * once. Bounded by `stats_shard_count`, in case the writer does not run.
+     */
+    _Atomic(ddtrace_coms_stats_shard_t *) stats_shards;
+    _Atomic(uint32_t) stats_shard_count;
+} ddtrace_coms_state_t;
 
 /* Is called by the PHP thread to buffer a payload in order to send it. It is non-blocking on the request to the agent.
  */
@@ -70,6 +78,25 @@ bool ddtrace_coms_on_pid_change(void);
 void ddtrace_coms_kill_background_sender(void);
 void ddtrace_coms_clean_background_sender_after_fork(void);
 
+/* Client-side stats {{{ */
+// What the stats of a span are grouped by and made of, the strings are only read while recording it
+typedef struct ddtrace_coms_stats_span_t {
+    datadog_php_string_view service, name, resource, type;
+    uint32_t http_status_code;
+    bool synthetics, top_level, error;
+    uint64_t end;  // nanoseconds since the epoch
+    uint64_t duration;
+} ddtrace_coms_stats_span_t;
+
+/* Is called by the PHP threads to count a span into their own shard, which is allocated on first use. A shard only
+ * covers a single bucket of time; it is submitted when a span of another bucket comes.
+ */
+void ddtrace_coms_stats_record(ddtrace_coms_stats_shard_t **shard, const ddtrace_coms_stats_span_t *span);
+// Hands the shard over to the writer, which sends the stats to the agent every 10 seconds
+void ddtrace_coms_stats_submit(ddtrace_coms_stats_shard_t **shard);
+void ddtrace_coms_stats_shard_free(ddtrace_coms_stats_shard_t *shard);
+/* }}} */
+
 /* exposed for testing {{{ */
 uint32_t ddtrace_coms_test_writers(void);
 uint32_t ddtrace_coms_test_consumer(void);
@@ -66,6 +66,19 @@ static bool dd_parse_dbm_mode(zai_string_view value, zval *decoded_value, bool p
     return true;
 }
 
+static bool dd_parse_api_version(zai_string_view value, zval *decoded_value, bool persistent) {
+    UNUSED(persistent);
+    if (zai_string_equals_literal_ci(value, "v0.4")) {
+        ZVAL_LONG(decoded_value, DD_TRACE_API_VERSION_V04);
+    } else if (zai_string_equals_literal_ci(value, "v0.5")) {
+        ZVAL_LONG(decoded_value, DD_TRACE_API_VERSION_V05);
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
 // Allow for partially defined struct initialization here
 #pragma GCC diagnostic ignored "-Wmissing-field-initializers"
 
@@ -23,6 +23,11 @@ enum ddtrace_dbm_propagation_mode {
     DD_TRACE_DBM_PROPAGATION_FULL,
 };
 
+enum ddtrace_api_version {
+    DD_TRACE_API_VERSION_V04,
+    DD_TRACE_API_VERSION_V05,
+};
+
 /* From the curl docs on CONNECT_TIMEOUT_MS:
  *     If libcurl is built to use the standard system name resolver, that
  *     portion of the transfer will still use full-second resolution for
@@ -88,30 +93,38 @@ enum ddtrace_dbm_propagation_mode {
     CONFIG(BOOL, DD_TRACE_HEALTH_METRICS_ENABLED, "false", .ini_change = zai_config_system_ini_change)         \
     CONFIG(DOUBLE, DD_TRACE_HEALTH_METRICS_HEARTBEAT_SAMPLE_RATE, "0.001")                                     \
     CONFIG(BOOL, DD_TRACE_DB_CLIENT_SPLIT_BY_INSTANCE, "false")                                                \
+    CONFIG(BOOL, DD_TRACE_SQL_QUANTIZATION_ENABLED, "false")                                                   \
     CONFIG(BOOL, DD_TRACE_HTTP_CLIENT_SPLIT_BY_DOMAIN, "false")                                                \
     CONFIG(BOOL, DD_TRACE_REDIS_CLIENT_SPLIT_BY_HOST, "false")                                                 \
     CONFIG(STRING, DD_TRACE_MEMORY_LIMIT, "")                                                                  \
     CONFIG(BOOL, DD_TRACE_REPORT_HOSTNAME, "false")                                                            \
     CONFIG(BOOL, DD_TRACE_FLUSH_COLLECT_CYCLES, "false")                                                       \
-    CONFIG(SET, DD_TRACE_RESOURCE_URI_FRAGMENT_REGEX, "")                                                      \
-    CONFIG(SET, DD_TRACE_RESOURCE_URI_MAPPING_INCOMING, "")                                                    \
-    CONFIG(SET, DD_TRACE_RESOURCE_URI_MAPPING_OUTGOING, "")                                                    \
-    CONFIG(SET, DD_TRACE_RESOURCE_URI_QUERY_PARAM_ALLOWED, "")                                                 \
-    CONFIG(SET, DD_TRACE_HTTP_URL_QUERY_PARAM_ALLOWED, "*")                                                    \
+    CONFIG(SET, DD_TRACE_RESOURCE_URI_FRAGMENT_REGEX, "",                                                      \
+           .ini_change = ddtrace_alter_uri_fragment_regex_config)                                              \
+    CONFIG(SET, DD_TRACE_RESOURCE_URI_MAPPING_INCOMING, "",                                                    \
+           .ini_change = ddtrace_alter_uri_mapping_incoming_config)                                            \
+    CONFIG(SET, DD_TRACE_RESOURCE_URI_MAPPING_OUTGOING, "",                                                    \
+           .ini_change = ddtrace_alter_uri_mapping_outgoing_config)                                            \
+    CONFIG(SET, DD_TRACE_RESOURCE_URI_QUERY_PARAM_ALLOWED, "",                                                 \
+           .ini_change = ddtrace_alter_resource_uri_query_param_allowed_config)                                \
+    CONFIG(SET, DD_TRACE_HTTP_URL_QUERY_PARAM_ALLOWED, "*",                                                    \
+           .ini_change = ddtrace_alter_http_url_query_param_allowed_config)                                    \
     CONFIG(SET, DD_TRACE_HTTP_POST_DATA_PARAM_ALLOWED, "")                                                    \
     CONFIG(INT, DD_TRACE_RATE_LIMIT, "0", .ini_change = zai_config_system_ini_change)                          \
     CALIAS(DOUBLE, DD_TRACE_SAMPLE_RATE, "1", CALIASES("DD_SAMPLING_RATE"))                                    \
-    CONFIG(JSON, DD_TRACE_SAMPLING_RULES, "[]")                                                                \
-    CONFIG(JSON, DD_SPAN_SAMPLING_RULES, "[]")                                                                 \
+    CONFIG(JSON, DD_TRACE_SAMPLING_RULES, "[]", .ini_change = ddtrace_alter_sampling_rules_config)             \
+    CONFIG(JSON, DD_SPAN_SAMPLING_RULES, "[]", .ini_change = ddtrace_alter_span_sampling_rules_config)         \
     CONFIG(STRING, DD_SPAN_SAMPLING_RULES_FILE, "", .ini_change = ddtrace_alter_sampling_rules_file_config)    \
     CONFIG(SET_LOWERCASE, DD_TRACE_HEADER_TAGS, "")                                                            \
     CONFIG(INT, DD_TRACE_X_DATADOG_TAGS_MAX_LENGTH, "512")                                                     \
     CONFIG(BOOL, DD_TRACE_PROPAGATE_SERVICE, "false")                                                          \
     CALIAS(SET_LOWERCASE, DD_TRACE_PROPAGATION_STYLE_EXTRACT, "tracecontext,Datadog,B3,B3 single header",      \
-           CALIASES("DD_PROPAGATION_STYLE_EXTRACT"))                                                           \
+           CALIASES("DD_PROPAGATION_STYLE_EXTRACT"),                                                           \
+           .ini_change = ddtrace_alter_propagation_style_extract_config)                                       \
     CALIAS(SET_LOWERCASE, DD_TRACE_PROPAGATION_STYLE_INJECT, "tracecontext,Datadog",                           \
            CALIASES("DD_PROPAGATION_STYLE_INJECT"))                                                            \
-    CONFIG(SET_LOWERCASE, DD_TRACE_PROPAGATION_STYLE, "tracecontext,Datadog")                                  \
+    CONFIG(SET_LOWERCASE, DD_TRACE_PROPAGATION_STYLE, "tracecontext,Datadog",                                  \
+           .ini_change = ddtrace_alter_propagation_style_extract_config)                                       \
     CONFIG(SET, DD_TRACE_TRACED_INTERNAL_FUNCTIONS, "")                                                        \
     CONFIG(INT, DD_TRACE_AGENT_TIMEOUT, DD_CFG_EXPSTR(DD_TRACE_AGENT_TIMEOUT_VAL),                             \
            .ini_change = zai_config_system_ini_change)                                                         \
@@ -140,7 +153,8 @@ enum ddtrace_dbm_propagation_mode {
     CONFIG(BOOL, DD_TRACE_WARN_LEGACY_DD_TRACE, "true")                                                        \
     CONFIG(BOOL, DD_TRACE_RETAIN_THREAD_CAPABILITIES, "false", .ini_change = zai_config_system_ini_change)     \
     CONFIG(STRING, DD_VERSION, "")                                                                             \
-    CONFIG(STRING, DD_TRACE_OBFUSCATION_QUERY_STRING_REGEXP, DD_TRACE_OBFUSCATION_QUERY_STRING_REGEXP_DEFAULT) \
+    CONFIG(STRING, DD_TRACE_OBFUSCATION_QUERY_STRING_REGEXP, DD_TRACE_OBFUSCATION_QUERY_STRING_REGEXP_DEFAULT, \
+           .ini_change = ddtrace_alter_obfuscation_query_string_regexp_config)                                 \
     CONFIG(BOOL, DD_TRACE_CLIENT_IP_ENABLED, "false")                                                          \
     CONFIG(STRING, DD_TRACE_CLIENT_IP_HEADER, "")                                                              \
     CONFIG(BOOL, DD_TRACE_FORKED_PROCESS, "true")                                                              \
@@ -148,6 +162,10 @@ enum ddtrace_dbm_propagation_mode {
     CONFIG(INT, DD_TRACE_AGENT_MAX_PAYLOAD_SIZE, "52428800", .ini_change = zai_config_system_ini_change)       \
     CONFIG(INT, DD_TRACE_AGENT_STACK_INITIAL_SIZE, "131072", .ini_change = zai_config_system_ini_change)       \
     CONFIG(INT, DD_TRACE_AGENT_STACK_BACKLOG, "12", .ini_change = zai_config_system_ini_change)                \
+    CONFIG(BOOL, DD_TRACE_AGENT_COMPRESSION_ENABLED, "false", .ini_change = zai_config_system_ini_change)      \
+    CONFIG(BOOL, DD_TRACE_STATS_COMPUTATION_ENABLED, "false", .ini_change = zai_config_system_ini_change)      \
+    CONFIG(CUSTOM(INT), DD_TRACE_API_VERSION, "v0.4", .parser = dd_parse_api_version,                          \
+           .ini_change = zai_config_system_ini_change)                                                         \
     CONFIG(BOOL, DD_TRACE_PROPAGATE_USER_ID_DEFAULT, "false")                                                  \
     CONFIG(CUSTOM(INT), DD_DBM_PROPAGATION_MODE, "disabled", .parser = dd_parse_dbm_mode)                      \
     DD_INTEGRATIONS
@@ -43,10 +43,13 @@
 #include "excluded_modules.h"
 #include "handlers_http.h"
 #include "handlers_internal.h"
+#include "integrations/dbm.h"
 #include "integrations/integrations.h"
+#include "integrations/pdo_dsn.h"
 #include "ip_extraction.h"
 #include "logging.h"
 #include "memory_limit.h"
+#include "object_store.h"
 #include "limiter/limiter.h"
 #include "priority_sampling/priority_sampling.h"
 #include "random.h"
@@ -54,8 +57,10 @@
 #include "serializer.h"
 #include "signals.h"
 #include "span.h"
+#include "sql_quantization.h"
 #include "startup_logging.h"
 #include "tracer_tag_propagation/tracer_tag_propagation.h"
+#include "uri_normalization.h"
 #include "ext/standard/file.h"
 
 #include "../hook/uhook.h"
@@ -225,6 +230,7 @@ static void ddtrace_activate(void) {
     // ZAI config is always set up
     pthread_once(&dd_activate_config_once_control, ddtrace_config_first_rinit);
     zai_config_rinit();
+    DDTRACE_G(propagation_extract_styles) = 0;
 
     zend_string *sampling_rules_file = get_DD_SPAN_SAMPLING_RULES_FILE();
     if (ZSTR_LEN(sampling_rules_file) > 0 && !zend_string_equals(get_global_DD_SPAN_SAMPLING_RULES_FILE(), sampling_rules_file)) {
@@ -291,11 +297,22 @@ static PHP_GINIT_FUNCTION(ddtrace) {
     ZEND_TSRMLS_CACHE_UPDATE();
 #endif
     php_ddtrace_init_globals(ddtrace_globals);
+    ddtrace_pdo_dsn_tags_ginit(&ddtrace_globals->pdo_dsn_tags);
+    ddtrace_sql_quantization_ginit(&ddtrace_globals->sql_quantization_cache);
     zai_hook_ginit();
 }
 
 static PHP_GSHUTDOWN_FUNCTION(ddtrace) {
-    UNUSED(ddtrace_globals);
+    ddtrace_pdo_dsn_tags_gshutdown(&ddtrace_globals->pdo_dsn_tags);
+    ddtrace_sql_quantization_gshutdown(&ddtrace_globals->sql_quantization_cache);
+    if (ddtrace_globals->stats_shard) {
+        ddtrace_coms_stats_shard_free(ddtrace_globals->stats_shard);
+    }
+    ddtrace_dogstatsd_client_gshutdown(ddtrace_globals);
+    ddtrace_sampling_rules_gshutdown(ddtrace_globals);
+    ddtrace_span_sampling_rules_gshutdown(ddtrace_globals);
+    ddtrace_uri_normalizers_gshutdown(ddtrace_globals);
+    ddtrace_query_string_filters_gshutdown(ddtrace_globals);
     zai_hook_gshutdown();
 }
 
@@ -434,6 +451,7 @@ static zend_object *ddtrace_span_stack_clone_obj(zend_object *old_obj) {
 }
 
 static void ddtrace_span_data_free_storage(zend_object *object) {
+    ddtrace_span_free_inline_meta((ddtrace_span_data *)object);
     zend_object_std_dtor(object);
     // Prevent use after free after zend_objects_store_free_object_storage is called (e.g. preloading) [PHP < 8.1]
     memset(object->properties_table, 0, sizeof(zval) + sizeof(((ddtrace_span_data *)NULL)->properties_table_placeholder));
@@ -445,11 +463,47 @@ static zend_object *ddtrace_span_data_clone_obj(zval *old_zv) {
 #else
 static zend_object *ddtrace_span_data_clone_obj(zend_object *old_obj) {
 #endif
+    ddtrace_span_materialize_meta((ddtrace_span_data *)old_obj);
     zend_object *new_obj = ddtrace_span_data_create(old_obj->ce);
     zend_objects_clone_members(new_obj, old_obj);
     return new_obj;
 }
 
+#if PHP_VERSION_ID >= 80000
+// Tags added by the tracer itself are kept inline on the span, until anything accesses the meta property
+static zend_always_inline void dd_span_data_materialize_meta(zend_object *object) {
+    ddtrace_span_data *span = (ddtrace_span_data *)object;
+    if (UNEXPECTED(Z_TYPE_P(ddtrace_spandata_property_meta_zval(span)) == IS_UNDEF)) {
+        ddtrace_span_materialize_meta(span);
+    }
+}
+
+static zval *ddtrace_span_data_read_property(zend_object *object, zend_string *member, int type, void **cache_slot, zval *rv) {
+    dd_span_data_materialize_meta(object);
+    return zend_std_read_property(object, member, type, cache_slot, rv);
+}
+
+static zval *ddtrace_span_data_get_property_ptr_ptr(zend_object *object, zend_string *member, int type, void **cache_slot) {
+    dd_span_data_materialize_meta(object);
+    return zend_std_get_property_ptr_ptr(object, member, type, cache_slot);
+}
+
+static int ddtrace_span_data_has_property(zend_object *object, zend_string *member, int has_set_exists, void **cache_slot) {
+    dd_span_data_materialize_meta(object);
+    return zend_std_has_property(object, member, has_set_exists, cache_slot);
+}
+
+static void ddtrace_span_data_unset_property(zend_object *object, zend_string *member, void **cache_slot) {
+    dd_span_data_materialize_meta(object);
+    zend_std_unset_property(object, member, cache_slot);
+}
+
+static HashTable *ddtrace_span_data_get_properties(zend_object *object) {
+    dd_span_data_materialize_meta(object);
+    return zend_std_get_properties(object);
+}
+#endif
+
 #if PHP_VERSION_ID < 80000
 #if PHP_VERSION_ID >= 70400
 static zval *ddtrace_span_data_readonly(zval *object, zval *member, zval *value, void **cache_slot) {
@@ -462,6 +516,7 @@ static void ddtrace_span_data_readonly(zval *object, zval *member, zval *value,
 static zval *ddtrace_span_data_readonly(zend_object *object, zend_string *member, zval *value, void **cache_slot) {
     zend_object *obj = object;
     zend_string *prop_name = member;
+    dd_span_data_materialize_meta(object);
 #endif
     if (zend_string_equals_literal(prop_name, "parent")
      || zend_string_equals_literal(prop_name, "id")
@@ -538,6 +593,13 @@ static void dd_register_span_data_ce(void) {
     ddtrace_span_data_handlers.free_obj = ddtrace_span_data_free_storage;
     ddtrace_span_data_handlers.write_property = ddtrace_span_data_readonly;
     ddtrace_span_data_handlers.get_constructor = ddtrace_span_data_get_constructor;
+#if PHP_VERSION_ID >= 80000
+    ddtrace_span_data_handlers.read_property = ddtrace_span_data_read_property;
+    ddtrace_span_data_handlers.get_property_ptr_ptr = ddtrace_span_data_get_property_ptr_ptr;
+    ddtrace_span_data_handlers.has_property = ddtrace_span_data_has_property;
+    ddtrace_span_data_handlers.unset_property = ddtrace_span_data_unset_property;
+    ddtrace_span_data_handlers.get_properties = ddtrace_span_data_get_properties;
+#endif
     ddtrace_ce_span_data = register_class_DDTrace_SpanData();
     ddtrace_ce_span_data->create_object = ddtrace_span_data_create;
     ddtrace_ce_span_stack = register_class_DDTrace_SpanStack();
@@ -582,6 +644,7 @@ static void dd_disable_if_incompatible_sapi_detected(void) {
 }
 
 static void dd_read_distributed_tracing_ids(void);
+static void dd_propagation_headers_minit(void);
 
 static PHP_MINIT_FUNCTION(ddtrace) {
     UNUSED(type);
@@ -654,6 +717,7 @@ static PHP_MINIT_FUNCTION(ddtrace) {
     ddtrace_ce_span_link = register_class_DDTrace_SpanLink(php_json_serializable_ce);
 
     ddtrace_engine_hooks_minit();
+    dd_propagation_headers_minit();
 
     ddtrace_coms_minit(get_global_DD_TRACE_AGENT_STACK_INITIAL_SIZE(),
                        get_global_DD_TRACE_AGENT_MAX_PAYLOAD_SIZE(),
@@ -661,6 +725,7 @@ static PHP_MINIT_FUNCTION(ddtrace) {
 
     ddtrace_integrations_minit();
     dd_ip_extraction_startup();
+    ddtrace_span_minit();
 
     return SUCCESS;
 }
@@ -761,6 +826,8 @@ static PHP_RINIT_FUNCTION(ddtrace) {
         DDTRACE_G(active_stack) = ddtrace_init_root_span_stack();
     }
 
+    ddtrace_object_store_rinit();
+
     if (get_DD_TRACE_ENABLED()) {
         dd_initialize_request();
     }
@@ -786,6 +853,7 @@ static void dd_clean_globals(void) {
     ddtrace_dogstatsd_client_rshutdown();
 
     ddtrace_free_span_stacks(false);
+    ddtrace_coms_stats_submit(&DDTRACE_G(stats_shard));
     ddtrace_coms_rshutdown();
 
     if (ZSTR_LEN(get_DD_TRACE_REQUEST_INIT_HOOK())) {
@@ -848,6 +916,9 @@ static PHP_RSHUTDOWN_FUNCTION(ddtrace) {
         DDTRACE_G(active_stack) = NULL;
     }
 
+    // the end hooks of the spans closed above may still read the connection tags of their objects
+    ddtrace_object_store_rshutdown();
+
     return SUCCESS;
 }
 
@@ -862,6 +933,11 @@ zend_result ddtrace_post_deactivate(void) {
     zai_hook_rshutdown();
     zai_uhook_rshutdown();
 
+    ddtrace_sampling_rules_rshutdown();
+    ddtrace_span_sampling_rules_rshutdown();
+    ddtrace_uri_normalizers_rshutdown();
+    ddtrace_query_string_filters_rshutdown();
+
     // zai config may be accessed indirectly via other modules RSHUTDOWN, so delay this until the last possible time
     zai_config_rshutdown();
     return SUCCESS;
@@ -1338,6 +1414,133 @@ PHP_FUNCTION(DDTrace_Config_integration_analytics_sample_rate) {
     RETVAL_DOUBLE(integration->get_sample_rate());
 }
 
+PHP_FUNCTION(DDTrace_ObjectStore_put) {
+    zval *instance, *value;
+    zend_string *key;
+
+    ZEND_PARSE_PARAMETERS_START(3, 3)
+        Z_PARAM_ZVAL(instance)
+        Z_PARAM_STR(key)
+        Z_PARAM_ZVAL(value)
+    ZEND_PARSE_PARAMETERS_END();
+
+    if (Z_TYPE_P(instance) == IS_OBJECT && ZSTR_LEN(key)) {
+        ddtrace_object_store_put(Z_OBJ_P(instance), key, value);
+    }
+}
+
+PHP_FUNCTION(DDTrace_ObjectStore_get) {
+    zval *instance, *default_value = NULL;
+    zend_string *key;
+
+    ZEND_PARSE_PARAMETERS_START(2, 3)
+        Z_PARAM_ZVAL(instance)
+        Z_PARAM_STR(key)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_ZVAL(default_value)
+    ZEND_PARSE_PARAMETERS_END();
+
+    zval *value = NULL;
+    if (Z_TYPE_P(instance) == IS_OBJECT && ZSTR_LEN(key)) {
+        value = ddtrace_object_store_get(Z_OBJ_P(instance), key);
+    }
+
+    if (value) {
+        ZVAL_DEREF(value);
+        if (Z_TYPE_P(value) != IS_NULL) {
+            RETURN_COPY(value);
+        }
+    }
+    if (default_value) {
+        RETURN_COPY(default_value);
+    }
+}
+
+PHP_FUNCTION(DDTrace_ObjectStore_propagate) {
+    zval *source, *destination;
+    zend_string *key;
+
+    ZEND_PARSE_PARAMETERS_START(3, 3)
+        Z_PARAM_ZVAL(source)
+        Z_PARAM_ZVAL(destination)
+        Z_PARAM_STR(key)
+    ZEND_PARSE_PARAMETERS_END();
+
+    if (Z_TYPE_P(source) != IS_OBJECT || Z_TYPE_P(destination) != IS_OBJECT || !ZSTR_LEN(key)) {
+        return;
+    }
+
+    zval *value = ddtrace_object_store_get(Z_OBJ_P(source), key), null;
+    if (value) {
+        ZVAL_DEREF(value);
+    } else {
+        ZVAL_NULL(&null);
+        value = &null;
+    }
+    ddtrace_object_store_put(Z_OBJ_P(destination), key, value);
+}
+
+PHP_FUNCTION(DDTrace_Integrations_parse_pdo_dsn) {
+    zend_string *dsn;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_STR(dsn)
+    ZEND_PARSE_PARAMETERS_END();
+
+    RETURN_ARR(ddtrace_pdo_dsn_tags(dsn));
+}
+
+PHP_FUNCTION(DDTrace_Integrations_add_span_meta) {
+    zval *span_zv;
+    zend_array *tags;
+
+    ZEND_PARSE_PARAMETERS_START(2, 2)
+        Z_PARAM_OBJECT_OF_CLASS(span_zv, ddtrace_ce_span_data)
+        Z_PARAM_ARRAY_HT(tags)
+    ZEND_PARSE_PARAMETERS_END();
+
+    zend_hash_merge(ddtrace_spandata_property_meta((ddtrace_span_data *)Z_OBJ_P(span_zv)), tags, zval_add_ref, 1);
+}
+
+PHP_FUNCTION(DDTrace_Integrations_filter_query_string) {
+    zend_string *query_string;
+    zend_bool resource = false;
+
+    ZEND_PARSE_PARAMETERS_START(1, 2)
+        Z_PARAM_STR(query_string)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_BOOL(resource)
+    ZEND_PARSE_PARAMETERS_END();
+
+    zai_string_view query_string_view = {.len = ZSTR_LEN(query_string), .ptr = ZSTR_VAL(query_string)};
+    RETURN_STR(resource ? ddtrace_filter_resource_query_string(query_string_view)
+                        : ddtrace_filter_url_query_string(query_string_view));
+}
+
+PHP_FUNCTION(DDTrace_Integrations_dbm_propagation_mode) {
+    zend_string *backend;
+
+    ZEND_PARSE_PARAMETERS_START(1, 1)
+        Z_PARAM_STR(backend)
+    ZEND_PARSE_PARAMETERS_END();
+
+    RETURN_LONG(ddtrace_dbm_propagation_mode(backend));
+}
+
+PHP_FUNCTION(DDTrace_Integrations_propagate_via_sql_comments) {
+    zend_string *query, *db_service;
+    zend_long mode = DD_TRACE_DBM_PROPAGATION_FULL;
+
+    ZEND_PARSE_PARAMETERS_START(2, 3)
+        Z_PARAM_STR(query)
+        Z_PARAM_STR(db_service)
+        Z_PARAM_OPTIONAL
+        Z_PARAM_LONG(mode)
+    ZEND_PARSE_PARAMETERS_END();
+
+    RETURN_STR(ddtrace_dbm_propagate_via_sql_comments(query, db_service, mode));
+}
+
 /* This is only exposed to serialize the container ID into an HTTP Agent header for the userland transport
  * (`DDTrace\Transport\Http`). The background sender (extension-level transport) is decoupled from userland
  * code to create any HTTP Agent headers. Once the dependency on the userland transport has been removed,
@@ -1927,37 +2130,86 @@ PHP_FUNCTION(DDTrace_set_distributed_tracing_context) {
     RETURN_TRUE;
 }
 
-void ddtrace_read_distributed_tracing_ids(bool (*read_header)(zai_string_view, const char *, zend_string **header_value, void *data), void *data);
+typedef enum {
+    DD_HEADER_B3,
+    DD_HEADER_X_DATADOG_ORIGIN,
+    DD_HEADER_X_DATADOG_TRACE_ID,
+    DD_HEADER_X_DATADOG_PARENT_ID,
+    DD_HEADER_X_DATADOG_SAMPLING_PRIORITY,
+    DD_HEADER_X_DATADOG_TAGS,
+    DD_HEADER_X_B3_TRACEID,
+    DD_HEADER_X_B3_SPANID,
+    DD_HEADER_X_B3_SAMPLED,
+    DD_HEADER_X_B3_FLAGS,
+    DD_HEADER_TRACEPARENT,
+    DD_HEADER_TRACESTATE,
+    DD_PROPAGATION_HEADERS_COUNT,
+} dd_propagation_header;
+
+static const char *dd_propagation_header_names[DD_PROPAGATION_HEADERS_COUNT] = {
+    [DD_HEADER_B3] = "b3",
+    [DD_HEADER_X_DATADOG_ORIGIN] = "x-datadog-origin",
+    [DD_HEADER_X_DATADOG_TRACE_ID] = "x-datadog-trace-id",
+    [DD_HEADER_X_DATADOG_PARENT_ID] = "x-datadog-parent-id",
+    [DD_HEADER_X_DATADOG_SAMPLING_PRIORITY] = "x-datadog-sampling-priority",
+    [DD_HEADER_X_DATADOG_TAGS] = "x-datadog-tags",
+    [DD_HEADER_X_B3_TRACEID] = "x-b3-traceid",
+    [DD_HEADER_X_B3_SPANID] = "x-b3-spanid",
+    [DD_HEADER_X_B3_SAMPLED] = "x-b3-sampled",
+    [DD_HEADER_X_B3_FLAGS] = "x-b3-flags",
+    [DD_HEADER_TRACEPARENT] = "traceparent",
+    [DD_HEADER_TRACESTATE] = "tracestate",
+};
+
+// Interned on MINIT, so that their hashes are computed once: "x-datadog-trace-id" and "HTTP_X_DATADOG_TRACE_ID"
+static zend_string *dd_propagation_header_lowercase[DD_PROPAGATION_HEADERS_COUNT];
+static zend_string *dd_propagation_header_server_vars[DD_PROPAGATION_HEADERS_COUNT];
+
+static void dd_propagation_headers_minit(void) {
+    for (int i = 0; i < DD_PROPAGATION_HEADERS_COUNT; ++i) {
+        const char *name = dd_propagation_header_names[i];
+        size_t len = strlen(name);
+        dd_propagation_header_lowercase[i] = zend_string_init_interned(name, len, 1);
+
+        char server_var[sizeof("HTTP_x-datadog-sampling-priority")];
+        memcpy(server_var, "HTTP_", 5);
+        for (size_t j = 0; j < len; ++j) {
+            server_var[5 + j] = name[j] == '-' ? '_' : (char)toupper(name[j]);
+        }
+        dd_propagation_header_server_vars[i] = zend_string_init_interned(server_var, len + 5, 1);
+    }
+}
+
+// Returns an owned reference to the header value
+typedef bool (*dd_read_propagation_header)(dd_propagation_header header, zend_string **header_value, void *data);
+
+void ddtrace_read_distributed_tracing_ids(dd_read_propagation_header read_header, void *data);
 
 typedef struct {
     zend_fcall_info fci;
     zend_fcall_info_cache fcc;
 } dd_fci_fcc_pair;
 
-static bool dd_read_userspace_header(zai_string_view zai_header, const char *lowercase_header, zend_string **header_value, void *data) {
-    UNUSED(zai_header);
+static bool dd_read_userspace_header(dd_propagation_header header, zend_string **header_value, void *data) {
     dd_fci_fcc_pair *func = (dd_fci_fcc_pair *) data;
     zval retval, arg;
     func->fci.params = &arg;
-    ZVAL_STRING(&arg, lowercase_header);
+    ZVAL_INTERNED_STR(&arg, dd_propagation_header_lowercase[header]);
 
     if (zend_call_function_with_return_value(&func->fci, &func->fcc, &retval) != SUCCESS || Z_TYPE(retval) <= IS_NULL) {
-        zval_ptr_dtor(&arg);
         return false;
     }
 
     *header_value = zval_get_string(&retval);
 
-    zval_ptr_dtor(&arg);
     zval_ptr_dtor(&retval);
 
     return true;
 }
 
-static bool dd_read_array_header(zai_string_view zai_header, const char *lowercase_header, zend_string **header_value, void *data) {
-    UNUSED(zai_header);
+static bool dd_read_array_header(dd_propagation_header header, zend_string **header_value, void *data) {
     zend_array *array = (zend_array *) data;
-    zval *value = zend_hash_str_find(array, lowercase_header, strlen(lowercase_header));
+    zval *value = zend_hash_find(array, dd_propagation_header_lowercase[header]);
     if (!value) {
         return false;
     }
@@ -2162,7 +2414,7 @@ PHP_FUNCTION(DDTrace_extract_ip_from_headers) {
 
     zval meta;
     array_init(&meta);
-    ddtrace_extract_ip_from_headers(arr, Z_ARR(meta));
+    ddtrace_extract_ip_from_headers(arr, Z_ARR(meta), false);
 
     RETURN_ARR(Z_ARR(meta));
 }
@@ -2194,7 +2446,90 @@ static inline bool dd_is_hex_char(char chr) {
     return (chr >= '0' && chr <= '9') || (chr >= 'a' && chr <= 'f');
 }
 
-void ddtrace_read_distributed_tracing_ids(bool (*read_header)(zai_string_view, const char *, zend_string **header_value, void *data), void *data) {
+#define DD_EXTRACT_STYLES_RESOLVED (1 << 0)
+#define DD_EXTRACT_STYLE_DATADOG (1 << 1)
+#define DD_EXTRACT_STYLE_TRACECONTEXT (1 << 2)
+#define DD_EXTRACT_STYLE_B3 (1 << 3)
+#define DD_EXTRACT_STYLE_B3_SINGLE_HEADER (1 << 4)
+
+bool ddtrace_alter_uri_fragment_regex_config(zval *old_value, zval *new_value) {
+    // re-applying the same environment value on RINIT keeps the normalizers, otherwise they are recompiled on next use
+    if (!zend_is_identical(old_value, new_value)) {
+        ddtrace_invalidate_uri_normalizers(true, true);
+    }
+    return true;
+}
+
+bool ddtrace_alter_uri_mapping_incoming_config(zval *old_value, zval *new_value) {
+    if (!zend_is_identical(old_value, new_value)) {
+        ddtrace_invalidate_uri_normalizers(true, false);
+    }
+    return true;
+}
+
+bool ddtrace_alter_uri_mapping_outgoing_config(zval *old_value, zval *new_value) {
+    if (!zend_is_identical(old_value, new_value)) {
+        ddtrace_invalidate_uri_normalizers(false, true);
+    }
+    return true;
+}
+
+bool ddtrace_alter_resource_uri_query_param_allowed_config(zval *old_value, zval *new_value) {
+    if (!zend_is_identical(old_value, new_value)) {
+        ddtrace_invalidate_query_string_filters(false, true);
+    }
+    return true;
+}
+
+bool ddtrace_alter_http_url_query_param_allowed_config(zval *old_value, zval *new_value) {
+    if (!zend_is_identical(old_value, new_value)) {
+        ddtrace_invalidate_query_string_filters(true, false);
+    }
+    return true;
+}
+
+bool ddtrace_alter_obfuscation_query_string_regexp_config(zval *old_value, zval *new_value) {
+    if (!zend_is_identical(old_value, new_value)) {
+        ddtrace_invalidate_query_string_filters(true, true);
+    }
+    return true;
+}
+
+bool ddtrace_alter_propagation_style_extract_config(zval *old_value, zval *new_value) {
+    UNUSED(old_value, new_value);
+    // resolved again on next use
+    DDTRACE_G(propagation_extract_styles) = 0;
+    return true;
+}
+
+static uint8_t dd_propagation_extract_styles(void) {
+    uint8_t styles = DDTRACE_G(propagation_extract_styles);
+    if (EXPECTED(styles)) {
+        return styles;
+    }
+
+    zend_array *extract = zai_config_is_modified(DDTRACE_CONFIG_DD_TRACE_PROPAGATION_STYLE)
+            && !zai_config_is_modified(DDTRACE_CONFIG_DD_TRACE_PROPAGATION_STYLE_EXTRACT)
+            ? get_DD_TRACE_PROPAGATION_STYLE() : get_DD_TRACE_PROPAGATION_STYLE_EXTRACT();
+    styles = DD_EXTRACT_STYLES_RESOLVED;
+    if (zend_hash_str_exists(extract, ZEND_STRL("datadog"))) {
+        styles |= DD_EXTRACT_STYLE_DATADOG;
+    }
+    if (zend_hash_str_exists(extract, ZEND_STRL("tracecontext"))) {
+        styles |= DD_EXTRACT_STYLE_TRACECONTEXT;
+    }
+    if (zend_hash_str_exists(extract, ZEND_STRL("b3")) || zend_hash_str_exists(extract, ZEND_STRL("b3multi"))) {
+        styles |= DD_EXTRACT_STYLE_B3;
+    }
+    if (zend_hash_str_exists(extract, ZEND_STRL("b3 single header"))) {
+        styles |= DD_EXTRACT_STYLE_B3_SINGLE_HEADER;
+    }
+
+    DDTRACE_G(propagation_extract_styles) = styles;
+    return styles;
+}
+
+void ddtrace_read_distributed_tracing_ids(dd_read_propagation_header read_header, void *data) {
     zend_string *trace_id_str, *parent_id_str, *priority_str, *propagated_tags, *b3_header_str, *traceparent, *tracestate;
 
     DDTRACE_G(distributed_trace_id) = (ddtrace_trace_id){ 0 };
@@ -2202,19 +2537,17 @@ void ddtrace_read_distributed_tracing_ids(bool (*read_header)(zai_string_view, c
     DDTRACE_G(dd_origin) = NULL;
     DDTRACE_G(tracestate) = NULL;
 
-    zend_array *extract = zai_config_is_modified(DDTRACE_CONFIG_DD_TRACE_PROPAGATION_STYLE)
-            && !zai_config_is_modified(DDTRACE_CONFIG_DD_TRACE_PROPAGATION_STYLE_EXTRACT)
-            ? get_DD_TRACE_PROPAGATION_STYLE() : get_DD_TRACE_PROPAGATION_STYLE_EXTRACT();
-    bool parse_datadog = zend_hash_str_exists(extract, ZEND_STRL("datadog"));
-    bool parse_tracestate = zend_hash_str_exists(extract, ZEND_STRL("tracecontext"));
-    bool parse_b3 = zend_hash_str_exists(extract, ZEND_STRL("b3")) || zend_hash_str_exists(extract, ZEND_STRL("b3multi"));
-    bool parse_b3_single = zend_hash_str_exists(extract, ZEND_STRL("b3 single header"));
+    uint8_t styles = dd_propagation_extract_styles();
+    bool parse_datadog = styles & DD_EXTRACT_STYLE_DATADOG;
+    bool parse_tracestate = styles & DD_EXTRACT_STYLE_TRACECONTEXT;
+    bool parse_b3 = styles & DD_EXTRACT_STYLE_B3;
+    bool parse_b3_single = styles & DD_EXTRACT_STYLE_B3_SINGLE_HEADER;
     bool parse_datadog_meta_headers = parse_datadog || parse_b3 || parse_b3_single;
 
     int priority_sampling = DDTRACE_PRIORITY_SAMPLING_UNKNOWN;
     bool reset_decision_maker = false;
 
-    if (parse_b3_single && read_header(ZAI_STRL_VIEW("B3"), "b3", &b3_header_str, data)) {
+    if (parse_b3_single && read_header(DD_HEADER_B3, &b3_header_str, data)) {
         char *b3_ptr = ZSTR_VAL(b3_header_str), *b3_end = b3_ptr + ZSTR_LEN(b3_header_str);
         char *b3_traceid = b3_ptr;
         while (b3_ptr < b3_end && *b3_ptr != '-') {
@@ -2252,29 +2585,23 @@ void ddtrace_read_distributed_tracing_ids(bool (*read_header)(zai_string_view, c
     }
 
     if (parse_datadog_meta_headers) {
-        read_header(ZAI_STRL_VIEW("X_DATADOG_ORIGIN"), "x-datadog-origin", &DDTRACE_G(dd_origin), data);
+        read_header(DD_HEADER_X_DATADOG_ORIGIN, &DDTRACE_G(dd_origin), data);
     }
 
-    if (parse_datadog && read_header(ZAI_STRL_VIEW("X_DATADOG_TRACE_ID"), "x-datadog-trace-id", &trace_id_str, data)) {
-        zval trace_zv;
-        ZVAL_STR(&trace_zv, trace_id_str);
-        DDTRACE_G(distributed_trace_id) = (ddtrace_trace_id){ .low = ddtrace_parse_userland_span_id(&trace_zv) };
+    if (parse_datadog && read_header(DD_HEADER_X_DATADOG_TRACE_ID, &trace_id_str, data)) {
+        DDTRACE_G(distributed_trace_id) = (ddtrace_trace_id){ .low = ddtrace_parse_userland_span_id_str(ZSTR_VAL(trace_id_str), ZSTR_LEN(trace_id_str)) };
         zend_string_release(trace_id_str);
-    } else if (parse_b3 && read_header(ZAI_STRL_VIEW("X_B3_TRACEID"), "x-b3-traceid", &trace_id_str, data)) {
+    } else if (parse_b3 && read_header(DD_HEADER_X_B3_TRACEID, &trace_id_str, data)) {
         DDTRACE_G(distributed_trace_id) = dd_parse_b3_trace_id(ZSTR_VAL(trace_id_str), ZSTR_LEN(trace_id_str));
         zend_string_release(trace_id_str);
     }
 
     if (DDTRACE_G(distributed_trace_id).low || DDTRACE_G(distributed_trace_id).high) {
-        if (parse_datadog && read_header(ZAI_STRL_VIEW("X_DATADOG_PARENT_ID"), "x-datadog-parent-id", &parent_id_str, data)) {
-            zval parent_zv;
-            ZVAL_STR(&parent_zv, parent_id_str);
-            DDTRACE_G(distributed_parent_trace_id) = ddtrace_parse_userland_span_id(&parent_zv);
+        if (parse_datadog && read_header(DD_HEADER_X_DATADOG_PARENT_ID, &parent_id_str, data)) {
+            DDTRACE_G(distributed_parent_trace_id) = ddtrace_parse_userland_span_id_str(ZSTR_VAL(parent_id_str), ZSTR_LEN(parent_id_str));
             zend_string_release(parent_id_str);
-        } else if (parse_b3 && read_header(ZAI_STRL_VIEW("X_B3_SPANID"), "x-b3-spanid", &parent_id_str, data)) {
-            zval parent_zv;
-            ZVAL_STR(&parent_zv, parent_id_str);
-            DDTRACE_G(distributed_parent_trace_id) = ddtrace_parse_hex_span_id(&parent_zv);
+        } else if (parse_b3 && read_header(DD_HEADER_X_B3_SPANID, &parent_id_str, data)) {
+            DDTRACE_G(distributed_parent_trace_id) = ddtrace_parse_hex_span_id_str(ZSTR_VAL(parent_id_str), ZSTR_LEN(parent_id_str));
             zend_string_release(parent_id_str);
         }
     } else {
@@ -2283,10 +2610,10 @@ void ddtrace_read_distributed_tracing_ids(bool (*read_header)(zai_string_view, c
         parse_datadog = 0;
     }
 
-    if (parse_datadog && read_header(ZAI_STRL_VIEW("X_DATADOG_SAMPLING_PRIORITY"), "x-datadog-sampling-priority", &priority_str, data)) {
+    if (parse_datadog && read_header(DD_HEADER_X_DATADOG_SAMPLING_PRIORITY, &priority_str, data)) {
         priority_sampling = strtol(ZSTR_VAL(priority_str), NULL, 10);
         zend_string_release(priority_str);
-    } else if (parse_b3 && read_header(ZAI_STRL_VIEW("X_B3_SAMPLED"), "x-b3-sampled", &priority_str, data)) {
+    } else if (parse_b3 && read_header(DD_HEADER_X_B3_SAMPLED, &priority_str, data)) {
         if (ZSTR_LEN(priority_str) == 1) {
             if (ZSTR_VAL(priority_str)[0] == '0') {
                 priority_sampling = 0;
@@ -2299,20 +2626,20 @@ void ddtrace_read_distributed_tracing_ids(bool (*read_header)(zai_string_view, c
             priority_sampling = 0;
         }
         zend_string_release(priority_str);
-    } else if (parse_b3 && read_header(ZAI_STRL_VIEW("X_B3_FLAGS"), "x-b3-flags", &priority_str, data)) {
+    } else if (parse_b3 && read_header(DD_HEADER_X_B3_FLAGS, &priority_str, data)) {
         if (ZSTR_LEN(priority_str) == 1 && ZSTR_VAL(priority_str)[1] == '1') {
             priority_sampling = PRIORITY_SAMPLING_USER_KEEP;
         }
         zend_string_release(priority_str);
     }
 
-    if (parse_datadog_meta_headers && read_header(ZAI_STRL_VIEW("X_DATADOG_TAGS"), "x-datadog-tags", &propagated_tags, data)) {
+    if (parse_datadog_meta_headers && read_header(DD_HEADER_X_DATADOG_TAGS, &propagated_tags, data)) {
         ddtrace_add_tracer_tags_from_header(propagated_tags);
         zend_string_release(propagated_tags);
     }
 
     // "{version:2}-{trace-id:32}-{parent-id:16}-{trace-flags:2}"
-    if (parse_tracestate && read_header(ZAI_STRL_VIEW("TRACEPARENT"), "traceparent", &traceparent, data)) {
+    if (parse_tracestate && read_header(DD_HEADER_TRACEPARENT, &traceparent, data)) {
         do {
             // skip whitespace
             char *ws = ZSTR_VAL(traceparent), *wsend = ws + ZSTR_LEN(traceparent);
@@ -2368,7 +2695,7 @@ void ddtrace_read_distributed_tracing_ids(bool (*read_header)(zai_string_view, c
         zend_string_release(traceparent);
 
        // header format: "[*,]dd=s:1;o:rum;t.dm:-4;t.usr.id:12345[,*]"
-        if (parse_tracestate && read_header(ZAI_STRL_VIEW("TRACESTATE"), "tracestate", &tracestate, data)) {
+        if (parse_tracestate && read_header(DD_HEADER_TRACESTATE, &tracestate, data)) {
             bool last_comma = true;
             DDTRACE_G(tracestate) = zend_string_alloc(ZSTR_LEN(tracestate), 0);
             char *persist = ZSTR_VAL(DDTRACE_G(tracestate));
@@ -2485,9 +2812,9 @@ void ddtrace_read_distributed_tracing_ids(bool (*read_header)(zai_string_view, c
     }
 }
 
-static bool dd_read_zai_header(zai_string_view zai_header, const char *lowercase_header, zend_string **header_value, void *data) {
-    UNUSED(lowercase_header, data);
-    if (zai_read_header(zai_header, header_value) != ZAI_HEADER_SUCCESS) {
+static bool dd_read_zai_header(dd_propagation_header header, zend_string **header_value, void *data) {
+    UNUSED(data);
+    if (zai_read_server_header(dd_propagation_header_server_vars[header], header_value) != ZAI_HEADER_SUCCESS) {
         return false;
     }
     *header_value = zend_string_copy(*header_value);
@@ -43,11 +43,17 @@ static inline zend_array *ddtrace_spandata_property_force_array(zval *zv) {
     SEPARATE_ARRAY(zv);
     return Z_ARR_P(zv);
 }
+// The meta property is left undefined while the span only carries inline tags, see ddtrace_span_add_meta()
+void ddtrace_span_materialize_meta(ddtrace_span_data *span);
 static inline zval *ddtrace_spandata_property_meta_zval(ddtrace_span_data *span) {
     return OBJ_PROP_NUM((zend_object *)span, 4);
 }
 static inline zend_array *ddtrace_spandata_property_meta(ddtrace_span_data *span) {
-    return ddtrace_spandata_property_force_array(ddtrace_spandata_property_meta_zval(span));
+    zval *meta = ddtrace_spandata_property_meta_zval(span);
+    if (UNEXPECTED(Z_TYPE_P(meta) == IS_UNDEF)) {
+        ddtrace_span_materialize_meta(span);
+    }
+    return ddtrace_spandata_property_force_array(meta);
 }
 static inline zval *ddtrace_spandata_property_metrics_zval(ddtrace_span_data *span) {
     return OBJ_PROP_NUM((zend_object *)span, 5);
@@ -75,7 +81,16 @@ void dd_prepare_for_new_trace(void);
 void ddtrace_disable_tracing_in_current_request(void);
 bool ddtrace_alter_dd_trace_disabled_config(zval *old_value, zval *new_value);
 bool ddtrace_alter_sampling_rules_file_config(zval *old_value, zval *new_value);
+bool ddtrace_alter_sampling_rules_config(zval *old_value, zval *new_value);
+bool ddtrace_alter_span_sampling_rules_config(zval *old_value, zval *new_value);
+bool ddtrace_alter_uri_fragment_regex_config(zval *old_value, zval *new_value);
+bool ddtrace_alter_uri_mapping_incoming_config(zval *old_value, zval *new_value);
+bool ddtrace_alter_uri_mapping_outgoing_config(zval *old_value, zval *new_value);
+bool ddtrace_alter_resource_uri_query_param_allowed_config(zval *old_value, zval *new_value);
+bool ddtrace_alter_http_url_query_param_allowed_config(zval *old_value, zval *new_value);
+bool ddtrace_alter_obfuscation_query_string_regexp_config(zval *old_value, zval *new_value);
 bool ddtrace_alter_default_propagation_style(zval *old_value, zval *new_value);
+bool ddtrace_alter_propagation_style_extract_config(zval *old_value, zval *new_value);
 void dd_force_shutdown_tracing(void);
 
 typedef struct {
@@ -111,19 +126,40 @@ ZEND_BEGIN_MODULE_GLOBALS(ddtrace)
     zend_array tracestate_unknown_dd_keys;
     zend_bool backtrace_handler_already_run;
     ddtrace_error_data active_error;
-    dogstatsd_client dogstatsd_client;
+    dogstatsd_client dogstatsd_client; // kept across requests, see ddtrace_dogstatsd_client_rinit()
+    pid_t dogstatsd_client_pid; // process which created dogstatsd_client, 0 if there is none
+    zend_string *dogstatsd_client_config; // persistent, the settings dogstatsd_client was created with
+    uint64_t dogstatsd_client_last_heartbeat; // monotonic milliseconds, 0 if none was sent by this client yet
+    HashTable pdo_dsn_tags; // persistent, see ddtrace_pdo_dsn_tags()
+    HashTable sql_quantization_cache; // persistent, see ddtrace_quantize_sql()
+    struct ddtrace_coms_stats_shard_t *stats_shard; // client-side stats not handed over to the writer yet
     zend_bool in_shutdown;
 
     zend_long default_priority_sampling;
     zend_long propagated_priority_sampling;
+    struct ddtrace_sampling_rules *sampling_rules; // persistent, DD_TRACE_SAMPLING_RULES compiled on first use
+    zend_bool sampling_rules_changed; // DD_TRACE_SAMPLING_RULES was changed at runtime in this request
+    struct ddtrace_span_sampling_rules *span_sampling_rules; // persistent, likewise for DD_SPAN_SAMPLING_RULES
+    zend_bool span_sampling_rules_changed;
+    struct zai_uri_normalizer *uri_normalizer_incoming; // persistent, likewise for DD_TRACE_RESOURCE_URI_* incoming
+    struct zai_uri_normalizer *uri_normalizer_outgoing; // and outgoing
+    zend_bool uri_normalizer_incoming_changed; // their config was changed at runtime in this request
+    zend_bool uri_normalizer_outgoing_changed;
+    struct zai_query_string_filter *url_query_string_filter; // DD_TRACE_HTTP_URL_QUERY_PARAM_ALLOWED, likewise
+    struct zai_query_string_filter *resource_query_string_filter; // DD_TRACE_RESOURCE_URI_QUERY_PARAM_ALLOWED
+    zend_bool url_query_string_filter_changed;
+    zend_bool resource_query_string_filter_changed;
     ddtrace_span_stack *active_stack; // never NULL except tracer is disabled
     ddtrace_span_stack *top_closed_stack;
     HashTable traced_spans; // tie a span to a specific active execute_data
     uint32_t open_spans_count;
     uint32_t closed_spans_count;
     uint32_t dropped_spans_count;
+    ddtrace_span_data *span_pool; // flushed spans kept for reuse, chained via next
+    uint32_t span_pool_count;
     int64_t compile_time_microseconds;
     ddtrace_trace_id distributed_trace_id;
+    uint8_t propagation_extract_styles; // resolved from the config on first use in a request, 0 if not yet
     uint64_t distributed_parent_trace_id;
     zend_string *dd_origin;
 
@@ -519,6 +519,91 @@ namespace DDTrace\Config {
     function integration_analytics_sample_rate(string $integrationName): float {}
 }
 
+namespace DDTrace\Integrations {
+
+    /**
+     * Parse the connection tags out of a PDO DSN. The result is cached per distinct DSN for the lifetime of the process.
+     *
+     * @param string $dsn The PDO data source name, e.g. "mysql:host=localhost;dbname=test"
+     * @return array The tags: db.engine, db.system and, if present, db.charset, db.name, out.host and out.port
+     */
+    function parse_pdo_dsn(string $dsn): array {}
+
+    /**
+     * Add tags to a span, overwriting existing ones of the same name
+     *
+     * @param \DDTrace\SpanData $span The span to add the tags to
+     * @param array $tags A map of tag name to value
+     */
+    function add_span_meta(\DDTrace\SpanData $span, array $tags): void {}
+
+    /**
+     * Filter a query string by the allowed parameters and redact it with the obfuscation regex. The filter is compiled
+     * once and kept as long as the configuration does not change.
+     *
+     * @param string $queryString The query string, without the leading question mark
+     * @param bool $resource Apply datadog.trace.resource_uri_query_param_allowed instead of
+     *                       datadog.trace.http_url_query_param_allowed
+     * @return string The filtered query string, possibly empty
+     */
+    function filter_query_string(string $queryString, bool $resource = false): string {}
+
+    /**
+     * Get the Database Monitoring propagation mode applying to a database backend.
+     *
+     * @param string $backend The database backend, like the PDO driver name
+     * @return int One of the DDTrace\DBM_PROPAGATION_* constants, DDTrace\DBM_PROPAGATION_DISABLED for unsupported
+     *             backends
+     */
+    function dbm_propagation_mode(string $backend): int {}
+
+    /**
+     * Prefix a query with the Database Monitoring comment, carrying the service, environment and version of the trace,
+     * and the traceparent in full propagation mode.
+     *
+     * @param string $query The SQL query
+     * @param string $databaseService The service of the database span
+     * @param int $mode One of the DDTrace\DBM_PROPAGATION_* constants
+     * @return string The commented query
+     */
+    function propagate_via_sql_comments(
+        string $query,
+        string $databaseService,
+        int $mode = \DDTrace\DBM_PROPAGATION_FULL
+    ): string {}
+}
+
+namespace DDTrace\ObjectStore {
+
+    /**
+     * Attach a value to an object, for as long as the object lives. Non-objects are ignored.
+     *
+     * @param mixed $instance The object to attach the value to
+     * @param string $key The name of the value
+     * @param mixed $value The value
+     */
+    function put(mixed $instance, string $key, mixed $value): void {}
+
+    /**
+     * Retrieve a value attached to an object
+     *
+     * @param mixed $instance The object the value is attached to
+     * @param string $key The name of the value
+     * @param mixed $default Returned if there is no such value, or it is null
+     * @return mixed The value attached to the object
+     */
+    function get(mixed $instance, string $key, mixed $default = null): mixed {}
+
+    /**
+     * Copy a value attached to an object onto another object, e.g. from a connection to its statements
+     *
+     * @param mixed $source The object the value is attached to
+     * @param mixed $destination The object to attach the value to
+     * @param string $key The name of the value
+     */
+    function propagate(mixed $source, mixed $destination, string $key): void {}
+}
+
 namespace DDTrace\Testing {
     /**
      * Overrides PHP's default error handling.
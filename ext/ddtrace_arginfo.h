@@ -125,6 +125,48 @@ ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_DDTrace_Config_integration_analy
 	ZEND_ARG_TYPE_INFO(0, integrationName, IS_STRING, 0)
 ZEND_END_ARG_INFO()
 
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_DDTrace_Integrations_parse_pdo_dsn, 0, 1, IS_ARRAY, 0)
+	ZEND_ARG_TYPE_INFO(0, dsn, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_DDTrace_Integrations_add_span_meta, 0, 2, IS_VOID, 0)
+	ZEND_ARG_OBJ_INFO(0, span, DDTrace\\SpanData, 0)
+	ZEND_ARG_TYPE_INFO(0, tags, IS_ARRAY, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_DDTrace_Integrations_filter_query_string, 0, 1, IS_STRING, 0)
+	ZEND_ARG_TYPE_INFO(0, queryString, IS_STRING, 0)
+	ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, resource, _IS_BOOL, 0, "false")
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_DDTrace_Integrations_dbm_propagation_mode, 0, 1, IS_LONG, 0)
+	ZEND_ARG_TYPE_INFO(0, backend, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_DDTrace_Integrations_propagate_via_sql_comments, 0, 2, IS_STRING, 0)
+	ZEND_ARG_TYPE_INFO(0, query, IS_STRING, 0)
+	ZEND_ARG_TYPE_INFO(0, databaseService, IS_STRING, 0)
+	ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, mode, IS_LONG, 0, "DDTrace\\DBM_PROPAGATION_FULL")
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_DDTrace_ObjectStore_put, 0, 3, IS_VOID, 0)
+	ZEND_ARG_TYPE_INFO(0, instance, IS_MIXED, 0)
+	ZEND_ARG_TYPE_INFO(0, key, IS_STRING, 0)
+	ZEND_ARG_TYPE_INFO(0, value, IS_MIXED, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_DDTrace_ObjectStore_get, 0, 2, IS_MIXED, 0)
+	ZEND_ARG_TYPE_INFO(0, instance, IS_MIXED, 0)
+	ZEND_ARG_TYPE_INFO(0, key, IS_STRING, 0)
+	ZEND_ARG_TYPE_INFO_WITH_DEFAULT_VALUE(0, default, IS_MIXED, 0, "null")
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_DDTrace_ObjectStore_propagate, 0, 3, IS_VOID, 0)
+	ZEND_ARG_TYPE_INFO(0, source, IS_MIXED, 0)
+	ZEND_ARG_TYPE_INFO(0, destination, IS_MIXED, 0)
+	ZEND_ARG_TYPE_INFO(0, key, IS_STRING, 0)
+ZEND_END_ARG_INFO()
+
 ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_DDTrace_Testing_trigger_error, 0, 2, IS_VOID, 0)
 	ZEND_ARG_TYPE_INFO(0, message, IS_STRING, 0)
 	ZEND_ARG_TYPE_INFO(0, errorType, IS_LONG, 0)
@@ -272,6 +314,14 @@ ZEND_FUNCTION(DDTrace_flush);
 ZEND_FUNCTION(DDTrace_System_container_id);
 ZEND_FUNCTION(DDTrace_Config_integration_analytics_enabled);
 ZEND_FUNCTION(DDTrace_Config_integration_analytics_sample_rate);
+ZEND_FUNCTION(DDTrace_Integrations_parse_pdo_dsn);
+ZEND_FUNCTION(DDTrace_Integrations_add_span_meta);
+ZEND_FUNCTION(DDTrace_Integrations_filter_query_string);
+ZEND_FUNCTION(DDTrace_Integrations_dbm_propagation_mode);
+ZEND_FUNCTION(DDTrace_Integrations_propagate_via_sql_comments);
+ZEND_FUNCTION(DDTrace_ObjectStore_put);
+ZEND_FUNCTION(DDTrace_ObjectStore_get);
+ZEND_FUNCTION(DDTrace_ObjectStore_propagate);
 ZEND_FUNCTION(DDTrace_Testing_trigger_error);
 ZEND_FUNCTION(dd_trace_env_config);
 ZEND_FUNCTION(dd_trace_disable_in_request);
@@ -344,6 +394,14 @@ static const zend_function_entry ext_functions[] = {
 	ZEND_NS_FALIAS("DDTrace\\System", container_id, DDTrace_System_container_id, arginfo_DDTrace_System_container_id)
 	ZEND_NS_FALIAS("DDTrace\\Config", integration_analytics_enabled, DDTrace_Config_integration_analytics_enabled, arginfo_DDTrace_Config_integration_analytics_enabled)
 	ZEND_NS_FALIAS("DDTrace\\Config", integration_analytics_sample_rate, DDTrace_Config_integration_analytics_sample_rate, arginfo_DDTrace_Config_integration_analytics_sample_rate)
+	ZEND_NS_FALIAS("DDTrace\\Integrations", parse_pdo_dsn, DDTrace_Integrations_parse_pdo_dsn, arginfo_DDTrace_Integrations_parse_pdo_dsn)
+	ZEND_NS_FALIAS("DDTrace\\Integrations", add_span_meta, DDTrace_Integrations_add_span_meta, arginfo_DDTrace_Integrations_add_span_meta)
+	ZEND_NS_FALIAS("DDTrace\\Integrations", filter_query_string, DDTrace_Integrations_filter_query_string, arginfo_DDTrace_Integrations_filter_query_string)
+	ZEND_NS_FALIAS("DDTrace\\Integrations", dbm_propagation_mode, DDTrace_Integrations_dbm_propagation_mode, arginfo_DDTrace_Integrations_dbm_propagation_mode)
+	ZEND_NS_FALIAS("DDTrace\\Integrations", propagate_via_sql_comments, DDTrace_Integrations_propagate_via_sql_comments, arginfo_DDTrace_Integrations_propagate_via_sql_comments)
+	ZEND_NS_FALIAS("DDTrace\\ObjectStore", put, DDTrace_ObjectStore_put, arginfo_DDTrace_ObjectStore_put)
+	ZEND_NS_FALIAS("DDTrace\\ObjectStore", get, DDTrace_ObjectStore_get, arginfo_DDTrace_ObjectStore_get)
+	ZEND_NS_FALIAS("DDTrace\\ObjectStore", propagate, DDTrace_ObjectStore_propagate, arginfo_DDTrace_ObjectStore_propagate)
 	ZEND_NS_FALIAS("DDTrace\\Testing", trigger_error, DDTrace_Testing_trigger_error, arginfo_DDTrace_Testing_trigger_error)
 	ZEND_FE(dd_trace_env_config, arginfo_dd_trace_env_config)
 	ZEND_FE(dd_trace_disable_in_request, arginfo_dd_trace_disable_in_request)
@@ -1,6 +1,7 @@
 #include "dogstatsd_client.h"
 
 #include <dogstatsd_client/client.h>
+#include <time.h>
 
 #include "configuration.h"
 #include "ddtrace.h"
@@ -11,16 +12,32 @@ ZEND_EXTERN_MODULE_GLOBALS(ddtrace);
 #define METRICS_CONST_TAGS "lang:php,lang_version:" PHP_VERSION ",tracer_version:" PHP_DDTRACE_VERSION
 #define DEFAULT_UDS_PATH "/var/run/datadog/dsd.socket"
 
-void ddtrace_dogstatsd_client_minit(void) { DDTRACE_G(dogstatsd_client) = dogstatsd_client_default_ctor(); }
+// The heartbeat is a gauge, which the agent keeps the last value of, so it is reported at most this often
+#define DD_DOGSTATSD_HEARTBEAT_INTERVAL_MSEC 1000
 
-static void _set_dogstatsd_client_globals(dogstatsd_client client) { DDTRACE_G(dogstatsd_client) = client; }
+void ddtrace_dogstatsd_client_minit(void) {
+    DDTRACE_G(dogstatsd_client) = dogstatsd_client_default_ctor();
+    DDTRACE_G(dogstatsd_client_pid) = 0;
+    DDTRACE_G(dogstatsd_client_config) = NULL;
+}
+
+static uint64_t dd_monotonic_msec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * UINT64_C(1000) + ts.tv_nsec / 1000000;
+}
 
 static struct addrinfo *dd_alloc_unix_addr(const char *path, size_t len) {
+    if (len >= sizeof(((struct sockaddr_un *)0)->sun_path)) {
+        ddtrace_log_debugf("Dogstatsd client encountered a too long unix socket path: %s", path);
+        return NULL;
+    }
+
     struct addrinfo *addrs = malloc(sizeof(*addrs));
     addrs->ai_next = NULL;
     addrs->ai_family = PF_UNIX;
     addrs->ai_protocol = 0;
-    addrs->ai_socktype = SOCK_STREAM;
+    addrs->ai_socktype = SOCK_DGRAM;
     addrs->ai_addrlen = sizeof(struct sockaddr_un);
     struct sockaddr_un *unixaddr = calloc(1, sizeof(struct sockaddr_un));
     addrs->ai_addr = (struct sockaddr *)unixaddr;
@@ -29,96 +46,161 @@ static struct addrinfo *dd_alloc_unix_addr(const char *path, size_t len) {
     return addrs;
 }
 
-void ddtrace_dogstatsd_client_rinit(void) {
-    bool health_metrics_enabled = get_DD_TRACE_HEALTH_METRICS_ENABLED();
-    dogstatsd_client client = dogstatsd_client_default_ctor();
-
-    while (health_metrics_enabled) {
-        struct addrinfo *addrs;
-        char *url = ZSTR_VAL(get_DD_DOGSTATSD_URL());
-        char *host, *port;
-        if (*url) {
-            if (strlen(url) > 7 && strncmp("unix://", url, 7) == 0) {
-                addrs = dd_alloc_unix_addr(url + 7, strlen(url) - 7);
-            } else if (strlen(url) > 6 && strncmp("udp://", url, 6) == 0) {
-                char *colon = strchr(url + 6, ':');
-                if (!colon) {
-                    ddtrace_log_debugf(
-                        "Dogstatsd client encountered an invalid udp:// DD_DOGSTATSD_URL: %s, missing a colon followed by a port",
-                        url);
-                    break;
-                }
-
-                host = estrndup(url + 6, colon - url - 6);
-
-                port = colon + 1;
-                int err;
-                if ((err = dogstatsd_client_getaddrinfo(&addrs, host, port))) {
-                    ddtrace_log_debugf("Dogstatsd client failed looking up %s:%s: %s", host, port,
-                                       (err == EAI_SYSTEM) ? strerror(errno) : gai_strerror(err));
-                    efree(host);
-                    break;
-                }
-                efree(host);
-            } else {
+static dogstatsd_client dd_dogstatsd_client_create(void) {
+    struct addrinfo *addrs;
+    char *url = ZSTR_VAL(get_DD_DOGSTATSD_URL());
+    char *host, *port;
+    if (*url) {
+        if (strlen(url) > 7 && strncmp("unix://", url, 7) == 0) {
+            addrs = dd_alloc_unix_addr(url + 7, strlen(url) - 7);
+        } else if (strlen(url) > 6 && strncmp("udp://", url, 6) == 0) {
+            char *colon = strchr(url + 6, ':');
+            if (!colon) {
                 ddtrace_log_debugf(
-                    "Dogstatsd client encountered an invalid DD_DOGSTATSD_URL: %s, expecting url starting with unix:// or udp://",
+                    "Dogstatsd client encountered an invalid udp:// DD_DOGSTATSD_URL: %s, missing a colon followed by a port",
                     url);
-                break;
+                return dogstatsd_client_default_ctor();
             }
 
-            host = url;
-            port = NULL;
+            host = estrndup(url + 6, colon - url - 6);
+
+            port = colon + 1;
+            int err;
+            if ((err = dogstatsd_client_getaddrinfo(&addrs, host, port))) {
+                ddtrace_log_debugf("Dogstatsd client failed looking up %s:%s: %s", host, port,
+                                   (err == EAI_SYSTEM) ? strerror(errno) : gai_strerror(err));
+                efree(host);
+                return dogstatsd_client_default_ctor();
+            }
+            efree(host);
         } else {
-            host = ZSTR_VAL(get_DD_AGENT_HOST());
-            port = ZSTR_VAL(get_DD_DOGSTATSD_PORT());
-
-            if (!*host) {
-                if (access(DEFAULT_UDS_PATH, F_OK) == SUCCESS) {
-                    addrs = dd_alloc_unix_addr(DEFAULT_UDS_PATH, sizeof(DEFAULT_UDS_PATH));
-                    host = "unix://" DEFAULT_UDS_PATH;
-                    port = NULL;
-                } else {
-                    host = "localhost";
-                }
+            ddtrace_log_debugf(
+                "Dogstatsd client encountered an invalid DD_DOGSTATSD_URL: %s, expecting url starting with unix:// or udp://",
+                url);
+            return dogstatsd_client_default_ctor();
+        }
+
+        host = url;
+        port = NULL;
+    } else {
+        host = ZSTR_VAL(get_DD_AGENT_HOST());
+        port = ZSTR_VAL(get_DD_DOGSTATSD_PORT());
+
+        if (!*host) {
+            if (access(DEFAULT_UDS_PATH, F_OK) == SUCCESS) {
+                host = "unix://" DEFAULT_UDS_PATH;
+            } else {
+                host = "localhost";
             }
+        }
 
-            if (strlen(host) > 7 && strncmp("unix://", host, 7) == 0) {
-                addrs = dd_alloc_unix_addr(host + 7, strlen(host) - 7);
-                port = NULL;
-            } else if (port) {
-                int err;
-                if ((err = dogstatsd_client_getaddrinfo(&addrs, host, port))) {
-                    ddtrace_log_debugf("Dogstatsd client failed looking up %s:%s: %s", host, port,
-                                       (err == EAI_SYSTEM) ? strerror(errno) : gai_strerror(err));
-                    break;
-                }
+        if (strlen(host) > 7 && strncmp("unix://", host, 7) == 0) {
+            addrs = dd_alloc_unix_addr(host + 7, strlen(host) - 7);
+            port = NULL;
+        } else {
+            int err;
+            if ((err = dogstatsd_client_getaddrinfo(&addrs, host, port))) {
+                ddtrace_log_debugf("Dogstatsd client failed looking up %s:%s: %s", host, port,
+                                   (err == EAI_SYSTEM) ? strerror(errno) : gai_strerror(err));
+                return dogstatsd_client_default_ctor();
             }
         }
+    }
 
-        client = dogstatsd_client_ctor(addrs, DOGSTATSD_CLIENT_RECOMMENDED_MAX_MESSAGE_SIZE, METRICS_CONST_TAGS);
-        if (dogstatsd_client_is_default_client(client)) {
-            ddtrace_log_debugf("Dogstatsd client failed opening socket to %s%s%s", host, port ? ":" : "",
-                               port ? port : "");
-            break;
+    int buffer_len = addrs && addrs->ai_family == PF_UNIX ? DOGSTATSD_CLIENT_RECOMMENDED_UDS_MAX_MESSAGE_SIZE
+                                                          : DOGSTATSD_CLIENT_RECOMMENDED_MAX_MESSAGE_SIZE;
+    dogstatsd_client client = dogstatsd_client_ctor(addrs, buffer_len, METRICS_CONST_TAGS);
+    if (dogstatsd_client_is_default_client(client)) {
+        ddtrace_log_debugf("Dogstatsd client failed opening socket to %s%s%s", host, port ? ":" : "", port ? port : "");
+    }
+    return client;
+}
+
+static void dd_dogstatsd_client_free(dogstatsd_client *client, zend_string **config, pid_t *pid, bool flush) {
+    if (flush) {
+        dogstatsd_client_flush(client);
+    }
+    dogstatsd_client_dtor(client);
+    *client = dogstatsd_client_default_ctor();
+
+    zend_string_release(*config);
+    *config = NULL;
+    *pid = 0;
+}
+
+static void dd_dogstatsd_client_destroy(bool flush) {
+    dd_dogstatsd_client_free(&DDTRACE_G(dogstatsd_client), &DDTRACE_G(dogstatsd_client_config),
+                             &DDTRACE_G(dogstatsd_client_pid), flush);
+}
+
+/* The client is kept for the lifetime of the process, so that the address lookup and the socket are not redone on
+ * every request. It is only re-created when its settings changed, or in a forked child, where the socket and the
+ * buffered metrics still belong to the parent. */
+void ddtrace_dogstatsd_client_rinit(void) {
+    pid_t pid = getpid();
+    if (DDTRACE_G(dogstatsd_client_pid) && DDTRACE_G(dogstatsd_client_pid) != pid) {
+        dd_dogstatsd_client_destroy(false);
+    }
+
+    if (!get_DD_TRACE_HEALTH_METRICS_ENABLED()) {
+        if (DDTRACE_G(dogstatsd_client_pid)) {
+            dd_dogstatsd_client_destroy(true);
         }
+        return;
+    }
+
+    zend_string *config = zend_strpprintf(0, "%s %s %s", ZSTR_VAL(get_DD_DOGSTATSD_URL()),
+                                          ZSTR_VAL(get_DD_AGENT_HOST()), ZSTR_VAL(get_DD_DOGSTATSD_PORT()));
+    if (DDTRACE_G(dogstatsd_client_pid) && !zend_string_equals(config, DDTRACE_G(dogstatsd_client_config))) {
+        dd_dogstatsd_client_destroy(true);
+    }
 
-        double sample_rate = get_DD_TRACE_HEALTH_METRICS_HEARTBEAT_SAMPLE_RATE();
-        const char *metric = "datadog.tracer.heartbeat";
-        dogstatsd_metric_t type = DOGSTATSD_METRIC_GAUGE;
-        dogstatsd_client_status status = dogstatsd_client_metric_send(&client, metric, "1", type, sample_rate, NULL);
-        if (status != DOGSTATSD_CLIENT_OK && get_DD_TRACE_DEBUG()) {
-            const char *status_str = dogstatsd_client_status_to_str(status) ?: "(unknown dogstatsd_client_status)";
-            ddtrace_log_errf("Health metric '%s' failed to send: %s", metric, status_str);
+    if (!DDTRACE_G(dogstatsd_client_pid)) {
+        // Failures are not kept, the next request retries
+        dogstatsd_client client = dd_dogstatsd_client_create();
+        if (dogstatsd_client_is_default_client(client)) {
+            zend_string_release(config);
+            return;
         }
 
-        break;
+        DDTRACE_G(dogstatsd_client) = client;
+        DDTRACE_G(dogstatsd_client_pid) = pid;
+        DDTRACE_G(dogstatsd_client_config) = zend_string_dup(config, 1);
+        DDTRACE_G(dogstatsd_client_last_heartbeat) = 0;
+    }
+    zend_string_release(config);
+
+    uint64_t now = dd_monotonic_msec();
+    if (DDTRACE_G(dogstatsd_client_last_heartbeat) &&
+        now - DDTRACE_G(dogstatsd_client_last_heartbeat) < DD_DOGSTATSD_HEARTBEAT_INTERVAL_MSEC) {
+        return;
+    }
+    DDTRACE_G(dogstatsd_client_last_heartbeat) = now;
+
+    double sample_rate = get_DD_TRACE_HEALTH_METRICS_HEARTBEAT_SAMPLE_RATE();
+    const char *metric = "datadog.tracer.heartbeat";
+    dogstatsd_metric_t type = DOGSTATSD_METRIC_GAUGE;
+    dogstatsd_client_status status =
+        dogstatsd_client_metric_buffer(&DDTRACE_G(dogstatsd_client), metric, "1", type, sample_rate, NULL);
+    if (status != DOGSTATSD_CLIENT_OK && get_DD_TRACE_DEBUG()) {
+        const char *status_str = dogstatsd_client_status_to_str(status) ?: "(unknown dogstatsd_client_status)";
+        ddtrace_log_errf("Health metric '%s' failed to send: %s", metric, status_str);
     }
-    _set_dogstatsd_client_globals(client);
 }
 
+/* Metrics are buffered during the request and sent together at its end, nothing is left in the buffer of an idle
+ * process. As the heartbeat is only reported once per interval, most requests have nothing to send. */
 void ddtrace_dogstatsd_client_rshutdown(void) {
-    dogstatsd_client_dtor(&DDTRACE_G(dogstatsd_client));
+    if (DDTRACE_G(dogstatsd_client_pid)) {
+        dogstatsd_client_flush(&DDTRACE_G(dogstatsd_client));
+    }
+}
 
-    _set_dogstatsd_client_globals(dogstatsd_client_default_ctor());
+void ddtrace_dogstatsd_client_gshutdown(zend_ddtrace_globals *ddtrace_globals) {
+    if (ddtrace_globals->dogstatsd_client_pid) {
+        // in a forked child, the buffered metrics belong to the parent
+        bool flush = ddtrace_globals->dogstatsd_client_pid == getpid();
+        dd_dogstatsd_client_free(&ddtrace_globals->dogstatsd_client, &ddtrace_globals->dogstatsd_client_config,
+                                 &ddtrace_globals->dogstatsd_client_pid, flush);
+    }
 }
@@ -2,9 +2,11 @@
 #define DDTRACE_DOGSTATSD_CLIENT_H
 
 #include "compatibility.h"
+#include "ddtrace.h"
 
 void ddtrace_dogstatsd_client_minit(void);
 void ddtrace_dogstatsd_client_rinit(void);
 void ddtrace_dogstatsd_client_rshutdown(void);
+void ddtrace_dogstatsd_client_gshutdown(zend_ddtrace_globals *ddtrace_globals);
 
 #endif  // DDTRACE_DOGSTATSD_CLIENT_H
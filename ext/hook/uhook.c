@@ -8,6 +8,7 @@
 #include "../logging.h"
 
 #define HOOK_INSTANCE 0x1
+#define HOOK_ARGS_BEGIN_ONLY 0x2
 
 #include "uhook_arginfo.h"
 
@@ -24,6 +25,7 @@ extern void (*profiling_interrupt_function)(zend_execute_data *);
 zend_class_entry *ddtrace_hook_data_ce;
 #if PHP_VERSION_ID >= 80000
 zend_property_info *ddtrace_hook_data_returned_prop_info;
+static zend_object_handlers dd_hook_data_handlers;
 #endif
 
 ZEND_TLS HashTable dd_closure_hooks;
@@ -38,6 +40,7 @@ typedef struct {
     zend_object *begin;
     zend_object *end;
     bool running;
+    bool args_begin_only;
     zend_long id;
 
     zend_ulong install_address;
@@ -56,6 +59,7 @@ typedef struct {
     zval property_exception;
     zend_ulong invocation;
     zend_execute_data *execute_data;
+    zend_execute_data *args_frame; // while set, $args is not yet collected from that frame
     zval *retval_ptr;
     ddtrace_span_data *span;
     ddtrace_span_stack *prior_stack;
@@ -69,7 +73,11 @@ static zend_object *dd_hook_data_create(zend_class_entry *class_type) {
     dd_hook_data *hook_data = ecalloc(1, sizeof(*hook_data));
     zend_object_std_init(&hook_data->std, class_type);
     object_properties_init(&hook_data->std, class_type);
+#if PHP_VERSION_ID >= 80000
+    hook_data->std.handlers = &dd_hook_data_handlers;
+#else
     hook_data->std.handlers = zend_get_std_object_handlers();
+#endif
     return &hook_data->std;
 }
 
@@ -116,6 +124,54 @@ HashTable *dd_uhook_collect_args(zend_execute_data *execute_data) {
     return ht;
 }
 
+static void dd_hook_data_materialize_args(dd_hook_data *hook_data) {
+    if (UNEXPECTED(hook_data->args_frame)) {
+        // $args may have been assigned without going through our handlers, e.g. via a warm property cache slot
+        if (Z_TYPE(hook_data->property_args) == IS_UNDEF) {
+            ZVAL_ARR(&hook_data->property_args, dd_uhook_collect_args(hook_data->args_frame));
+        }
+        hook_data->args_frame = NULL;
+    }
+}
+
+#if PHP_VERSION_ID >= 80000
+// Arguments are only copied into $args when something accesses the HookData properties
+static zval *dd_hook_data_read_property(zend_object *object, zend_string *member, int type, void **cache_slot, zval *rv) {
+    dd_hook_data_materialize_args((dd_hook_data *)object);
+    return zend_std_read_property(object, member, type, cache_slot, rv);
+}
+
+static zval *dd_hook_data_write_property(zend_object *object, zend_string *member, zval *value, void **cache_slot) {
+    dd_hook_data_materialize_args((dd_hook_data *)object);
+    return zend_std_write_property(object, member, value, cache_slot);
+}
+
+static zval *dd_hook_data_get_property_ptr_ptr(zend_object *object, zend_string *member, int type, void **cache_slot) {
+    dd_hook_data_materialize_args((dd_hook_data *)object);
+    return zend_std_get_property_ptr_ptr(object, member, type, cache_slot);
+}
+
+static int dd_hook_data_has_property(zend_object *object, zend_string *member, int has_set_exists, void **cache_slot) {
+    dd_hook_data_materialize_args((dd_hook_data *)object);
+    return zend_std_has_property(object, member, has_set_exists, cache_slot);
+}
+
+static void dd_hook_data_unset_property(zend_object *object, zend_string *member, void **cache_slot) {
+    dd_hook_data_materialize_args((dd_hook_data *)object);
+    zend_std_unset_property(object, member, cache_slot);
+}
+
+static HashTable *dd_hook_data_get_properties(zend_object *object) {
+    dd_hook_data_materialize_args((dd_hook_data *)object);
+    return zend_std_get_properties(object);
+}
+
+static zend_object *dd_hook_data_clone_obj(zend_object *object) {
+    dd_hook_data_materialize_args((dd_hook_data *)object);
+    return zend_objects_clone_obj(object);
+}
+#endif
+
 void dd_uhook_report_sandbox_error(zend_execute_data *execute_data, zend_object *closure) {
     if (get_DD_TRACE_DEBUG()) {
         char *scope = "";
@@ -231,7 +287,11 @@ static bool dd_uhook_begin(zend_ulong invocation, zend_execute_data *execute_dat
         zend_hash_index_add_new(filearg, 0, &filezv);
         ZVAL_ARR(&dyn->hook_data->property_args, filearg);
     } else {
+#if PHP_VERSION_ID >= 80000
+        dyn->hook_data->args_frame = execute_data;
+#else
         ZVAL_ARR(&dyn->hook_data->property_args, dd_uhook_collect_args(execute_data));
+#endif
     }
 
     if (def->begin && !def->running) {
@@ -243,6 +303,19 @@ static bool dd_uhook_begin(zend_ulong invocation, zend_execute_data *execute_dat
     }
     dyn->hook_data->execute_data = NULL;
 
+    if (dyn->hook_data->args_frame) {
+        // The function may change its arguments before returning, hence copy them for the end hook now, as it needs to see them as passed.
+        // Same if the HookData object was retained by the begin hook.
+        if ((def->end && !def->args_begin_only) || GC_REFCOUNT(&dyn->hook_data->std) > 1) {
+            dd_hook_data_materialize_args(dyn->hook_data);
+        } else {
+            if (Z_TYPE(dyn->hook_data->property_args) == IS_UNDEF) {
+                ZVAL_EMPTY_ARRAY(&dyn->hook_data->property_args);
+            }
+            dyn->hook_data->args_frame = NULL;
+        }
+    }
+
     return true;
 }
 
@@ -423,6 +496,7 @@ type_error:
     dd_uhook_def *def = emalloc(sizeof(*def));
     def->closure = NULL;
     def->running = false;
+    def->args_begin_only = (flags & HOOK_ARGS_BEGIN_ONLY) != 0;
     def->begin = begin ? Z_OBJ_P(begin) : NULL;
     if (def->begin) {
         GC_ADDREF(def->begin);
@@ -652,6 +726,9 @@ ZEND_METHOD(DDTrace_HookData, overrideArguments) {
         RETURN_FALSE;
     }
 
+    // $args shall keep the original arguments
+    dd_hook_data_materialize_args(hookData);
+
     int passed_args = ZEND_CALL_NUM_ARGS(hookData->execute_data);
     zend_function *func = hookData->execute_data->func;
     if (MAX(func->common.num_args, passed_args) < zend_hash_num_elements(args)) {
@@ -760,6 +837,15 @@ void zai_uhook_minit(int module_number) {
     ddtrace_hook_data_ce->create_object = dd_hook_data_create;
 #if PHP_VERSION_ID >= 80000
     ddtrace_hook_data_returned_prop_info = zend_hash_str_find_ptr(&ddtrace_hook_data_ce->properties_info, ZEND_STRL("returned"));
+
+    memcpy(&dd_hook_data_handlers, &std_object_handlers, sizeof(zend_object_handlers));
+    dd_hook_data_handlers.read_property = dd_hook_data_read_property;
+    dd_hook_data_handlers.write_property = dd_hook_data_write_property;
+    dd_hook_data_handlers.get_property_ptr_ptr = dd_hook_data_get_property_ptr_ptr;
+    dd_hook_data_handlers.has_property = dd_hook_data_has_property;
+    dd_hook_data_handlers.unset_property = dd_hook_data_unset_property;
+    dd_hook_data_handlers.get_properties = dd_hook_data_get_properties;
+    dd_hook_data_handlers.clone_obj = dd_hook_data_clone_obj;
 #endif
 
     zend_register_functions(NULL, ext_functions, NULL, MODULE_PERSISTENT);
@@ -89,6 +89,16 @@ const HOOK_ALL_FILES = "";
  */
 const HOOK_INSTANCE = UNKNOWN;
 
+/**
+ * The end hook does not access HookData::$args: arguments are then only copied if the begin hook accesses them,
+ * and the end hook gets an empty array.
+ * Without this flag, arguments not accessed by the begin hook are still copied for the end hook.
+ *
+ * @var int
+ * @cvalue HOOK_ARGS_BEGIN_ONLY
+ */
+const HOOK_ARGS_BEGIN_ONLY = UNKNOWN;
+
 /**
  * @param string|\Closure|\Generator $target The function to hook.
  *                                           If a string is passed, it must be either a function name or referencing
@@ -101,7 +111,7 @@ const HOOK_INSTANCE = UNKNOWN;
  *                                           and the hook applied to that.
  * @param null|\Closure(\DDTrace\HookData) $begin Called before the hooked function is invoked.
  * @param null|\Closure(\DDTrace\HookData) $end Called after the hooked function is invoked.
- * @param int $flags The only accepted flag currently is DDTrace\HOOK_INSTANCE.
+ * @param int $flags Accepts DDTrace\HOOK_INSTANCE and DDTrace\HOOK_ARGS_BEGIN_ONLY.
  * @return int An integer which can be used to remove a hook via DDTrace\remove_hook.
  */
 function install_hook(
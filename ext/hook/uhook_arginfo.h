@@ -1,5 +1,5 @@
 /* This is a generated file, edit the .stub.php file instead.
- * Stub hash: 998812aa3cd8f153aa141d6be99e957a38d3a60b */
+ * Stub hash: 74a52191cf9af5fa218fffbe4759234727d77a9f */
 
 ZEND_BEGIN_ARG_WITH_RETURN_TYPE_INFO_EX(arginfo_DDTrace_install_hook, 0, 1, IS_LONG, 0)
 	ZEND_ARG_OBJ_TYPE_MASK(0, target, Closure|Generator, MAY_BE_STRING|MAY_BE_CALLABLE, NULL)
@@ -54,6 +54,7 @@ static void register_uhook_symbols(int module_number)
 {
 	REGISTER_STRING_CONSTANT("DDTrace\\HOOK_ALL_FILES", "", CONST_PERSISTENT);
 	REGISTER_LONG_CONSTANT("DDTrace\\HOOK_INSTANCE", HOOK_INSTANCE, CONST_PERSISTENT);
+	REGISTER_LONG_CONSTANT("DDTrace\\HOOK_ARGS_BEGIN_ONLY", HOOK_ARGS_BEGIN_ONLY, CONST_PERSISTENT);
 }
 
 static zend_class_entry *register_class_DDTrace_HookData(void)
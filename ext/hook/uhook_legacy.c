@@ -4,6 +4,7 @@
 #include "uhook.h"
 #include <sandbox/sandbox.h>
 
+#include "../compatibility.h"
 #include "../logging.h"
 
 extern void (*profiling_interrupt_function)(zend_execute_data *);
@@ -15,6 +16,7 @@ typedef struct {
     bool run_if_limited;
     bool active;
     bool allow_recursion;
+    bool needs_args;
 } dd_uhook_def;
 
 typedef struct {
@@ -28,7 +30,11 @@ typedef struct {
 static bool dd_uhook_call(zend_object *closure, bool tracing, dd_uhook_dynamic *dyn, zend_execute_data *execute_data, zval *retval) {
     zval rv, closure_zv, args_zv, exception_zv;
     ZVAL_OBJ(&closure_zv, closure);
-    ZVAL_ARR(&args_zv, dyn->args);
+    if (dyn->args) {
+        ZVAL_ARR(&args_zv, dyn->args);
+    } else {
+        ZVAL_EMPTY_ARRAY(&args_zv);
+    }
     if (EG(exception)) {
         ZVAL_OBJ(&exception_zv, EG(exception));
     } else {
@@ -81,6 +87,9 @@ static bool dd_uhook_call(zend_object *closure, bool tracing, dd_uhook_dynamic *
     zai_sandbox_close(&sandbox);
 
     zval_ptr_dtor(&rv);
+    if (!dyn->args) {
+        zval_ptr_dtor(&args_zv);
+    }
 
     return Z_TYPE(rv) != IS_FALSE;
 }
@@ -98,7 +107,7 @@ static bool dd_uhook_begin(zend_ulong invocation, zend_execute_data *execute_dat
     dyn->skipped = false;
     dyn->was_primed = false;
     dyn->dropped_span = false;
-    dyn->args = dd_uhook_collect_args(execute_data);
+    dyn->args = def->needs_args ? dd_uhook_collect_args(execute_data) : NULL;
 
     if (def->tracing) {
         dyn->span = ddtrace_alloc_execute_data_span(invocation, execute_data);
@@ -223,7 +232,7 @@ static void dd_uhook_end(zend_ulong invocation, zend_execute_data *execute_data,
         keep_span = dd_uhook_call(def->end, def->tracing, dyn, execute_data, retval);
     }
 
-    if (!GC_DELREF(dyn->args)) {
+    if (dyn->args && !GC_DELREF(dyn->args)) {
         zend_array_destroy(dyn->args);
     }
 
@@ -234,6 +243,50 @@ static void dd_uhook_end(zend_ulong invocation, zend_execute_data *execute_data,
     def->active = false;
 }
 
+// Whether the closure can observe the $args parameter at position args_offset, be it declared or via func_get_args()
+static bool dd_uhook_closure_needs_args(zend_object *closure, uint32_t args_offset) {
+    if (!closure) {
+        return false;
+    }
+
+    const zend_function *func = zend_get_closure_method_def(closure);
+    if (func->type != ZEND_USER_FUNCTION || func->common.num_args > args_offset || (func->common.fn_flags & ZEND_ACC_VARIADIC)) {
+        return true;
+    }
+
+    const zend_op_array *op_array = &func->op_array;
+    for (const zend_op *opline = op_array->opcodes, *end = opline + op_array->last; opline < end; ++opline) {
+        switch (opline->opcode) {
+#ifdef ZEND_FUNC_GET_ARGS
+            case ZEND_FUNC_GET_ARGS:
+#endif
+            case ZEND_INIT_DYNAMIC_CALL:
+            case ZEND_INIT_USER_CALL:
+                return true;
+
+            case ZEND_INIT_FCALL:
+            case ZEND_INIT_FCALL_BY_NAME:
+            case ZEND_INIT_NS_FCALL_BY_NAME: {
+#if PHP_VERSION_ID < 70300
+                zval *name = RT_CONSTANT(op_array, opline->op2);
+#else
+                zval *name = RT_CONSTANT(opline, opline->op2);
+#endif
+                // the lowercased name follows the literal name, except for ZEND_INIT_FCALL which only has the lowercased one
+                if (opline->opcode != ZEND_INIT_FCALL) {
+                    ++name;
+                }
+                if (Z_TYPE_P(name) == IS_STRING && zend_memnstr(Z_STRVAL_P(name), ZEND_STRL("func_get_arg"), Z_STRVAL_P(name) + Z_STRLEN_P(name))) {
+                    return true;
+                }
+                break;
+            }
+        }
+    }
+
+    return false;
+}
+
 static void dd_uhook_dtor(void *data) {
     dd_uhook_def *def = data;
     if (def->begin) {
@@ -358,6 +411,9 @@ static void dd_uhook(INTERNAL_FUNCTION_PARAMETERS, bool tracing, bool method) {
     def->run_if_limited = !tracing || run_when_limited;
     def->active = false;
     def->allow_recursion = allow_recursion;
+    // The closures receive (SpanData $span, array $args, ...), ($This, $scope, array $args, ...) or (array $args, ...)
+    uint32_t args_offset = tracing ? 1 : method ? 2 : 0;
+    def->needs_args = dd_uhook_closure_needs_args(def->begin, args_offset) || dd_uhook_closure_needs_args(def->end, args_offset);
 
     zai_string_view class_str = method ? ZAI_STRING_FROM_ZSTR(class_name) : ZAI_STRING_EMPTY;
     zai_string_view func_str = ZAI_STRING_FROM_ZSTR(method_name);
@@ -0,0 +1,100 @@
+#include "dbm.h"
+
+#include <Zend/zend_smart_str.h>
+#include <ext/standard/url.h>
+
+#include "../compatibility.h"
+#include "../configuration.h"
+#include "../ddtrace.h"
+#include "../priority_sampling/priority_sampling.h"
+#include "../random.h"
+#include "../span.h"
+
+ZEND_EXTERN_MODULE_GLOBALS(ddtrace);
+
+zend_long ddtrace_dbm_propagation_mode(zend_string *backend) {
+    zend_long mode = get_DD_DBM_PROPAGATION_MODE();
+    if (mode == DD_TRACE_DBM_PROPAGATION_DISABLED) {
+        return mode;
+    }
+
+    // only these two carry the traceparent, the others are limited to the service tags
+    if (zend_string_equals_literal(backend, "mysql") || zend_string_equals_literal(backend, "pgsql")) {
+        return mode;
+    }
+    if (zend_string_equals_literal(backend, "sqlsrv") || zend_string_equals_literal(backend, "mssql") ||
+        zend_string_equals_literal(backend, "dblib") || zend_string_equals_literal(backend, "odbc")) {
+        return DD_TRACE_DBM_PROPAGATION_SERVICE;
+    }
+    return DD_TRACE_DBM_PROPAGATION_DISABLED;
+}
+
+static void dd_dbm_append_tag(smart_str *comment, const char *tag, zend_string *value) {
+    if (!value || !ZSTR_LEN(value)) {
+        return;
+    }
+    if (ZSTR_LEN(comment->s) > 2) {
+        smart_str_appendc(comment, ',');
+    }
+    smart_str_appends(comment, tag);
+    smart_str_appends(comment, "='");
+    zend_string *encoded = php_raw_url_encode(ZSTR_VAL(value), ZSTR_LEN(value));
+    smart_str_append(comment, encoded);
+    zend_string_release(encoded);
+    smart_str_appendc(comment, '\'');
+}
+
+static zend_string *dd_dbm_root_meta(ddtrace_span_data *root, const char *key, size_t key_len) {
+    zval *value = root ? ddtrace_span_find_meta(root, key, key_len) : NULL;
+    if (value) {
+        ZVAL_DEREF(value);
+    }
+    return value && Z_TYPE_P(value) == IS_STRING ? Z_STR_P(value) : NULL;
+}
+
+// The tags must be in alphabetical order
+zend_string *ddtrace_dbm_propagate_via_sql_comments(zend_string *query, zend_string *db_service, zend_long mode) {
+    ddtrace_span_data *root = DDTRACE_G(active_stack) ? DDTRACE_G(active_stack)->root_span : NULL;
+
+    smart_str comment = {0};
+    smart_str_appends(&comment, "/*");
+    dd_dbm_append_tag(&comment, "dddbs", db_service);
+
+    zend_string *env = dd_dbm_root_meta(root, ZEND_STRL("env"));
+    dd_dbm_append_tag(&comment, "dde", env && ZSTR_LEN(env) ? env : get_DD_ENV());
+
+    zval *root_service = root ? ddtrace_spandata_property_service(root) : NULL;
+    if (root_service && Z_TYPE_P(root_service) == IS_STRING && Z_STRLEN_P(root_service)) {
+        dd_dbm_append_tag(&comment, "ddps", Z_STR_P(root_service));
+    } else {
+        dd_dbm_append_tag(&comment, "ddps", get_DD_SERVICE());
+    }
+
+    zend_string *version = dd_dbm_root_meta(root, ZEND_STRL("version"));
+    dd_dbm_append_tag(&comment, "ddpv", version && ZSTR_LEN(version) ? version : get_DD_VERSION());
+
+    if (mode == DD_TRACE_DBM_PROPAGATION_FULL) {
+        ddtrace_trace_id trace_id = ddtrace_peek_trace_id();
+        uint64_t span_id = ddtrace_peek_span_id();
+        if ((trace_id.low || trace_id.high) && span_id) {
+            zend_string *traceparent = zend_strpprintf(0, "00-%016" PRIx64 "%016" PRIx64 "-%016" PRIx64 "-%02" PRIx8,
+                                                       trace_id.high, trace_id.low, span_id,
+                                                       ddtrace_fetch_prioritySampling_from_root() > 0);
+            dd_dbm_append_tag(&comment, "traceparent", traceparent);
+            zend_string_release(traceparent);
+        }
+    }
+
+    if (ZSTR_LEN(comment.s) <= 2) {
+        smart_str_free(&comment);
+        return zend_string_copy(query);
+    }
+
+    smart_str_appends(&comment, "*/");
+    if (ZSTR_LEN(query)) {
+        smart_str_appendc(&comment, ' ');
+        smart_str_append(&comment, query);
+    }
+    smart_str_0(&comment);
+    return comment.s;
+}
@@ -0,0 +1,12 @@
+#ifndef DD_INTEGRATIONS_DBM_H
+#define DD_INTEGRATIONS_DBM_H
+#include <php.h>
+
+// Returns the Database Monitoring propagation mode for a database backend, DD_TRACE_DBM_PROPAGATION_DISABLED if the
+// backend does not support it or propagation is disabled
+zend_long ddtrace_dbm_propagation_mode(zend_string *backend);
+
+// Returns the query prefixed with the Database Monitoring comment, as a new string
+zend_string *ddtrace_dbm_propagate_via_sql_comments(zend_string *query, zend_string *db_service, zend_long mode);
+
+#endif  // DD_INTEGRATIONS_DBM_H
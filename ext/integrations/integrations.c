@@ -2,6 +2,7 @@
 
 #include "../configuration.h"
 #include "../logging.h"
+#include "native.h"
 #include <hook/hook.h>
 #undef INTEGRATION
 
@@ -9,18 +10,6 @@
     dd_hook_method_and_unhook_on_first_call(ZAI_STRL_VIEW(class), ZAI_STRL_VIEW(fname), \
                           ZAI_STRL_VIEW(integration_name), (ddtrace_integration_name)-1, false)
 
-#define DD_SET_UP_DEFERRED_LOADING_BY_METHOD(name, Class, fname, integration)                                \
-    dd_set_up_deferred_loading_by_method(name, ZAI_STRL_VIEW(Class), ZAI_STRL_VIEW(fname), \
-                                         ZAI_STRL_VIEW(integration), false)
-
-#define DD_SET_UP_DEFERRED_LOADING_BY_METHOD_POST(name, Class, fname, integration)                                \
-    dd_set_up_deferred_loading_by_method(name, ZAI_STRL_VIEW(Class), ZAI_STRL_VIEW(fname), \
-                                         ZAI_STRL_VIEW(integration), true)
-
-#define DD_SET_UP_DEFERRED_LOADING_BY_FUNCTION(name, fname, integration)                           \
-    dd_set_up_deferred_loading_by_method(name, ZAI_STRING_EMPTY, ZAI_STRL_VIEW(fname), \
-                                         ZAI_STRL_VIEW(integration), false)
-
 #define INTEGRATION(id, lcname)                                        \
     {                                                                  \
         .name = DDTRACE_INTEGRATION_##id,                              \
@@ -125,11 +114,130 @@ static void dd_load_test_integrations(void) {
     // DDTRACE_INTEGRATION_TRACE("test", "automaticaly_traced_method", "tracing_function", DDTRACE_DISPATCH_POSTHOOK);
 }
 
-static void dd_set_up_deferred_loading_by_method(ddtrace_integration_name name, zai_string_view Class,
-                                                 zai_string_view method, zai_string_view integration, bool posthook) {
-    // We unconditionally install our hooks. We skip it on hit.
-    dd_hook_method_and_unhook_on_first_call(Class, method, integration, name, posthook);
-}
+typedef struct {
+    ddtrace_integration_name name;
+    zai_string_view scope;
+    zai_string_view function;
+    zai_string_view loader;
+    bool posthook;
+} dd_deferred_integration;
+
+#define DD_DEFERRED_STRL(str) { .len = sizeof(str) - 1, .ptr = (str) }
+#define DD_DEFERRED_LOADING(id, Class, fname, integration, post)                                              \
+    { .name = DDTRACE_INTEGRATION_##id, .scope = DD_DEFERRED_STRL(Class), .function = DD_DEFERRED_STRL(fname), \
+      .loader = DD_DEFERRED_STRL(integration), .posthook = (post) },
+#define DD_DEFERRED_METHOD(id, Class, fname, integration) DD_DEFERRED_LOADING(id, Class, fname, integration, false)
+#define DD_DEFERRED_METHOD_POST(id, Class, fname, integration) DD_DEFERRED_LOADING(id, Class, fname, integration, true)
+#define DD_DEFERRED_FUNCTION(id, fname, integration) DD_DEFERRED_LOADING(id, "", fname, integration, false)
+
+// The functions and methods whose first call loads the respective PHP integration
+static const dd_deferred_integration dd_deferred_integrations[] = {
+    DD_DEFERRED_METHOD(AMQP, "PhpAmqpLib\\Connection\\AbstractConnection", "__construct",
+                       "DDTrace\\Integrations\\AMQP\\AMQPIntegration")
+
+    DD_DEFERRED_METHOD(CAKEPHP, "App", "init",
+                       "DDTrace\\Integrations\\CakePHP\\CakePHPIntegration")
+    DD_DEFERRED_METHOD(CAKEPHP, "Dispatcher", "__construct",
+                       "DDTrace\\Integrations\\CakePHP\\CakePHPIntegration")
+
+    DD_DEFERRED_METHOD_POST(CODEIGNITER, "CI_Router", "_set_routing",
+                            "DDTrace\\Integrations\\CodeIgniter\\V2\\CodeIgniterIntegration")
+
+    DD_DEFERRED_METHOD(ELASTICSEARCH, "elasticsearch\\client", "__construct",
+                       "DDTrace\\Integrations\\ElasticSearch\\V1\\ElasticSearchIntegration")
+    DD_DEFERRED_METHOD(ELASTICSEARCH, "elastic\\elasticsearch\\client", "__construct",
+                       "DDTrace\\Integrations\\ElasticSearch\\V8\\ElasticSearchIntegration")
+
+    DD_DEFERRED_METHOD(ELOQUENT, "Illuminate\\Database\\Eloquent\\Builder", "__construct",
+                       "DDTrace\\Integrations\\Eloquent\\EloquentIntegration")
+    DD_DEFERRED_METHOD(ELOQUENT, "Illuminate\\Database\\Eloquent\\Model", "__construct",
+                       "DDTrace\\Integrations\\Eloquent\\EloquentIntegration")
+    DD_DEFERRED_METHOD(ELOQUENT, "Illuminate\\Database\\Eloquent\\Model", "destroy",
+                       "DDTrace\\Integrations\\Eloquent\\EloquentIntegration")
+
+    DD_DEFERRED_METHOD(LAMINAS, "Laminas\\Mvc\\Application", "init",
+                       "DDTrace\\Integrations\\Laminas\\LaminasIntegration")
+    DD_DEFERRED_METHOD(LAMINAS, "Laminas\\Mvc\\Application", "__construct",
+                       "DDTrace\\Integrations\\Laminas\\LaminasIntegration")
+
+    DD_DEFERRED_METHOD(LUMEN, "Laravel\\Lumen\\Application", "__construct",
+                       "DDTrace\\Integrations\\Lumen\\LumenIntegration")
+
+    DD_DEFERRED_METHOD(MEMCACHE, "Memcache", "connect",
+                       "DDTrace\\Integrations\\Memcache\\MemcacheIntegration")
+    DD_DEFERRED_METHOD(MEMCACHE, "Memcache", "pconnect",
+                       "DDTrace\\Integrations\\Memcache\\MemcacheIntegration")
+    DD_DEFERRED_METHOD(MEMCACHE, "Memcache", "addServer",
+                       "DDTrace\\Integrations\\Memcache\\MemcacheIntegration")
+    DD_DEFERRED_FUNCTION(MEMCACHE, "memcache_connect",
+                         "DDTrace\\Integrations\\Memcache\\MemcacheIntegration")
+    DD_DEFERRED_FUNCTION(MEMCACHE, "memcache_pconnect",
+                         "DDTrace\\Integrations\\Memcache\\MemcacheIntegration")
+    DD_DEFERRED_FUNCTION(MEMCACHE, "memcache_add_server",
+                         "DDTrace\\Integrations\\Memcache\\MemcacheIntegration")
+
+    DD_DEFERRED_METHOD(MEMCACHED, "Memcached", "__construct",
+                       "DDTrace\\Integrations\\Memcached\\MemcachedIntegration")
+
+    DD_DEFERRED_METHOD(MONGODB, "mongodb\\driver\\manager", "__construct",
+                       "DDTrace\\Integrations\\MongoDB\\MongoDBIntegration")
+    DD_DEFERRED_METHOD(MONGODB, "mongodb\\driver\\query", "__construct",
+                       "DDTrace\\Integrations\\MongoDB\\MongoDBIntegration")
+    DD_DEFERRED_METHOD(MONGODB, "mongodb\\driver\\command", "__construct",
+                       "DDTrace\\Integrations\\MongoDB\\MongoDBIntegration")
+    DD_DEFERRED_METHOD(MONGODB, "mongodb\\driver\\bulkwrite", "__construct",
+                       "DDTrace\\Integrations\\MongoDB\\MongoDBIntegration")
+
+    DD_DEFERRED_METHOD(NETTE, "Nette\\Configurator", "__construct",
+                       "DDTrace\\Integrations\\Nette\\NetteIntegration")
+    DD_DEFERRED_METHOD(NETTE, "Nette\\Bootstrap\\Configurator", "__construct",
+                       "DDTrace\\Integrations\\Nette\\NetteIntegration")
+
+    DD_DEFERRED_METHOD(PHPREDIS, "Redis", "__construct",
+                       "DDTrace\\Integrations\\PHPRedis\\PHPRedisIntegration")
+    DD_DEFERRED_METHOD(PHPREDIS, "RedisCluster", "__construct",
+                       "DDTrace\\Integrations\\PHPRedis\\PHPRedisIntegration")
+
+    DD_DEFERRED_METHOD(PREDIS, "Predis\\Client", "__construct",
+                       "DDTrace\\Integrations\\Predis\\PredisIntegration")
+
+    DD_DEFERRED_METHOD(PSR18, "Psr\\Http\\Client\\ClientInterface", "sendRequest",
+                       "DDTrace\\Integrations\\Psr18\\Psr18Integration")
+
+    DD_DEFERRED_METHOD(ROADRUNNER, "Spiral\\RoadRunner\\Http\\HttpWorker", "waitRequest",
+                       "DDTrace\\Integrations\\Roadrunner\\RoadrunnerIntegration")
+
+    DD_DEFERRED_METHOD(SLIM, "Slim\\App", "__construct",
+                       "DDTrace\\Integrations\\Slim\\SlimIntegration")
+
+    DD_DEFERRED_METHOD(LARAVELQUEUE, "Illuminate\\Queue\\Worker", "__construct",
+                       "DDTrace\\Integrations\\LaravelQueue\\LaravelQueueIntegration")
+    DD_DEFERRED_METHOD(LARAVELQUEUE, "Illuminate\\Contracts\\Queue\\Queue", "push",
+                       "DDTrace\\Integrations\\LaravelQueue\\LaravelQueueIntegration")
+    DD_DEFERRED_METHOD(LARAVELQUEUE, "Illuminate\\Contracts\\Queue\\Queue", "later",
+                       "DDTrace\\Integrations\\LaravelQueue\\LaravelQueueIntegration")
+    DD_DEFERRED_METHOD(LARAVELQUEUE, "Illuminate\\Bus\\PendingBatch", "__construct",
+                       "DDTrace\\Integrations\\LaravelQueue\\LaravelQueueIntegration")
+    DD_DEFERRED_METHOD(LARAVELQUEUE, "Illuminate\\Foundation\\Bus\\PendingChain", "__construct",
+                       "DDTrace\\Integrations\\LaravelQueue\\LaravelQueueIntegration")
+
+    DD_DEFERRED_METHOD(SYMFONY, "Symfony\\Component\\HttpKernel\\Kernel", "__construct",
+                       "DDTrace\\Integrations\\Symfony\\SymfonyIntegration")
+    DD_DEFERRED_METHOD(SYMFONY, "Symfony\\Component\\HttpKernel\\HttpKernel", "__construct",
+                       "DDTrace\\Integrations\\Symfony\\SymfonyIntegration")
+
+    DD_DEFERRED_FUNCTION(SQLSRV, "sqlsrv_connect",
+                         "DDTrace\\Integrations\\SQLSRV\\SQLSRVIntegration")
+
+    DD_DEFERRED_FUNCTION(WORDPRESS, "wp_check_php_mysql_versions",
+                         "DDTrace\\Integrations\\WordPress\\WordPressIntegration")
+
+    DD_DEFERRED_METHOD(YII, "yii\\di\\Container", "__construct",
+                       "DDTrace\\Integrations\\Yii\\YiiIntegration")
+
+    DD_DEFERRED_METHOD(ZENDFRAMEWORK, "Zend_Controller_Plugin_Broker", "preDispatch",
+                       "DDTrace\\Integrations\\ZendFramework\\ZendFrameworkIntegration")
+};
 
 void ddtrace_integrations_minit(void) {
     zend_hash_init(&_dd_string_to_integration_name_map, ddtrace_integrations_len, NULL, NULL, 1);
@@ -143,116 +251,13 @@ void ddtrace_integrations_minit(void) {
 
     dd_load_test_integrations();
 
-    DD_SET_UP_DEFERRED_LOADING_BY_METHOD(DDTRACE_INTEGRATION_AMQP, "PhpAmqpLib\\Connection\\AbstractConnection", "__construct",
-                                        "DDTrace\\Integrations\\AMQP\\AMQPIntegration");
-
-    DD_SET_UP_DEFERRED_LOADING_BY_METHOD(DDTRACE_INTEGRATION_CAKEPHP, "App", "init",
-                                         "DDTrace\\Integrations\\CakePHP\\CakePHPIntegration");
-    DD_SET_UP_DEFERRED_LOADING_BY_METHOD(DDTRACE_INTEGRATION_CAKEPHP, "Dispatcher", "__construct",
-                                         "DDTrace\\Integrations\\CakePHP\\CakePHPIntegration");
-
-    DD_SET_UP_DEFERRED_LOADING_BY_METHOD_POST(DDTRACE_INTEGRATION_CODEIGNITER, "CI_Router", "_set_routing",
-                                         "DDTrace\\Integrations\\CodeIgniter\\V2\\CodeIgniterIntegration");
-
-    DD_SET_UP_DEFERRED_LOADING_BY_METHOD(DDTRACE_INTEGRATION_ELASTICSEARCH, "elasticsearch\\client", "__construct",
-                                         "DDTrace\\Integrations\\ElasticSearch\\V1\\ElasticSearchIntegration");
-    DD_SET_UP_DEFERRED_LOADING_BY_METHOD(DDTRACE_INTEGRATION_ELASTICSEARCH, "elastic\\elasticsearch\\client", "__construct",
-                                         "DDTrace\\Integrations\\ElasticSearch\\V8\\ElasticSearchIntegration");
-
-    DD_SET_UP_DEFERRED_LOADING_BY_METHOD(DDTRACE_INTEGRATION_ELOQUENT, "Illuminate\\Database\\Eloquent\\Builder", "__construct",
-                                         "DDTrace\\Integrations\\Eloquent\\EloquentIntegration");
-    DD_SET_UP_DEFERRED_LOADING_BY_METHOD(DDTRACE_INTEGRATION_ELOQUENT, "Illuminate\\Database\\Eloquent\\Model", "__construct",
-                                         "DDTrace\\Integrations\\Eloquent\\EloquentIntegration");
-    DD_SET_UP_DEFERRED_LOADING_BY_METHOD(DDTRACE_INTEGRATION_ELOQUENT, "Illuminate\\Database\\Eloquent\\Model", "destroy",
-                                         "DDTrace\\Integrations\\Eloquent\\EloquentIntegration");
-
-    DD_SET_UP_DEFERRED_LOADING_BY_METHOD(DDTRACE_INTEGRATION_LAMINAS, "Laminas\\Mvc\\Application", "init",
-                                         "DDTrace\\Integrations\\Laminas\\LaminasIntegration");
-    DD_SET_UP_DEFERRED_LOADING_BY_METHOD(DDTRACE_INTEGRATION_LAMINAS, "Laminas\\Mvc\\Application", "__construct",
-                                             "DDTrace\\Integrations\\Laminas\\LaminasIntegration");
-
-    DD_SET_UP_DEFERRED_LOADING_BY_METHOD(DDTRACE_INTEGRATION_LUMEN, "Laravel\\Lumen\\Application", "__construct",
-                                         "DDTrace\\Integrations\\Lumen\\LumenIntegration");
-
-    DD_SET_UP_DEFERRED_LOADING_BY_METHOD(DDTRACE_INTEGRATION_MEMCACHE, "Memcache", "connect",
-                                         "DDTrace\\Integrations\\Memcache\\MemcacheIntegration");
-    DD_SET_UP_DEFERRED_LOADING_BY_METHOD(DDTRACE_INTEGRATION_MEMCACHE, "Memcache", "pconnect",
-                                         "DDTrace\\Integrations\\Memcache\\MemcacheIntegration");
-    DD_SET_UP_DEFERRED_LOADING_BY_METHOD(DDTRACE_INTEGRATION_MEMCACHE, "Memcache", "addServer",
-                                         "DDTrace\\Integrations\\Memcache\\MemcacheIntegration");
-    DD_SET_UP_DEFERRED_LOADING_BY_FUNCTION(DDTRACE_INTEGRATION_MEMCACHE, "memcache_connect",
-                                         "DDTrace\\Integrations\\Memcache\\MemcacheIntegration");
-    DD_SET_UP_DEFERRED_LOADING_BY_FUNCTION(DDTRACE_INTEGRATION_MEMCACHE, "memcache_pconnect",
-                                         "DDTrace\\Integrations\\Memcache\\MemcacheIntegration");
-    DD_SET_UP_DEFERRED_LOADING_BY_FUNCTION(DDTRACE_INTEGRATION_MEMCACHE, "memcache_add_server",
-                                         "DDTrace\\Integrations\\Memcache\\MemcacheIntegration");
-
-    DD_SET_UP_DEFERRED_LOADING_BY_METHOD(DDTRACE_INTEGRATION_MEMCACHED, "Memcached", "__construct",
-                                         "DDTrace\\Integrations\\Memcached\\MemcachedIntegration");
-
-    DD_SET_UP_DEFERRED_LOADING_BY_METHOD(DDTRACE_INTEGRATION_MONGODB, "mongodb\\driver\\manager", "__construct",
-                                         "DDTrace\\Integrations\\MongoDB\\MongoDBIntegration");
-    DD_SET_UP_DEFERRED_LOADING_BY_METHOD(DDTRACE_INTEGRATION_MONGODB, "mongodb\\driver\\query", "__construct",
-                                         "DDTrace\\Integrations\\MongoDB\\MongoDBIntegration");
-    DD_SET_UP_DEFERRED_LOADING_BY_METHOD(DDTRACE_INTEGRATION_MONGODB, "mongodb\\driver\\command", "__construct",
-                                         "DDTrace\\Integrations\\MongoDB\\MongoDBIntegration");
-    DD_SET_UP_DEFERRED_LOADING_BY_METHOD(DDTRACE_INTEGRATION_MONGODB, "mongodb\\driver\\bulkwrite", "__construct",
-                                         "DDTrace\\Integrations\\MongoDB\\MongoDBIntegration");
-
-    DD_SET_UP_DEFERRED_LOADING_BY_METHOD(DDTRACE_INTEGRATION_NETTE, "Nette\\Configurator", "__construct",
-                                         "DDTrace\\Integrations\\Nette\\NetteIntegration");
-
-    DD_SET_UP_DEFERRED_LOADING_BY_METHOD(DDTRACE_INTEGRATION_NETTE, "Nette\\Bootstrap\\Configurator", "__construct",
-                                         "DDTrace\\Integrations\\Nette\\NetteIntegration");
-
-    DD_SET_UP_DEFERRED_LOADING_BY_METHOD(DDTRACE_INTEGRATION_PDO, "PDO", "__construct",
-                                         "DDTrace\\Integrations\\PDO\\PDOIntegration");
-
-    DD_SET_UP_DEFERRED_LOADING_BY_METHOD(DDTRACE_INTEGRATION_PHPREDIS, "Redis", "__construct",
-                                         "DDTrace\\Integrations\\PHPRedis\\PHPRedisIntegration");
-
-    DD_SET_UP_DEFERRED_LOADING_BY_METHOD(DDTRACE_INTEGRATION_PHPREDIS, "RedisCluster", "__construct",
-                                         "DDTrace\\Integrations\\PHPRedis\\PHPRedisIntegration");
-
-    DD_SET_UP_DEFERRED_LOADING_BY_METHOD(DDTRACE_INTEGRATION_PREDIS, "Predis\\Client", "__construct",
-                                         "DDTrace\\Integrations\\Predis\\PredisIntegration");
-
-    DD_SET_UP_DEFERRED_LOADING_BY_METHOD(DDTRACE_INTEGRATION_PSR18, "Psr\\Http\\Client\\ClientInterface", "sendRequest",
-                                         "DDTrace\\Integrations\\Psr18\\Psr18Integration");
-
-    DD_SET_UP_DEFERRED_LOADING_BY_METHOD(DDTRACE_INTEGRATION_ROADRUNNER, "Spiral\\RoadRunner\\Http\\HttpWorker", "waitRequest",
-                                         "DDTrace\\Integrations\\Roadrunner\\RoadrunnerIntegration");
-
-    DD_SET_UP_DEFERRED_LOADING_BY_METHOD(DDTRACE_INTEGRATION_SLIM, "Slim\\App", "__construct",
-                                         "DDTrace\\Integrations\\Slim\\SlimIntegration");
-
-    DD_SET_UP_DEFERRED_LOADING_BY_METHOD(DDTRACE_INTEGRATION_LARAVELQUEUE, "Illuminate\\Queue\\Worker", "__construct",
-                                         "DDTrace\\Integrations\\LaravelQueue\\LaravelQueueIntegration");
-    DD_SET_UP_DEFERRED_LOADING_BY_METHOD(DDTRACE_INTEGRATION_LARAVELQUEUE, "Illuminate\\Contracts\\Queue\\Queue", "push",
-                                         "DDTrace\\Integrations\\LaravelQueue\\LaravelQueueIntegration");
-    DD_SET_UP_DEFERRED_LOADING_BY_METHOD(DDTRACE_INTEGRATION_LARAVELQUEUE, "Illuminate\\Contracts\\Queue\\Queue", "later",
-                                             "DDTrace\\Integrations\\LaravelQueue\\LaravelQueueIntegration");
-    DD_SET_UP_DEFERRED_LOADING_BY_METHOD(DDTRACE_INTEGRATION_LARAVELQUEUE, "Illuminate\\Bus\\PendingBatch", "__construct",
-                                         "DDTrace\\Integrations\\LaravelQueue\\LaravelQueueIntegration");
-    DD_SET_UP_DEFERRED_LOADING_BY_METHOD(DDTRACE_INTEGRATION_LARAVELQUEUE, "Illuminate\\Foundation\\Bus\\PendingChain", "__construct",
-                                             "DDTrace\\Integrations\\LaravelQueue\\LaravelQueueIntegration");
-
-    DD_SET_UP_DEFERRED_LOADING_BY_METHOD(DDTRACE_INTEGRATION_SYMFONY, "Symfony\\Component\\HttpKernel\\Kernel", "__construct",
-                                         "DDTrace\\Integrations\\Symfony\\SymfonyIntegration");
-    DD_SET_UP_DEFERRED_LOADING_BY_METHOD(DDTRACE_INTEGRATION_SYMFONY, "Symfony\\Component\\HttpKernel\\HttpKernel", "__construct",
-                                         "DDTrace\\Integrations\\Symfony\\SymfonyIntegration");
-
-    DD_SET_UP_DEFERRED_LOADING_BY_FUNCTION(DDTRACE_INTEGRATION_SQLSRV, "sqlsrv_connect",
-                                         "DDTrace\\Integrations\\SQLSRV\\SQLSRVIntegration");
-
-    DD_SET_UP_DEFERRED_LOADING_BY_FUNCTION(DDTRACE_INTEGRATION_WORDPRESS, "wp_check_php_mysql_versions",
-                                           "DDTrace\\Integrations\\WordPress\\WordPressIntegration");
-
-    DD_SET_UP_DEFERRED_LOADING_BY_METHOD(DDTRACE_INTEGRATION_YII, "yii\\di\\Container", "__construct",
-                                         "DDTrace\\Integrations\\Yii\\YiiIntegration");
-
-    DD_SET_UP_DEFERRED_LOADING_BY_METHOD(DDTRACE_INTEGRATION_ZENDFRAMEWORK, "Zend_Controller_Plugin_Broker", "preDispatch",
-                                         "DDTrace\\Integrations\\ZendFramework\\ZendFrameworkIntegration");
+    // We unconditionally install our hooks. We skip it on hit.
+    for (size_t i = 0; i < sizeof(dd_deferred_integrations) / sizeof(dd_deferred_integrations[0]); ++i) {
+        const dd_deferred_integration *deferred = &dd_deferred_integrations[i];
+        dd_hook_method_and_unhook_on_first_call(deferred->scope, deferred->function, deferred->loader, deferred->name, deferred->posthook);
+    }
+
+    ddtrace_native_integrations_minit();
 }
 
 ddtrace_integration* ddtrace_get_integration_from_string(ddtrace_string integration) {
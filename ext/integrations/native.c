@@ -0,0 +1,390 @@
+#include "native.h"
+
+#include <php.h>
+#include <Zend/zend_smart_str.h>
+
+#include <hook/hook.h>
+
+#include "../compatibility.h"
+#include "../configuration.h"
+#include "../ddtrace.h"
+#include "../object_store.h"
+#include "../span.h"
+#include "dbm.h"
+#include "integrations.h"
+#include "pdo_dsn.h"
+
+ZEND_EXTERN_MODULE_GLOBALS(ddtrace);
+
+// PDO::ATTR_DRIVER_NAME, without depending on the pdo headers
+#define DD_PDO_ATTR_DRIVER_NAME 16
+
+enum {
+    // the resource is the first argument instead of the span name
+    DD_NATIVE_RESOURCE_ARG0 = 1 << 0,
+    // the resource is the queryString property of $this
+    DD_NATIVE_RESOURCE_QUERY_STRING = 1 << 1,
+    // parse the DSN passed as first argument into the connection tags of $this
+    DD_NATIVE_CONNECT = 1 << 2,
+    // prepend the Database Monitoring comment to the first argument
+    DD_NATIVE_DBM = 1 << 3,
+    DD_NATIVE_ANALYTICS = 1 << 4,
+    // an int return value, a returned statement's rowCount() or $this->rowCount() on true
+    DD_NATIVE_ROW_COUNT = 1 << 5,
+    // the returned statement inherits the connection tags of $this
+    DD_NATIVE_PROPAGATE = 1 << 6,
+    DD_NATIVE_DETECT_ERROR = 1 << 7,
+};
+
+typedef struct {
+    ddtrace_integration_name integration;
+    zai_string_view scope;
+    zai_string_view function;
+    zai_string_view name;
+    uint32_t flags;
+} dd_native_hook;
+
+#define DD_NATIVE_STRL(str) { .len = sizeof(str) - 1, .ptr = (str) }
+#define DD_NATIVE_METHOD(id, Class, fname, span_name, hook_flags)                                         \
+    { .integration = DDTRACE_INTEGRATION_##id, .scope = DD_NATIVE_STRL(Class), .function = DD_NATIVE_STRL(fname), \
+      .name = DD_NATIVE_STRL(span_name), .flags = (hook_flags) },
+
+// The methods traced without going through a PHP integration
+static const dd_native_hook dd_native_hooks[] = {
+    DD_NATIVE_METHOD(PDO, "PDO", "__construct", "PDO.__construct", DD_NATIVE_CONNECT)
+    DD_NATIVE_METHOD(PDO, "PDO", "exec", "PDO.exec",
+                     DD_NATIVE_RESOURCE_ARG0 | DD_NATIVE_DBM | DD_NATIVE_ANALYTICS | DD_NATIVE_ROW_COUNT |
+                     DD_NATIVE_DETECT_ERROR)
+    DD_NATIVE_METHOD(PDO, "PDO", "query", "PDO.query",
+                     DD_NATIVE_RESOURCE_ARG0 | DD_NATIVE_DBM | DD_NATIVE_ANALYTICS | DD_NATIVE_ROW_COUNT |
+                     DD_NATIVE_PROPAGATE | DD_NATIVE_DETECT_ERROR)
+    DD_NATIVE_METHOD(PDO, "PDO", "prepare", "PDO.prepare",
+                     DD_NATIVE_RESOURCE_ARG0 | DD_NATIVE_DBM | DD_NATIVE_PROPAGATE)
+    DD_NATIVE_METHOD(PDO, "PDO", "commit", "PDO.commit", 0)
+    DD_NATIVE_METHOD(PDO, "PDOStatement", "execute", "PDOStatement.execute",
+                     DD_NATIVE_RESOURCE_QUERY_STRING | DD_NATIVE_ANALYTICS | DD_NATIVE_ROW_COUNT |
+                     DD_NATIVE_DETECT_ERROR)
+};
+
+// The object store key of the connection tags, also readable through DDTrace\ObjectStore\get()
+static zend_string *dd_connection_tags_key;
+
+static void dd_native_set_string(zval *property, zend_string *str) {
+    zval_ptr_dtor(property);
+    ZVAL_STR(property, str);
+}
+
+static zend_string *dd_native_arg_to_string(zend_execute_data *execute_data, uint32_t arg) {
+    if (EX_NUM_ARGS() < arg) {
+        return ZSTR_EMPTY_ALLOC();
+    }
+    zval *zv = ZEND_CALL_ARG(execute_data, arg);
+    ZVAL_DEREF(zv);
+    if (Z_TYPE_P(zv) == IS_STRING) {
+        return zend_string_copy(Z_STR_P(zv));
+    }
+    // the arguments are not coerced yet; anything which is not a scalar will fail the parameter parsing anyway
+    return Z_TYPE_P(zv) < IS_STRING ? zval_get_string(zv) : ZSTR_EMPTY_ALLOC();
+}
+
+static bool dd_native_call_method(zval *object, const char *name, size_t name_len, zval *rv, uint32_t argc, zval *arg) {
+    bool success = argc ? zai_symbol_call_method_literal(object, name, name_len, rv, argc, arg)
+                        : zai_symbol_call_method_literal(object, name, name_len, rv, 0);
+    if (!success) {
+        ZVAL_UNDEF(rv);
+    }
+    return success;
+}
+
+static void dd_native_store_connection_tags(zend_execute_data *execute_data, zval *thisp) {
+    if (!EX_NUM_ARGS() || Z_TYPE_P(ZEND_CALL_ARG(execute_data, 1)) != IS_STRING) {
+        return;
+    }
+
+    zval tags;
+    ZVAL_ARR(&tags, ddtrace_pdo_dsn_tags(Z_STR_P(ZEND_CALL_ARG(execute_data, 1))));
+    if (EX_NUM_ARGS() >= 2) {
+        zval *user = ZEND_CALL_ARG(execute_data, 2);
+        ZVAL_DEREF(user);
+        if (Z_TYPE_P(user) > IS_NULL) {
+            Z_TRY_ADDREF_P(user);
+            zend_hash_str_update(Z_ARR(tags), ZEND_STRL("db.user"), user);
+        }
+    }
+    ddtrace_object_store_put(Z_OBJ_P(thisp), dd_connection_tags_key, &tags);
+    zval_ptr_dtor(&tags);
+}
+
+// Normalizer::normalizeHostUdsAsService(): strip the scheme and spaces, collapse anything else into dashes
+static void dd_native_append_host_as_service(smart_str *service, zend_string *host) {
+    const char *start = ZSTR_VAL(host), *end = ZSTR_VAL(host) + ZSTR_LEN(host);
+    for (const char *p = start; p + 3 <= end; ++p) {
+        if (p[0] == ':' && p[1] == '/' && p[2] == '/') {
+            start = p + 3;
+        }
+    }
+
+    size_t prefix_len = ZSTR_LEN(service->s);
+    bool dash = false;
+    for (const char *p = start; p < end; ++p) {
+        if (*p == ' ') {
+            continue;
+        }
+        if ((*p >= 'a' && *p <= 'z') || (*p >= 'A' && *p <= 'Z') || (*p >= '0' && *p <= '9') || *p == '.' || *p == '_') {
+            if (dash && ZSTR_LEN(service->s) > prefix_len) {
+                smart_str_appendc(service, '-');
+            }
+            dash = false;
+            smart_str_appendc(service, *p);
+        } else {
+            dash = true;
+        }
+    }
+}
+
+// The type, service, span kind, component and connection tags shared by all PDO spans
+static void dd_native_pdo_common_span_info(ddtrace_span_data *span, zval *thisp) {
+    zval *tags = ddtrace_object_store_get(Z_OBJ_P(thisp), dd_connection_tags_key);
+    if (tags) {
+        ZVAL_DEREF(tags);
+        if (Z_TYPE_P(tags) != IS_ARRAY) {
+            tags = NULL;
+        }
+    }
+
+    dd_native_set_string(ddtrace_spandata_property_type(span), zend_string_init(ZEND_STRL("sql"), 0));
+
+    smart_str service = {0};
+    smart_str_appends(&service, "pdo");
+    zval *host;
+    if (get_DD_TRACE_DB_CLIENT_SPLIT_BY_INSTANCE() && tags &&
+        (host = zend_hash_str_find(Z_ARR_P(tags), ZEND_STRL("out.host"))) && Z_TYPE_P(host) == IS_STRING) {
+        smart_str_appendc(&service, '-');
+        dd_native_append_host_as_service(&service, Z_STR_P(host));
+    }
+    smart_str_0(&service);
+    dd_native_set_string(ddtrace_spandata_property_service(span), service.s);
+
+    zend_array *meta = ddtrace_spandata_property_meta(span);
+    zval value;
+    ZVAL_STR(&value, zend_string_init(ZEND_STRL("client"), 0));
+    zend_hash_str_update(meta, ZEND_STRL("span.kind"), &value);
+    ZVAL_STR(&value, zend_string_init(ZEND_STRL("pdo"), 0));
+    zend_hash_str_update(meta, ZEND_STRL("component"), &value);
+    if (tags) {
+        zend_hash_merge(meta, Z_ARR_P(tags), zval_add_ref, 1);
+    }
+}
+
+// Prepends the Database Monitoring comment to the first argument, like DatabaseIntegrationHelper does for the PHP integrations
+static void dd_native_inject_dbm_comment(ddtrace_span_data *span, zend_execute_data *execute_data, zval *thisp) {
+    if (get_DD_DBM_PROPAGATION_MODE() == DD_TRACE_DBM_PROPAGATION_DISABLED || !EX_NUM_ARGS()) {
+        return;
+    }
+
+    zval driver, attribute;
+    ZVAL_LONG(&attribute, DD_PDO_ATTR_DRIVER_NAME);
+    if (!dd_native_call_method(thisp, ZEND_STRL("getattribute"), &driver, 1, &attribute)) {
+        return;
+    }
+    zend_long mode = DD_TRACE_DBM_PROPAGATION_DISABLED;
+    if (Z_TYPE(driver) == IS_STRING) {
+        mode = ddtrace_dbm_propagation_mode(Z_STR(driver));
+    }
+    zval_ptr_dtor(&driver);
+    if (mode == DD_TRACE_DBM_PROPAGATION_DISABLED) {
+        return;
+    }
+
+    zval *service = ddtrace_spandata_property_service(span);
+    zend_string *db_service = Z_TYPE_P(service) == IS_STRING ? Z_STR_P(service) : NULL;
+    zval *query = ZEND_CALL_ARG(execute_data, 1);
+    zend_string *original = zval_get_string(query);
+    zend_string *commented = ddtrace_dbm_propagate_via_sql_comments(original, db_service, mode);
+    zend_string_release(original);
+
+    zval garbage;
+    ZVAL_COPY_VALUE(&garbage, query);
+    ZVAL_STR(query, commented);
+    zval_ptr_dtor(&garbage);
+
+    zval injected;
+    ZVAL_STR(&injected, zend_string_init(ZEND_STRL("true"), 0));
+    zend_hash_str_update(ddtrace_spandata_property_meta(span), ZEND_STRL("_dd.dbm_trace_injected"), &injected);
+}
+
+// Error codes follow the ANSI SQL-92 convention, '00', '01' and 'IM' are no errors
+static void dd_native_pdo_detect_error(ddtrace_span_data *span, zval *thisp) {
+    zval code;
+    if (!dd_native_call_method(thisp, ZEND_STRL("errorcode"), &code, 0, NULL)) {
+        return;
+    }
+    if (Z_TYPE(code) != IS_STRING || Z_STRLEN(code) != 5 || strncasecmp(Z_STRVAL(code), "00", 2) == 0 ||
+        strncasecmp(Z_STRVAL(code), "01", 2) == 0 || strncasecmp(Z_STRVAL(code), "IM", 2) == 0) {
+        zval_ptr_dtor(&code);
+        return;
+    }
+
+    zval info;
+    if (!dd_native_call_method(thisp, ZEND_STRL("errorinfo"), &info, 0, NULL) || Z_TYPE(info) != IS_ARRAY) {
+        zval_ptr_dtor(&info);
+        zval_ptr_dtor(&code);
+        return;
+    }
+
+    smart_str message = {0};
+    smart_str_appends(&message, "SQL error: ");
+    smart_str_append(&message, Z_STR(code));
+    smart_str_appends(&message, ". Driver error: ");
+    zval *driver_code = zend_hash_index_find(Z_ARR(info), 1);
+    if (driver_code && Z_TYPE_P(driver_code) > IS_NULL) {
+        zend_string *str = zval_get_string(driver_code);
+        smart_str_append(&message, str);
+        zend_string_release(str);
+    }
+    if (zend_hash_num_elements(Z_ARR(info)) > 2) {
+        smart_str_appends(&message, ". Driver-specific error data: ");
+        zend_ulong index = 0;
+        zval *data;
+        ZEND_HASH_FOREACH_VAL(Z_ARR(info), data) {
+            if (index++ < 2) {
+                continue;
+            }
+            if (index > 3) {
+                smart_str_appends(&message, ". ");
+            }
+            zend_string *str = zval_get_string(data);
+            smart_str_append(&message, str);
+            zend_string_release(str);
+        } ZEND_HASH_FOREACH_END();
+    }
+    smart_str_0(&message);
+
+    zend_array *meta = ddtrace_spandata_property_meta(span);
+    zval value;
+    ZVAL_STR(&value, message.s);
+    zend_hash_str_update(meta, ZEND_STRL("error.message"), &value);
+    ZVAL_STR(&value, zend_strpprintf(0, "%s error", ZSTR_VAL(Z_OBJCE_P(thisp)->name)));
+    zend_hash_str_update(meta, ZEND_STRL("error.type"), &value);
+
+    zval_ptr_dtor(&info);
+    zval_ptr_dtor(&code);
+}
+
+static void dd_native_pdo_row_count(ddtrace_span_data *span, zval *thisp, zval *retval) {
+    zval count;
+    if (Z_TYPE_P(retval) == IS_LONG) {
+        ZVAL_LONG(&count, Z_LVAL_P(retval));
+    } else if (Z_TYPE_P(retval) == IS_OBJECT || Z_TYPE_P(retval) == IS_TRUE) {
+        if (!dd_native_call_method(Z_TYPE_P(retval) == IS_OBJECT ? retval : thisp, ZEND_STRL("rowcount"), &count, 0, NULL)) {
+            return;
+        }
+        if (Z_TYPE(count) != IS_LONG) {
+            zval_ptr_dtor(&count);
+            return;
+        }
+    } else {
+        return;
+    }
+    zend_hash_str_update(ddtrace_spandata_property_metrics(span), ZEND_STRL("db.row_count"), &count);
+}
+
+static bool dd_native_hook_begin(zend_ulong invocation, zend_execute_data *execute_data, void *auxiliary, void *dynamic) {
+    const dd_native_hook *hook = auxiliary;
+    ddtrace_span_data **span = dynamic;
+
+    *span = NULL;
+    zval *thisp = getThis();
+    if (!thisp || ddtrace_tracer_is_limited() || !get_DD_TRACE_ENABLED() ||
+        !ddtrace_config_integration_enabled(hook->integration)) {
+        return true;
+    }
+
+    *span = ddtrace_alloc_execute_data_span(invocation, execute_data);
+
+    zend_string *name = zend_string_init(hook->name.ptr, hook->name.len, 0);
+    dd_native_set_string(ddtrace_spandata_property_name(*span), zend_string_copy(name));
+    if (hook->flags & DD_NATIVE_RESOURCE_ARG0) {
+        zend_string_release(name);
+        name = dd_native_arg_to_string(execute_data, 1);
+    } else if (hook->flags & DD_NATIVE_RESOURCE_QUERY_STRING) {
+        zend_string_release(name);
+#if PHP_VERSION_ID < 80000
+        zval rv, *query = zend_read_property(Z_OBJCE_P(thisp), thisp, ZEND_STRL("queryString"), 1, &rv);
+#else
+        zval rv, *query = zend_read_property(Z_OBJCE_P(thisp), Z_OBJ_P(thisp), ZEND_STRL("queryString"), 1, &rv);
+#endif
+        name = query && Z_TYPE_P(query) == IS_STRING ? zend_string_copy(Z_STR_P(query)) : ZSTR_EMPTY_ALLOC();
+    }
+    dd_native_set_string(ddtrace_spandata_property_resource(*span), name);
+
+    if (hook->flags & DD_NATIVE_CONNECT) {
+        dd_native_store_connection_tags(execute_data, thisp);
+    }
+
+    dd_native_pdo_common_span_info(*span, thisp);
+
+    if ((hook->flags & DD_NATIVE_ANALYTICS) && ddtrace_integrations[hook->integration].is_analytics_enabled()) {
+        zval sample_rate;
+        ZVAL_DOUBLE(&sample_rate, ddtrace_integrations[hook->integration].get_sample_rate());
+        zend_hash_str_update(ddtrace_spandata_property_metrics(*span), ZEND_STRL("_dd1.sr.eausr"), &sample_rate);
+    }
+
+    if (hook->flags & DD_NATIVE_DBM) {
+        dd_native_inject_dbm_comment(*span, execute_data, thisp);
+    }
+
+    return true;
+}
+
+static void dd_native_hook_end(zend_ulong invocation, zend_execute_data *execute_data, zval *retval, void *auxiliary, void *dynamic) {
+    const dd_native_hook *hook = auxiliary;
+    ddtrace_span_data *span = *(ddtrace_span_data **)dynamic;
+
+    if (!span) {
+        return;
+    }
+
+    if (span->duration == DDTRACE_DROPPED_SPAN) {
+        ddtrace_clear_execute_data_span(invocation, false);
+        return;
+    }
+
+    zval *exception_zv = ddtrace_spandata_property_exception(span);
+    if (EG(exception) && Z_TYPE_P(exception_zv) <= IS_FALSE) {
+        ZVAL_OBJ_COPY(exception_zv, EG(exception));
+    }
+
+    dd_trace_stop_span_time(span);
+
+    zval *thisp = getThis();
+    if (hook->flags & DD_NATIVE_ROW_COUNT) {
+        dd_native_pdo_row_count(span, thisp, retval);
+    }
+    if ((hook->flags & DD_NATIVE_PROPAGATE) && Z_TYPE_P(retval) == IS_OBJECT) {
+        zval *tags = ddtrace_object_store_get(Z_OBJ_P(thisp), dd_connection_tags_key), null;
+        if (tags) {
+            ZVAL_DEREF(tags);
+        } else {
+            ZVAL_NULL(&null);
+            tags = &null;
+        }
+        ddtrace_object_store_put(Z_OBJ_P(retval), dd_connection_tags_key, tags);
+    }
+    // the calls are sandboxed, so the error is also recorded with PDO::ERRMODE_EXCEPTION
+    if (hook->flags & DD_NATIVE_DETECT_ERROR) {
+        dd_native_pdo_detect_error(span, thisp);
+    }
+
+    ddtrace_clear_execute_data_span(invocation, true);
+}
+
+void ddtrace_native_integrations_minit(void) {
+    dd_connection_tags_key = zend_string_init_interned(ZEND_STRL("connection_tags"), 1);
+
+    for (size_t i = 0; i < sizeof(dd_native_hooks) / sizeof(dd_native_hooks[0]); ++i) {
+        const dd_native_hook *hook = &dd_native_hooks[i];
+        zai_hook_install(hook->scope, hook->function, dd_native_hook_begin, dd_native_hook_end,
+                         ZAI_HOOK_AUX((void *)hook, NULL), sizeof(ddtrace_span_data *));
+    }
+}
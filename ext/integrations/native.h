@@ -0,0 +1,7 @@
+#ifndef DD_INTEGRATIONS_NATIVE_H
+#define DD_INTEGRATIONS_NATIVE_H
+
+// Installs the hooks of the integrations which are implemented in C rather than loaded from PHP
+void ddtrace_native_integrations_minit(void);
+
+#endif  // DD_INTEGRATIONS_NATIVE_H
@@ -0,0 +1,148 @@
+#include "pdo_dsn.h"
+
+#include <php.h>
+#include <strings.h>
+
+#include "../compatibility.h"
+#include "../ddtrace.h"
+
+ZEND_EXTERN_MODULE_GLOBALS(ddtrace);
+
+// An application connects to a handful of databases; past that, DSNs are most likely generated and not worth keeping
+#define DD_PDO_DSN_TAGS_CACHE_MAX 64
+
+/* The tags of every distinct DSN are kept for the lifetime of the thread, in DDTRACE_G(pdo_dsn_tags). Their strings are
+ * persistent and flagged as interned, so that the per-request copy handed to userland does not need to copy or
+ * refcount them. They are only ever freed on GSHUTDOWN. */
+static zend_string *dd_pdo_dsn_persistent_string(const char *str, size_t len) {
+    zend_string *string = zend_string_init(str, len, 1);
+    zend_string_hash_val(string);
+    GC_ADD_FLAGS(string, IS_STR_INTERNED);
+    return string;
+}
+
+static void dd_pdo_dsn_tags_add(HashTable *tags, bool persistent, const char *key, size_t key_len, const char *value,
+                                size_t value_len) {
+    zval zv;
+    if (persistent) {
+        ZVAL_INTERNED_STR(&zv, dd_pdo_dsn_persistent_string(value, value_len));
+        zend_string *key_str = dd_pdo_dsn_persistent_string(key, key_len);
+        zval *old = zend_hash_find(tags, key_str);
+        if (old) {
+            pefree(Z_STR_P(old), 1);
+            ZVAL_COPY_VALUE(old, &zv);
+            pefree(key_str, 1);
+        } else {
+            zend_hash_add_new(tags, key_str, &zv);
+        }
+    } else {
+        ZVAL_STRINGL(&zv, value, value_len);
+        zend_hash_str_update(tags, key, key_len, &zv);
+    }
+}
+
+static const char *dd_pdo_db_system(const char *engine, size_t len) {
+    static const struct {
+        const char *driver;
+        const char *system;
+    } systems[] = {
+        {"cubrid", "other_sql"},
+        // may be mssql or Sybase, not supported anymore so shouldn't be a problem
+        {"dblib", "other_sql"},
+        {"firebird", "firebird"},
+        {"ibm", "db2"},
+        {"informix", "informix"},
+        {"mysql", "mysql"},
+        {"sqlsrv", "mssql"},
+        {"oci", "oracle"},
+        {"odbc", "other_sql"},
+        {"pgsql", "postgresql"},
+        {"sqlite", "sqlite"},
+    };
+    for (size_t i = 0; i < sizeof(systems) / sizeof(systems[0]); ++i) {
+        if (strlen(systems[i].driver) == len && memcmp(systems[i].driver, engine, len) == 0) {
+            return systems[i].system;
+        }
+    }
+    return "other_sql";
+}
+
+#define DD_PDO_DSN_KEY_IS(str) (key_len == sizeof(str) - 1 && strncasecmp(key, str, sizeof(str) - 1) == 0)
+
+// Parses "<engine>:key=value;key=value"
+static void dd_pdo_dsn_parse(HashTable *tags, bool persistent, zend_string *dsn) {
+    const char *str = ZSTR_VAL(dsn), *end = str + ZSTR_LEN(dsn);
+    const char *colon = memchr(str, ':', ZSTR_LEN(dsn));
+    size_t engine_len = colon ? (size_t)(colon - str) : 0;
+
+    const char *system = dd_pdo_db_system(str, engine_len);
+    dd_pdo_dsn_tags_add(tags, persistent, ZEND_STRL("db.engine"), str, engine_len);
+    dd_pdo_dsn_tags_add(tags, persistent, ZEND_STRL("db.system"), system, strlen(system));
+
+    const char *pair = str + engine_len + 1;
+    while (pair < end) {
+        const char *pair_end = memchr(pair, ';', end - pair);
+        if (!pair_end) {
+            pair_end = end;
+        }
+
+        const char *equals = memchr(pair, '=', pair_end - pair);
+        if (equals && equals != pair) {
+            const char *key = pair, *value = equals + 1;
+            size_t key_len = equals - pair;
+            // only up to a second '=', if any
+            const char *value_end = memchr(value, '=', pair_end - value);
+            size_t value_len = (value_end ? value_end : pair_end) - value;
+
+            if (DD_PDO_DSN_KEY_IS("charset")) {
+                dd_pdo_dsn_tags_add(tags, persistent, ZEND_STRL("db.charset"), value, value_len);
+            } else if (DD_PDO_DSN_KEY_IS("database") || DD_PDO_DSN_KEY_IS("dbname")) {
+                dd_pdo_dsn_tags_add(tags, persistent, ZEND_STRL("db.name"), value, value_len);
+            } else if (DD_PDO_DSN_KEY_IS("server") || DD_PDO_DSN_KEY_IS("unix_socket") ||
+                       DD_PDO_DSN_KEY_IS("hostname") || DD_PDO_DSN_KEY_IS("host")) {
+                dd_pdo_dsn_tags_add(tags, persistent, ZEND_STRL("out.host"), value, value_len);
+            } else if (DD_PDO_DSN_KEY_IS("port")) {
+                dd_pdo_dsn_tags_add(tags, persistent, ZEND_STRL("out.port"), value, value_len);
+            }
+        }
+
+        pair = pair_end + 1;
+    }
+}
+
+static void dd_pdo_dsn_tags_free(HashTable *tags) {
+    zend_string *key;
+    zval *value;
+    ZEND_HASH_FOREACH_STR_KEY_VAL(tags, key, value) {
+        pefree(key, 1);
+        pefree(Z_STR_P(value), 1);
+    }
+    ZEND_HASH_FOREACH_END();
+    zend_hash_destroy(tags);
+    pefree(tags, 1);
+}
+
+static void dd_pdo_dsn_tags_dtor(zval *zv) { dd_pdo_dsn_tags_free(Z_PTR_P(zv)); }
+
+void ddtrace_pdo_dsn_tags_ginit(HashTable *cache) { zend_hash_init(cache, 8, NULL, dd_pdo_dsn_tags_dtor, 1); }
+
+void ddtrace_pdo_dsn_tags_gshutdown(HashTable *cache) { zend_hash_destroy(cache); }
+
+zend_array *ddtrace_pdo_dsn_tags(zend_string *dsn) {
+    HashTable *cache = &DDTRACE_G(pdo_dsn_tags);
+    HashTable *tags = zend_hash_find_ptr(cache, dsn);
+    if (!tags) {
+        if (zend_hash_num_elements(cache) >= DD_PDO_DSN_TAGS_CACHE_MAX) {
+            zend_array *uncached = zend_new_array(8);
+            dd_pdo_dsn_parse(uncached, false, dsn);
+            return uncached;
+        }
+
+        tags = pemalloc(sizeof(HashTable), 1);
+        zend_hash_init(tags, 8, NULL, NULL, 1);
+        dd_pdo_dsn_parse(tags, true, dsn);
+        zend_hash_str_add_ptr(cache, ZSTR_VAL(dsn), ZSTR_LEN(dsn), tags);
+    }
+
+    return zend_array_dup(tags);
+}
@@ -0,0 +1,11 @@
+#ifndef DD_INTEGRATIONS_PDO_DSN_H
+#define DD_INTEGRATIONS_PDO_DSN_H
+#include <php.h>
+
+void ddtrace_pdo_dsn_tags_ginit(HashTable *cache);
+void ddtrace_pdo_dsn_tags_gshutdown(HashTable *cache);
+
+// Returns the connection tags for a PDO DSN, as a new array
+zend_array *ddtrace_pdo_dsn_tags(zend_string *dsn);
+
+#endif  // DD_INTEGRATIONS_PDO_DSN_H
@@ -28,6 +28,7 @@ static bool dd_parse_forwarded(zend_string *zvalue, ipaddr *out);
 typedef struct _header_map_node {
     zend_string *key;
     zend_string *name;
+    zend_string *tag;  // http.request.headers.<name>
     extract_func_t parse_fn;
 } header_map_node;
 
@@ -54,28 +55,32 @@ static zend_string *dd_ipaddr_to_zstr(const ipaddr *ipaddr);
 static zend_string *dd_try_extract(const zval *server, zend_string *key, extract_func_t extract_func);
 static zend_string *dd_try_extract_ip_from_custom_header(const zval *server, zend_string *ipheader);
 
+static header_map_node dd_header_map_node(const char *key, size_t key_len, const char *name, size_t name_len, extract_func_t parse_fn) {
+    char tag[64];
+    ZEND_ASSERT(sizeof("http.request.headers.") - 1 + name_len < sizeof(tag));
+    memcpy(tag, "http.request.headers.", sizeof("http.request.headers.") - 1);
+    memcpy(tag + sizeof("http.request.headers.") - 1, name, name_len);
+
+    return (header_map_node){
+        .key = zend_string_init_interned(key, key_len, 1),
+        .name = zend_string_init_interned(name, name_len, 1),
+        .tag = zend_string_init_interned(tag, sizeof("http.request.headers.") - 1 + name_len, 1),
+        .parse_fn = parse_fn,
+    };
+}
+
 void dd_ip_extraction_startup() {
-    priority_header_map[X_FORWARDED_FOR] = (header_map_node){zend_string_init_interned(ZEND_STRL("HTTP_X_FORWARDED_FOR"), 1),
-                                                             zend_string_init_interned(ZEND_STRL("x-forwarded-for"), 1), &dd_parse_x_forwarded_for};
-    priority_header_map[X_REAL_IP] = (header_map_node){zend_string_init_interned(ZEND_STRL("HTTP_X_REAL_IP"), 1),
-                                                       zend_string_init_interned(ZEND_STRL("x-real-ip"), 1), &dd_parse_plain};
-    priority_header_map[TRUE_CLIENT_IP] = (header_map_node){zend_string_init_interned(ZEND_STRL("HTTP_TRUE_CLIENT_IP"), 1),
-                                                            zend_string_init_interned(ZEND_STRL("true-client-ip"), 1), &dd_parse_plain};
-    priority_header_map[X_CLIENT_IP] = (header_map_node){zend_string_init_interned(ZEND_STRL("HTTP_X_CLIENT_IP"), 1),
-                                                         zend_string_init_interned(ZEND_STRL("x-client-ip"), 1), &dd_parse_plain};
-    priority_header_map[X_FORWARDED] = (header_map_node){zend_string_init_interned(ZEND_STRL("HTTP_X_FORWARDED"), 1),
-                                                         zend_string_init_interned(ZEND_STRL("x-forwarded"), 1), &dd_parse_forwarded};
-    priority_header_map[FORWARDED_FOR] = (header_map_node){zend_string_init_interned(ZEND_STRL("HTTP_FORWARDED_FOR"), 1),
-                                                           zend_string_init_interned(ZEND_STRL("forwarded-for"), 1), &dd_parse_x_forwarded_for};
+    priority_header_map[X_FORWARDED_FOR] = dd_header_map_node(ZEND_STRL("HTTP_X_FORWARDED_FOR"), ZEND_STRL("x-forwarded-for"), &dd_parse_x_forwarded_for);
+    priority_header_map[X_REAL_IP] = dd_header_map_node(ZEND_STRL("HTTP_X_REAL_IP"), ZEND_STRL("x-real-ip"), &dd_parse_plain);
+    priority_header_map[TRUE_CLIENT_IP] = dd_header_map_node(ZEND_STRL("HTTP_TRUE_CLIENT_IP"), ZEND_STRL("true-client-ip"), &dd_parse_plain);
+    priority_header_map[X_CLIENT_IP] = dd_header_map_node(ZEND_STRL("HTTP_X_CLIENT_IP"), ZEND_STRL("x-client-ip"), &dd_parse_plain);
+    priority_header_map[X_FORWARDED] = dd_header_map_node(ZEND_STRL("HTTP_X_FORWARDED"), ZEND_STRL("x-forwarded"), &dd_parse_forwarded);
+    priority_header_map[FORWARDED_FOR] = dd_header_map_node(ZEND_STRL("HTTP_FORWARDED_FOR"), ZEND_STRL("forwarded-for"), &dd_parse_x_forwarded_for);
     priority_header_map[X_CLUSTER_CLIENT_IP] =
-        (header_map_node){zend_string_init_interned(ZEND_STRL("HTTP_X_CLUSTER_CLIENT_IP"), 1),
-                          zend_string_init_interned(ZEND_STRL("x-cluster-client-ip"), 1), &dd_parse_x_forwarded_for};
-    priority_header_map[FASTLY_CLIENT_IP] = (header_map_node){zend_string_init_interned(ZEND_STRL("HTTP_FASTLY_CLIENT_IP"), 1),
-                                                              zend_string_init_interned(ZEND_STRL("fastly-client-ip"), 1), &dd_parse_plain};
-    priority_header_map[CF_CONNECTING_IP] = (header_map_node){zend_string_init_interned(ZEND_STRL("HTTP_CF_CONNECTING_IP"), 1),
-                                                              zend_string_init_interned(ZEND_STRL("cf-connecting-ip"), 1), &dd_parse_plain};
-    priority_header_map[CF_CONNECTING_IPV6] = (header_map_node){zend_string_init_interned(ZEND_STRL("HTTP_CF_CONNECTING_IPV6"), 1),
-                                                                zend_string_init_interned(ZEND_STRL("cf-connecting-ipv6"), 1), &dd_parse_plain};
+        dd_header_map_node(ZEND_STRL("HTTP_X_CLUSTER_CLIENT_IP"), ZEND_STRL("x-cluster-client-ip"), &dd_parse_x_forwarded_for);
+    priority_header_map[FASTLY_CLIENT_IP] = dd_header_map_node(ZEND_STRL("HTTP_FASTLY_CLIENT_IP"), ZEND_STRL("fastly-client-ip"), &dd_parse_plain);
+    priority_header_map[CF_CONNECTING_IP] = dd_header_map_node(ZEND_STRL("HTTP_CF_CONNECTING_IP"), ZEND_STRL("cf-connecting-ip"), &dd_parse_plain);
+    priority_header_map[CF_CONNECTING_IPV6] = dd_header_map_node(ZEND_STRL("HTTP_CF_CONNECTING_IPV6"), ZEND_STRL("cf-connecting-ipv6"), &dd_parse_plain);
 
     remote_addr_key = zend_string_init_interned(ZEND_STRL("REMOTE_ADDR"), 1);
 }
@@ -105,7 +110,7 @@ static zend_string *dd_get_ipheader(zend_string *value) {
     return normalized_value;
 }
 
-void ddtrace_extract_ip_from_headers(zval *server, zend_array *meta) {
+void ddtrace_extract_ip_from_headers(zval *server, zend_array *meta, bool server_vars_only) {
     zend_string *client_ip = NULL;
 
     zend_string *ipheader = dd_get_ipheader(get_DD_TRACE_CLIENT_IP_HEADER());
@@ -118,15 +123,13 @@ void ddtrace_extract_ip_from_headers(zval *server, zend_array *meta) {
     } else {
         for (unsigned i = 0; i < ARRAY_SIZE(priority_header_map); i++) {
             zval *val = zend_hash_find(Z_ARR_P(server), priority_header_map[i].key);
-            if (!val) {
+            if (!val && !server_vars_only) {
                 val = zend_hash_find(Z_ARR_P(server), priority_header_map[i].name);
             }
             if (val && Z_TYPE_P(val) == IS_STRING && Z_STRLEN_P(val) > 0) {
-                zend_string *headertag = zend_strpprintf(0, "http.request.headers.%s", ZSTR_VAL(priority_header_map[i].name));
                 zval headerzv;
                 ZVAL_STR_COPY(&headerzv, Z_STR_P(val));
-                zend_hash_update(meta, headertag, &headerzv);
-                zend_string_release(headertag);
+                zend_hash_update(meta, priority_header_map[i].tag, &headerzv);
 
                 if (!client_ip) {
                     // We pick the most priority header only
@@ -316,12 +319,18 @@ static bool dd_parse_ip_address(const char *_addr, size_t addr_len, bool ip_or_e
     if (addr_len == 0) {
         return false;
     }
-    char *addr = safe_emalloc(addr_len, 1, 1);
+
+    // anything longer than the longest textual IPv6 address is not an address; parse from a stack copy otherwise
+    char addr[INET6_ADDRSTRLEN];
+    if (addr_len >= sizeof(addr)) {
+        if (ip_or_error) {
+            ddtrace_log_errf("Not recognized as IP address: \"%.*s\"", (int)addr_len, _addr);
+        }
+        return false;
+    }
     memcpy(addr, _addr, addr_len);
     addr[addr_len] = '\0';
 
-    bool res = true;
-
     int ret = inet_pton(AF_INET, addr, &out->v4);
     if (ret != 1) {
         ret = inet_pton(AF_INET6, addr, &out->v6);
@@ -329,8 +338,7 @@ static bool dd_parse_ip_address(const char *_addr, size_t addr_len, bool ip_or_e
             if (ip_or_error) {
                 ddtrace_log_errf("Not recognized as IP address: \"%s\"", addr);
             }
-            res = false;
-            goto err;
+            return false;
         }
 
         uint8_t *s6addr = out->v6.s6_addr;
@@ -349,9 +357,7 @@ static bool dd_parse_ip_address(const char *_addr, size_t addr_len, bool ip_or_e
         out->af = AF_INET;
     }
 
-err:
-    efree(addr);
-    return res;
+    return true;
 }
 
 static bool dd_parse_ip_address_maybe_port_pair(const char *addr, size_t addr_len, bool ip_or_error, ipaddr *out) {
@@ -4,6 +4,7 @@
 #include <php.h>
 
 void dd_ip_extraction_startup(void);
-void ddtrace_extract_ip_from_headers(zval *server, zend_array *meta);
+// server_vars_only: whether the headers only need to be looked up as HTTP_* server variables, not by their plain name
+void ddtrace_extract_ip_from_headers(zval *server, zend_array *meta, bool server_vars_only);
 
 #endif
@@ -1,32 +1,32 @@
 #include "limiter.h"
 
-#include <pthread.h>
+#include <stdatomic.h>
 #include <unistd.h>
 #include <sys/mman.h>
 
 // clang-format Off
 
 #define NANOSECONDS_PER_SECOND 1000000000
+#define NANOSECONDS_PER_MILLISECOND 1000000
+#define MILLISECONDS_PER_SECOND 1000
+
+/*
+ The current window is packed into a single word, so that it can be updated with a CAS by all forks sharing the limiter:
+ the upper bits hold the beginning of the window (in milliseconds since the limiter was created), the lower bits the
+ number of samples seen in this window. The allowed count is not stored, it is always min(samples, limit).
+*/
+#define DD_LIMITER_SAMPLES_BITS 24
+#define DD_LIMITER_SAMPLES_MASK ((UINT64_C(1) << DD_LIMITER_SAMPLES_BITS) - 1)
 
 typedef struct {
     /* limit from configuration DD_TRACE_RATE_LIMIT */
     uint32_t limit;
-    struct {
-        /* beginning of window */
-        uint64_t open;
-        /* last hit inside this window */
-        uint64_t current;
-        /* total count for this window */
-        uint32_t samples;
-        /* allowed count for this window */
-        uint32_t allowed;
-        /* limit (tokens) for this window */
-        uint32_t limit;
-        /* rate for the last window that passed */
-        uint32_t rate;
-    } window;
-
-    pthread_mutex_t lock;
+    /* clock at creation, the windows are relative to it */
+    uint64_t epoch;
+    /* beginning of window << DD_LIMITER_SAMPLES_BITS | samples in this window (saturating) */
+    _Atomic uint64_t window;
+    /* rate for the last window that passed (as double bits), 0 if there was none yet */
+    _Atomic uint64_t rate;
 } ddtrace_limiter;
 
 static ddtrace_limiter* dd_limiter;
@@ -44,6 +44,14 @@ static inline uint64_t ddtrace_limiter_clock() {
             ts.tv_nsec;                           /* plus remaining nanoseconds */
 }
 
+static inline uint64_t ddtrace_limiter_now() {
+    return (ddtrace_limiter_clock() - dd_limiter->epoch) / NANOSECONDS_PER_MILLISECOND;
+}
+
+static inline uint32_t ddtrace_limiter_allowed(uint32_t samples) {
+    return samples < dd_limiter->limit ? samples : dd_limiter->limit;
+}
+
 void ddtrace_limiter_create() {
     uint32_t limit = (uint32_t) get_global_DD_TRACE_RATE_LIMIT();
 
@@ -54,7 +62,7 @@ void ddtrace_limiter_create() {
     /*
      We share the limiter among forks (ie, forks need to write this memory), this requires that we map the memory as anonymous and shared
     */
-    dd_limiter = mmap(NULL, sysconf(_SC_PAGESIZE), PROT_WRITE, MAP_SHARED|MAP_ANONYMOUS, -1, 0);
+    dd_limiter = mmap(NULL, sysconf(_SC_PAGESIZE), PROT_READ|PROT_WRITE, MAP_SHARED|MAP_ANONYMOUS, -1, 0);
 
     if ( dd_limiter == MAP_FAILED) {
         dd_limiter = NULL;
@@ -62,19 +70,9 @@ void ddtrace_limiter_create() {
     }
 
     dd_limiter->limit = limit;
-    dd_limiter->window.open = ddtrace_limiter_clock();
-    dd_limiter->window.limit = limit;
-
-    pthread_mutexattr_t mattr;
-
-    /*
-     Mutex must have PROCESS_SHARED set to be usable among forks
-    */
-    pthread_mutexattr_init(&mattr);
-    pthread_mutexattr_setpshared(
-        &mattr, PTHREAD_PROCESS_SHARED);
-    pthread_mutex_init(&dd_limiter->lock, &mattr);
-    pthread_mutexattr_destroy(&mattr);
+    dd_limiter->epoch = ddtrace_limiter_clock();
+    atomic_init(&dd_limiter->window, 0);
+    atomic_init(&dd_limiter->rate, 0);
 }
 
 bool ddtrace_limiter_active() {
@@ -88,53 +86,54 @@ bool ddtrace_limiter_active() {
 bool ddtrace_limiter_allow() {
     ZEND_ASSERT(dd_limiter);
 
-    pthread_mutex_lock(&dd_limiter->lock);
-
-    dd_limiter->window.current  = ddtrace_limiter_clock();
-
-    if (dd_limiter->window.current > (dd_limiter->window.open + NANOSECONDS_PER_SECOND)) {
-        /* window passed, reset */
-
-        /* store current window rate for effective rate calculation */
-        dd_limiter->window.rate = dd_limiter->window.samples ?
-            (double) dd_limiter->window.allowed / dd_limiter->window.samples : 1;
-
-        /* move window */
-        dd_limiter->window.open = dd_limiter->window.current;
-        dd_limiter->window.samples = 0;
-        dd_limiter->window.allowed = 0;
-    }
-
-    if (dd_limiter->window.samples++ < dd_limiter->window.limit) {
-        dd_limiter->window.allowed++;
-
-        pthread_mutex_unlock(&dd_limiter->lock);
+    uint64_t now = ddtrace_limiter_now();
+    uint64_t window = atomic_load_explicit(&dd_limiter->window, memory_order_relaxed), next;
+    uint32_t samples;
+    bool passed;
+
+    do {
+        uint64_t open = window >> DD_LIMITER_SAMPLES_BITS;
+        samples = (uint32_t) (window & DD_LIMITER_SAMPLES_MASK);
+
+        passed = now > open + MILLISECONDS_PER_SECOND;
+        if (passed) {
+            /* window passed, move it and count this sample in the new one */
+            next = (now << DD_LIMITER_SAMPLES_BITS) | 1;
+        } else {
+            next = samples == DD_LIMITER_SAMPLES_MASK ? window : window + 1;
+        }
+    } while (!atomic_compare_exchange_weak_explicit(&dd_limiter->window, &window, next, memory_order_relaxed, memory_order_relaxed));
+
+    if (passed) {
+        /* store the passed window rate for effective rate calculation, only the fork moving the window does */
+        double rate = samples ? (double) ddtrace_limiter_allowed(samples) / samples : 1;
+        uint64_t rate_bits;
+        memcpy(&rate_bits, &rate, sizeof(rate_bits));
+        atomic_store_explicit(&dd_limiter->rate, rate_bits, memory_order_relaxed);
+
+        /* first sample of the new window */
         return true;
     }
 
-    pthread_mutex_unlock(&dd_limiter->lock);
-    return false;
+    return samples < dd_limiter->limit;
 }
 
 double ddtrace_limiter_rate() {
-    double effective = 0;
+    uint64_t window = atomic_load_explicit(&dd_limiter->window, memory_order_relaxed);
+    uint64_t rate_bits = atomic_load_explicit(&dd_limiter->rate, memory_order_relaxed);
 
-    pthread_mutex_lock(&dd_limiter->lock);
+    uint32_t samples = (uint32_t) (window & DD_LIMITER_SAMPLES_MASK);
+    double current = (double) ddtrace_limiter_allowed(samples) / samples, rate;
+    memcpy(&rate, &rate_bits, sizeof(rate));
 
-    if (!dd_limiter->window.rate ||
-        !dd_limiter->window.samples) {
+    if (!rate_bits || !samples) {
         /* no previous window, or samples */
-        effective = (double) dd_limiter->window.allowed / dd_limiter->window.samples;
-    } else {
-        effective = (double) (
-            (double) dd_limiter->window.allowed / dd_limiter->window.samples +  /* current rate */
-            dd_limiter->window.rate                                             /* previous window rate */
-        ) / 2.0;                                                                /* spread over last two windows */
+        return current;
     }
 
-    pthread_mutex_unlock(&dd_limiter->lock);
-
-    return effective;
+    return (current + /* current rate */
+            rate      /* previous window rate */
+        ) / 2.0;      /* spread over last two windows */
 }
 
 void ddtrace_limiter_destroy() {
@@ -142,8 +141,6 @@ void ddtrace_limiter_destroy() {
         return;
     }
 
-    pthread_mutex_destroy(&dd_limiter->lock);
-
     munmap(dd_limiter, sysconf(_SC_PAGESIZE));
 
     dd_limiter = NULL;
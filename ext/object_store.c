@@ -0,0 +1,87 @@
+#include "object_store.h"
+
+#include <php.h>
+
+/* Comment to prevent reordering by code style fixer */
+#if PHP_VERSION_ID >= 80000
+#include <Zend/zend_weakrefs.h>
+#endif
+
+#include "compatibility.h"
+
+/* Metadata attached by integrations to objects, e.g. the connection tags of a PDO instance, propagated to its
+ * statements. On PHP 8 it lives in a map weakly keyed by the object, to a map of key -> value, which is dropped together
+ * with the object. PHP 7 has no weak references, so the values are stored in dynamic properties of the object, as
+ * DDTrace\Util\ObjectKVStore did before. */
+#if PHP_VERSION_ID >= 80000
+ZEND_TLS HashTable dd_object_store;
+
+static void dd_object_store_values_dtor(zval *zv) { zend_array_release(Z_PTR_P(zv)); }
+
+void ddtrace_object_store_rinit(void) { zend_hash_init(&dd_object_store, 8, NULL, dd_object_store_values_dtor, 0); }
+
+void ddtrace_object_store_rshutdown(void) {
+    zend_ulong key;
+    ZEND_HASH_FOREACH_NUM_KEY(&dd_object_store, key) { zend_weakrefs_hash_del(&dd_object_store, zend_weakref_key_to_object(key)); }
+    ZEND_HASH_FOREACH_END();
+    zend_hash_destroy(&dd_object_store);
+    // objects may still be stored into during the remaining shutdown, so leave a valid table behind
+    zend_hash_init(&dd_object_store, 8, NULL, dd_object_store_values_dtor, 0);
+}
+
+void ddtrace_object_store_put(zend_object *object, zend_string *key, zval *value) {
+    HashTable *values = zend_hash_index_find_ptr(&dd_object_store, zend_object_to_weakref_key(object));
+    if (!values) {
+        values = zend_new_array(4);
+        zend_weakrefs_hash_add_ptr(&dd_object_store, object, values);
+    }
+    Z_TRY_ADDREF_P(value);
+    zend_hash_update(values, key, value);
+}
+
+zval *ddtrace_object_store_get(zend_object *object, zend_string *key) {
+    HashTable *values = zend_hash_index_find_ptr(&dd_object_store, zend_object_to_weakref_key(object));
+    if (!values) {
+        return NULL;
+    }
+    return zend_hash_find(values, key);
+}
+#else
+#define DD_OBJECT_STORE_PREFIX "__dd_store_"
+
+void ddtrace_object_store_rinit(void) {}
+
+void ddtrace_object_store_rshutdown(void) {}
+
+static zend_string *dd_object_store_property_name(zend_string *key) {
+    zend_string *name = zend_string_alloc(sizeof(DD_OBJECT_STORE_PREFIX) - 1 + ZSTR_LEN(key), 0);
+    memcpy(ZSTR_VAL(name), DD_OBJECT_STORE_PREFIX, sizeof(DD_OBJECT_STORE_PREFIX) - 1);
+    memcpy(ZSTR_VAL(name) + sizeof(DD_OBJECT_STORE_PREFIX) - 1, ZSTR_VAL(key), ZSTR_LEN(key) + 1);
+    return name;
+}
+
+void ddtrace_object_store_put(zend_object *object, zend_string *key, zval *value) {
+    zval obj, member;
+    ZVAL_OBJ(&obj, object);
+    ZVAL_STR(&member, dd_object_store_property_name(key));
+    object->handlers->write_property(&obj, &member, value, NULL);
+    zval_ptr_dtor(&member);
+}
+
+zval *ddtrace_object_store_get(zend_object *object, zend_string *key) {
+    zval obj;
+    ZVAL_OBJ(&obj, object);
+    HashTable *properties = object->handlers->get_properties(&obj);
+    if (!properties) {
+        return NULL;
+    }
+
+    zend_string *name = dd_object_store_property_name(key);
+    zval *value = zend_hash_find(properties, name);
+    zend_string_release(name);
+    if (value && Z_TYPE_P(value) == IS_INDIRECT) {
+        value = Z_INDIRECT_P(value);
+    }
+    return value;
+}
+#endif
@@ -0,0 +1,12 @@
+#ifndef DDTRACE_OBJECT_STORE_H
+#define DDTRACE_OBJECT_STORE_H
+
+#include "php.h"
+
+void ddtrace_object_store_rinit(void);
+void ddtrace_object_store_rshutdown(void);
+
+void ddtrace_object_store_put(zend_object *object, zend_string *key, zval *value);
+zval *ddtrace_object_store_get(zend_object *object, zend_string *key);
+
+#endif // DDTRACE_OBJECT_STORE_H
@@ -30,24 +30,217 @@ static void dd_update_decision_maker_tag(ddtrace_span_data *span, enum dd_sampli
     }
 }
 
-static bool dd_rule_matches(zval *pattern, zval *prop) {
-    if (Z_TYPE_P(pattern) != IS_STRING) {
+enum dd_sampling_pattern_kind {
+    DD_SAMPLING_PATTERN_ANY,
+    DD_SAMPLING_PATTERN_CONTAINS,
+    DD_SAMPLING_PATTERN_PREFIX,
+    DD_SAMPLING_PATTERN_SUFFIX,
+    DD_SAMPLING_PATTERN_EXACT,
+    DD_SAMPLING_PATTERN_REGEX,
+};
+
+typedef struct {
+    enum dd_sampling_pattern_kind kind;
+    zend_string *str;  // the literal, or the wrapped regex for DD_SAMPLING_PATTERN_REGEX
+} dd_sampling_pattern;
+
+typedef struct {
+    dd_sampling_pattern service;
+    dd_sampling_pattern name;
+    double sample_rate;
+} dd_sampling_rule;
+
+struct ddtrace_sampling_rules {
+    uint32_t count;
+    dd_sampling_rule rules[];
+};
+
+static bool dd_is_regex_meta_char(char c) {
+    switch (c) {
+        case '\\': case '^': case '$': case '.': case '|': case '?': case '*': case '+':
+        case '(': case ')': case '[': case ']': case '{': case '}':
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Patterns are unanchored regular expressions; the common plain and ^/$ anchored literals are matched without PCRE
+static bool dd_compile_sampling_pattern(dd_sampling_pattern *pattern, zval *pattern_zv) {
+    if (!pattern_zv) {
+        pattern->kind = DD_SAMPLING_PATTERN_ANY;
+        return true;
+    }
+    if (Z_TYPE_P(pattern_zv) != IS_STRING) {
+        return false;  // never matches
+    }
+
+    const char *str = Z_STRVAL_P(pattern_zv);
+    size_t start = 0, end = Z_STRLEN_P(pattern_zv);
+    bool anchored_start = end > 0 && str[0] == '^';
+    start += anchored_start;
+    bool anchored_end = end > start && str[end - 1] == '$';
+    end -= anchored_end;
+
+    bool literal = true;
+    for (size_t i = start; i < end; ++i) {
+        if (dd_is_regex_meta_char(str[i])) {
+            literal = false;
+            break;
+        }
+    }
+
+    if (literal) {
+        if (anchored_start && anchored_end) {
+            pattern->kind = DD_SAMPLING_PATTERN_EXACT;
+        } else if (start == end) {
+            pattern->kind = DD_SAMPLING_PATTERN_ANY;
+            return true;
+        } else if (anchored_start) {
+            pattern->kind = DD_SAMPLING_PATTERN_PREFIX;
+        } else if (anchored_end) {
+            pattern->kind = DD_SAMPLING_PATTERN_SUFFIX;
+        } else {
+            pattern->kind = DD_SAMPLING_PATTERN_CONTAINS;
+        }
+        pattern->str = zend_string_init(str + start, end - start, 1);
+        return true;
+    }
+
+    if (zend_string_equals_literal(Z_STR_P(pattern_zv), ".*")) {
+        pattern->kind = DD_SAMPLING_PATTERN_ANY;
+        return true;
+    }
+
+    pattern->kind = DD_SAMPLING_PATTERN_REGEX;
+    zend_string *regex = zend_strpprintf(0, "(%s)", str);
+    pattern->str = zend_string_init(ZSTR_VAL(regex), ZSTR_LEN(regex), 1);
+    zend_string_release(regex);
+    if (!pcre_get_compiled_regex_cache(pattern->str)) {
+        zend_string_release(pattern->str);
         return false;
     }
-    if (Z_TYPE_P(prop) != IS_STRING) {
+    return true;
+}
+
+static void dd_sampling_pattern_dtor(dd_sampling_pattern *pattern) {
+    if (pattern->kind != DD_SAMPLING_PATTERN_ANY) {
+        zend_string_release(pattern->str);
+    }
+}
+
+static struct ddtrace_sampling_rules *dd_compile_sampling_rules(zend_array *rules_array) {
+    struct ddtrace_sampling_rules *rules =
+        pemalloc(sizeof(*rules) + zend_hash_num_elements(rules_array) * sizeof(dd_sampling_rule), 1);
+    rules->count = 0;
+
+    zval *rule_zv;
+    ZEND_HASH_FOREACH_VAL(rules_array, rule_zv) {
+        zval *sample_rate_zv;
+        // Rules without sample_rate never apply, matching them has no effect
+        if (Z_TYPE_P(rule_zv) != IS_ARRAY ||
+            !(sample_rate_zv = zend_hash_str_find(Z_ARR_P(rule_zv), ZEND_STRL("sample_rate")))) {
+            continue;
+        }
+
+        dd_sampling_rule *rule = &rules->rules[rules->count];
+        if (!dd_compile_sampling_pattern(&rule->service, zend_hash_str_find(Z_ARR_P(rule_zv), ZEND_STRL("service")))) {
+            continue;
+        }
+        if (!dd_compile_sampling_pattern(&rule->name, zend_hash_str_find(Z_ARR_P(rule_zv), ZEND_STRL("name")))) {
+            dd_sampling_pattern_dtor(&rule->service);
+            continue;
+        }
+        rule->sample_rate = zval_get_double(sample_rate_zv);
+        ++rules->count;
+    }
+    ZEND_HASH_FOREACH_END();
+
+    return rules;
+}
+
+static void dd_free_sampling_rules(struct ddtrace_sampling_rules *rules) {
+    for (uint32_t i = 0; i < rules->count; ++i) {
+        dd_sampling_pattern_dtor(&rules->rules[i].service);
+        dd_sampling_pattern_dtor(&rules->rules[i].name);
+    }
+    pefree(rules, 1);
+}
+
+/* The compiled rules are persistent and kept by the thread as long as the configured rules do not change.
+ * Values differing from the one set at startup (ini_set(), per-directory settings) only hold for the current request,
+ * the runtime config is reset at the next RINIT without notifying us, so such rules are dropped when the request ends. */
+void ddtrace_sampling_rules_rshutdown(void) {
+    if (DDTRACE_G(sampling_rules_changed)) {
+        DDTRACE_G(sampling_rules_changed) = false;
+        if (DDTRACE_G(sampling_rules)) {
+            dd_free_sampling_rules(DDTRACE_G(sampling_rules));
+            DDTRACE_G(sampling_rules) = NULL;
+        }
+    }
+}
+
+void ddtrace_sampling_rules_gshutdown(zend_ddtrace_globals *ddtrace_globals) {
+    if (ddtrace_globals->sampling_rules) {
+        dd_free_sampling_rules(ddtrace_globals->sampling_rules);
+        ddtrace_globals->sampling_rules = NULL;
+    }
+}
+
+bool ddtrace_alter_sampling_rules_config(zval *old_value, zval *new_value) {
+    // environment values are re-applied on every RINIT, these leave the compiled rules valid
+    if (zend_is_identical(old_value, new_value)) {
+        return true;
+    }
+
+    // recompiled on next use
+    DDTRACE_G(sampling_rules_changed) = true;
+    if (DDTRACE_G(sampling_rules)) {
+        dd_free_sampling_rules(DDTRACE_G(sampling_rules));
+        DDTRACE_G(sampling_rules) = NULL;
+    }
+    return true;
+}
+
+static bool dd_sampling_pattern_matches(dd_sampling_pattern *pattern, zval *prop) {
+    if (pattern->kind == DD_SAMPLING_PATTERN_ANY || Z_TYPE_P(prop) != IS_STRING) {
         return true;  // default case unset or null must be true, everything else is too then...
     }
 
-    zend_string *regex = zend_strpprintf(0, "(%s)", Z_STRVAL_P(pattern));
-    pcre_cache_entry *pce = pcre_get_compiled_regex_cache(regex);
-    zval ret;
+    const char *subject = Z_STRVAL_P(prop), *literal = ZSTR_VAL(pattern->str);
+    size_t subject_len = Z_STRLEN_P(prop), literal_len = ZSTR_LEN(pattern->str);
+    switch (pattern->kind) {
+        case DD_SAMPLING_PATTERN_CONTAINS:
+            return zend_memnstr(subject, literal, literal_len, subject + subject_len) != NULL;
+
+        case DD_SAMPLING_PATTERN_PREFIX:
+            return subject_len >= literal_len && memcmp(subject, literal, literal_len) == 0;
+
+        case DD_SAMPLING_PATTERN_SUFFIX:
+        case DD_SAMPLING_PATTERN_EXACT:
+            // like PCRE, $ also matches before a trailing newline
+            if (subject_len > 0 && subject[subject_len - 1] == '\n' &&
+                (pattern->kind == DD_SAMPLING_PATTERN_EXACT ? subject_len - 1 == literal_len : subject_len > literal_len) &&
+                memcmp(subject + subject_len - 1 - literal_len, literal, literal_len) == 0) {
+                return true;
+            }
+            return (pattern->kind == DD_SAMPLING_PATTERN_EXACT ? subject_len == literal_len : subject_len >= literal_len) &&
+                   memcmp(subject + subject_len - literal_len, literal, literal_len) == 0;
+
+        default: {
+            pcre_cache_entry *pce = pcre_get_compiled_regex_cache(pattern->str);
+            if (!pce) {
+                return false;
+            }
+            zval ret;
 #if PHP_VERSION_ID < 70400
-    php_pcre_match_impl(pce, Z_STRVAL_P(prop), (int)Z_STRLEN_P(prop), &ret, NULL, 0, 0, 0, 0);
+            php_pcre_match_impl(pce, Z_STRVAL_P(prop), (int)Z_STRLEN_P(prop), &ret, NULL, 0, 0, 0, 0);
 #else
-    php_pcre_match_impl(pce, Z_STR_P(prop), &ret, NULL, 0, 0, 0, 0);
+            php_pcre_match_impl(pce, Z_STR_P(prop), &ret, NULL, 0, 0, 0, 0);
 #endif
-    zend_string_release(regex);
-    return Z_TYPE(ret) == IS_LONG && Z_LVAL(ret) > 0;
+            return Z_TYPE(ret) == IS_LONG && Z_LVAL(ret) > 0;
+        }
+    }
 }
 
 static void dd_decide_on_sampling(ddtrace_span_data *span) {
@@ -55,33 +248,23 @@ static void dd_decide_on_sampling(ddtrace_span_data *span) {
     // manual if it's not just inherited, otherwise this value is irrelevant (as sampling priority will be default)
     enum dd_sampling_mechanism mechanism = DD_MECHANISM_MANUAL;
     if (priority == DDTRACE_PRIORITY_SAMPLING_UNKNOWN) {
-        zval *rule;
         bool explicit_rule = zai_config_memoized_entries[DDTRACE_CONFIG_DD_TRACE_SAMPLE_RATE].name_index >= 0;
         double default_sample_rate = get_DD_TRACE_SAMPLE_RATE(), sample_rate = default_sample_rate;
 
-        ZEND_HASH_FOREACH_VAL(get_DD_TRACE_SAMPLING_RULES(), rule) {
-            if (Z_TYPE_P(rule) != IS_ARRAY) {
-                continue;
-            }
-
-            bool rule_matches = true;
-
-            zval *rule_pattern;
-            if ((rule_pattern = zend_hash_str_find(Z_ARR_P(rule), ZEND_STRL("service")))) {
-                rule_matches &= dd_rule_matches(rule_pattern, ddtrace_spandata_property_service(span));
-            }
-            if ((rule_pattern = zend_hash_str_find(Z_ARR_P(rule), ZEND_STRL("name")))) {
-                rule_matches &= dd_rule_matches(rule_pattern, ddtrace_spandata_property_name(span));
-            }
+        if (!DDTRACE_G(sampling_rules)) {
+            DDTRACE_G(sampling_rules) = dd_compile_sampling_rules(get_DD_TRACE_SAMPLING_RULES());
+        }
 
-            zval *sample_rate_zv;
-            if (rule_matches && (sample_rate_zv = zend_hash_str_find(Z_ARR_P(rule), ZEND_STRL("sample_rate")))) {
-                sample_rate = zval_get_double(sample_rate_zv);
+        struct ddtrace_sampling_rules *rules = DDTRACE_G(sampling_rules);
+        for (uint32_t i = 0; i < rules->count; ++i) {
+            dd_sampling_rule *rule = &rules->rules[i];
+            if (dd_sampling_pattern_matches(&rule->service, ddtrace_spandata_property_service(span)) &&
+                dd_sampling_pattern_matches(&rule->name, ddtrace_spandata_property_name(span))) {
+                sample_rate = rule->sample_rate;
                 explicit_rule = true;
                 break;
             }
         }
-        ZEND_HASH_FOREACH_END();
 
         bool sampling = (double)genrand64_int64() < sample_rate * (double)~0ULL;
         bool limited  = ddtrace_limiter_active() && (sampling && !ddtrace_limiter_allow());
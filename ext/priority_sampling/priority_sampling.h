@@ -22,5 +22,7 @@ enum dd_sampling_mechanism {
 void ddtrace_set_prioritySampling_on_root(zend_long priority, enum dd_sampling_mechanism mechanism);
 zend_long ddtrace_fetch_prioritySampling_from_span(ddtrace_span_data *root_span);
 zend_long ddtrace_fetch_prioritySampling_from_root(void);
+void ddtrace_sampling_rules_rshutdown(void);
+void ddtrace_sampling_rules_gshutdown(zend_ddtrace_globals *ddtrace_globals);
 
 #endif  // DDTRACE_PRIORITY_SAMPLING_H
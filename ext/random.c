@@ -34,19 +34,26 @@ bool ddtrace_reseed_seed_change(zval *old_value, zval *new_value) {
     return true;
 }
 
-uint64_t ddtrace_parse_userland_span_id(zval *zid) {
-    if (!zid || Z_TYPE_P(zid) != IS_STRING) {
-        return 0U;
-    }
-    const char *id = Z_STRVAL_P(zid);
-    for (size_t i = 0; i < Z_STRLEN_P(zid); i++) {
+uint64_t ddtrace_parse_userland_span_id_str(const char *id, size_t len) {
+    uint64_t uid = 0;
+    for (size_t i = 0; i < len; i++) {
         if (id[i] < '0' || id[i] > '9') {
             return 0U;
         }
+        uint8_t digit = id[i] - '0';
+        if (uid > (UINT64_MAX - digit) / 10) {
+            return 0U;  // out of range
+        }
+        uid = uid * 10 + digit;
     }
-    errno = 0;
-    uint64_t uid = (uint64_t)strtoull(id, NULL, 10);
-    return (uid && errno == 0) ? uid : 0U;
+    return uid;
+}
+
+uint64_t ddtrace_parse_userland_span_id(zval *zid) {
+    if (!zid || Z_TYPE_P(zid) != IS_STRING) {
+        return 0U;
+    }
+    return ddtrace_parse_userland_span_id_str(Z_STRVAL_P(zid), Z_STRLEN_P(zid));
 }
 
 ddtrace_trace_id ddtrace_parse_userland_trace_id(zend_string *tid) {
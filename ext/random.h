@@ -15,6 +15,7 @@ bool ddtrace_reseed_seed_change(zval *old_value, zval *new_value);
 uint64_t ddtrace_generate_span_id(void);
 uint64_t ddtrace_peek_span_id(void);
 ddtrace_trace_id ddtrace_peek_trace_id(void);
+uint64_t ddtrace_parse_userland_span_id_str(const char *id, size_t len);
 uint64_t ddtrace_parse_userland_span_id(zval *zid);
 ddtrace_trace_id ddtrace_parse_userland_trace_id(zend_string *tid);
 uint64_t ddtrace_parse_hex_span_id_str(const char *id, size_t len);
@@ -21,6 +21,7 @@
 
 #include "arrays.h"
 #include "compat_string.h"
+#include "coms.h"
 #include "ddtrace.h"
 #include "engine_api.h"
 #include "engine_hooks.h"
@@ -30,6 +31,7 @@
 #include "priority_sampling/priority_sampling.h"
 #include "runtime.h"
 #include "span.h"
+#include "sql_quantization.h"
 #include "uri_normalization.h"
 
 ZEND_EXTERN_MODULE_GLOBALS(ddtrace);
@@ -384,10 +386,11 @@ static int dd_fatal_error_to_meta(zend_array *meta, dd_error_info error) {
 }
 
 static zend_result dd_add_meta_array(void *context, ddtrace_string key, ddtrace_string value) {
-    zval *meta = context, tmp = ddtrace_zval_stringl(value.ptr, value.len);
+    zend_array *meta = context;
+    zval tmp = ddtrace_zval_stringl(value.ptr, value.len);
 
     // meta array takes ownership of tmp
-    return zend_symtable_str_update(Z_ARR_P(meta), key.ptr, key.len, &tmp) != NULL ? SUCCESS : FAILURE;
+    return zend_symtable_str_update(meta, key.ptr, key.len, &tmp) != NULL ? SUCCESS : FAILURE;
 }
 
 static void dd_add_header_to_meta(zend_array *meta, const char *type, zend_string *lowerheader,
@@ -499,24 +502,18 @@ static void dd_add_post_fields_to_meta_recursive(zend_array *meta, const char *t
 }
 
 void ddtrace_set_global_span_properties(ddtrace_span_data *span) {
-    zend_array *meta = ddtrace_spandata_property_meta(span);
-
     zend_array *global_tags = get_DD_TAGS();
     zend_string *global_key;
     zval *global_val;
     ZEND_HASH_FOREACH_STR_KEY_VAL(global_tags, global_key, global_val) {
-        if (zend_hash_add(meta, global_key, global_val)) {
-            Z_TRY_ADDREF_P(global_val);
-        }
+        ddtrace_span_add_meta(span, global_key, global_val);
     }
     ZEND_HASH_FOREACH_END();
 
     zend_string *tag_key;
     zval *tag_value;
     ZEND_HASH_FOREACH_STR_KEY_VAL(DDTRACE_G(additional_global_tags), tag_key, tag_value) {
-        if (zend_hash_add(meta, tag_key, tag_value)) {
-            Z_TRY_ADDREF_P(tag_value);
-        }
+        ddtrace_span_add_meta(span, tag_key, tag_value);
     }
     ZEND_HASH_FOREACH_END();
 
@@ -580,9 +577,8 @@ static zend_string *dd_build_req_url() {
     zend_string *query_string = ZSTR_EMPTY_ALLOC();
     if (question_mark) {
         uri_len = question_mark - uri;
-        query_string = zai_filter_query_string(
-            (zai_string_view){.len = strlen(uri) - uri_len - 1, .ptr = question_mark + 1},
-            get_DD_TRACE_HTTP_URL_QUERY_PARAM_ALLOWED(), get_DD_TRACE_OBFUSCATION_QUERY_STRING_REGEXP());
+        query_string = ddtrace_filter_url_query_string(
+            (zai_string_view){.len = strlen(uri) - uri_len - 1, .ptr = question_mark + 1});
     } else {
         uri_len = strlen(uri);
     }
@@ -651,10 +647,8 @@ void ddtrace_set_root_span_properties(ddtrace_span_data *span) {
                 zend_string *query_string = ZSTR_EMPTY_ALLOC();
                 const char *query_str = dd_get_query_string();
                 if (query_str) {
-                    query_string =
-                        zai_filter_query_string((zai_string_view){.len = strlen(query_str), .ptr = query_str},
-                                                get_DD_TRACE_RESOURCE_URI_QUERY_PARAM_ALLOWED(),
-                                                get_DD_TRACE_OBFUSCATION_QUERY_STRING_REGEXP());
+                    query_string = ddtrace_filter_resource_query_string(
+                        (zai_string_view){.len = strlen(query_str), .ptr = query_str});
                 }
 
                 ZVAL_STR(prop_resource, zend_strpprintf(0, "%s %s%s%.*s", method, ZSTR_VAL(normalized),
@@ -671,7 +665,7 @@ void ddtrace_set_root_span_properties(ddtrace_span_data *span) {
 
     if (get_DD_TRACE_CLIENT_IP_ENABLED()) {
         if (Z_TYPE(PG(http_globals)[TRACK_VARS_SERVER]) == IS_ARRAY || zend_is_auto_global_str(ZEND_STRL("_SERVER"))) {
-            ddtrace_extract_ip_from_headers(&PG(http_globals)[TRACK_VARS_SERVER], meta);
+            ddtrace_extract_ip_from_headers(&PG(http_globals)[TRACK_VARS_SERVER], meta, true);
         }
     }
 
@@ -790,25 +784,35 @@ static void _dd_serialize_json(zend_array *arr, smart_str *buf, int options) {
     smart_str_0(buf);
 }
 
-static void _serialize_meta(zval *el, ddtrace_span_data *span) {
-    bool is_top_level_span = span->parent_id == DDTRACE_G(distributed_parent_trace_id);
-    bool is_local_root_span = span->parent_id == 0 || is_top_level_span;
-    zval meta_zv, *meta = ddtrace_spandata_property_meta_zval(span);
+/* With DD_TRACE_SQL_QUANTIZATION_ENABLED, the statements of sql spans are sent with their literals stripped. The
+ * quantized statements go into the extras, which take precedence over the span meta: the meta itself may be referenced
+ * from userland and is left untouched. */
+static void dd_quantize_sql_statements(ddtrace_span_data *span, zend_array *extras) {
+    zval *type = ddtrace_spandata_property_type(span);
+    ZVAL_DEREF(type);
+    if (Z_TYPE_P(type) != IS_STRING || !zend_string_equals_literal(Z_STR_P(type), "sql")) {
+        return;
+    }
 
-    array_init(&meta_zv);
-    ZVAL_DEREF(meta);
-    if (Z_TYPE_P(meta) == IS_ARRAY) {
-        zend_string *str_key;
-        zval *orig_val, val_as_string;
-        ZEND_HASH_FOREACH_STR_KEY_VAL_IND(Z_ARRVAL_P(meta), str_key, orig_val) {
-            if (str_key) {
-                ddtrace_convert_to_string(&val_as_string, orig_val);
-                add_assoc_zval(&meta_zv, ZSTR_VAL(str_key), &val_as_string);
-            }
+    static const char *const statement_keys[] = {"sql.query", "db.statement"};
+    for (size_t i = 0; i < sizeof(statement_keys) / sizeof(statement_keys[0]); ++i) {
+        size_t key_len = strlen(statement_keys[i]);
+        zval *statement = ddtrace_span_find_meta(span, statement_keys[i], key_len);
+        if (statement) {
+            ZVAL_DEREF(statement);
+        }
+        if (statement && Z_TYPE_P(statement) == IS_STRING) {
+            zval quantized;
+            ZVAL_STR(&quantized, ddtrace_quantize_sql(Z_STR_P(statement)));
+            zend_hash_str_update(extras, statement_keys[i], key_len, &quantized);
         }
-        ZEND_HASH_FOREACH_END();
     }
-    meta = &meta_zv;
+}
+
+// Collects the meta entries which are only computed at serialization time. They take precedence over the span meta.
+static void dd_serialize_meta_extras(ddtrace_span_data *span, zend_array *extras) {
+    bool is_top_level_span = span->parent_id == DDTRACE_G(distributed_parent_trace_id);
+    bool is_local_root_span = span->parent_id == 0 || is_top_level_span;
 
     zval *exception_zv = ddtrace_spandata_property_exception(span);
     if (Z_TYPE_P(exception_zv) == IS_OBJECT && instanceof_function(Z_OBJCE_P(exception_zv), zend_ce_throwable)) {
@@ -816,24 +820,25 @@ static void _serialize_meta(zval *el, ddtrace_span_data *span) {
         if (is_local_root_span) {
             exception_type = Z_PROP_FLAG_P(exception_zv) == 2 ? DD_EXCEPTION_CAUGHT : DD_EXCEPTION_UNCAUGHT;
         }
-        ddtrace_exception_to_meta(Z_OBJ_P(exception_zv), meta, dd_add_meta_array, exception_type);
+        ddtrace_exception_to_meta(Z_OBJ_P(exception_zv), extras, dd_add_meta_array, exception_type);
     }
 
     zend_array *span_links_zv = ddtrace_spandata_property_links(span);
     if (zend_hash_num_elements(span_links_zv) > 0) {
         smart_str buf = {0};
         _dd_serialize_json(span_links_zv, &buf, 0);
-        add_assoc_str(meta, "_dd.span_links", buf.s);
+        zval links = ddtrace_zval_zstr(buf.s);
+        zend_hash_str_update(extras, ZEND_STRL("_dd.span_links"), &links);
     }
 
     if (is_top_level_span) {
         if (SG(sapi_headers).http_response_code) {
-            add_assoc_str(meta, "http.status_code", zend_long_to_str(SG(sapi_headers).http_response_code));
-            if (SG(sapi_headers).http_response_code >= 500) {
-                zval zv = {0}, *value;
-                if ((value = zend_hash_str_add(Z_ARR_P(meta), ZEND_STRL("error.type"), &zv))) {
-                    ZVAL_STR(value, zend_string_init(ZEND_STRL("Internal Server Error"), 0));
-                }
+            zval status_code = ddtrace_zval_zstr(zend_long_to_str(SG(sapi_headers).http_response_code));
+            zend_hash_str_update(extras, ZEND_STRL("http.status_code"), &status_code);
+            if (SG(sapi_headers).http_response_code >= 500 && !zend_hash_str_exists(extras, ZEND_STRL("error.type")) &&
+                !ddtrace_span_find_meta(span, ZEND_STRL("error.type"))) {
+                zval error_type = ddtrace_zval_zstr(zend_string_init(ZEND_STRL("Internal Server Error"), 0));
+                zend_hash_str_add_new(extras, ZEND_STRL("error.type"), &error_type);
             }
         }
 
@@ -872,23 +877,54 @@ static void _serialize_meta(zval *el, ddtrace_span_data *span) {
             }
 
             zend_string *headerval = zend_string_init(header, end - header, 0);
-            dd_add_header_to_meta(Z_ARR_P(meta), "response", lowerheader, headerval);
+            dd_add_header_to_meta(extras, "response", lowerheader, headerval);
 
             zend_string_release(headerval);
             zend_string_release(lowerheader);
         }
     }
 
+    if (span->trace_id.high) {
+        zval tid = ddtrace_zval_zstr(zend_strpprintf(0, "%" PRIx64, span->trace_id.high));
+        zend_hash_str_update(extras, ZEND_STRL("_dd.p.tid"), &tid);
+    }
+
+    if (get_DD_TRACE_SQL_QUANTIZATION_ENABLED()) {
+        dd_quantize_sql_statements(span, extras);
+    }
+}
+
+static void _serialize_meta(zval *el, ddtrace_span_data *span) {
+    ddtrace_span_materialize_meta(span);
+    zval meta_zv, *meta = ddtrace_spandata_property_meta_zval(span);
+
+    array_init(&meta_zv);
+    ZVAL_DEREF(meta);
+    if (Z_TYPE_P(meta) == IS_ARRAY) {
+        zend_string *str_key;
+        zval *orig_val, val_as_string;
+        ZEND_HASH_FOREACH_STR_KEY_VAL_IND(Z_ARRVAL_P(meta), str_key, orig_val) {
+            if (str_key) {
+                ddtrace_convert_to_string(&val_as_string, orig_val);
+                add_assoc_zval(&meta_zv, ZSTR_VAL(str_key), &val_as_string);
+            }
+        }
+        ZEND_HASH_FOREACH_END();
+    }
+
+    HashTable extras;
+    zend_hash_init(&extras, 8, NULL, ZVAL_PTR_DTOR, 0);
+    dd_serialize_meta_extras(span, &extras);
+    zend_hash_merge(Z_ARR(meta_zv), &extras, zval_add_ref, 1);
+    zend_hash_destroy(&extras);
+    meta = &meta_zv;
+
     zend_bool error = ddtrace_hash_find_ptr(Z_ARR_P(meta), ZEND_STRL("error.message")) ||
                       ddtrace_hash_find_ptr(Z_ARR_P(meta), ZEND_STRL("error.type"));
     if (error) {
         add_assoc_long(el, "error", 1);
     }
 
-    if (span->trace_id.high) {
-        add_assoc_str(meta, "_dd.p.tid", zend_strpprintf(0, "%" PRIx64, span->trace_id.high));
-    }
-
     if (zend_array_count(Z_ARRVAL_P(meta))) {
         add_assoc_zval(el, "meta", meta);
     } else {
@@ -896,56 +932,76 @@ static void _serialize_meta(zval *el, ddtrace_span_data *span) {
     }
 }
 
-static bool dd_rule_matches(zval *pattern, zend_string* value) {
-    if (Z_TYPE_P(pattern) != IS_STRING) {
-        return false;
+// A glob split at its '*'s; '?' matches any single character. As the segments are fixed-length, matching each one at
+// its leftmost possible position never needs backtracking.
+typedef struct {
+    uint32_t offset;
+    uint32_t len;
+} dd_glob_segment;
+
+typedef struct {
+    zend_string *pattern;
+    uint32_t segment_count;
+    dd_glob_segment *segments;
+} dd_glob;
+
+static void dd_glob_compile(dd_glob *glob, zend_string *pattern) {
+    glob->pattern = zend_string_init(ZSTR_VAL(pattern), ZSTR_LEN(pattern), 1);
+    glob->segment_count = 1;
+    for (size_t i = 0; i < ZSTR_LEN(pattern); ++i) {
+        glob->segment_count += ZSTR_VAL(pattern)[i] == '*';
+    }
+    glob->segments = safe_pemalloc(glob->segment_count, sizeof(dd_glob_segment), 0, 1);
+
+    uint32_t segment = 0, offset = 0;
+    for (uint32_t i = 0; i <= ZSTR_LEN(pattern); ++i) {
+        if (i == ZSTR_LEN(pattern) || ZSTR_VAL(pattern)[i] == '*') {
+            glob->segments[segment++] = (dd_glob_segment){.offset = offset, .len = i - offset};
+            offset = i + 1;
+        }
     }
+}
 
-    char *p = Z_STRVAL_P(pattern);
-    char *s = ZSTR_VAL(value);
+static void dd_glob_dtor(dd_glob *glob) {
+    if (glob->pattern) {
+        zend_string_release(glob->pattern);
+        pefree(glob->segments, 1);
+    }
+}
 
-    int wildcards = 0;
-    while (*p) {
-        if (*(p++) == '*') {
-            ++wildcards;
+static bool dd_glob_segment_matches_at(const char *segment, uint32_t len, const char *s) {
+    for (uint32_t i = 0; i < len; ++i) {
+        if (segment[i] != s[i] && segment[i] != '?') {
+            return false;
         }
     }
-    p = Z_STRVAL_P(pattern);
+    return true;
+}
 
-    ALLOCA_FLAG(use_heap)
-    char **backtrack_points = do_alloca(wildcards * 2 * sizeof(char *), use_heap);
-    int backtrack_idx = 0;
+// Like the previous backtracking matcher, the value only needs to start with a match of the pattern
+static bool dd_glob_matches(dd_glob *glob, zend_string *value) {
+    const char *pattern = ZSTR_VAL(glob->pattern), *s = ZSTR_VAL(value), *end = s + ZSTR_LEN(value);
 
-    while (*p) {
-        if (!*s) {
-            while (*p == '*') {
-                ++p;
+    dd_glob_segment *segment = &glob->segments[0];
+    if ((size_t)(end - s) < segment->len || !dd_glob_segment_matches_at(pattern + segment->offset, segment->len, s)) {
+        return false;
+    }
+    s += segment->len;
+
+    for (uint32_t i = 1; i < glob->segment_count; ++i) {
+        segment = &glob->segments[i];
+        for (;;) {
+            if ((size_t)(end - s) < segment->len) {
+                return false;
             }
-            free_alloca(backtrack_points, use_heap);
-            return !*p;
-        }
-        if (*s == *p || *p == '?') {
-            ++s, ++p;
-        } else if (*p == '*') {
-            backtrack_points[backtrack_idx++] = ++p;
-            backtrack_points[backtrack_idx++] = s;
-        } else {
-            do {
-                if (backtrack_idx > 0) {
-                    backtrack_idx -= 2;
-                    p = backtrack_points[backtrack_idx];
-                    s = ++backtrack_points[backtrack_idx + 1];
-                } else {
-                    free_alloca(backtrack_points, use_heap);
-                    return false;
-                }
-            } while (!*s);
-            backtrack_idx += 2;
+            if (dd_glob_segment_matches_at(pattern + segment->offset, segment->len, s)) {
+                break;
+            }
+            ++s;
         }
+        s += segment->len;
     }
 
-    free_alloca(backtrack_points, use_heap);
-
     return true;
 }
 
@@ -979,197 +1035,198 @@ void ddtrace_shutdown_span_sampling_limiter(void) {
     zend_hash_destroy(&dd_span_sampling_limiters);
 }
 
-void ddtrace_serialize_span_to_array(ddtrace_span_data *span, zval *array) {
-    bool top_level_span = span->parent_id == DDTRACE_G(distributed_parent_trace_id);
-    zval *el;
-    zval zv;
-    el = &zv;
-    array_init(el);
+static uint64_t dd_monotonic_nsec(void) {
+    struct timespec timespec;
+    clock_gettime(CLOCK_MONOTONIC, &timespec);
+    return timespec.tv_sec * 1000000000 + timespec.tv_nsec;
+}
 
-    add_assoc_str(el, KEY_TRACE_ID, ddtrace_span_id_as_string(span->trace_id.low));
-    add_assoc_str(el, KEY_SPAN_ID, ddtrace_span_id_as_string(span->span_id));
+// Buckets live until MSHUTDOWN, so compiled rules may keep pointers to them
+static struct dd_sampling_bucket *dd_find_span_sampling_bucket(zend_string *service_pattern, zend_string *name_pattern) {
+    size_t service_pattern_len = service_pattern ? ZSTR_LEN(service_pattern) : 0;
+    zend_string *rule_key = zend_string_alloc(service_pattern_len + (name_pattern ? ZSTR_LEN(name_pattern) + (service_pattern_len != 0) : 0), 1);
+    if (service_pattern) {
+        memcpy(ZSTR_VAL(rule_key), ZSTR_VAL(service_pattern), ZSTR_LEN(service_pattern));
+    }
+    if (name_pattern) {
+        ZSTR_VAL(rule_key)[service_pattern_len] = 0;
+        memcpy(ZSTR_VAL(rule_key) + service_pattern_len + 1, ZSTR_VAL(name_pattern), ZSTR_LEN(name_pattern));
+    }
+    ZSTR_VAL(rule_key)[ZSTR_LEN(rule_key)] = 0;
 
-    // handle dropped spans
-    if (span->parent) {
-        ddtrace_span_data *parent = span->parent;
-        while (ddtrace_span_is_dropped(parent)) {
-            parent = parent->parent;
+#if ZTS
+    pthread_rwlock_rdlock(&dd_span_sampling_limiter_lock);
+#endif
+    struct dd_sampling_bucket *sampling_bucket = zend_hash_find_ptr(&dd_span_sampling_limiters, rule_key);
+#if ZTS
+    pthread_rwlock_unlock(&dd_span_sampling_limiter_lock);
+#endif
+
+    if (!sampling_bucket) {
+        struct dd_sampling_bucket *new_sampling_bucket = malloc(sizeof(*new_sampling_bucket));
+        new_sampling_bucket->hit_count = 1;
+        new_sampling_bucket->last_update = dd_monotonic_nsec();
+
+#if ZTS
+        pthread_rwlock_wrlock(&dd_span_sampling_limiter_lock);
+#endif
+        if (!(sampling_bucket = zend_hash_add_ptr(&dd_span_sampling_limiters, rule_key, new_sampling_bucket))) {
+            free(new_sampling_bucket);
+            sampling_bucket = zend_hash_find_ptr(&dd_span_sampling_limiters, rule_key);
         }
-        span->parent_id = parent->span_id;
+#if ZTS
+        pthread_rwlock_unlock(&dd_span_sampling_limiter_lock);
+#endif
     }
 
-    if (span->parent_id > 0) {
-        add_assoc_str(el, KEY_PARENT_ID, ddtrace_span_id_as_string(span->parent_id));
-    }
-    add_assoc_long(el, "start", span->start);
-    add_assoc_long(el, "duration", span->duration);
+    zend_string_release(rule_key);
+    return sampling_bucket;
+}
 
-    // SpanData::$name defaults to fully qualified called name (set at span close)
-    zval *prop_name = ddtrace_spandata_property_name(span);
-    ZVAL_DEREF(prop_name);
-    if (Z_TYPE_P(prop_name) > IS_NULL) {
-        zval prop_name_as_string;
-        ddtrace_convert_to_string(&prop_name_as_string, prop_name);
-        prop_name = zend_hash_str_update(Z_ARR_P(el), ZEND_STRL("name"), &prop_name_as_string);
-    }
+typedef struct {
+    dd_glob service;  // pattern is NULL if the rule has no service
+    dd_glob name;     // pattern is NULL if the rule has no name
+    double sample_rate;
+    double max_per_second;
+    struct dd_sampling_bucket *bucket;  // NULL without max_per_second
+} dd_span_sampling_rule;
+
+struct ddtrace_span_sampling_rules {
+    uint32_t count;
+    dd_span_sampling_rule rules[];
+};
 
-    // SpanData::$resource defaults to SpanData::$name
-    zval *prop_resource = ddtrace_spandata_property_resource(span);
-    ZVAL_DEREF(prop_resource);
-    zval prop_resource_as_string;
-    ZVAL_UNDEF(&prop_resource_as_string);
-    if (Z_TYPE_P(prop_resource) > IS_FALSE && (Z_TYPE_P(prop_resource) != IS_STRING || Z_STRLEN_P(prop_resource) > 0)) {
-        ddtrace_convert_to_string(&prop_resource_as_string, prop_resource);
-    } else if (Z_TYPE_P(prop_name) > IS_NULL) {
-        ZVAL_COPY(&prop_resource_as_string, prop_name);
-    }
+static struct ddtrace_span_sampling_rules *dd_compile_span_sampling_rules(zend_array *rules_array) {
+    struct ddtrace_span_sampling_rules *rules =
+        pemalloc(sizeof(*rules) + zend_hash_num_elements(rules_array) * sizeof(dd_span_sampling_rule), 1);
+    rules->count = 0;
 
-    if (Z_TYPE(prop_resource_as_string) == IS_STRING) {
-        _add_assoc_zval_copy(el, "resource", &prop_resource_as_string);
-    }
+    zval *rule_zv;
+    ZEND_HASH_FOREACH_VAL(rules_array, rule_zv) {
+        if (Z_TYPE_P(rule_zv) != IS_ARRAY) {
+            continue;
+        }
 
-    // TODO: SpanData::$service defaults to parent SpanData::$service or DD_SERVICE if root span
-    zval *prop_service = ddtrace_spandata_property_service(span);
-    ZVAL_DEREF(prop_service);
-    zval prop_service_as_string;
-    if (Z_TYPE_P(prop_service) > IS_NULL) {
-        ddtrace_convert_to_string(&prop_service_as_string, prop_service);
+        // non-string patterns never match
+        zval *rule_service = zend_hash_str_find(Z_ARR_P(rule_zv), ZEND_STRL("service"));
+        zval *rule_name = zend_hash_str_find(Z_ARR_P(rule_zv), ZEND_STRL("name"));
+        if ((rule_service && Z_TYPE_P(rule_service) != IS_STRING) || (rule_name && Z_TYPE_P(rule_name) != IS_STRING)) {
+            continue;
+        }
 
-        zend_array *service_mappings = get_DD_SERVICE_MAPPING();
-        zval *new_name = zend_hash_find(service_mappings, Z_STR(prop_service_as_string));
-        if (new_name) {
-            zend_string_release(Z_STR(prop_service_as_string));
-            ZVAL_COPY(&prop_service_as_string, new_name);
+        dd_span_sampling_rule *rule = &rules->rules[rules->count++];
+        memset(rule, 0, sizeof(*rule));
+        if (rule_service) {
+            dd_glob_compile(&rule->service, Z_STR_P(rule_service));
+        }
+        if (rule_name) {
+            dd_glob_compile(&rule->name, Z_STR_P(rule_name));
         }
 
-        add_assoc_zval(el, "service", &prop_service_as_string);
+        zval *sample_rate_zv = zend_hash_str_find(Z_ARR_P(rule_zv), ZEND_STRL("sample_rate"));
+        rule->sample_rate = sample_rate_zv ? zval_get_double(sample_rate_zv) : 1;
+
+        zval *max_per_second_zv = zend_hash_str_find(Z_ARR_P(rule_zv), ZEND_STRL("max_per_second"));
+        if (max_per_second_zv) {
+            rule->max_per_second = zval_get_double(max_per_second_zv);
+            rule->bucket = dd_find_span_sampling_bucket(rule_service ? Z_STR_P(rule_service) : NULL,
+                                                        rule_name ? Z_STR_P(rule_name) : NULL);
+        }
     }
+    ZEND_HASH_FOREACH_END();
 
-    // SpanData::$type is optional and defaults to 'custom' at the Agent level
-    zval *prop_type = ddtrace_spandata_property_type(span);
-    ZVAL_DEREF(prop_type);
-    zval prop_type_as_string;
-    ZVAL_UNDEF(&prop_type_as_string);
-    if (Z_TYPE_P(prop_type) > IS_NULL) {
-        ddtrace_convert_to_string(&prop_type_as_string, prop_type);
-        _add_assoc_zval_copy(el, "type", &prop_type_as_string);
+    return rules;
+}
+
+static void dd_free_span_sampling_rules(struct ddtrace_span_sampling_rules **rules_p) {
+    struct ddtrace_span_sampling_rules *rules = *rules_p;
+    if (!rules) {
+        return;
     }
 
-    // Notify profiling for Endpoint Profiling.
-    if (profiling_notify_trace_finished && top_level_span && Z_TYPE(prop_resource_as_string) == IS_STRING) {
-        zai_string_view type = Z_TYPE(prop_type_as_string) == IS_STRING
-                               ? ZAI_STRING_FROM_ZSTR(Z_STR(prop_type_as_string))
-                               : ZAI_STRL_VIEW("custom");
-        zai_string_view resource = ZAI_STRING_FROM_ZSTR(Z_STR(prop_resource_as_string));
-        ddtrace_log_debug("Notifying profiler of finished local root span.");
-        profiling_notify_trace_finished(span->span_id, type, resource);
+    for (uint32_t i = 0; i < rules->count; ++i) {
+        dd_glob_dtor(&rules->rules[i].service);
+        dd_glob_dtor(&rules->rules[i].name);
+    }
+    pefree(rules, 1);
+    *rules_p = NULL;
+}
+
+// The compiled rules are persistent and kept by the thread until DD_SPAN_SAMPLING_RULES changes. The buckets they point
+// to live in dd_span_sampling_limiters until MSHUTDOWN. A runtime change only holds for the current request, the config
+// is reset at the next RINIT without notifying us, so these rules are dropped when the request ends.
+void ddtrace_span_sampling_rules_rshutdown(void) {
+    if (DDTRACE_G(span_sampling_rules_changed)) {
+        DDTRACE_G(span_sampling_rules_changed) = false;
+        dd_free_span_sampling_rules(&DDTRACE_G(span_sampling_rules));
+    }
+}
+
+void ddtrace_span_sampling_rules_gshutdown(zend_ddtrace_globals *ddtrace_globals) {
+    dd_free_span_sampling_rules(&ddtrace_globals->span_sampling_rules);
+}
+
+bool ddtrace_alter_span_sampling_rules_config(zval *old_value, zval *new_value) {
+    // environment values are re-applied on every RINIT, these leave the compiled rules valid
+    if (zend_is_identical(old_value, new_value)) {
+        return true;
     }
 
-    zval_ptr_dtor(&prop_type_as_string);
-    zval_ptr_dtor(&prop_resource_as_string);
+    // recompiled on next use
+    DDTRACE_G(span_sampling_rules_changed) = true;
+    dd_free_span_sampling_rules(&DDTRACE_G(span_sampling_rules));
+    return true;
+}
+
+// The string representation of the span properties, shared by the array and the msgpack serialization
+typedef struct dd_span_fields {
+    bool top_level_span;
+    zval name;
+    zval resource;
+    zval service;
+    zval type;
+} dd_span_fields;
 
+static void dd_apply_span_sampling_rules(ddtrace_span_data *span, dd_span_fields *fields) {
     if (ddtrace_fetch_prioritySampling_from_span(span->root) <= 0) {
-        zval *rule;
-        ZEND_HASH_FOREACH_VAL(get_DD_SPAN_SAMPLING_RULES(), rule) {
-            if (Z_TYPE_P(rule) != IS_ARRAY) {
-                continue;
-            }
+        if (!DDTRACE_G(span_sampling_rules)) {
+            DDTRACE_G(span_sampling_rules) = dd_compile_span_sampling_rules(get_DD_SPAN_SAMPLING_RULES());
+        }
 
-            bool rule_matches = true;
+        struct ddtrace_span_sampling_rules *rules = DDTRACE_G(span_sampling_rules);
+        for (uint32_t i = 0; i < rules->count; ++i) {
+            dd_span_sampling_rule *rule = &rules->rules[i];
 
-            zval *rule_service;
-            if ((rule_service = zend_hash_str_find(Z_ARR_P(rule), ZEND_STRL("service")))) {
-                if (Z_TYPE_P(prop_service) > IS_NULL) {
-                    rule_matches &= dd_rule_matches(rule_service, Z_STR(prop_service_as_string));
-                } else {
-                    rule_matches &= false;
-                }
-            }
-            zval *rule_name;
-            if ((rule_name = zend_hash_str_find(Z_ARR_P(rule), ZEND_STRL("name")))) {
-                if (Z_TYPE_P(prop_name) > IS_NULL) {
-                    rule_matches &= dd_rule_matches(rule_name, Z_STR_P(prop_name));
-                } else {
-                    rule_matches = false;
-                }
+            if (rule->service.pattern && (Z_TYPE(fields->service) != IS_STRING || !dd_glob_matches(&rule->service, Z_STR(fields->service)))) {
+                continue;
             }
-
-            if (!rule_matches) {
+            if (rule->name.pattern && (Z_TYPE(fields->name) != IS_STRING || !dd_glob_matches(&rule->name, Z_STR(fields->name)))) {
                 continue;
             }
 
-            zval *sample_rate_zv;
-            double sample_rate = 1;
-            if ((sample_rate_zv = zend_hash_str_find(Z_ARR_P(rule), ZEND_STRL("sample_rate")))) {
-                sample_rate = zval_get_double(sample_rate_zv);
-                if ((double)span->span_id > sample_rate * (double)~0ULL) {
-                    break; // sample_rate not matched
-                }
+            if ((double)span->span_id > rule->sample_rate * (double)~0ULL) {
+                break; // sample_rate not matched
             }
 
-            zval *max_per_second_zv;
-            double max_per_second = 0;
-            if ((max_per_second_zv = zend_hash_str_find(Z_ARR_P(rule), ZEND_STRL("max_per_second")))) {
-                max_per_second = zval_get_double(max_per_second_zv);
-                size_t service_pattern_len = rule_service ? Z_STRLEN_P(rule_service) : 0;
-                zend_string *rule_key = zend_string_alloc(service_pattern_len + (rule_name ? Z_STRLEN_P(rule_name) + (service_pattern_len != 0) : 0), 1);
-                if (rule_service) {
-                    memcpy(ZSTR_VAL(rule_key), Z_STRVAL_P(rule_service), Z_STRLEN_P(rule_service));
-                }
-                if (rule_name) {
-                    ZSTR_VAL(rule_key)[service_pattern_len] = 0;
-                    memcpy(ZSTR_VAL(rule_key) + service_pattern_len + 1, Z_STRVAL_P(rule_name), Z_STRLEN_P(rule_name));
-                }
-                ZSTR_VAL(rule_key)[ZSTR_LEN(rule_key)] = 0;
-
-#if ZTS
-                pthread_rwlock_rdlock(&dd_span_sampling_limiter_lock);
-#endif
-                struct dd_sampling_bucket *sampling_bucket = zend_hash_find_ptr(&dd_span_sampling_limiters, rule_key);
-#if ZTS
-                pthread_rwlock_unlock(&dd_span_sampling_limiter_lock);
-#endif
-
-                struct timespec timespec;
-                clock_gettime(CLOCK_MONOTONIC, &timespec);
-                uint64_t timeval = timespec.tv_sec * 1000000000 + timespec.tv_nsec;
+            if (rule->bucket) {
+                struct dd_sampling_bucket *sampling_bucket = rule->bucket;
+                double max_per_second = rule->max_per_second;
+                uint64_t timeval = dd_monotonic_nsec();
+                const int nanosecond = 1000000000;
 
-                if (!sampling_bucket) {
-                    struct dd_sampling_bucket *new_sampling_bucket = malloc(sizeof(*new_sampling_bucket));
-                    new_sampling_bucket->hit_count = 1;
-                    new_sampling_bucket->last_update = timeval;
+                // restore allowed time basis
+                uint64_t old_time = atomic_exchange(&sampling_bucket->last_update, timeval);
+                int64_t clear_counter = (int64_t)((long double)(timeval - old_time) * max_per_second);
 
-#if ZTS
-                    pthread_rwlock_wrlock(&dd_span_sampling_limiter_lock);
-#endif
-                    if (!zend_hash_add_ptr(&dd_span_sampling_limiters, rule_key, new_sampling_bucket)) {
-                        free(new_sampling_bucket);
-                        sampling_bucket = zend_hash_find_ptr(&dd_span_sampling_limiters, rule_key);
-                    }
-#if ZTS
-                    pthread_rwlock_unlock(&dd_span_sampling_limiter_lock);
-#endif
+                int64_t previous_hits = atomic_fetch_sub(&sampling_bucket->hit_count, clear_counter);
+                if (previous_hits < clear_counter) {
+                    atomic_fetch_add(&sampling_bucket->hit_count, previous_hits > 0 ? clear_counter - previous_hits : clear_counter);
                 }
 
-                zend_string_release(rule_key);
-
-                if (sampling_bucket) {
-                    const int nanosecond = 1000000000;
-
-                    // restore allowed time basis
-                    uint64_t old_time = atomic_exchange(&sampling_bucket->last_update, timeval);
-                    int64_t clear_counter = (int64_t)((long double)(timeval - old_time) * max_per_second);
-
-                    int64_t previous_hits = atomic_fetch_sub(&sampling_bucket->hit_count, clear_counter);
-                    if (previous_hits < clear_counter) {
-                        atomic_fetch_add(&sampling_bucket->hit_count, previous_hits > 0 ? clear_counter - previous_hits : clear_counter);
-                    }
-
-                    previous_hits = atomic_fetch_add(&sampling_bucket->hit_count, nanosecond);
-                    if ((long double)previous_hits / nanosecond >= max_per_second) {
-                        atomic_fetch_sub(&sampling_bucket->hit_count, nanosecond);
-                        break; // limit exceeded
-                    }
+                previous_hits = atomic_fetch_add(&sampling_bucket->hit_count, nanosecond);
+                if ((long double)previous_hits / nanosecond >= max_per_second) {
+                    atomic_fetch_sub(&sampling_bucket->hit_count, nanosecond);
+                    break; // limit exceeded
                 }
             }
 
@@ -1180,19 +1237,131 @@ void ddtrace_serialize_span_to_array(ddtrace_span_data *span, zval *array) {
             zend_hash_str_update(metrics, ZEND_STRL("_dd.span_sampling.mechanism"), &mechanism);
 
             zval rule_rate;
-            ZVAL_DOUBLE(&rule_rate, sample_rate);
+            ZVAL_DOUBLE(&rule_rate, rule->sample_rate);
             zend_hash_str_update(metrics, ZEND_STRL("_dd.span_sampling.rule_rate"), &rule_rate);
 
-            if (max_per_second_zv) {
+            if (rule->bucket) {
                 zval max_per_sec;
-                ZVAL_DOUBLE(&max_per_sec, max_per_second);
+                ZVAL_DOUBLE(&max_per_sec, rule->max_per_second);
                 zend_hash_str_update(metrics, ZEND_STRL("_dd.span_sampling.max_per_second"), &max_per_sec);
             }
 
             break;
         }
-        ZEND_HASH_FOREACH_END();
     }
+}
+
+static void dd_span_fields_init(ddtrace_span_data *span, dd_span_fields *fields) {
+    fields->top_level_span = span->parent_id == DDTRACE_G(distributed_parent_trace_id);
+    ZVAL_UNDEF(&fields->name);
+    ZVAL_UNDEF(&fields->resource);
+    ZVAL_UNDEF(&fields->service);
+    ZVAL_UNDEF(&fields->type);
+
+    // handle dropped spans
+    if (span->parent) {
+        ddtrace_span_data *parent = span->parent;
+        while (ddtrace_span_is_dropped(parent)) {
+            parent = parent->parent;
+        }
+        span->parent_id = parent->span_id;
+    }
+
+    // SpanData::$name defaults to fully qualified called name (set at span close)
+    zval *prop_name = ddtrace_spandata_property_name(span);
+    ZVAL_DEREF(prop_name);
+    if (Z_TYPE_P(prop_name) > IS_NULL) {
+        ddtrace_convert_to_string(&fields->name, prop_name);
+    }
+
+    // SpanData::$resource defaults to SpanData::$name
+    zval *prop_resource = ddtrace_spandata_property_resource(span);
+    ZVAL_DEREF(prop_resource);
+    if (Z_TYPE_P(prop_resource) > IS_FALSE && (Z_TYPE_P(prop_resource) != IS_STRING || Z_STRLEN_P(prop_resource) > 0)) {
+        ddtrace_convert_to_string(&fields->resource, prop_resource);
+    } else if (Z_TYPE(fields->name) == IS_STRING) {
+        ZVAL_COPY(&fields->resource, &fields->name);
+    }
+
+    // TODO: SpanData::$service defaults to parent SpanData::$service or DD_SERVICE if root span
+    zval *prop_service = ddtrace_spandata_property_service(span);
+    ZVAL_DEREF(prop_service);
+    if (Z_TYPE_P(prop_service) > IS_NULL) {
+        ddtrace_convert_to_string(&fields->service, prop_service);
+
+        zend_array *service_mappings = get_DD_SERVICE_MAPPING();
+        zval *new_name = zend_hash_find(service_mappings, Z_STR(fields->service));
+        if (new_name) {
+            zend_string_release(Z_STR(fields->service));
+            ZVAL_COPY(&fields->service, new_name);
+        }
+    }
+
+    // SpanData::$type is optional and defaults to 'custom' at the Agent level
+    zval *prop_type = ddtrace_spandata_property_type(span);
+    ZVAL_DEREF(prop_type);
+    if (Z_TYPE_P(prop_type) > IS_NULL) {
+        ddtrace_convert_to_string(&fields->type, prop_type);
+    }
+
+    if (get_DD_TRACE_SQL_QUANTIZATION_ENABLED() && Z_TYPE(fields->resource) == IS_STRING &&
+        Z_TYPE(fields->type) == IS_STRING && zend_string_equals_literal(Z_STR(fields->type), "sql")) {
+        zend_string *resource = ddtrace_quantize_sql(Z_STR(fields->resource));
+        zend_string_release(Z_STR(fields->resource));
+        ZVAL_STR(&fields->resource, resource);
+    }
+
+    // Notify profiling for Endpoint Profiling.
+    if (profiling_notify_trace_finished && fields->top_level_span && Z_TYPE(fields->resource) == IS_STRING) {
+        zai_string_view type = Z_TYPE(fields->type) == IS_STRING
+                               ? ZAI_STRING_FROM_ZSTR(Z_STR(fields->type))
+                               : ZAI_STRL_VIEW("custom");
+        zai_string_view resource = ZAI_STRING_FROM_ZSTR(Z_STR(fields->resource));
+        ddtrace_log_debug("Notifying profiler of finished local root span.");
+        profiling_notify_trace_finished(span->span_id, type, resource);
+    }
+
+    dd_apply_span_sampling_rules(span, fields);
+}
+
+static void dd_span_fields_dtor(dd_span_fields *fields) {
+    zval_ptr_dtor(&fields->name);
+    zval_ptr_dtor(&fields->resource);
+    zval_ptr_dtor(&fields->service);
+    zval_ptr_dtor(&fields->type);
+}
+
+void ddtrace_serialize_span_to_array(ddtrace_span_data *span, zval *array) {
+    dd_span_fields fields;
+    dd_span_fields_init(span, &fields);
+
+    zval *el;
+    zval zv;
+    el = &zv;
+    array_init(el);
+
+    add_assoc_str(el, KEY_TRACE_ID, ddtrace_span_id_as_string(span->trace_id.low));
+    add_assoc_str(el, KEY_SPAN_ID, ddtrace_span_id_as_string(span->span_id));
+    if (span->parent_id > 0) {
+        add_assoc_str(el, KEY_PARENT_ID, ddtrace_span_id_as_string(span->parent_id));
+    }
+    add_assoc_long(el, "start", span->start);
+    add_assoc_long(el, "duration", span->duration);
+
+    if (Z_TYPE(fields.name) == IS_STRING) {
+        _add_assoc_zval_copy(el, "name", &fields.name);
+    }
+    if (Z_TYPE(fields.resource) == IS_STRING) {
+        _add_assoc_zval_copy(el, "resource", &fields.resource);
+    }
+    if (Z_TYPE(fields.service) == IS_STRING) {
+        _add_assoc_zval_copy(el, "service", &fields.service);
+    }
+    if (Z_TYPE(fields.type) == IS_STRING) {
+        _add_assoc_zval_copy(el, "type", &fields.type);
+    }
+
+    dd_span_fields_dtor(&fields);
 
     _serialize_meta(el, span);
 
@@ -1214,7 +1383,7 @@ void ddtrace_serialize_span_to_array(ddtrace_span_data *span, zval *array) {
         metrics = NULL;
     }
 
-    if (top_level_span && get_DD_TRACE_MEASURE_COMPILE_TIME()) {
+    if (fields.top_level_span && get_DD_TRACE_MEASURE_COMPILE_TIME()) {
         if (!metrics) {
             zval metrics_array;
             array_init(&metrics_array);
@@ -1226,6 +1395,317 @@ void ddtrace_serialize_span_to_array(ddtrace_span_data *span, zval *array) {
     add_next_index_zval(array, el);
 }
 
+
+// The stats count the top-level spans: the local roots and the spans whose parent belongs to another service
+static bool dd_stats_is_top_level(ddtrace_span_data *span, dd_span_fields *fields) {
+    if (fields->top_level_span || !span->parent) {
+        return true;
+    }
+    zval *service = ddtrace_spandata_property_service(span);
+    zval *parent_service = ddtrace_spandata_property_service(span->parent);
+    ZVAL_DEREF(service);
+    ZVAL_DEREF(parent_service);
+    if (Z_TYPE_P(service) == IS_STRING && Z_TYPE_P(parent_service) == IS_STRING) {
+        return !zend_string_equals(Z_STR_P(service), Z_STR_P(parent_service));
+    }
+    return Z_TYPE_P(service) != Z_TYPE_P(parent_service);
+}
+
+static datadog_php_string_view dd_stats_string(zval *zv) {
+    if (Z_TYPE_P(zv) == IS_STRING) {
+        return (datadog_php_string_view){Z_STRLEN_P(zv), Z_STRVAL_P(zv)};
+    }
+    return (datadog_php_string_view){0, ""};
+}
+
+static void dd_record_span_stats(ddtrace_span_data *span, dd_span_fields *fields, HashTable *extras,
+                                 zend_array *metrics, bool error) {
+    bool top_level = dd_stats_is_top_level(span, fields);
+    zval *measured = metrics ? zend_hash_str_find(metrics, ZEND_STRL("_dd.measured")) : NULL;
+    if (!top_level && !(measured && zval_get_double(measured))) {
+        return;
+    }
+
+    uint32_t http_status_code = 0;
+    zval *status_code = zend_hash_str_find(extras, ZEND_STRL("http.status_code"));
+    if (!status_code) {
+        status_code = ddtrace_span_find_meta(span, ZEND_STRL("http.status_code"));
+    }
+    if (status_code) {
+        zend_long code = zval_get_long(status_code);
+        http_status_code = code > 0 && code < 1000 ? (uint32_t)code : 0;
+    }
+
+    zend_string *origin = DDTRACE_G(dd_origin);
+    ddtrace_coms_stats_span_t stats = {
+        .service = dd_stats_string(&fields->service),
+        .name = dd_stats_string(&fields->name),
+        .resource = dd_stats_string(&fields->resource),
+        .type = dd_stats_string(&fields->type),
+        .http_status_code = http_status_code,
+        .synthetics = origin && ZSTR_LEN(origin) >= sizeof("synthetics") - 1 &&
+                      memcmp(ZSTR_VAL(origin), "synthetics", sizeof("synthetics") - 1) == 0,
+        .top_level = top_level,
+        .error = error,
+        .end = span->start + span->duration,
+        .duration = span->duration,
+    };
+    ddtrace_coms_stats_record(&DDTRACE_G(stats_shard), &stats);
+}
+
+#define dd_mpack_write_lit(writer, str) mpack_write_str(writer, str, sizeof(str) - 1)
+
+static inline void dd_mpack_write_zstr(mpack_writer_t *writer, zend_string *str) {
+    mpack_write_str(writer, ZSTR_VAL(str), ZSTR_LEN(str));
+}
+
+bool ddtrace_serialize_span_to_msgpack(ddtrace_span_data *span, mpack_writer_t *writer) {
+    dd_span_fields fields;
+    dd_span_fields_init(span, &fields);
+
+    // Only the rarely present computed entries get an own table; the span meta is written from the span directly
+    HashTable extras;
+    zend_hash_init(&extras, 8, NULL, ZVAL_PTR_DTOR, 0);
+    dd_serialize_meta_extras(span, &extras);
+
+    // Spans whose meta was never accessed still carry their tags inline
+    zend_array *meta = NULL;
+    uint8_t inline_meta_count = 0;
+    zval *meta_zv = ddtrace_spandata_property_meta_zval(span);
+    if (Z_TYPE_P(meta_zv) == IS_UNDEF) {
+        inline_meta_count = span->inline_meta_count;
+    }
+    ZVAL_DEREF(meta_zv);
+    if (Z_TYPE_P(meta_zv) == IS_ARRAY) {
+        meta = Z_ARR_P(meta_zv);
+    }
+
+    bool has_extras = zend_hash_num_elements(&extras) > 0;
+    uint32_t meta_count = zend_hash_num_elements(&extras);
+    bool error = zend_hash_str_exists(&extras, ZEND_STRL("error.message")) ||
+                 zend_hash_str_exists(&extras, ZEND_STRL("error.type"));
+    zend_string *str_key;
+    zval *val;
+    if (meta) {
+        ZEND_HASH_FOREACH_STR_KEY_VAL_IND(meta, str_key, val) {
+            if (str_key && (!has_extras || !zend_hash_exists(&extras, str_key))) {
+                ++meta_count;
+                error = error || zend_string_equals_literal(str_key, "error.message") ||
+                        zend_string_equals_literal(str_key, "error.type");
+            }
+        }
+        ZEND_HASH_FOREACH_END();
+    }
+    for (uint8_t i = 0; i < inline_meta_count; ++i) {
+        str_key = span->inline_meta[i].key;
+        if (!has_extras || !zend_hash_exists(&extras, str_key)) {
+            ++meta_count;
+            error = error || zend_string_equals_literal(str_key, "error.message") ||
+                    zend_string_equals_literal(str_key, "error.type");
+        }
+    }
+
+    zend_array *metrics = NULL;
+    zval *metrics_zv = ddtrace_spandata_property_metrics_zval(span);
+    ZVAL_DEREF(metrics_zv);
+    if (Z_TYPE_P(metrics_zv) == IS_ARRAY) {
+        metrics = Z_ARR_P(metrics_zv);
+    }
+
+    bool add_compile_time = fields.top_level_span && get_DD_TRACE_MEASURE_COMPILE_TIME();
+    uint32_t metrics_count = add_compile_time;
+    if (metrics) {
+        ZEND_HASH_FOREACH_STR_KEY_VAL_IND(metrics, str_key, val) {
+            if (str_key && (!add_compile_time || !zend_string_equals_literal(str_key, "php.compilation.total_time_ms"))) {
+                ++metrics_count;
+            }
+        }
+        ZEND_HASH_FOREACH_END();
+    }
+
+    if (get_global_DD_TRACE_STATS_COMPUTATION_ENABLED()) {
+        dd_record_span_stats(span, &fields, &extras, metrics, error);
+
+        // the stats are complete already, the agent only wants the traces it keeps
+        if (ddtrace_fetch_prioritySampling_from_span(span->root) <= 0 &&
+            !(metrics && zend_hash_str_exists(metrics, ZEND_STRL("_dd.span_sampling.mechanism")))) {
+            dd_span_fields_dtor(&fields);
+            zend_hash_destroy(&extras);
+            return false;
+        }
+    }
+
+    uint32_t field_count = 4 + (span->parent_id > 0) + (Z_TYPE(fields.name) == IS_STRING) +
+                           (Z_TYPE(fields.resource) == IS_STRING) + (Z_TYPE(fields.service) == IS_STRING) +
+                           (Z_TYPE(fields.type) == IS_STRING) + error + (meta_count > 0) + (metrics_count > 0);
+    mpack_start_map(writer, field_count);
+
+    dd_mpack_write_lit(writer, KEY_TRACE_ID);
+    mpack_write_u64(writer, span->trace_id.low);
+    dd_mpack_write_lit(writer, KEY_SPAN_ID);
+    mpack_write_u64(writer, span->span_id);
+    if (span->parent_id > 0) {
+        dd_mpack_write_lit(writer, KEY_PARENT_ID);
+        mpack_write_u64(writer, span->parent_id);
+    }
+    dd_mpack_write_lit(writer, "start");
+    mpack_write_int(writer, (zend_long)span->start);
+    dd_mpack_write_lit(writer, "duration");
+    mpack_write_int(writer, (zend_long)span->duration);
+
+    if (Z_TYPE(fields.name) == IS_STRING) {
+        dd_mpack_write_lit(writer, "name");
+        dd_mpack_write_zstr(writer, Z_STR(fields.name));
+    }
+    if (Z_TYPE(fields.resource) == IS_STRING) {
+        dd_mpack_write_lit(writer, "resource");
+        dd_mpack_write_zstr(writer, Z_STR(fields.resource));
+    }
+    if (Z_TYPE(fields.service) == IS_STRING) {
+        dd_mpack_write_lit(writer, "service");
+        dd_mpack_write_zstr(writer, Z_STR(fields.service));
+    }
+    if (Z_TYPE(fields.type) == IS_STRING) {
+        dd_mpack_write_lit(writer, "type");
+        dd_mpack_write_zstr(writer, Z_STR(fields.type));
+    }
+
+    dd_span_fields_dtor(&fields);
+
+    if (error) {
+        dd_mpack_write_lit(writer, "error");
+        mpack_write_int(writer, 1);
+    }
+
+    if (meta_count) {
+        dd_mpack_write_lit(writer, "meta");
+        mpack_start_map(writer, meta_count);
+        if (meta) {
+            ZEND_HASH_FOREACH_STR_KEY_VAL_IND(meta, str_key, val) {
+                if (str_key && (!has_extras || !zend_hash_exists(&extras, str_key))) {
+                    zend_string *str = ddtrace_convert_to_str(val);
+                    dd_mpack_write_zstr(writer, str_key);
+                    dd_mpack_write_zstr(writer, str);
+                    zend_string_release(str);
+                }
+            }
+            ZEND_HASH_FOREACH_END();
+        }
+        for (uint8_t i = 0; i < inline_meta_count; ++i) {
+            str_key = span->inline_meta[i].key;
+            if (!has_extras || !zend_hash_exists(&extras, str_key)) {
+                zend_string *str = ddtrace_convert_to_str(&span->inline_meta[i].value);
+                dd_mpack_write_zstr(writer, str_key);
+                dd_mpack_write_zstr(writer, str);
+                zend_string_release(str);
+            }
+        }
+        ZEND_HASH_FOREACH_STR_KEY_VAL(&extras, str_key, val) {
+            dd_mpack_write_zstr(writer, str_key);
+            dd_mpack_write_zstr(writer, Z_STR_P(val));
+        }
+        ZEND_HASH_FOREACH_END();
+        mpack_finish_map(writer);
+    }
+
+    zend_hash_destroy(&extras);
+
+    if (metrics_count) {
+        dd_mpack_write_lit(writer, "metrics");
+        mpack_start_map(writer, metrics_count);
+        if (metrics) {
+            ZEND_HASH_FOREACH_STR_KEY_VAL_IND(metrics, str_key, val) {
+                if (str_key && (!add_compile_time || !zend_string_equals_literal(str_key, "php.compilation.total_time_ms"))) {
+                    dd_mpack_write_zstr(writer, str_key);
+                    mpack_write_double(writer, zval_get_double(val));
+                }
+            }
+            ZEND_HASH_FOREACH_END();
+        }
+        if (add_compile_time) {
+            dd_mpack_write_lit(writer, "php.compilation.total_time_ms");
+            mpack_write_double(writer, ddtrace_compile_time_get() / 1000.);
+        }
+        mpack_finish_map(writer);
+    }
+
+    mpack_finish_map(writer);
+    return true;
+}
+
+struct dd_msgpack_spans {
+    mpack_writer_t writer;
+    size_t *offsets;  // end offset of every span in the writer buffer
+    size_t count;
+    size_t capacity;
+};
+
+static void dd_serialize_span_to_msgpack_buffer(ddtrace_span_data *span, void *context) {
+    struct dd_msgpack_spans *spans = context;
+    if (!ddtrace_serialize_span_to_msgpack(span, &spans->writer)) {
+        return;
+    }
+    if (spans->count == spans->capacity) {
+        spans->capacity = spans->capacity ? spans->capacity * 2 : 64;
+        spans->offsets = erealloc(spans->offsets, spans->capacity * sizeof(*spans->offsets));
+    }
+    spans->offsets[spans->count++] = mpack_writer_buffer_used(&spans->writer);
+}
+
+bool ddtrace_serialize_closed_spans_into_c_string(bool collect_cycles, char **data_p, size_t *size_p, size_t *num_spans_p) {
+    struct dd_msgpack_spans spans = {0};
+    char *spans_data;
+    size_t spans_size;
+    mpack_writer_init_growable(&spans.writer, &spans_data, &spans_size);
+
+    // The spans are released after serialization, regardless of whether the encoding succeeds
+    if (collect_cycles) {
+        ddtrace_serialize_closed_spans_with_cycle_using(dd_serialize_span_to_msgpack_buffer, &spans);
+    } else {
+        ddtrace_serialize_closed_spans_using(dd_serialize_span_to_msgpack_buffer, &spans);
+    }
+
+    bool success = mpack_writer_destroy(&spans.writer) == mpack_ok;
+
+    *data_p = NULL;
+    *size_p = 0;
+    *num_spans_p = spans.count;
+
+    if (success && spans.count) {
+        // The span count is only known now, so prefix the already encoded spans with the array headers.
+        // This is the trace as a single element of the list of traces.
+        size_t size = spans_size + 2 * (1 + sizeof(uint32_t));
+        char *data = malloc(size);
+        mpack_writer_t writer;
+        mpack_writer_init(&writer, data, size);
+        mpack_start_array(&writer, 1);
+        mpack_start_array(&writer, (uint32_t)spans.count);
+        size_t start = 0;
+        for (size_t i = 0; i < spans.count; ++i) {
+            mpack_write_object_bytes(&writer, spans_data + start, spans.offsets[i] - start);
+            start = spans.offsets[i];
+        }
+        mpack_finish_array(&writer);
+        mpack_finish_array(&writer);
+
+        size = mpack_writer_buffer_used(&writer);
+        if (mpack_writer_destroy(&writer) == mpack_ok) {
+            *data_p = data;
+            *size_p = size;
+        } else {
+            free(data);
+            success = false;
+        }
+    }
+
+    free(spans_data);
+    if (spans.offsets) {
+        efree(spans.offsets);
+    }
+
+    return success;
+}
+
 static zend_string *dd_truncate_uncaught_exception(zend_string *msg) {
     const char uncaught[] = "Uncaught ";
     const char *data = ZSTR_VAL(msg);
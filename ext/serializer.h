@@ -1,11 +1,16 @@
 #ifndef DD_SERIALIZER_H
 #define DD_SERIALIZER_H
 #include "span.h"
+#include "mpack/mpack.h"
 
 int ddtrace_serialize_simple_array(zval *trace, zval *retval);
 int ddtrace_serialize_simple_array_into_c_string(zval *trace, char **data_p, size_t *size_p);
 
 void ddtrace_serialize_span_to_array(ddtrace_span_data *span, zval *array);
+// Returns false if the span is left out of the trace, e.g. as the stats are computed client-side and it is dropped
+bool ddtrace_serialize_span_to_msgpack(ddtrace_span_data *span, mpack_writer_t *writer);
+// Encodes all closed spans as a single msgpack trace (an array holding one array of spans) without going through zvals
+bool ddtrace_serialize_closed_spans_into_c_string(bool collect_cycles, char **data_p, size_t *size_p, size_t *num_spans_p);
 
 void ddtrace_save_active_error_to_metadata(void);
 void ddtrace_set_global_span_properties(ddtrace_span_data *span);
@@ -13,5 +18,7 @@ void ddtrace_set_root_span_properties(ddtrace_span_data *span);
 
 void ddtrace_initialize_span_sampling_limiter(void);
 void ddtrace_shutdown_span_sampling_limiter(void);
+void ddtrace_span_sampling_rules_rshutdown(void);
+void ddtrace_span_sampling_rules_gshutdown(zend_ddtrace_globals *ddtrace_globals);
 
 #endif  // DD_SERIALIZER_H
@@ -20,6 +20,14 @@
 
 ZEND_EXTERN_MODULE_GLOBALS(ddtrace);
 
+static zend_string *dd_inherited_meta_keys[3];
+
+void ddtrace_span_minit(void) {
+    dd_inherited_meta_keys[0] = zend_string_init_interned(ZEND_STRL("version"), 1);
+    dd_inherited_meta_keys[1] = zend_string_init_interned(ZEND_STRL("env"), 1);
+    dd_inherited_meta_keys[2] = zend_string_init_interned(ZEND_STRL("_dd.origin"), 1);
+}
+
 static void dd_reset_span_counters(void) {
     DDTRACE_G(open_spans_count) = 0;
     DDTRACE_G(dropped_spans_count) = 0;
@@ -40,6 +48,112 @@ static void dd_drop_span(ddtrace_span_data *span, bool silent) {
     OBJ_RELEASE(&span->std);
 }
 
+// Flushed spans nobody else references are reset and kept around, saving the object allocation and the metrics
+// table (and the meta table before PHP 8) for the next spans of the request. The Zend object store owns the object
+// memory, so reuse is the closest we get to a span slab.
+#define DD_SPAN_POOL_MAX_SIZE 1024
+// Larger tables are released rather than kept around for spans which will mostly have a handful of tags
+#define DD_SPAN_POOL_MAX_TABLE_SIZE 64
+
+static zend_array *dd_take_reusable_array(zval *zv) {
+    if (Z_TYPE_P(zv) != IS_ARRAY || !Z_REFCOUNTED_P(zv) || Z_REFCOUNT_P(zv) != 1 ||
+        Z_ARRVAL_P(zv)->nTableSize > DD_SPAN_POOL_MAX_TABLE_SIZE) {
+        return NULL;
+    }
+    zend_array *array = Z_ARR_P(zv);
+    ZVAL_NULL(zv);
+    zend_hash_clean(array);
+    return array;
+}
+
+static void dd_restore_reusable_array(zval *zv, zend_array *array) {
+    if (array) {
+        zval_ptr_dtor(zv);
+        ZVAL_ARR(zv, array);
+    }
+#if PHP_VERSION_ID < 80000
+    else {
+        // Not handled in arginfo on these old versions
+        array_init(zv);
+    }
+#endif
+}
+
+static bool dd_recycle_span(ddtrace_span_data *span) {
+    zend_object *obj = &span->std;
+    if (DDTRACE_G(span_pool_count) >= DD_SPAN_POOL_MAX_SIZE || GC_REFCOUNT(obj) != 1 || obj->ce != ddtrace_ce_span_data ||
+        obj->properties
+#if PHP_VERSION_ID >= 80000
+        || (GC_FLAGS(obj) & IS_OBJ_WEAKLY_REFERENCED)
+#endif
+    ) {
+        return false;
+    }
+
+    ddtrace_span_free_inline_meta(span);
+#if PHP_VERSION_ID >= 80000
+    // the meta table is not kept, an undefined meta lets the next tags go inline again, see ddtrace_span_add_meta()
+    zend_array *meta = NULL;
+#else
+    zend_array *meta = dd_take_reusable_array(ddtrace_spandata_property_meta_zval(span));
+#endif
+    zend_array *metrics = dd_take_reusable_array(ddtrace_spandata_property_metrics_zval(span));
+
+    zval *property = obj->properties_table, *end = property + obj->ce->default_properties_count;
+    for (; property < end; ++property) {
+        zval_ptr_dtor(property);
+    }
+
+    // destructors of released properties may have grabbed a new reference
+    if (GC_REFCOUNT(obj) != 1 || obj->properties) {
+        if (meta) {
+            zend_array_destroy(meta);
+        }
+        if (metrics) {
+            zend_array_destroy(metrics);
+        }
+        object_properties_init(obj, obj->ce);
+        return false;
+    }
+
+    object_properties_init(obj, obj->ce);
+#if PHP_VERSION_ID >= 80000
+    ZVAL_UNDEF(ddtrace_spandata_property_meta_zval(span));
+#else
+    dd_restore_reusable_array(ddtrace_spandata_property_meta_zval(span), meta);
+#endif
+    dd_restore_reusable_array(ddtrace_spandata_property_metrics_zval(span), metrics);
+#if PHP_VERSION_ID < 80000
+    // Not handled in arginfo on these old versions
+    array_init(ddtrace_spandata_property_links_zval(span));
+#endif
+    span->stack = NULL;
+    span->parent = NULL;
+    memset(&span->trace_id, 0, sizeof(*span) - offsetof(ddtrace_span_data, trace_id));
+
+    span->next = DDTRACE_G(span_pool);
+    DDTRACE_G(span_pool) = span;
+    ++DDTRACE_G(span_pool_count);
+    return true;
+}
+
+static void dd_release_flushed_span(ddtrace_span_data *span) {
+    if (!dd_recycle_span(span)) {
+        OBJ_RELEASE(&span->std);
+    }
+}
+
+static void dd_free_span_pool(void) {
+    ddtrace_span_data *span = DDTRACE_G(span_pool);
+    DDTRACE_G(span_pool) = NULL;
+    DDTRACE_G(span_pool_count) = 0;
+    while (span) {
+        ddtrace_span_data *next = span->next;
+        OBJ_RELEASE(&span->std);
+        span = next;
+    }
+}
+
 static void dd_free_span_ring(ddtrace_span_data *span) {
     if (span != NULL) {
         ddtrace_span_data *cur = span;
@@ -117,6 +231,8 @@ void ddtrace_free_span_stacks(bool silent) {
     DDTRACE_G(dropped_spans_count) = 0;
     DDTRACE_G(closed_spans_count) = 0;
     DDTRACE_G(top_closed_stack) = NULL;
+
+    dd_free_span_pool();
 }
 
 static uint64_t _get_nanoseconds(bool monotonic_clock) {
@@ -193,23 +309,12 @@ set_trace_id_from_span_id:
         zval_ptr_dtor(prop_type);
         ZVAL_COPY(prop_type, ddtrace_spandata_property_type(parent_span));
 
-        zend_array *meta = ddtrace_spandata_property_meta(span), *parent_meta = ddtrace_spandata_property_meta(parent_span);
-        zval *version;
-        if ((version = zend_hash_str_find(parent_meta, ZEND_STRL("version")))) {
-            Z_TRY_ADDREF_P(version);
-            zend_hash_str_add_new(meta, ZEND_STRL("version"), version);
-        }
-
-        zval *env;
-        if ((env = zend_hash_str_find(parent_meta, ZEND_STRL("env")))) {
-            Z_TRY_ADDREF_P(env);
-            zend_hash_str_add_new(meta, ZEND_STRL("env"), env);
-        }
-
-        zval *origin;
-        if ((origin = zend_hash_str_find(parent_meta, ZEND_STRL("_dd.origin")))) {
-            Z_TRY_ADDREF_P(origin);
-            zend_hash_str_add_new(meta, ZEND_STRL("_dd.origin"), origin);
+        for (size_t i = 0; i < sizeof(dd_inherited_meta_keys) / sizeof(*dd_inherited_meta_keys); ++i) {
+            zend_string *key = dd_inherited_meta_keys[i];
+            zval *inherited = ddtrace_span_find_meta(parent_span, ZSTR_VAL(key), ZSTR_LEN(key));
+            if (inherited) {
+                ddtrace_span_add_meta(span, key, inherited);
+            }
         }
     }
 
@@ -308,7 +413,95 @@ void ddtrace_switch_span_stack(ddtrace_span_stack *target_stack) {
     DDTRACE_G(active_stack) = target_stack;
 }
 
+#if PHP_VERSION_ID >= 80000
+static bool dd_span_meta_is_pristine(zval *meta) {
+    // still the immutable empty array the property defaults to
+    return Z_TYPE_P(meta) == IS_ARRAY && !Z_REFCOUNTED_P(meta) && zend_hash_num_elements(Z_ARR_P(meta)) == 0;
+}
+#endif
+
+void ddtrace_span_add_meta(ddtrace_span_data *span, zend_string *key, zval *value) {
+#if PHP_VERSION_ID >= 80000
+    zval *meta = ddtrace_spandata_property_meta_zval(span);
+    bool pending = Z_TYPE_P(meta) == IS_UNDEF;
+    if ((pending || dd_span_meta_is_pristine(meta)) && Z_TYPE_P(value) <= IS_STRING) {
+        for (uint8_t i = 0; i < span->inline_meta_count; ++i) {
+            if (zend_string_equals(span->inline_meta[i].key, key)) {
+                return;
+            }
+        }
+
+        if (span->inline_meta_count < DDTRACE_SPAN_INLINE_META_SIZE) {
+            if (!pending) {
+                ZVAL_UNDEF(meta);
+            }
+            ddtrace_span_inline_tag *tag = &span->inline_meta[span->inline_meta_count++];
+            tag->key = zend_string_copy(key);
+            ZVAL_COPY(&tag->value, value);
+            return;
+        }
+    }
+#endif
+
+    if (zend_hash_add(ddtrace_spandata_property_meta(span), key, value)) {
+        Z_TRY_ADDREF_P(value);
+    }
+}
+
+zval *ddtrace_span_find_meta(ddtrace_span_data *span, const char *key, size_t len) {
+    zval *meta = ddtrace_spandata_property_meta_zval(span);
+    if (Z_TYPE_P(meta) == IS_UNDEF) {
+        for (uint8_t i = 0; i < span->inline_meta_count; ++i) {
+            ddtrace_span_inline_tag *tag = &span->inline_meta[i];
+            if (ZSTR_LEN(tag->key) == len && memcmp(ZSTR_VAL(tag->key), key, len) == 0) {
+                return &tag->value;
+            }
+        }
+        return NULL;
+    }
+
+    ZVAL_DEREF(meta);
+    if (Z_TYPE_P(meta) == IS_ARRAY) {
+        return zend_hash_str_find(Z_ARR_P(meta), key, len);
+    }
+    return NULL;
+}
+
+void ddtrace_span_materialize_meta(ddtrace_span_data *span) {
+    zval *meta = ddtrace_spandata_property_meta_zval(span);
+    if (Z_TYPE_P(meta) != IS_UNDEF) {
+        return;
+    }
+
+    array_init_size(meta, span->inline_meta_count);
+    for (uint8_t i = 0; i < span->inline_meta_count; ++i) {
+        ddtrace_span_inline_tag *tag = &span->inline_meta[i];
+        // ownership of the value moves to the array
+        zend_hash_add_new(Z_ARR_P(meta), tag->key, &tag->value);
+        zend_string_release(tag->key);
+    }
+    span->inline_meta_count = 0;
+}
+
+void ddtrace_span_free_inline_meta(ddtrace_span_data *span) {
+    for (uint8_t i = 0; i < span->inline_meta_count; ++i) {
+        zend_string_release(span->inline_meta[i].key);
+        zval_ptr_dtor(&span->inline_meta[i].value);
+    }
+    span->inline_meta_count = 0;
+}
+
 ddtrace_span_data *ddtrace_init_span(enum ddtrace_span_dataype type) {
+    ddtrace_span_data *pooled = DDTRACE_G(span_pool);
+    if (pooled) {
+        // the pool holds the single reference, which is handed over like the one of a fresh object
+        DDTRACE_G(span_pool) = pooled->next;
+        --DDTRACE_G(span_pool_count);
+        pooled->next = NULL;
+        pooled->type = type;
+        return pooled;
+    }
+
     zval fci_zv;
     object_init_ex(&fci_zv, ddtrace_ce_span_data);
     ddtrace_span_data *span = (ddtrace_span_data *)Z_OBJ(fci_zv);
@@ -671,7 +864,7 @@ void ddtrace_drop_span(ddtrace_span_data *span) {
     dd_drop_span(span, false);
 }
 
-void ddtrace_serialize_closed_spans(zval *serialized) {
+void ddtrace_serialize_closed_spans_using(ddtrace_span_serializer serializer, void *context) {
     if (DDTRACE_G(top_closed_stack)) {
         ddtrace_span_stack *rootstack = DDTRACE_G(top_closed_stack);
         DDTRACE_G(top_closed_stack) = NULL;
@@ -687,12 +880,12 @@ void ddtrace_serialize_closed_spans(zval *serialized) {
                 do {
                     ddtrace_span_data *tmp = span;
                     span = tmp->next;
-                    ddtrace_serialize_span_to_array(tmp, serialized);
+                    serializer(tmp, context);
 #if PHP_VERSION_ID < 70400
                     // remove the artificially increased RC while closing again
                     GC_DELREF(&tmp->std);
 #endif
-                    OBJ_RELEASE(&tmp->std);
+                    dd_release_flushed_span(tmp);
                 } while (span != end);
                 // We hold a reference to stacks with flushable spans
                 OBJ_RELEASE(&stack->std);
@@ -712,15 +905,27 @@ void ddtrace_serialize_closed_spans(zval *serialized) {
     DDTRACE_G(dropped_spans_count) = 0;
 }
 
-void ddtrace_serialize_closed_spans_with_cycle(zval *serialized) {
+void ddtrace_serialize_closed_spans_with_cycle_using(ddtrace_span_serializer serializer, void *context) {
     // We need to loop here, as closing the last span root stack could add other spans here
     while (DDTRACE_G(top_closed_stack)) {
-        ddtrace_serialize_closed_spans(serialized);
+        ddtrace_serialize_closed_spans_using(serializer, context);
         // Also flush possible cycles here
         gc_collect_cycles();
     }
 }
 
+static void dd_serialize_span_to_array(ddtrace_span_data *span, void *serialized) {
+    ddtrace_serialize_span_to_array(span, serialized);
+}
+
+void ddtrace_serialize_closed_spans(zval *serialized) {
+    ddtrace_serialize_closed_spans_using(dd_serialize_span_to_array, serialized);
+}
+
+void ddtrace_serialize_closed_spans_with_cycle(zval *serialized) {
+    ddtrace_serialize_closed_spans_with_cycle_using(dd_serialize_span_to_array, serialized);
+}
+
 zend_string *ddtrace_span_id_as_string(uint64_t id) { return zend_strpprintf(0, "%" PRIu64, id); }
 
 zend_string *ddtrace_trace_id_as_string(ddtrace_trace_id id) {
@@ -22,6 +22,13 @@ enum ddtrace_span_dataype {
     DDTRACE_SPAN_CLOSED,
 };
 
+#define DDTRACE_SPAN_INLINE_META_SIZE 6
+
+typedef struct ddtrace_span_inline_tag {
+    zend_string *key;
+    zval value;
+} ddtrace_span_inline_tag;
+
 // Refcounting:
 // Only internal/autoroot spans retain a ref on their own
 // Non-flushed closed spans also have a ref on their own
@@ -48,6 +55,10 @@ struct ddtrace_span_data {
     enum ddtrace_span_dataype type;
     struct ddtrace_span_data *next;
     struct ddtrace_span_data *root;
+    // Tags set by the tracer on spans with an untouched meta property; only moved into a meta array once something
+    // accesses it. Most spans never have their meta read before serialization.
+    uint8_t inline_meta_count;
+    ddtrace_span_inline_tag inline_meta[DDTRACE_SPAN_INLINE_META_SIZE];
 };
 
 struct ddtrace_span_stack {
@@ -91,6 +102,7 @@ struct ddtrace_span_link {
     };
 };
 
+void ddtrace_span_minit(void);
 void ddtrace_init_span_stacks(void);
 void ddtrace_free_span_stacks(bool silent);
 void ddtrace_switch_span_stack(ddtrace_span_stack *target_stack);
@@ -119,6 +131,10 @@ void ddtrace_close_top_span_without_stack_swap(ddtrace_span_data *span);
 void ddtrace_close_all_open_spans(bool force_close_root_span);
 void ddtrace_drop_span(ddtrace_span_data *span);
 void ddtrace_mark_all_span_stacks_flushable(void);
+typedef void (*ddtrace_span_serializer)(ddtrace_span_data *span, void *context);
+// Hands every closed span to the serializer exactly once and releases it afterwards
+void ddtrace_serialize_closed_spans_using(ddtrace_span_serializer serializer, void *context);
+void ddtrace_serialize_closed_spans_with_cycle_using(ddtrace_span_serializer serializer, void *context);
 void ddtrace_serialize_closed_spans(zval *serialized);
 void ddtrace_serialize_closed_spans_with_cycle(zval *serialized);
 zend_string *ddtrace_span_id_as_string(uint64_t id);
@@ -128,6 +144,12 @@ zend_string *ddtrace_trace_id_as_hex_string(ddtrace_trace_id id);
 
 bool ddtrace_span_alter_root_span_config(zval *old_value, zval *new_value);
 
+// Adds a tag unless already present, without allocating a meta array for the span if possible
+void ddtrace_span_add_meta(ddtrace_span_data *span, zend_string *key, zval *value);
+// Looks up a tag without materializing the meta array
+zval *ddtrace_span_find_meta(ddtrace_span_data *span, const char *key, size_t len);
+void ddtrace_span_free_inline_meta(ddtrace_span_data *span);
+
 static inline bool ddtrace_span_is_dropped(ddtrace_span_data *span) {
     return span->duration == DDTRACE_DROPPED_SPAN || span->duration == DDTRACE_SILENTLY_DROPPED_SPAN;
 }
@@ -0,0 +1,83 @@
+#include "sql_quantization.h"
+
+#include <components/sql_quantizer/sql_quantizer.h>
+
+#include "compatibility.h"
+#include "ddtrace.h"
+
+ZEND_EXTERN_MODULE_GLOBALS(ddtrace);
+
+// Prepared statements of an application are a bounded set; the least recently used ones are evicted past that
+#define DD_SQL_QUANTIZATION_CACHE_MAX 512
+// Longer statements are typically bulk inserts with their values inlined: they are rarely repeated verbatim
+#define DD_SQL_QUANTIZATION_CACHE_MAX_LEN 4096
+
+typedef struct {
+    zend_string *sql;
+    zend_string *quantized;
+} dd_sql_quantization_entry;
+
+/* The quantized statements are kept for the lifetime of the thread, in DDTRACE_G(sql_quantization_cache), ordered from
+ * the least to the most recently used. Like the PDO DSN tags, their strings are persistent and flagged as interned, so
+ * that they can be handed to the request without being copied. */
+static zend_string *dd_sql_persistent_string(const char *str, size_t len) {
+    zend_string *string = zend_string_init(str, len, 1);
+    zend_string_hash_val(string);
+    GC_ADD_FLAGS(string, IS_STR_INTERNED);
+    return string;
+}
+
+static void dd_sql_quantization_entry_free(dd_sql_quantization_entry *entry) {
+    pefree(entry->sql, 1);
+    pefree(entry->quantized, 1);
+    pefree(entry, 1);
+}
+
+static zend_string *dd_quantize_sql(zend_string *sql) {
+    zend_string *quantized = zend_string_alloc(ZSTR_LEN(sql), 0);
+    datadog_php_string_view view = {ZSTR_LEN(sql), ZSTR_VAL(sql)};
+    size_t len = datadog_php_sql_quantize(view, ZSTR_VAL(quantized));
+    ZSTR_VAL(quantized)[len] = '\0';
+    ZSTR_LEN(quantized) = len;
+    return quantized;
+}
+
+void ddtrace_sql_quantization_ginit(HashTable *cache) { zend_hash_init(cache, 8, NULL, NULL, 1); }
+
+void ddtrace_sql_quantization_gshutdown(HashTable *cache) {
+    dd_sql_quantization_entry *entry;
+    ZEND_HASH_FOREACH_PTR(cache, entry) { dd_sql_quantization_entry_free(entry); }
+    ZEND_HASH_FOREACH_END();
+    zend_hash_destroy(cache);
+}
+
+zend_string *ddtrace_quantize_sql(zend_string *sql) {
+    if (ZSTR_LEN(sql) > DD_SQL_QUANTIZATION_CACHE_MAX_LEN) {
+        return dd_quantize_sql(sql);
+    }
+
+    HashTable *cache = &DDTRACE_G(sql_quantization_cache);
+    dd_sql_quantization_entry *entry = zend_hash_find_ptr(cache, sql);
+    if (entry) {
+        // move it last; the keys are interned, so that deleting them does not free them
+        zend_hash_del(cache, entry->sql);
+        zend_hash_add_new_ptr(cache, entry->sql, entry);
+        return entry->quantized;
+    }
+
+    if (zend_hash_num_elements(cache) >= DD_SQL_QUANTIZATION_CACHE_MAX) {
+        dd_sql_quantization_entry *oldest = NULL;
+        ZEND_HASH_FOREACH_PTR(cache, oldest) { break; }
+        ZEND_HASH_FOREACH_END();
+        zend_hash_del(cache, oldest->sql);
+        dd_sql_quantization_entry_free(oldest);
+    }
+
+    zend_string *quantized = dd_quantize_sql(sql);
+    entry = pemalloc(sizeof(*entry), 1);
+    entry->sql = dd_sql_persistent_string(ZSTR_VAL(sql), ZSTR_LEN(sql));
+    entry->quantized = dd_sql_persistent_string(ZSTR_VAL(quantized), ZSTR_LEN(quantized));
+    zend_string_release(quantized);
+    zend_hash_add_new_ptr(cache, entry->sql, entry);
+    return entry->quantized;
+}
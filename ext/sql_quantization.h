@@ -0,0 +1,11 @@
+#ifndef DD_SQL_QUANTIZATION_H
+#define DD_SQL_QUANTIZATION_H
+#include <php.h>
+
+void ddtrace_sql_quantization_ginit(HashTable *cache);
+void ddtrace_sql_quantization_gshutdown(HashTable *cache);
+
+// Returns the quantized form of a SQL statement, see datadog_php_sql_quantize()
+zend_string *ddtrace_quantize_sql(zend_string *sql);
+
+#endif  // DD_SQL_QUANTIZATION_H
@@ -4,14 +4,101 @@
 #include <uri_normalization/uri_normalization.h>
 
 #include "configuration.h"
+#include "ddtrace.h"
+
+ZEND_EXTERN_MODULE_GLOBALS(ddtrace);
 
 static inline zend_string *ddtrace_uri_normalize_incoming_path(zend_string *path) {
-    return zai_uri_normalize_path(path, get_DD_TRACE_RESOURCE_URI_FRAGMENT_REGEX(),
-                                  get_DD_TRACE_RESOURCE_URI_MAPPING_INCOMING());
+    if (!DDTRACE_G(uri_normalizer_incoming)) {
+        DDTRACE_G(uri_normalizer_incoming) = zai_uri_normalizer_compile(
+            get_DD_TRACE_RESOURCE_URI_FRAGMENT_REGEX(), get_DD_TRACE_RESOURCE_URI_MAPPING_INCOMING(), true);
+    }
+    return zai_uri_normalizer_apply(DDTRACE_G(uri_normalizer_incoming), path);
 }
 static inline zend_string *ddtrace_uri_normalize_outgoing_path(zend_string *path) {
-    return zai_uri_normalize_path(path, get_DD_TRACE_RESOURCE_URI_FRAGMENT_REGEX(),
-                                  get_DD_TRACE_RESOURCE_URI_MAPPING_OUTGOING());
+    if (!DDTRACE_G(uri_normalizer_outgoing)) {
+        DDTRACE_G(uri_normalizer_outgoing) = zai_uri_normalizer_compile(
+            get_DD_TRACE_RESOURCE_URI_FRAGMENT_REGEX(), get_DD_TRACE_RESOURCE_URI_MAPPING_OUTGOING(), true);
+    }
+    return zai_uri_normalizer_apply(DDTRACE_G(uri_normalizer_outgoing), path);
+}
+
+static inline void ddtrace_free_uri_normalizer(zai_uri_normalizer **normalizer) {
+    if (*normalizer) {
+        zai_uri_normalizer_free(*normalizer);
+        *normalizer = NULL;
+    }
+}
+
+/* The normalizers are persistent and kept by the thread as long as their config does not change. A runtime change
+ * only holds for the current request, so the normalizers compiled from it are dropped again when the request ends. */
+static inline void ddtrace_invalidate_uri_normalizers(bool incoming, bool outgoing) {
+    if (incoming) {
+        DDTRACE_G(uri_normalizer_incoming_changed) = true;
+        ddtrace_free_uri_normalizer(&DDTRACE_G(uri_normalizer_incoming));
+    }
+    if (outgoing) {
+        DDTRACE_G(uri_normalizer_outgoing_changed) = true;
+        ddtrace_free_uri_normalizer(&DDTRACE_G(uri_normalizer_outgoing));
+    }
+}
+
+static inline void ddtrace_uri_normalizers_rshutdown(void) {
+    ddtrace_invalidate_uri_normalizers(DDTRACE_G(uri_normalizer_incoming_changed),
+                                       DDTRACE_G(uri_normalizer_outgoing_changed));
+    DDTRACE_G(uri_normalizer_incoming_changed) = false;
+    DDTRACE_G(uri_normalizer_outgoing_changed) = false;
+}
+
+static inline void ddtrace_uri_normalizers_gshutdown(zend_ddtrace_globals *ddtrace_globals) {
+    ddtrace_free_uri_normalizer(&ddtrace_globals->uri_normalizer_incoming);
+    ddtrace_free_uri_normalizer(&ddtrace_globals->uri_normalizer_outgoing);
+}
+
+static inline zend_string *ddtrace_filter_url_query_string(zai_string_view query_string) {
+    if (!DDTRACE_G(url_query_string_filter)) {
+        DDTRACE_G(url_query_string_filter) = zai_query_string_filter_compile(
+            get_DD_TRACE_HTTP_URL_QUERY_PARAM_ALLOWED(), get_DD_TRACE_OBFUSCATION_QUERY_STRING_REGEXP(), true);
+    }
+    return zai_query_string_filter_apply(DDTRACE_G(url_query_string_filter), query_string);
+}
+static inline zend_string *ddtrace_filter_resource_query_string(zai_string_view query_string) {
+    if (!DDTRACE_G(resource_query_string_filter)) {
+        DDTRACE_G(resource_query_string_filter) = zai_query_string_filter_compile(
+            get_DD_TRACE_RESOURCE_URI_QUERY_PARAM_ALLOWED(), get_DD_TRACE_OBFUSCATION_QUERY_STRING_REGEXP(), true);
+    }
+    return zai_query_string_filter_apply(DDTRACE_G(resource_query_string_filter), query_string);
+}
+
+static inline void ddtrace_free_query_string_filter(zai_query_string_filter **filter) {
+    if (*filter) {
+        zai_query_string_filter_free(*filter);
+        *filter = NULL;
+    }
+}
+
+// Kept across requests like the normalizers, a filter compiled from a runtime value ends with the request
+static inline void ddtrace_invalidate_query_string_filters(bool url, bool resource) {
+    if (url) {
+        DDTRACE_G(url_query_string_filter_changed) = true;
+        ddtrace_free_query_string_filter(&DDTRACE_G(url_query_string_filter));
+    }
+    if (resource) {
+        DDTRACE_G(resource_query_string_filter_changed) = true;
+        ddtrace_free_query_string_filter(&DDTRACE_G(resource_query_string_filter));
+    }
+}
+
+static inline void ddtrace_query_string_filters_rshutdown(void) {
+    ddtrace_invalidate_query_string_filters(DDTRACE_G(url_query_string_filter_changed),
+                                            DDTRACE_G(resource_query_string_filter_changed));
+    DDTRACE_G(url_query_string_filter_changed) = false;
+    DDTRACE_G(resource_query_string_filter_changed) = false;
+}
+
+static inline void ddtrace_query_string_filters_gshutdown(zend_ddtrace_globals *ddtrace_globals) {
+    ddtrace_free_query_string_filter(&ddtrace_globals->url_query_string_filter);
+    ddtrace_free_query_string_filter(&ddtrace_globals->resource_query_string_filter);
 }
 
 #endif  // DD_TRACE_URI_NORMALIZATION_H
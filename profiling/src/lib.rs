@@ -15,7 +15,7 @@ use lazy_static::lazy_static;
 use libc::c_char;
 use log::{debug, error, info, trace, warn, LevelFilter};
 use once_cell::sync::OnceCell;
-use profiling::{LocalRootSpanResourceMessage, Profiler, VmInterrupt};
+use profiling::{clear_string_cache, LocalRootSpanResourceMessage, Profiler, VmInterrupt};
 use sapi::Sapi;
 use std::borrow::Cow;
 use std::cell::RefCell;
@@ -24,8 +24,9 @@ use std::mem::MaybeUninit;
 use std::ops::DerefMut;
 use std::os::raw::c_int;
 use std::path::PathBuf;
+use std::ptr;
 use std::str::FromStr;
-use std::sync::atomic::{AtomicBool, AtomicU32, Ordering};
+use std::sync::atomic::{AtomicBool, AtomicPtr, AtomicU32, Ordering};
 use std::sync::{Arc, Mutex, Once};
 use std::time::{Duration, Instant};
 use uuid::Uuid;
@@ -43,9 +44,35 @@ use crate::bindings::{
 static PHP_VERSION: OnceCell<String> = OnceCell::new();
 
 /// The global profiler. Profiler gets made during the first rinit after an
-/// minit, and is destroyed on mshutdown.
+/// minit, and is destroyed on mshutdown. The lock only serializes creating,
+/// stopping, forking and destroying the profiler; samples go through
+/// [profiler] so that a PHP thread never waits on another thread's sample.
 static PROFILER: Mutex<Option<Profiler>> = Mutex::new(None);
 
+/// Points at the profiler inside of `PROFILER` while there is one. It's
+/// published after the profiler is created and cleared before the profiler
+/// is taken out of `PROFILER`, always while holding its lock.
+static PROFILER_HANDLE: AtomicPtr<Profiler> = AtomicPtr::new(ptr::null_mut());
+
+/// Returns the current profiler, if there is one, without locking.
+fn profiler() -> Option<&'static Profiler> {
+    // Safety: the handle only ever points at the profiler stored in the
+    // static `PROFILER`, and is cleared before that one is taken out of it.
+    // The profiler is only destroyed on extension shutdown or in a forked
+    // child, when no other PHP thread is sampling.
+    unsafe { PROFILER_HANDLE.load(Ordering::Acquire).as_ref() }
+}
+
+/// Publishes the profiler stored in `maybe_profiler`, which must be the
+/// contents of `PROFILER`, or clears the handle if there is none.
+fn publish_profiler(maybe_profiler: &Option<Profiler>) {
+    let ptr = match maybe_profiler {
+        Some(profiler) => profiler as *const Profiler as *mut Profiler,
+        None => ptr::null_mut(),
+    };
+    PROFILER_HANDLE.store(ptr, Ordering::Release);
+}
+
 /// Name of the profiling module and zend_extension. Must not contain any
 /// interior null bytes and must be null terminated.
 static PROFILER_NAME: &[u8] = b"datadog-profiling\0";
@@ -297,6 +324,9 @@ extern "C" fn prshutdown() -> ZendResult {
      */
     unsafe { bindings::zai_config_rshutdown() };
 
+    // The engine has freed the request's functions and classes by now.
+    clear_string_cache();
+
     ZendResult::Success
 }
 
@@ -358,7 +388,7 @@ impl AllocationProfilingStats {
             }
             let locals = locals.unwrap();
 
-            if let Some(profiler) = PROFILER.lock().unwrap().as_ref() {
+            if let Some(profiler) = profiler() {
                 // Safety: execute_data was provided by the engine, and the profiler doesn't mutate it.
                 unsafe {
                     profiler.collect_allocations(
@@ -428,6 +458,9 @@ extern "C" fn rinit(r#type: c_int, module_number: c_int) -> ZendResult {
 
     unsafe { bindings::zai_config_rinit() };
 
+    // Frames may have been sampled after the previous request's prshutdown.
+    clear_string_cache();
+
     // Safety: We are after first rinit and before mshutdown.
     let (
         profiling_enabled,
@@ -558,7 +591,8 @@ extern "C" fn rinit(r#type: c_int, module_number: c_int) -> ZendResult {
          */
         let mut profiler = PROFILER.lock().unwrap();
         if profiler.is_none() {
-            *profiler = Some(Profiler::new(output_pprof))
+            *profiler = Some(Profiler::new(output_pprof));
+            publish_profiler(&profiler);
         }
     };
 
@@ -597,7 +631,7 @@ extern "C" fn rinit(r#type: c_int, module_number: c_int) -> ZendResult {
                 locals.tags = Arc::new(tags);
             }
 
-            if let Some(profiler) = PROFILER.lock().unwrap().as_ref() {
+            if let Some(profiler) = profiler() {
                 let interrupt = VmInterrupt {
                     interrupt_count_ptr: &locals.interrupt_count as *const AtomicU32,
                     engine_ptr: locals.vm_interrupt_addr,
@@ -730,7 +764,7 @@ extern "C" fn rshutdown(r#type: c_int, module_number: c_int) -> ZendResult {
         let mut locals = cell.borrow_mut();
 
         if locals.profiling_enabled {
-            if let Some(profiler) = PROFILER.lock().unwrap().as_ref() {
+            if let Some(profiler) = profiler() {
                 let interrupt = VmInterrupt {
                     interrupt_count_ptr: &locals.interrupt_count,
                     engine_ptr: locals.vm_interrupt_addr,
@@ -969,6 +1003,7 @@ extern "C" fn shutdown(_extension: *mut ZendExtension) {
     trace!("shutdown({:p})", _extension);
 
     let mut profiler = PROFILER.lock().unwrap();
+    publish_profiler(&None);
     if let Some(profiler) = profiler.take() {
         profiler.shutdown(Duration::from_secs(2));
     }
@@ -988,7 +1023,7 @@ fn notify_trace_finished(local_root_span_id: u64, span_type: Cow<str>, resource:
                 return;
             }
 
-            if let Some(profiler) = PROFILER.lock().unwrap().as_ref() {
+            if let Some(profiler) = profiler() {
                 let message = LocalRootSpanResourceMessage {
                     local_root_span_id,
                     resource: resource.into_owned(),
@@ -1026,7 +1061,7 @@ fn interrupt_function(execute_data: *mut zend::zend_execute_data) {
             return;
         }
 
-        if let Some(profiler) = PROFILER.lock().unwrap().as_ref() {
+        if let Some(profiler) = profiler() {
             // Safety: execute_data was provided by the engine, and the profiler doesn't mutate it.
             unsafe { profiler.collect_time(execute_data, interrupt_count, locals.deref_mut()) };
         }
@@ -2,7 +2,7 @@ use crate::bindings::{
     datadog_php_install_handler, datadog_php_zif_handler, zend_execute_data, zend_long, zval,
     InternalFunctionHandler,
 };
-use crate::{Profiler, PROFILER, REQUEST_LOCALS};
+use crate::{publish_profiler, Profiler, PROFILER, REQUEST_LOCALS};
 use log::{error, warn};
 use std::ffi::CStr;
 use std::mem::{forget, swap};
@@ -90,6 +90,7 @@ fn stop_and_forget_profiling(maybe_profiler: &mut Option<Profiler>) {
      * and forgetting it, which avoids running the destructor. Yes, this will
      * most likely leak some small amount of memory.
      */
+    publish_profiler(&None);
     let mut old_profiler = None;
     swap(&mut *maybe_profiler, &mut old_profiler);
     forget(old_profiler);
@@ -4,6 +4,7 @@ mod thread_utils;
 mod uploader;
 
 pub use interrupts::*;
+pub use stalk_walking::clear_string_cache;
 use stalk_walking::*;
 use uploader::*;
 
@@ -323,7 +324,7 @@ impl TimeCollector {
             let location = Location {
                 lines: vec![Line {
                     function: Function {
-                        name: frame.function.as_str(),
+                        name: &frame.function,
                         system_name: "",
                         filename: frame.file.as_deref().unwrap_or(""),
                         start_line: 0,
@@ -749,8 +750,8 @@ mod tests {
 
     fn get_frames() -> Vec<ZendFrame> {
         vec![ZendFrame {
-            function: "foobar()".to_string(),
-            file: Some("foobar.php".to_string()),
+            function: Arc::from("foobar()"),
+            file: Some(Arc::from("foobar.php")),
             line: 42,
         }]
     }
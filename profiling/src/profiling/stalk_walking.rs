@@ -2,17 +2,62 @@ use crate::bindings::{
     ddog_php_prof_zend_string_view, zend_execute_data, zend_function, zend_string,
     ZEND_USER_FUNCTION,
 };
+use std::cell::RefCell;
+use std::collections::HashMap;
 use std::str::Utf8Error;
+use std::sync::Arc;
 
-#[derive(Default, Debug)]
+#[derive(Debug)]
 pub struct ZendFrame {
     // Most tools don't like frames that don't have function names, so use a
     // fake name if you need to like "<php>".
-    pub function: String,
-    pub file: Option<String>,
+    pub function: Arc<str>,
+    pub file: Option<Arc<str>>,
     pub line: u32, // use 0 for no line info
 }
 
+/// Past this many strings the cache is emptied, so that a long-running
+/// script which keeps creating functions doesn't grow it forever.
+const STRING_CACHE_LIMIT: usize = 1 << 14;
+
+/// The function names and filenames seen by the stack walker, so that frames
+/// of an already seen function only cost a reference count increment instead
+/// of two string allocations. Functions are keyed by the addresses of their
+/// name, scope and module, files by the address of the filename. These are
+/// only stable for the duration of a request, see [clear_string_cache].
+struct StringCache {
+    functions: HashMap<(usize, usize, usize), Option<Arc<str>>>,
+    files: HashMap<usize, Arc<str>>,
+    php: Arc<str>,
+    truncated: Arc<str>,
+}
+
+impl Default for StringCache {
+    fn default() -> Self {
+        Self {
+            functions: HashMap::new(),
+            files: HashMap::new(),
+            php: Arc::from("<?php"),
+            truncated: Arc::from("[truncated]"),
+        }
+    }
+}
+
+thread_local! {
+    static STRING_CACHE: RefCell<StringCache> = RefCell::new(StringCache::default());
+}
+
+/// Forgets the strings cached by the stack walker on this thread. Must be
+/// called at the beginning and end of every request, as the engine may free
+/// and reuse the memory of functions, classes and filenames after that.
+pub fn clear_string_cache() {
+    STRING_CACHE.with(|cell| {
+        let mut cache = cell.borrow_mut();
+        cache.functions.clear();
+        cache.files.clear();
+    });
+}
+
 // todo: dedup
 unsafe fn zend_string_to_bytes(zstr: Option<&mut zend_string>) -> &[u8] {
     ddog_php_prof_zend_string_view(zstr).into_bytes()
@@ -59,12 +104,51 @@ unsafe fn extract_function_name(func: &zend_function) -> Option<String> {
     Some(String::from_utf8_lossy(buffer.as_slice()).into_owned())
 }
 
-unsafe fn extract_file_and_line(execute_data: &zend_execute_data) -> (Option<String>, u32) {
+/// Returns the cached name of the function, see [extract_function_name].
+unsafe fn cached_function_name(cache: &mut StringCache, func: &zend_function) -> Option<Arc<str>> {
+    let module = if func.type_ == ZEND_USER_FUNCTION as u8 {
+        0
+    } else {
+        func.internal_function.module as usize
+    };
+    let key = (
+        func.common.function_name as usize,
+        func.common.scope as usize,
+        module,
+    );
+
+    if let Some(name) = cache.functions.get(&key) {
+        return name.clone();
+    }
+
+    if cache.functions.len() >= STRING_CACHE_LIMIT {
+        cache.functions.clear();
+    }
+    let name = extract_function_name(func).map(Arc::from);
+    cache.functions.insert(key, name.clone());
+    name
+}
+
+unsafe fn extract_file_and_line(
+    cache: &mut StringCache,
+    execute_data: &zend_execute_data,
+) -> (Option<Arc<str>>, u32) {
     // This should be Some, just being cautious.
     match execute_data.func.as_ref() {
         Some(func) if func.type_ == ZEND_USER_FUNCTION as u8 => {
-            let bytes = zend_string_to_bytes(func.op_array.filename.as_mut());
-            let file = String::from_utf8_lossy(bytes).to_string();
+            let filename = func.op_array.filename;
+            let file = match cache.files.get(&(filename as usize)) {
+                Some(file) => file.clone(),
+                None => {
+                    if cache.files.len() >= STRING_CACHE_LIMIT {
+                        cache.files.clear();
+                    }
+                    let bytes = zend_string_to_bytes(filename.as_mut());
+                    let file: Arc<str> = Arc::from(String::from_utf8_lossy(bytes));
+                    cache.files.insert(filename as usize, file.clone());
+                    file
+                }
+            };
             let lineno = match execute_data.opline.as_ref() {
                 Some(opline) => opline.lineno,
                 None => 0,
@@ -75,15 +159,18 @@ unsafe fn extract_file_and_line(execute_data: &zend_execute_data) -> (Option<Str
     }
 }
 
-unsafe fn collect_call_frame(execute_data: &zend_execute_data) -> Option<ZendFrame> {
+unsafe fn collect_call_frame(
+    cache: &mut StringCache,
+    execute_data: &zend_execute_data,
+) -> Option<ZendFrame> {
     if let Some(func) = execute_data.func.as_ref() {
-        let function = extract_function_name(func);
-        let (file, line) = extract_file_and_line(execute_data);
+        let function = cached_function_name(cache, func);
+        let (file, line) = extract_file_and_line(cache, execute_data);
 
         // Only create a new frame if there's file or function info.
         if file.is_some() || function.is_some() {
             // If there's no function name, use a fake name.
-            let function = function.unwrap_or_else(|| "<?php".to_owned());
+            let function = function.unwrap_or_else(|| cache.php.clone());
             return Some(ZendFrame {
                 function,
                 file,
@@ -101,26 +188,29 @@ pub(super) unsafe fn collect_stack_sample(
     let mut samples = Vec::with_capacity(max_depth >> 3);
     let mut execute_data_ptr = top_execute_data;
 
-    while let Some(execute_data) = execute_data_ptr.as_ref() {
-        if let Some(frame) = collect_call_frame(execute_data) {
-            samples.push(frame);
-
-            /* -1 to reserve room for the [truncated] message. In case the
-             * backend and/or frontend have the same limit, without the -1
-             * then ironically the [truncated] message would be truncated.
-             */
-            if samples.len() == max_depth - 1 {
-                samples.push(ZendFrame {
-                    function: "[truncated]".to_string(),
-                    file: None,
-                    line: 0,
-                });
-                break;
+    STRING_CACHE.with(|cell| {
+        let cache = &mut *cell.borrow_mut();
+        while let Some(execute_data) = execute_data_ptr.as_ref() {
+            if let Some(frame) = collect_call_frame(cache, execute_data) {
+                samples.push(frame);
+
+                /* -1 to reserve room for the [truncated] message. In case the
+                 * backend and/or frontend have the same limit, without the -1
+                 * then ironically the [truncated] message would be truncated.
+                 */
+                if samples.len() == max_depth - 1 {
+                    samples.push(ZendFrame {
+                        function: cache.truncated.clone(),
+                        file: None,
+                        line: 0,
+                    });
+                    break;
+                }
             }
-        }
 
-        execute_data_ptr = execute_data.prev_execute_data;
-    }
+            execute_data_ptr = execute_data.prev_execute_data;
+        }
+    });
     Ok(samples)
 }
 
@@ -139,16 +229,16 @@ mod tests {
 
             assert_eq!(stack.len(), 3);
 
-            assert_eq!(stack[0].function, "function name 003");
-            assert_eq!(stack[0].file, Some("filename-003.php".to_string()));
+            assert_eq!(&*stack[0].function, "function name 003");
+            assert_eq!(stack[0].file.as_deref(), Some("filename-003.php"));
             assert_eq!(stack[0].line, 0);
 
-            assert_eq!(stack[1].function, "function name 002");
-            assert_eq!(stack[1].file, Some("filename-002.php".to_string()));
+            assert_eq!(&*stack[1].function, "function name 002");
+            assert_eq!(stack[1].file.as_deref(), Some("filename-002.php"));
             assert_eq!(stack[1].line, 0);
 
-            assert_eq!(stack[2].function, "function name 001");
-            assert_eq!(stack[2].file, Some("filename-001.php".to_string()));
+            assert_eq!(&*stack[2].function, "function name 001");
+            assert_eq!(stack[2].file.as_deref(), Some("filename-001.php"));
             assert_eq!(stack[2].line, 0);
 
             // Free the allocated memory
@@ -8,26 +8,8 @@ class DatabaseIntegrationHelper
 {
     public static function injectDatabaseIntegrationData(HookData $hook, $backend, $argNum = 0)
     {
-        $allowedBackends = [
-            "sqlsrv" => true,
-            "mysql" => true,
-            "pgsql" => true,
-            "mssql" => true, // part of dblib
-            "dblib" => true,
-            "odbc" => true,
-        ];
-
-        $propagationMode = dd_trace_env_config("DD_DBM_PROPAGATION_MODE");
-        if ($propagationMode != \DDTrace\DBM_PROPAGATION_DISABLED && isset($allowedBackends[$backend])) {
-            $fullPropagationBackends = [
-                "mysql" => true,
-                "pgsql" => true,
-            ];
-
-            if ($propagationMode == \DDTrace\DBM_PROPAGATION_FULL && !isset($fullPropagationBackends[$backend])) {
-                $propagationMode = \DDTrace\DBM_PROPAGATION_SERVICE;
-            }
-
+        $propagationMode = \DDTrace\Integrations\dbm_propagation_mode((string)$backend);
+        if ($propagationMode != \DDTrace\DBM_PROPAGATION_DISABLED) {
             $query = self::propagateViaSqlComments($hook->args[$argNum], $hook->span()->service, $propagationMode);
             $hook->args[$argNum] = $query;
             $hook->overrideArguments($hook->args);
@@ -35,48 +17,10 @@ class DatabaseIntegrationHelper
         }
     }
 
+    // Shares the native implementation used by the PDO hooks
     public static function propagateViaSqlComments($query, $databaseService, $mode = \DDTrace\DBM_PROPAGATION_FULL)
     {
-        $rootSpan = \DDTrace\root_span();
-
-        // Note: the order of the tags is relevant, they must be passed ordered alphabetically
-        $tags = [];
-
-        if ($databaseService != "") {
-            $tags["dddbs"] = $databaseService;
-        }
-
-        $env = $rootSpan->meta["env"] ?? "";
-        if ($env == "") {
-            $env = ini_get("datadog.env");
-        }
-        if ($env != "") {
-            $tags["dde"] = $env;
-        }
-
-        $service = $rootSpan->service ?? "";
-        if ($service == "") {
-            $service = ddtrace_config_app_name();
-        }
-        if ($service != "") {
-            $tags["ddps"] = $service;
-        }
-
-        $version = $rootSpan->meta["version"] ?? "";
-        if ($version == "") {
-            $version = ini_get("datadog.version");
-        }
-        if ($version != "") {
-            $tags["ddpv"] = $version;
-        }
-
-        if ($mode == \DDTrace\DBM_PROPAGATION_FULL) {
-            if ($headers = \DDTrace\generate_distributed_tracing_headers(["tracecontext"])) {
-                $tags["traceparent"] = $headers["traceparent"];
-            }
-        }
-
-        return self::injectSqlComment($query, $tags);
+        return \DDTrace\Integrations\propagate_via_sql_comments((string)$query, (string)$databaseService, $mode);
     }
 
     public static function injectSqlComment($query, array $tags)
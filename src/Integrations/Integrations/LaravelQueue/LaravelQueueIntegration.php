@@ -164,7 +164,8 @@ class LaravelQueueIntegration extends Integration
                 // Decode it, add the distributed tracing headers, re-encode it, return this one instead
                 $payload = $integration->injectContext(json_decode($hook->returned, true));
                 $hook->overrideReturnValue(json_encode($payload));
-            }
+            },
+            \DDTrace\HOOK_ARGS_BEGIN_ONLY
         );
 
         trace_method(
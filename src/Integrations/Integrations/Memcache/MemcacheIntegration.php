@@ -4,10 +4,10 @@ namespace DDTrace\Integrations\Memcache;
 
 use DDTrace\Integrations\Integration;
 use DDTrace\Obfuscation;
+use DDTrace\ObjectStore;
 use DDTrace\SpanData;
 use DDTrace\Tag;
 use DDTrace\Type;
-use DDTrace\Util\ObjectKVStore;
 
 /**
  * Tracing of the Memcache library.
@@ -66,8 +66,8 @@ class MemcacheIntegration extends Integration
 
         $memcache_addServer = function ($memcache, $scope, $args) {
             // We just care about the first server to add tags
-            if (count($args) > 1 && !ObjectKVStore::get($memcache, 'server')) {
-                ObjectKVStore::put($memcache, 'server', $args);
+            if (count($args) > 1 && !ObjectStore\get($memcache, 'server')) {
+                ObjectStore\put($memcache, 'server', $args);
             }
         };
         \DDTrace\hook_function('memcache_add_server', $this->wrapClosureForHookFunction($memcache_addServer));
@@ -161,7 +161,7 @@ class MemcacheIntegration extends Integration
      */
     public function setServerTags(SpanData $span, \Memcache $memcache)
     {
-        if ($server = ObjectKVStore::get($memcache, 'server')) {
+        if ($server = ObjectStore\get($memcache, 'server')) {
             list($span->meta[Tag::TARGET_HOST], $span->meta[Tag::TARGET_PORT]) = $server;
         }
     }
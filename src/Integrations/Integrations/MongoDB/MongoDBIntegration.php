@@ -3,10 +3,10 @@
 namespace DDTrace\Integrations\MongoDB;
 
 use DDTrace\Integrations\Integration;
+use DDTrace\ObjectStore;
 use DDTrace\SpanData;
 use DDTrace\Tag;
 use DDTrace\Type;
-use DDTrace\Util\ObjectKVStore;
 
 /**
  * Defines and register a subscriber. It is done in a function, rather than at a root of any PHP file, so the interface
@@ -277,7 +277,7 @@ class MongoDBIntegration extends Integration
             null,
             function ($self, $_2, $args, $_4) {
                 if (isset($args[0])) {
-                    ObjectKVStore::put($self, 'filter', $args[0]);
+                    ObjectStore\put($self, 'filter', $args[0]);
                 }
             }
         );
@@ -288,7 +288,7 @@ class MongoDBIntegration extends Integration
             null,
             function ($self, $_2, $args, $_4) {
                 if (isset($args[0])) {
-                    ObjectKVStore::put($self, 'cmd', $args[0]);
+                    ObjectStore\put($self, 'cmd', $args[0]);
                 }
             }
         );
@@ -299,9 +299,9 @@ class MongoDBIntegration extends Integration
             null,
             function ($self, $_2, $args, $_4) {
                 if (isset($args[0])) {
-                    $existingDeletes = ObjectKVStore::get($self, 'deletes', []);
+                    $existingDeletes = ObjectStore\get($self, 'deletes', []);
                     \array_push($existingDeletes, MongoDBIntegration::serializeQuery($args[0]));
-                    ObjectKVStore::put($self, 'deletes', $existingDeletes);
+                    ObjectStore\put($self, 'deletes', $existingDeletes);
                 }
             }
         );
@@ -312,9 +312,9 @@ class MongoDBIntegration extends Integration
             null,
             function ($self, $_2, $args, $_4) {
                 if (isset($args[0])) {
-                    $existingUpdates = ObjectKVStore::get($self, 'updates', []);
+                    $existingUpdates = ObjectStore\get($self, 'updates', []);
                     \array_push($existingUpdates, MongoDBIntegration::serializeQuery($args[0]));
-                    ObjectKVStore::put($self, 'updates', $existingUpdates);
+                    ObjectStore\put($self, 'updates', $existingUpdates);
                 }
             }
         );
@@ -324,8 +324,8 @@ class MongoDBIntegration extends Integration
             'insert',
             null,
             function ($self, $_2, $args, $_4) {
-                $existingInsertCount = ObjectKVStore::get($self, 'insertsCount', 0);
-                ObjectKVStore::put($self, 'insertsCount', $existingInsertCount + 1);
+                $existingInsertCount = ObjectStore\get($self, 'insertsCount', 0);
+                ObjectStore\put($self, 'insertsCount', $existingInsertCount + 1);
             }
         );
 
@@ -334,8 +334,8 @@ class MongoDBIntegration extends Integration
             'selectServer',
             null,
             function ($self, $_2, $_3, $server) {
-                ObjectKVStore::put($self, 'host', $server->getHost());
-                ObjectKVStore::put($self, 'port', $server->getPort());
+                ObjectStore\put($self, 'host', $server->getHost());
+                ObjectStore\put($self, 'port', $server->getPort());
             }
         );
 
@@ -362,8 +362,8 @@ class MongoDBIntegration extends Integration
                     $method,
                     $this->getDatabaseName(),
                     $this->getCollectionName(),
-                    ObjectKVStore::get($this->getManager(), 'host'),
-                    ObjectKVStore::get($this->getManager(), 'port'),
+                    ObjectStore\get($this->getManager(), 'host'),
+                    ObjectStore\get($this->getManager(), 'port'),
                     null,
                     empty($args[0]) ? null : $args[0]
                 );
@@ -390,8 +390,8 @@ class MongoDBIntegration extends Integration
                     $method,
                     $this->getDatabaseName(),
                     $this->getCollectionName(),
-                    ObjectKVStore::get($this->getManager(), 'host'),
-                    ObjectKVStore::get($this->getManager(), 'port'),
+                    ObjectStore\get($this->getManager(), 'host'),
+                    ObjectStore\get($this->getManager(), 'port'),
                     null,
                     null
                 );
@@ -421,7 +421,7 @@ class MongoDBIntegration extends Integration
                 null,
                 null,
                 null,
-                ObjectKVStore::get($args[1], 'filter', null)
+                ObjectStore\get($args[1], 'filter', null)
             );
         });
     }
@@ -452,17 +452,17 @@ class MongoDBIntegration extends Integration
             );
 
             if (isset($args[1])) {
-                $deletes = ObjectKVStore::get($args[1], 'deletes', []);
+                $deletes = ObjectStore\get($args[1], 'deletes', []);
                 for ($index = 0; $index < \count($deletes); $index++) {
                     $span->meta['mongodb.deletes.' . $index . '.filter'] = $deletes[$index];
                 }
 
-                $updates = ObjectKVStore::get($args[1], 'updates', []);
+                $updates = ObjectStore\get($args[1], 'updates', []);
                 for ($index = 0; $index < \count($updates); $index++) {
                     $span->meta['mongodb.updates.' . $index . '.filter'] = $updates[$index];
                 }
 
-                $insertsCount = ObjectKVStore::get($args[1], 'insertsCount', 0);
+                $insertsCount = ObjectStore\get($args[1], 'insertsCount', 0);
                 $span->meta['mongodb.insertsCount'] = $insertsCount;
             }
         });
@@ -490,7 +490,7 @@ class MongoDBIntegration extends Integration
             $commandName = 'unknown_command';
             if (
                 isset($args[1])
-                && ($command = ObjectKVStore::get($args[1], 'cmd'))
+                && ($command = ObjectStore\get($args[1], 'cmd'))
                 && (\is_array($command) || \is_object($command))
             ) {
                 $command = (array)$command;
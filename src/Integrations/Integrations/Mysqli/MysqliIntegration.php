@@ -5,10 +5,10 @@ namespace DDTrace\Integrations\Mysqli;
 use DDTrace\HookData;
 use DDTrace\Integrations\DatabaseIntegrationHelper;
 use DDTrace\Integrations\Integration;
+use DDTrace\ObjectStore;
 use DDTrace\SpanData;
 use DDTrace\Tag;
 use DDTrace\Type;
-use DDTrace\Util\ObjectKVStore;
 
 class MysqliIntegration extends Integration
 {
@@ -84,6 +84,8 @@ class MysqliIntegration extends Integration
         });
 
         if (PHP_MAJOR_VERSION > 5) {
+            // The end hooks get the arguments, with the DBM comment injected, from $hook->data instead of copying
+            // them again
             \DDTrace\install_hook('mysqli_query', function (HookData $hook) use ($integration) {
                 list(, $query) = $hook->args;
 
@@ -92,19 +94,20 @@ class MysqliIntegration extends Integration
                 $integration->addTraceAnalyticsIfEnabled($span);
 
                 DatabaseIntegrationHelper::injectDatabaseIntegrationData($hook, 'mysql', 1);
+                $hook->data = $hook->args;
             }, function (HookData $hook) use ($integration) {
-                list($mysqli, $query) = $hook->args;
+                list($mysqli, $query) = $hook->data;
                 $span = $hook->span();
                 $integration->setConnectionInfo($span, $mysqli);
 
                 MysqliCommon::storeQuery($mysqli, $query);
                 MysqliCommon::storeQuery($hook->returned, $query);
-                ObjectKVStore::put($hook->returned, 'host_info', MysqliCommon::extractHostInfo($mysqli));
+                ObjectStore\put($hook->returned, 'host_info', MysqliCommon::extractHostInfo($mysqli));
 
                 if (is_object($hook->returned) && property_exists($hook->returned, 'num_rows')) {
                     $span->metrics[Tag::DB_ROW_COUNT] = $hook->returned->num_rows;
                 }
-            });
+            }, \DDTrace\HOOK_ARGS_BEGIN_ONLY);
 
             \DDTrace\install_hook('mysqli_prepare', function (HookData $hook) use ($integration) {
                 list(, $query) = $hook->args;
@@ -113,19 +116,20 @@ class MysqliIntegration extends Integration
                 $integration->setDefaultAttributes($span, 'mysqli_prepare', $query);
 
                 DatabaseIntegrationHelper::injectDatabaseIntegrationData($hook, 'mysql', 1);
+                $hook->data = $hook->args;
             }, function (HookData $hook) use ($integration) {
-                list($mysqli, $query) = $hook->args;
+                list($mysqli, $query) = $hook->data;
                 $span = $hook->span();
                 $integration->setConnectionInfo($span, $mysqli);
 
                 $host_info = MysqliCommon::extractHostInfo($mysqli);
                 MysqliCommon::storeQuery($hook->returned, $query);
-                ObjectKVStore::put($hook->returned, 'host_info', $host_info);
+                ObjectStore\put($hook->returned, 'host_info', $host_info);
 
                 if (is_object($hook->returned) && property_exists($hook->returned, 'num_rows')) {
                     $span->metrics[Tag::DB_ROW_COUNT] = $hook->returned->num_rows;
                 }
-            });
+            }, \DDTrace\HOOK_ARGS_BEGIN_ONLY);
 
             \DDTrace\install_hook('mysqli::query', function (HookData $hook) use ($integration) {
                 list($query) = $hook->args;
@@ -135,20 +139,21 @@ class MysqliIntegration extends Integration
                 $integration->addTraceAnalyticsIfEnabled($span);
 
                 DatabaseIntegrationHelper::injectDatabaseIntegrationData($hook, 'mysql');
+                $hook->data = $hook->args;
             }, function (HookData $hook) use ($integration) {
-                list($query) = $hook->args;
+                list($query) = $hook->data;
                 $span = $hook->span();
                 $integration->setConnectionInfo($span, $this);
 
                 MysqliCommon::storeQuery($this, $query);
                 MysqliCommon::storeQuery($hook->returned, $query);
-                ObjectKVStore::put($hook->returned, 'host_info', MysqliCommon::extractHostInfo($this));
-                ObjectKVStore::put($hook->returned, 'query', $query);
+                ObjectStore\put($hook->returned, 'host_info', MysqliCommon::extractHostInfo($this));
+                ObjectStore\put($hook->returned, 'query', $query);
 
                 if (is_object($hook->returned) && property_exists($hook->returned, 'num_rows')) {
                     $span->metrics[Tag::DB_ROW_COUNT] = $hook->returned->num_rows;
                 }
-            });
+            }, \DDTrace\HOOK_ARGS_BEGIN_ONLY);
 
             \DDTrace\install_hook('mysqli::prepare', function (HookData $hook) use ($integration) {
                 list($query) = $hook->args;
@@ -157,19 +162,20 @@ class MysqliIntegration extends Integration
                 $integration->setDefaultAttributes($span, 'mysqli.prepare', $query);
 
                 DatabaseIntegrationHelper::injectDatabaseIntegrationData($hook, 'mysql');
+                $hook->data = $hook->args;
             }, function (HookData $hook) use ($integration) {
-                list($query) = $hook->args;
+                list($query) = $hook->data;
                 $span = $hook->span();
                 $integration->setConnectionInfo($span, $this);
 
                 $host_info = MysqliCommon::extractHostInfo($this);
                 MysqliCommon::storeQuery($hook->returned, $query);
-                ObjectKVStore::put($hook->returned, 'host_info', $host_info);
+                ObjectStore\put($hook->returned, 'host_info', $host_info);
 
                 if (is_object($hook->returned) && property_exists($hook->returned, 'num_rows')) {
                     $span->metrics[Tag::DB_ROW_COUNT] = $hook->returned->num_rows;
                 }
-            });
+            }, \DDTrace\HOOK_ARGS_BEGIN_ONLY);
 
             if (PHP_VERSION_ID >= 80200) {
                 \DDTrace\install_hook('mysqli_execute_query', function (HookData $hook) use ($integration) {
@@ -180,20 +186,21 @@ class MysqliIntegration extends Integration
                     $integration->addTraceAnalyticsIfEnabled($span);
 
                     DatabaseIntegrationHelper::injectDatabaseIntegrationData($hook, 'mysql', 1);
+                    $hook->data = $hook->args;
                 }, function (HookData $hook) use ($integration) {
-                    list($mysqli, $query) = $hook->args;
+                    list($mysqli, $query) = $hook->data;
                     $span = $hook->span();
                     $integration->setConnectionInfo($span, $mysqli);
 
                     MysqliCommon::storeQuery($mysqli, $query);
                     MysqliCommon::storeQuery($hook->returned, $query);
-                    ObjectKVStore::put($hook->returned, 'host_info', MysqliCommon::extractHostInfo($mysqli));
-                    ObjectKVStore::put($hook->returned, 'query', $query);
+                    ObjectStore\put($hook->returned, 'host_info', MysqliCommon::extractHostInfo($mysqli));
+                    ObjectStore\put($hook->returned, 'query', $query);
 
                     if (is_object($hook->returned) && property_exists($hook->returned, 'num_rows')) {
                         $span->metrics[Tag::DB_ROW_COUNT] = $hook->returned->num_rows;
                     }
-                });
+                }, \DDTrace\HOOK_ARGS_BEGIN_ONLY);
 
                 \DDTrace\install_hook('mysqli::execute_query', function (HookData $hook) use ($integration) {
                     list($query) = $hook->args;
@@ -203,20 +210,21 @@ class MysqliIntegration extends Integration
                     $integration->addTraceAnalyticsIfEnabled($span);
 
                     DatabaseIntegrationHelper::injectDatabaseIntegrationData($hook, 'mysql');
+                    $hook->data = $hook->args;
                 }, function (HookData $hook) use ($integration) {
-                    list($query) = $hook->args;
+                    list($query) = $hook->data;
                     $span = $hook->span();
                     $integration->setConnectionInfo($span, $this);
 
                     MysqliCommon::storeQuery($this, $query);
                     MysqliCommon::storeQuery($hook->returned, $query);
-                    ObjectKVStore::put($hook->returned, 'host_info', MysqliCommon::extractHostInfo($this));
-                    ObjectKVStore::put($hook->returned, 'query', $query);
+                    ObjectStore\put($hook->returned, 'host_info', MysqliCommon::extractHostInfo($this));
+                    ObjectStore\put($hook->returned, 'query', $query);
 
                     if (is_object($hook->returned) && property_exists($hook->returned, 'num_rows')) {
                         $span->metrics[Tag::DB_ROW_COUNT] = $hook->returned->num_rows;
                     }
-                });
+                }, \DDTrace\HOOK_ARGS_BEGIN_ONLY);
             }
         } else {
             \DDTrace\trace_function('mysqli_query', function (SpanData $span, $args, $result) use ($integration) {
@@ -227,7 +235,7 @@ class MysqliIntegration extends Integration
 
                 MysqliCommon::storeQuery($mysqli, $query);
                 MysqliCommon::storeQuery($result, $query);
-                ObjectKVStore::put($result, 'host_info', MysqliCommon::extractHostInfo($mysqli));
+                ObjectStore\put($result, 'host_info', MysqliCommon::extractHostInfo($mysqli));
             });
 
             \DDTrace\trace_function('mysqli_prepare', function (SpanData $span, $args, $retval) use ($integration) {
@@ -237,7 +245,7 @@ class MysqliIntegration extends Integration
 
                 $host_info = MysqliCommon::extractHostInfo($mysqli);
                 MysqliCommon::storeQuery($retval, $query);
-                ObjectKVStore::put($retval, 'host_info', $host_info);
+                ObjectStore\put($retval, 'host_info', $host_info);
             });
 
             \DDTrace\trace_method('mysqli', 'query', function (SpanData $span, $args, $result) use ($integration) {
@@ -246,10 +254,10 @@ class MysqliIntegration extends Integration
                 $integration->addTraceAnalyticsIfEnabled($span);
                 $integration->setConnectionInfo($span, $this);
                 MysqliCommon::storeQuery($this, $query);
-                ObjectKVStore::put($result, 'query', $query);
+                ObjectStore\put($result, 'query', $query);
                 $host_info = MysqliCommon::extractHostInfo($this);
-                ObjectKVStore::put($result, 'host_info', $host_info);
-                ObjectKVStore::put($result, 'query', $query);
+                ObjectStore\put($result, 'host_info', $host_info);
+                ObjectStore\put($result, 'query', $query);
             });
 
             \DDTrace\trace_method('mysqli', 'prepare', function (SpanData $span, $args, $retval) use ($integration) {
@@ -257,7 +265,7 @@ class MysqliIntegration extends Integration
                 $integration->setDefaultAttributes($span, 'mysqli.prepare', $query);
                 $integration->setConnectionInfo($span, $this);
                 $host_info = MysqliCommon::extractHostInfo($this);
-                ObjectKVStore::put($retval, 'host_info', $host_info);
+                ObjectStore\put($retval, 'host_info', $host_info);
                 MysqliCommon::storeQuery($retval, $query);
             });
         }
@@ -283,7 +291,7 @@ class MysqliIntegration extends Integration
             list($statement) = $args;
             $resource = MysqliCommon::retrieveQuery($statement, 'mysqli_stmt_get_result');
             MysqliCommon::storeQuery($result, $resource);
-            ObjectKVStore::propagate($statement, $result, 'host_info');
+            ObjectStore\propagate($statement, $result, 'host_info');
 
             return false;
         });
@@ -309,8 +317,8 @@ class MysqliIntegration extends Integration
             $integration->setDefaultAttributes($span, 'mysqli_stmt.get_result', $resource, $result);
             $integration->setConnectionInfo($span, $this);
 
-            ObjectKVStore::propagate($this, $result, 'host_info');
-            ObjectKVStore::put($result, 'query', $resource);
+            ObjectStore\propagate($this, $result, 'host_info');
+            ObjectStore\put($result, 'query', $resource);
         });
 
         return Integration::LOADED;
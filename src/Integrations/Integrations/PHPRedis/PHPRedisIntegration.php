@@ -3,10 +3,10 @@
 namespace DDTrace\Integrations\PHPRedis;
 
 use DDTrace\Integrations\Integration;
+use DDTrace\ObjectStore;
 use DDTrace\SpanData;
 use DDTrace\Tag;
 use DDTrace\Type;
-use DDTrace\Util\ObjectKVStore;
 
 class PHPRedisIntegration extends Integration
 {
@@ -53,7 +53,7 @@ class PHPRedisIntegration extends Integration
             //   - in case of connection error, the Redis::host value is not set and we would not have access to it
             //     during callbacks, meaning that we would have to use two different ways to extract the name: args or
             //     Redis::getHost() depending on when we are interested in such information.
-            ObjectKVStore::put($this, 'service', $serviceName);
+            ObjectStore\put($this, 'service', $serviceName);
 
             PHPRedisIntegration::enrichSpan($span, $this, 'Redis');
         };
@@ -94,7 +94,7 @@ class PHPRedisIntegration extends Integration
                 $serviceName = 'redis-' . \DDTrace\Util\Normalizer::normalizeHostUdsAsService($clusterName);
             }
 
-            ObjectKVStore::put($this, 'service', $serviceName);
+            ObjectStore\put($this, 'service', $serviceName);
 
             PHPRedisIntegration::enrichSpan($span, $this, 'RedisCluster');
         };
@@ -316,7 +316,7 @@ class PHPRedisIntegration extends Integration
 
     public static function enrichSpan(SpanData $span, $instance, $class, $method = null)
     {
-        $span->service = ObjectKVStore::get($instance, 'service', 'phpredis');
+        $span->service = ObjectStore\get($instance, 'service', 'phpredis');
         $span->type = Type::REDIS;
         $span->meta[Tag::SPAN_KIND] = 'client';
         $span->meta[Tag::COMPONENT] = PHPRedisIntegration::NAME;
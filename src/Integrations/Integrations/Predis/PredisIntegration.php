@@ -3,10 +3,10 @@
 namespace DDTrace\Integrations\Predis;
 
 use DDTrace\Integrations\Integration;
+use DDTrace\ObjectStore;
 use DDTrace\SpanData;
 use DDTrace\Tag;
 use DDTrace\Type;
-use DDTrace\Util\ObjectKVStore;
 use DDTrace\Util\Versions;
 use Predis\Configuration\OptionsInterface;
 use Predis\Connection\NodeConnectionInterface;
@@ -171,8 +171,8 @@ class PredisIntegration extends Integration
             }
         }
 
-        ObjectKVStore::put($predis, 'service', $service);
-        ObjectKVStore::put($predis, 'connection_meta', $tags);
+        ObjectStore\put($predis, 'service', $service);
+        ObjectStore\put($predis, 'connection_meta', $tags);
     }
 
     /**
@@ -185,12 +185,12 @@ class PredisIntegration extends Integration
      */
     public static function setMetaAndServiceFromConnection($predis, SpanData $span)
     {
-        $span->service = ObjectKVStore::get($predis, 'service', PredisIntegration::DEFAULT_SERVICE_NAME);
+        $span->service = ObjectStore\get($predis, 'service', PredisIntegration::DEFAULT_SERVICE_NAME);
         $span->meta[Tag::SPAN_KIND] = 'client';
         $span->meta[Tag::COMPONENT] = PredisIntegration::NAME;
         $span->meta[Tag::DB_SYSTEM] = PredisIntegration::SYSTEM;
 
-        foreach (ObjectKVStore::get($predis, 'connection_meta', []) as $tag => $value) {
+        foreach (ObjectStore\get($predis, 'connection_meta', []) as $tag => $value) {
             $span->meta[$tag] = $value;
         }
     }
@@ -5,10 +5,10 @@ namespace DDTrace\Integrations\SQLSRV;
 use DDTrace\HookData;
 use DDTrace\Integrations\DatabaseIntegrationHelper;
 use DDTrace\Integrations\Integration;
+use DDTrace\ObjectStore;
 use DDTrace\SpanData;
 use DDTrace\Tag;
 use DDTrace\Type;
-use DDTrace\Util\ObjectKVStore;
 
 use function DDTrace\install_hook;
 
@@ -43,7 +43,7 @@ class SQLSRVIntegration extends Integration
         // sqlsrv_connect ( string $serverName [, array $connectionInfo] ) : resource
         \DDTrace\trace_function('sqlsrv_connect', function (SpanData $span, $args, $retval) use ($integration) {
             $connectionMetadata = $integration->extractConnectionMetadata($args);
-            ObjectKVStore::put($this, SQLSRVIntegration::CONNECTION_TAGS_KEY, $connectionMetadata);
+            ObjectStore\put($this, SQLSRVIntegration::CONNECTION_TAGS_KEY, $connectionMetadata);
             self::setDefaultAttributes($connectionMetadata, $span, 'sqlsrv_connect');
 
             $integration->detectError($retval, $span);
@@ -58,25 +58,25 @@ class SQLSRVIntegration extends Integration
                 self::setDefaultAttributes($this, $span, 'sqlsrv_query', $query);
                 $integration->addTraceAnalyticsIfEnabled($span);
 
-                ObjectKVStore::put($this, SQLSRVIntegration::QUERY_TAGS_KEY, $query);
+                ObjectStore\put($this, SQLSRVIntegration::QUERY_TAGS_KEY, $query);
 
                 DatabaseIntegrationHelper::injectDatabaseIntegrationData($hook, 'sqlsrv', 1);
             }, function (HookData $hook) use ($integration) {
                 $span = $hook->span();
                 if (is_object($hook->returned)) {
-                    ObjectKVStore::propagate($this, $hook->returned, SQLSRVIntegration::CONNECTION_TAGS_KEY);
+                    ObjectStore\propagate($this, $hook->returned, SQLSRVIntegration::CONNECTION_TAGS_KEY);
                 }
 
                 $result = $hook->returned;
                 $this->setMetrics($span, $result);
                 $integration->detectError($result, $span);
-            });
+            }, \DDTrace\HOOK_ARGS_BEGIN_ONLY);
 
             // sqlsrv_prepare ( resource $conn , string $query [, array $params [, array $options ]] ) : resource
             \DDTrace\install_hook('sqlsrv_prepare', function (HookData $hook) use ($integration) {
                 list(, $query) = $hook->args;
 
-                ObjectKVStore::put($this, SQLSRVIntegration::QUERY_TAGS_KEY, $query);
+                ObjectStore\put($this, SQLSRVIntegration::QUERY_TAGS_KEY, $query);
 
                 $span = $hook->span();
                 self::setDefaultAttributes($this, $span, 'sqlsrv_prepare', $query);
@@ -85,11 +85,11 @@ class SQLSRVIntegration extends Integration
             }, function (HookData $hook) use ($integration) {
                 $span = $hook->span();
                 if (is_object($hook->returned)) {
-                    ObjectKVStore::propagate($this, $hook->returned, SQLSRVIntegration::CONNECTION_TAGS_KEY);
+                    ObjectStore\propagate($this, $hook->returned, SQLSRVIntegration::CONNECTION_TAGS_KEY);
                 }
 
                 $integration->detectError($hook->returned, $span);
-            });
+            }, \DDTrace\HOOK_ARGS_BEGIN_ONLY);
         } else {
             // sqlsrv_query ( resource $conn , string $query [, array $params [, array $options ]] ) : resource
             \DDTrace\trace_function('sqlsrv_query', function (SpanData $span, $args, $retval) use ($integration) {
@@ -99,7 +99,7 @@ class SQLSRVIntegration extends Integration
                 $query = $args[1];
                 self::setDefaultAttributes($this, $span, 'sqlsrv_query', $query, $retval);
                 $integration->addTraceAnalyticsIfEnabled($span);
-                ObjectKVStore::put($this, SQLSRVIntegration::QUERY_TAGS_KEY, $query);
+                ObjectStore\put($this, SQLSRVIntegration::QUERY_TAGS_KEY, $query);
 
                 $this->setMetrics($span, $retval);
 
@@ -111,7 +111,7 @@ class SQLSRVIntegration extends Integration
                 /** @var string $query */
                 $query = $args[1];
                 self::setDefaultAttributes($this, $span, 'sqlsrv_prepare', $query, $retval);
-                ObjectKVStore::put($this, SQLSRVIntegration::QUERY_TAGS_KEY, $query);
+                ObjectStore\put($this, SQLSRVIntegration::QUERY_TAGS_KEY, $query);
 
                 $integration->detectError($retval, $span);
             });
@@ -126,7 +126,7 @@ class SQLSRVIntegration extends Integration
 
         // sqlsrv_execute ( resource $stmt ) : bool
         \DDTrace\trace_function('sqlsrv_execute', function (SpanData $span, $args, $retval) use ($integration) {
-            $query = ObjectKVStore::get($this, SQLSRVIntegration::QUERY_TAGS_KEY);
+            $query = ObjectStore\get($this, SQLSRVIntegration::QUERY_TAGS_KEY);
             self::setDefaultAttributes($this, $span, 'sqlsrv_execute', $query, $retval);
             $integration->addTraceAnalyticsIfEnabled($span);
             if ($retval) {
@@ -187,7 +187,7 @@ class SQLSRVIntegration extends Integration
         if (is_array($source)) {
             $storedConnectionInfo = $source;
         } else {
-            $storedConnectionInfo = ObjectKVStore::get($source, SQLSRVIntegration::CONNECTION_TAGS_KEY, []);
+            $storedConnectionInfo = ObjectStore\get($source, SQLSRVIntegration::CONNECTION_TAGS_KEY, []);
         }
 
         if (!is_array($storedConnectionInfo)) {
@@ -206,9 +206,7 @@ class SQLSRVIntegration extends Integration
             $span->meta[Tag::DB_STMT] = $query;
         }
 
-        foreach ($storedConnectionInfo as $tag => $value) {
-            $span->meta[$tag] = $value;
-        }
+        \DDTrace\Integrations\add_span_meta($span, $storedConnectionInfo);
     }
 
     public static function detectError($SQLSRVRetval, SpanData $span)
@@ -273,32 +273,13 @@ class Normalizer
             return "";
         }
 
-        $allowedSet = self::decodeConfigSet($allowedSetting);
-
-        if (empty($allowedSet)) {
-            return "";
-        }
-
-        if ($allowedSet == ["*"]) {
-            $obfuscationRegex = \ini_get('datadog.trace.obfuscation_query_string_regexp');
-            if ($obfuscationRegex !== "") {
-                $obfuscationRegex = '(' . $obfuscationRegex . ')';
-                $queryString = preg_replace($obfuscationRegex, '<redacted>', $queryString);
-            }
-
-            return "?$queryString";
-        }
-
-        $allowedSet = array_flip($allowedSet);
-        $preserve = array_filter(explode('&', $queryString), function ($part) use ($allowedSet) {
-            return isset($allowedSet[explode('=', $part)[0]]);
-        });
-
-        if (empty($preserve)) {
-            return "";
-        }
+        // The allowed parameters and the obfuscation regex are compiled once by the extension
+        $queryString = \DDTrace\Integrations\filter_query_string(
+            $queryString,
+            $allowedSetting === "datadog.trace.resource_uri_query_param_allowed"
+        );
 
-        return '?' . implode('&', $preserve);
+        return $queryString === "" ? "" : "?$queryString";
     }
 
     /**
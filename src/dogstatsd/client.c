@@ -39,6 +39,15 @@ int dogstatsd_client_getaddrinfo(struct addrinfo **result, const char *host,
   return getaddrinfo(host, port, &hints, result);
 }
 
+static void dogstatsd_client_free_addresslist(struct addrinfo *addrs) {
+  if (addrs->ai_family == PF_UNIX) {
+    free(addrs->ai_addr);
+    free(addrs);
+  } else {
+    freeaddrinfo(addrs);
+  }
+}
+
 dogstatsd_client dogstatsd_client_ctor(struct addrinfo *addrs, int buffer_len,
                                        const char *const_tags) {
   dogstatsd_client client = dogstatsd_client_default_ctor();
@@ -46,41 +55,37 @@ dogstatsd_client dogstatsd_client_ctor(struct addrinfo *addrs, int buffer_len,
   if (!addrs) {
     return client;
   }
-  client.addresslist = addrs;
 
   struct addrinfo *addr = NULL;
-  if (buffer_len < 0) {
+  if (buffer_len <= 0) {
+    dogstatsd_client_free_addresslist(addrs);
     return client;
   }
 
   /* loop over all returned results and do inverse lookup */
-  for (addr = client.addresslist; addr != NULL; addr = addr->ai_next) {
+  for (addr = addrs; addr != NULL; addr = addr->ai_next) {
     if ((client.socket = socket(addr->ai_family, addr->ai_socktype,
                                 addr->ai_protocol)) != -1) {
       break;
     }
   }
 
-  if (addr->ai_family == PF_UNIX) {
-    if (!connect(client.socket, addr->ai_addr, addr->ai_addrlen)) {
-      free(addr->ai_addr);
-      free(client.addresslist);
-      client.addresslist = NULL;
-      close(client.socket);
-      client.socket = -1;
-      return client;
-    }
+  if (!addr) {
+    dogstatsd_client_free_addresslist(addrs);
+    return client;
   }
 
   if (!const_tags) {
     const_tags = "";
   }
 
+  client.addresslist = addrs;
   client.const_tags = const_tags;
   client.const_tags_len = strlen(const_tags);
   client.address = addr;
   client.msg_buffer = malloc(buffer_len);
   client.msg_buffer_len = buffer_len;
+  client.msg_len = 0;
 
   return client;
 }
@@ -91,85 +96,180 @@ void dogstatsd_client_dtor(dogstatsd_client *client) {
   }
   if (client->msg_buffer) {
     free(client->msg_buffer);
+    client->msg_buffer = NULL;
   }
+  client->msg_len = 0;
   if (client->socket != -1) {
     close(client->socket);
     client->socket = -1;
   }
   if (client->addresslist) {
-    if (client->address->ai_family == PF_UNIX) {
-      free(client->address->ai_addr);
-      free(client->addresslist);
-    } else {
-      freeaddrinfo(client->addresslist);
-    }
+    dogstatsd_client_free_addresslist(client->addresslist);
     client->addresslist = NULL;
   }
 }
 
-/* allowed metric types: c, g, ms, h, and s.
- * sample_rate must be between 0.0 and 1.0 (inclusive); if you are unsure then
- * specify 1.0.
- */
-dogstatsd_client_status dogstatsd_client_metric_send(
-    dogstatsd_client *client, const char *name, const char *value,
-    dogstatsd_metric_t type, double sample_rate, const char *tags) {
+dogstatsd_client_status dogstatsd_client_flush(dogstatsd_client *client) {
   if (dogstatsd_client_is_default_client(*client)) {
     return DOGSTATSD_CLIENT_E_NO_CLIENT;
   }
 
-  const char *typestr = dogstatsd_metric_type_to_str(type);
-  if (!name || !value || !typestr || sample_rate < 0.0 || sample_rate > 1.0) {
-    return DOGSTATSD_CLIENT_E_VALUE;
+  if (!client->msg_len) {
+    return DOGSTATSD_CLIENT_OK;
   }
 
+  ssize_t send_status =
+      sendto(client->socket, client->msg_buffer, client->msg_len, MSG_DONTWAIT,
+             client->address->ai_addr, client->address->ai_addrlen);
+
+  // The metrics are dropped on failure, like unbuffered ones would be.
+  client->msg_len = 0;
+
+  if (send_status > -1) {
+    return DOGSTATSD_CLIENT_OK;
+  }
+
+  return DOGSTATSD_CLIENT_EWRITE;
+}
+
+/* Formats the metric into the given buffer, returning the size of the
+ * formatted metric or a negative value on failure.
+ */
+static int dogstatsd_client_format(dogstatsd_client *client, char *buffer,
+                                   size_t buffer_len, const char *name,
+                                   const char *value, const char *typestr,
+                                   double sample_rate, const char *tags) {
   /* We need to concatenate all the strings together (without spaces, they
    * are there just to show how the format maps):
    *     metric : value | type |@ sample_rate |# tags ,  const_tags
    *     %s     : %s    | %s   |@ %f          %s %s   %s %s
    */
 
-  if (!tags) {
-    tags = "";
-  }
-
   size_t tags_len = strlen(tags);
   size_t const_tags_len = client->const_tags_len;
   const char *tags_prefix = (tags_len + const_tags_len > 0) ? "|#" : "";
   const char *tags_separator = (tags_len > 0 && const_tags_len > 0) ? "," : "";
 
-  const char *format;
-  int size;
   /* Omit the sample rate iff it is 1.0; a sample rate of 1.000000 causes issues
    * for the agent, for some reason
    */
   if (sample_rate != 1.0) {
-    format = "%s:%s|%s|@%.6f%s%s%s%s";
-    size = snprintf(client->msg_buffer, client->msg_buffer_len, format, name,
-                    value, typestr, sample_rate, tags_prefix, tags,
-                    tags_separator, client->const_tags);
-  } else {
-    format = "%s:%s|%s%s%s%s%s";
-    size = snprintf(client->msg_buffer, client->msg_buffer_len, format, name,
-                    value, typestr, tags_prefix, tags, tags_separator,
+    return snprintf(buffer, buffer_len, "%s:%s|%s|@%.6f%s%s%s%s", name, value,
+                    typestr, sample_rate, tags_prefix, tags, tags_separator,
                     client->const_tags);
   }
+  return snprintf(buffer, buffer_len, "%s:%s|%s%s%s%s%s", name, value, typestr,
+                  tags_prefix, tags, tags_separator, client->const_tags);
+}
+
+/* allowed metric types: c, g, ms, h, and s.
+ * sample_rate must be between 0.0 and 1.0 (inclusive); if you are unsure then
+ * specify 1.0.
+ */
+static dogstatsd_client_status dogstatsd_client_check_metric(
+    dogstatsd_client *client, const char *name, const char *value,
+    const char *typestr, double sample_rate) {
+  if (dogstatsd_client_is_default_client(*client)) {
+    return DOGSTATSD_CLIENT_E_NO_CLIENT;
+  }
+
+  if (!name || !value || !typestr || sample_rate < 0.0 || sample_rate > 1.0) {
+    return DOGSTATSD_CLIENT_E_VALUE;
+  }
 
+  return DOGSTATSD_CLIENT_OK;
+}
+
+dogstatsd_client_status dogstatsd_client_metric_buffer(
+    dogstatsd_client *client, const char *name, const char *value,
+    dogstatsd_metric_t type, double sample_rate, const char *tags) {
+  const char *typestr = dogstatsd_metric_type_to_str(type);
+  dogstatsd_client_status status =
+      dogstatsd_client_check_metric(client, name, value, typestr, sample_rate);
+  if (status != DOGSTATSD_CLIENT_OK) {
+    return status;
+  }
+
+  if (!tags) {
+    tags = "";
+  }
+
+  /* Metrics in the same datagram are separated by a newline, which is only
+   * written once the metric is known to fit, so that a truncated metric does
+   * not corrupt the buffered ones.
+   */
+  int offset = client->msg_len ? client->msg_len + 1 : 0;
+  int size = dogstatsd_client_format(
+      client, client->msg_buffer + offset, client->msg_buffer_len - offset,
+      name, value, typestr, sample_rate, tags);
   if (size < 0) {
     return DOGSTATSD_CLIENT_E_FORMATTING;
   }
 
-  /* snprintf does not report the null byte in the length, so if it is size or
-   * more then it is an error
+  /* snprintf does not report the null byte in the length, so if it is the
+   * remaining space or more then it did not fit
    */
-  if (size >= client->msg_buffer_len) {
+  if (offset && size >= client->msg_buffer_len - offset) {
+    status = dogstatsd_client_flush(client);
+    if (status != DOGSTATSD_CLIENT_OK) {
+      return status;
+    }
+
+    offset = 0;
+    size = dogstatsd_client_format(client, client->msg_buffer,
+                                   client->msg_buffer_len, name, value,
+                                   typestr, sample_rate, tags);
+    if (size < 0) {
+      return DOGSTATSD_CLIENT_E_FORMATTING;
+    }
+  }
+
+  if (size >= client->msg_buffer_len - offset) {
+    return DOGSTATSD_CLIENT_E_TOO_LONG;
+  }
+
+  if (offset) {
+    client->msg_buffer[offset - 1] = '\n';
+  }
+  client->msg_len = offset + size;
+
+  return DOGSTATSD_CLIENT_OK;
+}
+
+dogstatsd_client_status dogstatsd_client_metric_send(
+    dogstatsd_client *client, const char *name, const char *value,
+    dogstatsd_metric_t type, double sample_rate, const char *tags) {
+  const char *typestr = dogstatsd_metric_type_to_str(type);
+  dogstatsd_client_status status =
+      dogstatsd_client_check_metric(client, name, value, typestr, sample_rate);
+  if (status != DOGSTATSD_CLIENT_OK) {
+    return status;
+  }
+
+  if (!tags) {
+    tags = "";
+  }
+
+  /* The metric is formatted on the stack and the buffered metrics are left
+   * alone: this is called from signal handlers, which may have interrupted
+   * dogstatsd_client_metric_buffer in the middle of writing the buffer.
+   */
+  char buffer[DOGSTATSD_CLIENT_RECOMMENDED_MAX_MESSAGE_SIZE];
+  int buffer_len = client->msg_buffer_len < (int)sizeof buffer
+                       ? client->msg_buffer_len
+                       : (int)sizeof buffer;
+  int size = dogstatsd_client_format(client, buffer, buffer_len, name, value,
+                                     typestr, sample_rate, tags);
+  if (size < 0) {
+    return DOGSTATSD_CLIENT_E_FORMATTING;
+  }
+  if (size >= buffer_len) {
     return DOGSTATSD_CLIENT_E_TOO_LONG;
   }
 
   ssize_t send_status =
-      sendto(client->socket, client->msg_buffer, size, MSG_DONTWAIT,
+      sendto(client->socket, buffer, size, MSG_DONTWAIT,
              client->address->ai_addr, client->address->ai_addrlen);
-
   if (send_status > -1) {
     return DOGSTATSD_CLIENT_OK;
   }
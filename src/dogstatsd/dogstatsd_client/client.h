@@ -20,8 +20,9 @@ struct dogstatsd_client {
   int socket;                    // closed on dtor
   struct addrinfo *address;      // freed on dtor as part of addresslist
   struct addrinfo *addresslist;  // freed on dtor
-  char *msg_buffer;              // NOT freed on dtor
+  char *msg_buffer;              // freed on dtor
   int msg_buffer_len;
+  int msg_len;  // bytes of buffered metrics which were not sent yet
   const char *const_tags;  // NOT freed on dtor
   size_t const_tags_len;
 };
@@ -78,6 +79,11 @@ inline const char *dogstatsd_client_status_to_str(
  */
 #define DOGSTATSD_CLIENT_RECOMMENDED_MAX_MESSAGE_SIZE 1024
 
+/* Unix domain sockets are not subject to the MTU, and the agent reads
+ * datagrams of up to 8192 bytes by default (dogstatsd_buffer_size).
+ */
+#define DOGSTATSD_CLIENT_RECOMMENDED_UDS_MAX_MESSAGE_SIZE 8192
+
 enum dogstatsd_metric_t {
   DOGSTATSD_METRIC_COUNT,
   DOGSTATSD_METRIC_GAUGE,
@@ -101,7 +107,7 @@ inline const char *dogstatsd_metric_type_to_str(dogstatsd_metric_t type) {
 
 // Creates a client whose operations will fail with E_NO_CLIENT
 inline dogstatsd_client dogstatsd_client_default_ctor() {
-  dogstatsd_client client = {-1, NULL, NULL, NULL, 0, NULL, 0};
+  dogstatsd_client client = {-1, NULL, NULL, NULL, 0, 0, NULL, 0};
   return client;
 }
 
@@ -117,18 +123,34 @@ void dogstatsd_client_dtor(dogstatsd_client *client);
 int dogstatsd_client_getaddrinfo(struct addrinfo **result, const char *host,
                                  const char *port);
 
-/* If the client fails to open a socket, it will create a default client. */
+/* If the client fails to open a socket, it will create a default client.
+ * Unix domain socket addresses must be of type SOCK_DGRAM.
+ */
 dogstatsd_client dogstatsd_client_ctor(struct addrinfo *addrs, int buffer_len,
                                        const char *const_tags);
 
 /* Most generic way to send a metric. If the input is malformed the metric will
  * not be sent, and an error code will be returned.
  * The sample_rate must be between 0.0 and 1.0 inclusive.
+ * The metric is sent on its own, without touching the buffered metrics, so it
+ * is safe to call from a signal handler.
  */
 dogstatsd_client_status dogstatsd_client_metric_send(
     dogstatsd_client *client, const char *metric, const char *value,
     dogstatsd_metric_t type, double sample_rate, const char *tags);
 
+/* Like dogstatsd_client_metric_send, but only appends the metric to the
+ * client's buffer, so that multiple metrics are sent in a single datagram.
+ * The buffered metrics are sent first if the metric does not fit anymore.
+ * Call dogstatsd_client_flush to send the remaining buffered metrics.
+ */
+dogstatsd_client_status dogstatsd_client_metric_buffer(
+    dogstatsd_client *client, const char *metric, const char *value,
+    dogstatsd_metric_t type, double sample_rate, const char *tags);
+
+/* Sends the buffered metrics, if any. */
+dogstatsd_client_status dogstatsd_client_flush(dogstatsd_client *client);
+
 inline dogstatsd_client_status dogstatsd_client_count(dogstatsd_client *client,
                                                       const char *metric,
                                                       const char *value,
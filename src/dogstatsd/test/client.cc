@@ -34,7 +34,8 @@ dogstatsd_server dogstatsd_server_make() {
 
 void dogstatsd_server_listen(dogstatsd_server *server, dogstatsd_client *client,
                              const char *expected_string) {
-  socklen_t client_addr_size = sizeof(struct addrinfo);
+  struct sockaddr_storage client_addr;
+  socklen_t client_addr_size = sizeof client_addr;
   // 60 bytes for the IP header
   // 8 bytes for the UDP overhead
   int buffer_len = client->msg_buffer_len + 60 + 8;
@@ -42,7 +43,7 @@ void dogstatsd_server_listen(dogstatsd_server *server, dogstatsd_client *client,
 
   ssize_t bytes_received =
       recvfrom(server->sock, buffer, buffer_len, 0,
-               (struct sockaddr *)&client->address, &client_addr_size);
+               (struct sockaddr *)&client_addr, &client_addr_size);
 
   REQUIRE(bytes_received > -1);
   REQUIRE(bytes_received < buffer_len);
@@ -56,24 +57,29 @@ void dogstatsd_server_listen(dogstatsd_server *server, dogstatsd_client *client,
   free(buffer);
 }
 
-template <class Method>
-static void _test_method(const char *expect, const char *metric,
-                         const char *value, const char *tags,
-                         const char *const_tags, Method method) {
-  dogstatsd_server server = dogstatsd_server_make();
-
-  char buf[DOGSTATSD_CLIENT_RECOMMENDED_MAX_MESSAGE_SIZE];
-  size_t len = DOGSTATSD_CLIENT_RECOMMENDED_MAX_MESSAGE_SIZE;
+static dogstatsd_client dogstatsd_client_make(dogstatsd_server *server, int len,
+                                              const char *const_tags) {
   char host[NI_MAXHOST];
   char port[NI_MAXSERV];
 
-  getnameinfo((sockaddr *)&server.addr, server.addr.sin_len, host, NI_MAXHOST,
+  getnameinfo((sockaddr *)&server->addr, sizeof server->addr, host, NI_MAXHOST,
               port, NI_MAXSERV, NI_NUMERICHOST | NI_NUMERICSERV);
 
   struct addrinfo *addrs = nullptr;
   REQUIRE(!dogstatsd_client_getaddrinfo(&addrs, host, port));
-  dogstatsd_client client = dogstatsd_client_ctor(addrs, buf, len, const_tags);
+  dogstatsd_client client = dogstatsd_client_ctor(addrs, len, const_tags);
   REQUIRE(!dogstatsd_client_is_default_client(client));
+  return client;
+}
+
+template <class Method>
+static void _test_method(const char *expect, const char *metric,
+                         const char *value, const char *tags,
+                         const char *const_tags, Method method) {
+  dogstatsd_server server = dogstatsd_server_make();
+
+  int len = DOGSTATSD_CLIENT_RECOMMENDED_MAX_MESSAGE_SIZE;
+  dogstatsd_client client = dogstatsd_client_make(&server, len, const_tags);
 
   // start a thread for the server
   std::thread server_thread{dogstatsd_server_listen, &server, &client, expect};
@@ -194,6 +200,65 @@ TEST_CASE("sample_rate -tags -const_tags", "[dogstatsd_client]") {
   _test_metric(expect, metric, "240", type, 0.5, nullptr, nullptr);
 }
 
+TEST_CASE("buffered metrics are sent in one datagram", "[dogstatsd_client]") {
+  dogstatsd_server server = dogstatsd_server_make();
+  dogstatsd_client client = dogstatsd_client_make(&server, 128, "hello:world");
+
+  REQUIRE(dogstatsd_client_metric_buffer(&client, "page.views", "1",
+                                         DOGSTATSD_METRIC_COUNT, 1.0,
+                                         nullptr) == DOGSTATSD_CLIENT_OK);
+  REQUIRE(dogstatsd_client_metric_buffer(&client, "fuel.level", "0.5",
+                                         DOGSTATSD_METRIC_GAUGE, 1.0,
+                                         "lang:c") == DOGSTATSD_CLIENT_OK);
+  REQUIRE(dogstatsd_client_flush(&client) == DOGSTATSD_CLIENT_OK);
+  dogstatsd_server_listen(
+      &server, &client,
+      "page.views:1|c|#hello:world\nfuel.level:0.5|g|#lang:c,hello:world");
+
+  dogstatsd_client_dtor(&client);
+}
+
+TEST_CASE("buffered metrics are sent when the buffer is full",
+          "[dogstatsd_client]") {
+  dogstatsd_server server = dogstatsd_server_make();
+  dogstatsd_client client = dogstatsd_client_make(&server, 32, nullptr);
+
+  REQUIRE(dogstatsd_client_metric_buffer(&client, "page.views", "1",
+                                         DOGSTATSD_METRIC_COUNT, 1.0,
+                                         nullptr) == DOGSTATSD_CLIENT_OK);
+  REQUIRE(dogstatsd_client_metric_buffer(&client, "song.length", "240",
+                                         DOGSTATSD_METRIC_HISTOGRAM, 1.0,
+                                         nullptr) == DOGSTATSD_CLIENT_OK);
+  dogstatsd_server_listen(&server, &client, "page.views:1|c");
+
+  const char *too_long = "a.metric.name.too.long.to.fit";
+  REQUIRE(dogstatsd_client_metric_buffer(&client, too_long, "1",
+                                         DOGSTATSD_METRIC_COUNT, 1.0, nullptr) ==
+          DOGSTATSD_CLIENT_E_TOO_LONG);
+  REQUIRE(dogstatsd_client_flush(&client) == DOGSTATSD_CLIENT_OK);
+  dogstatsd_server_listen(&server, &client, "song.length:240|h");
+
+  dogstatsd_client_dtor(&client);
+}
+
+TEST_CASE("sent metrics leave the buffered metrics alone",
+          "[dogstatsd_client]") {
+  dogstatsd_server server = dogstatsd_server_make();
+  dogstatsd_client client = dogstatsd_client_make(&server, 128, nullptr);
+
+  REQUIRE(dogstatsd_client_metric_buffer(&client, "page.views", "1",
+                                         DOGSTATSD_METRIC_COUNT, 1.0,
+                                         nullptr) == DOGSTATSD_CLIENT_OK);
+  REQUIRE(dogstatsd_client_count(&client, "crashes", "1", "class:sigsegv") ==
+          DOGSTATSD_CLIENT_OK);
+  dogstatsd_server_listen(&server, &client, "crashes:1|c|#class:sigsegv");
+
+  REQUIRE(dogstatsd_client_flush(&client) == DOGSTATSD_CLIENT_OK);
+  dogstatsd_server_listen(&server, &client, "page.views:1|c");
+
+  dogstatsd_client_dtor(&client);
+}
+
 // todo: test sending message that's too large
 // todo: test configuring client with lens of 0 and < 0.
 // todo: test an out of range sample rate returns DOGSTATSD_CLIENT_E_VALUE
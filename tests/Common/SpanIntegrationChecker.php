@@ -16,8 +16,6 @@ final class SpanIntegrationChecker
     public function defineIntegrationsByPattern()
     {
         // <regex pattern> => <integration class>
-        $pdoIntegration = 'DDTrace\Integrations\PDO\PDOIntegration';
-
         return [
             // Prepend your operation names with custom for custom spans to have the span check disabled
             '/custom.*/' => null,
@@ -31,7 +29,8 @@ final class SpanIntegrationChecker
             '/Memcache.*/' => 'DDTrace\Integrations\Memcache\MemcacheIntegration',
             '/Mongo(Client)|(DB)|(Collection).*/' => 'DDTrace\Integrations\Mongo\MongoIntegration',
             '/mysqli.*/' => 'DDTrace\Integrations\Mysqli\MysqliIntegration',
-            '/PDO(.)|(Statement).*/' => $pdoIntegration,
+            // traced by native hooks, without an integration class
+            '/PDO(.)|(Statement).*/' => null,
             '/Predis.*/' => 'DDTrace\Integrations\Predis\PredisIntegration',
             '/Psr18.*/' => 'DDTrace\Integrations\Psr18\Psr18Integration',
             '/symfony.*/' => 'DDTrace\Integrations\Symfony\SymfonyIntegration',
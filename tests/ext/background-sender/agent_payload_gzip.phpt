@@ -0,0 +1,53 @@
+--TEST--
+Trace payloads are gzip-compressed by the background sender when compression is enabled
+--SKIPIF--
+<?php include __DIR__ . '/../includes/skipif_no_dev_env.inc'; ?>
+--ENV--
+DD_TRACE_BGS_ENABLED=1
+DD_AGENT_HOST=request-replayer
+DD_TRACE_AGENT_PORT=80
+DD_TRACE_AGENT_FLUSH_AFTER_N_REQUESTS=1
+DD_TRACE_AGENT_FLUSH_INTERVAL=333
+DD_TRACE_AGENT_COMPRESSION_ENABLED=1
+DD_TRACE_AUTO_FLUSH_ENABLED=1
+DD_TRACE_GENERATE_ROOT_SPAN=0
+--FILE--
+<?php
+include __DIR__ . '/../includes/request_replayer.inc';
+
+$span = \DDTrace\start_span();
+$span->name = 'gzip';
+$span->service = 'gzip_service';
+// large enough to need several read callbacks, both before and after compression
+$span->meta['large'] = str_repeat('0123456789abcdef', 65536);
+\DDTrace\close_span();
+
+$rr = new RequestReplayer();
+$rr->waitForFlush();
+
+$request = $rr->replayRequest();
+ksort($request['headers']);
+foreach ($request['headers'] as $name => $value) {
+    if (in_array($name, ['Content-Encoding', 'Content-Type', 'X-Datadog-Trace-Count'], true)) {
+        echo $name . ': ' . $value . PHP_EOL;
+    }
+}
+
+$traces = json_decode($request['body'], true);
+var_dump(count($traces));
+var_dump($traces[0][0]['name']);
+var_dump($traces[0][0]['service']);
+var_dump($traces[0][0]['meta']['large'] === str_repeat('0123456789abcdef', 65536));
+
+echo 'Done.' . PHP_EOL;
+
+?>
+--EXPECT--
+Content-Encoding: gzip
+Content-Type: application/msgpack
+X-Datadog-Trace-Count: 1
+int(1)
+string(4) "gzip"
+string(12) "gzip_service"
+bool(true)
+Done.
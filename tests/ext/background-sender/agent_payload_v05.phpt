@@ -0,0 +1,68 @@
+--TEST--
+Traces are sent in the v0.5 format with a shared string table when DD_TRACE_API_VERSION=v0.5
+--SKIPIF--
+<?php include __DIR__ . '/../includes/skipif_no_dev_env.inc'; ?>
+--ENV--
+DD_TRACE_BGS_ENABLED=1
+DD_AGENT_HOST=request-replayer
+DD_TRACE_AGENT_PORT=80
+DD_TRACE_AGENT_FLUSH_AFTER_N_REQUESTS=1
+DD_TRACE_AGENT_FLUSH_INTERVAL=333
+DD_TRACE_API_VERSION=v0.5
+DD_TRACE_AUTO_FLUSH_ENABLED=1
+DD_TRACE_GENERATE_ROOT_SPAN=0
+--FILE--
+<?php
+include __DIR__ . '/../includes/request_replayer.inc';
+
+$root = \DDTrace\start_span();
+$root->name = 'root';
+$root->service = 'v05_service';
+$root->meta['shared'] = 'v05_service';
+$child = \DDTrace\start_span();
+$child->name = 'child';
+$child->meta['shared'] = 'v05_service';
+\DDTrace\close_span();
+\DDTrace\close_span();
+
+$rr = new RequestReplayer();
+$rr->waitForFlush();
+
+$request = $rr->replayRequest();
+echo $request['uri'], PHP_EOL;
+echo 'X-Datadog-Trace-Count: ', $request['headers']['X-Datadog-Trace-Count'], PHP_EOL;
+
+list($strings, $traces) = json_decode($request['body'], true);
+var_dump(count($strings) === count(array_unique($strings)));
+var_dump(count($traces));
+
+$spans = $traces[0];
+// the root span has no parent
+usort($spans, function ($a, $b) {
+    return $a[5] <=> $b[5];
+});
+foreach ($spans as $span) {
+    var_dump(count($span));
+    echo $strings[$span[0]], ' ', $strings[$span[1]], PHP_EOL;
+    foreach ($span[9] as $key => $value) {
+        if ($strings[$key] === 'shared') {
+            echo 'shared: ', $strings[$value], PHP_EOL;
+        }
+    }
+}
+
+echo 'Done.' . PHP_EOL;
+
+?>
+--EXPECT--
+/v0.5/traces
+X-Datadog-Trace-Count: 1
+bool(true)
+int(1)
+int(12)
+v05_service root
+shared: v05_service
+int(12)
+v05_service child
+shared: v05_service
+Done.
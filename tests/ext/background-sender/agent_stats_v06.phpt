@@ -0,0 +1,80 @@
+--TEST--
+Client-side stats of the top-level spans are sent to /v0.6/stats when DD_TRACE_STATS_COMPUTATION_ENABLED=1
+--SKIPIF--
+<?php include __DIR__ . '/../includes/skipif_no_dev_env.inc'; ?>
+--ENV--
+DD_TRACE_BGS_ENABLED=1
+DD_AGENT_HOST=request-replayer
+DD_TRACE_AGENT_PORT=80
+DD_TRACE_AGENT_FLUSH_INTERVAL=333
+DD_TRACE_AUTO_FLUSH_ENABLED=1
+DD_TRACE_GENERATE_ROOT_SPAN=0
+DD_TRACE_STATS_COMPUTATION_ENABLED=1
+DD_ENV=stats_env
+--FILE--
+<?php
+include __DIR__ . '/../includes/request_replayer.inc';
+
+$root = \DDTrace\start_span();
+$root->name = 'root';
+$root->service = 'stats_service';
+$root->resource = 'GET /';
+$root->type = 'web';
+
+$query = \DDTrace\start_span();
+$query->name = 'query';
+$query->service = 'stats_db';
+$query->resource = 'SELECT ?';
+$query->type = 'sql';
+\DDTrace\close_span();
+
+// same service as its parent: traced, but not counted
+$inner = \DDTrace\start_span();
+$inner->name = 'inner';
+$inner->service = 'stats_service';
+\DDTrace\close_span();
+
+\DDTrace\close_span();
+
+// sends the current bucket right away instead of once it is over
+dd_trace_internal_fn('synchronous_flush', 1000);
+
+$rr = new RequestReplayer();
+$rr->waitForFlush();
+
+foreach ($rr->replayAllRequests() as $request) {
+    echo $request['uri'], PHP_EOL;
+    if ($request['uri'] !== '/v0.6/stats') {
+        echo 'Datadog-Client-Computed-Stats: ', $request['headers']['Datadog-Client-Computed-Stats'], PHP_EOL;
+        continue;
+    }
+
+    $payload = json_decode($request['body'], true);
+    echo $payload['Lang'], ' ', $payload['Env'], PHP_EOL;
+    foreach ($payload['Stats'] as $bucket) {
+        var_dump($bucket['Duration']);
+        $groups = $bucket['Stats'];
+        usort($groups, function ($a, $b) {
+            return strcmp($a['Service'], $b['Service']);
+        });
+        foreach ($groups as $group) {
+            echo $group['Service'], ' ', $group['Name'], ' ', $group['Resource'], ' ', $group['Type'], PHP_EOL;
+            echo 'hits: ', $group['Hits'], ', top-level: ', $group['TopLevelHits'], ', errors: ', $group['Errors'], PHP_EOL;
+        }
+    }
+}
+
+echo 'Done.' . PHP_EOL;
+
+?>
+--EXPECT--
+/v0.4/traces
+Datadog-Client-Computed-Stats: yes
+/v0.6/stats
+php stats_env
+int(10000000000)
+stats_db query SELECT ? sql
+hits: 1, top-level: 1, errors: 0
+stats_service root GET / web
+hits: 1, top-level: 1, errors: 0
+Done.
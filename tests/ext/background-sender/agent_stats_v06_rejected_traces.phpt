@@ -0,0 +1,87 @@
+--TEST--
+Rejected traces are counted in /v0.6/stats but only their spans kept by span sampling are sent to /v0.4/traces
+--SKIPIF--
+<?php include __DIR__ . '/../includes/skipif_no_dev_env.inc'; ?>
+--ENV--
+DD_TRACE_BGS_ENABLED=1
+DD_AGENT_HOST=request-replayer
+DD_TRACE_AGENT_PORT=80
+DD_TRACE_AGENT_FLUSH_INTERVAL=333
+DD_TRACE_AUTO_FLUSH_ENABLED=1
+DD_TRACE_GENERATE_ROOT_SPAN=0
+DD_TRACE_STATS_COMPUTATION_ENABLED=1
+DD_TRACE_SAMPLE_RATE=0
+DD_SPAN_SAMPLING_RULES=[{"service":"kept_db"}]
+DD_ENV=stats_env
+--FILE--
+<?php
+include __DIR__ . '/../includes/request_replayer.inc';
+
+function trace($rootName, $childService) {
+    $root = \DDTrace\start_span();
+    $root->name = $rootName;
+    $root->service = 'stats_service';
+    $root->resource = 'GET /';
+    $root->type = 'web';
+
+    $query = \DDTrace\start_span();
+    $query->name = 'query';
+    $query->service = $childService;
+    $query->resource = 'SELECT ?';
+    $query->type = 'sql';
+    \DDTrace\close_span();
+
+    \DDTrace\close_span();
+}
+
+// no span is kept: the whole trace is dropped after being counted
+trace('rejected', 'rejected_db');
+// the query is kept by the span sampling rule, its root is dropped
+trace('rescued', 'kept_db');
+
+// sends the current bucket right away instead of once it is over
+dd_trace_internal_fn('synchronous_flush', 1000);
+
+$rr = new RequestReplayer();
+$rr->waitForFlush();
+
+foreach ($rr->replayAllRequests() as $request) {
+    echo $request['uri'], PHP_EOL;
+    if ($request['uri'] !== '/v0.6/stats') {
+        foreach (json_decode($request['body'], true) as $trace) {
+            foreach ($trace as $span) {
+                echo $span['service'], ' ', $span['name'], ' mechanism: ', $span['metrics']['_dd.span_sampling.mechanism'], PHP_EOL;
+            }
+        }
+        continue;
+    }
+
+    $payload = json_decode($request['body'], true);
+    foreach ($payload['Stats'] as $bucket) {
+        $groups = $bucket['Stats'];
+        usort($groups, function ($a, $b) {
+            return strcmp($a['Service'] . $a['Name'], $b['Service'] . $b['Name']);
+        });
+        foreach ($groups as $group) {
+            echo $group['Service'], ' ', $group['Name'], ' ', $group['Resource'], ' ', $group['Type'], PHP_EOL;
+            echo 'hits: ', $group['Hits'], ', top-level: ', $group['TopLevelHits'], ', errors: ', $group['Errors'], PHP_EOL;
+        }
+    }
+}
+
+echo 'Done.' . PHP_EOL;
+
+?>
+--EXPECT--
+/v0.4/traces
+kept_db query mechanism: 8
+/v0.6/stats
+kept_db query SELECT ? sql
+hits: 1, top-level: 1, errors: 0
+rejected_db query SELECT ? sql
+hits: 1, top-level: 1, errors: 0
+stats_service rejected GET / web
+hits: 1, top-level: 1, errors: 0
+stats_service rescued GET / web
+hits: 1, top-level: 1, errors: 0
+Done.
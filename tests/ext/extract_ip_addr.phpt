@@ -25,6 +25,8 @@ test('x_forwarded_for', '127.1.1.1,, ');
 test('x_forwarded_for', '1.2.3.4:456');
 test('x_forwarded_for', '[2001::1]:1111');
 test('x_forwarded_for', 'bad_value, 1.1.1.1');
+test('x_forwarded_for', '10.0.0.1, 10.0.0.2:80, 172.16.0.3, 192.168.0.4, 127.0.0.5, 169.254.0.6, [fd00::7]:443, 8.8.4.4, 8.8.8.8');
+test('x_forwarded_for', 'ffffffffffffffffffffffffffffffffffffffffffffffffff, 1.1.1.1');
 
 test('x_real_ip', '2.2.2.2');
 test('x_real_ip', '2.2.2.2, 3.3.3.3');
@@ -112,6 +114,14 @@ Not recognized as IP address: "bad_value"
 Not recognized as IP address: "bad_value"
 string(7) "1.1.1.1"
 
+x_forwarded_for: 10.0.0.1, 10.0.0.2:80, 172.16.0.3, 192.168.0.4, 127.0.0.5, 169.254.0.6, [fd00::7]:443, 8.8.4.4, 8.8.8.8
+string(7) "8.8.4.4"
+
+x_forwarded_for: ffffffffffffffffffffffffffffffffffffffffffffffffff, 1.1.1.1
+Not recognized as IP address: "ffffffffffffffffffffffffffffffffffffffffffffffffff"
+Not recognized as IP address: "ffffffffffffffffffffffffffffffffffffffffffffffffff"
+string(7) "1.1.1.1"
+
 x_real_ip: 2.2.2.2
 string(7) "2.2.2.2"
 
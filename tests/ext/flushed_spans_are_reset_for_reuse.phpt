@@ -0,0 +1,57 @@
+--TEST--
+Spans reused after a flush start out clean, spans still referenced by userland are left alone
+--ENV--
+DD_TRACE_AUTO_FLUSH_ENABLED=1
+DD_TRACE_GENERATE_ROOT_SPAN=0
+DD_TRACE_AGENT_URL=http://localhost:1
+--FILE--
+<?php
+
+$kept = \DDTrace\start_span();
+$kept->name = "kept";
+$kept->meta["kept.tag"] = "yes";
+for ($i = 0; $i < 3; ++$i) {
+    $child = \DDTrace\start_span();
+    $child->name = "child";
+    $child->resource = "child_resource";
+    $child->service = "child_service";
+    $child->meta["child.tag"] = "yes";
+    $child->metrics["child.metric"] = 1;
+    \DDTrace\close_span();
+}
+unset($child);
+// flushes the trace
+\DDTrace\close_span();
+
+// the span is still referenced here, it must not have been touched by the flush
+var_dump($kept->name, $kept->meta["kept.tag"]);
+
+for ($i = 0; $i < 3; ++$i) {
+    $span = \DDTrace\start_span();
+    var_dump($span->name, $span->resource, $span->parent);
+    var_dump($span->service === "child_service", isset($span->meta["child.tag"]), isset($span->metrics["child.metric"]));
+    \DDTrace\close_span();
+}
+
+?>
+--EXPECT--
+string(4) "kept"
+string(3) "yes"
+string(0) ""
+string(0) ""
+NULL
+bool(false)
+bool(false)
+bool(false)
+string(0) ""
+string(0) ""
+NULL
+bool(false)
+bool(false)
+bool(false)
+string(0) ""
+string(0) ""
+NULL
+bool(false)
+bool(false)
+bool(false)
@@ -0,0 +1,28 @@
+--TEST--
+Query strings are filtered natively and the filter follows runtime config changes
+--ENV--
+DD_TRACE_HTTP_URL_QUERY_PARAM_ALLOWED=a,c
+DD_TRACE_RESOURCE_URI_QUERY_PARAM_ALLOWED=*
+DD_TRACE_OBFUSCATION_QUERY_STRING_REGEXP=c=[0-9]+
+--FILE--
+<?php
+
+var_dump(DDTrace\Integrations\filter_query_string("a=1&b=2&c=3"));
+var_dump(DDTrace\Integrations\filter_query_string("b=2"));
+var_dump(DDTrace\Integrations\filter_query_string("a=1&b=2&c"));
+var_dump(DDTrace\Integrations\filter_query_string("a=1&b=2&c=3", true));
+
+ini_set("datadog.trace.http_url_query_param_allowed", "b");
+var_dump(DDTrace\Integrations\filter_query_string("a=1&b=2&c=3"));
+
+ini_set("datadog.trace.obfuscation_query_string_regexp", "b=[0-9]+");
+var_dump(DDTrace\Integrations\filter_query_string("a=1&b=2&c=3", true));
+
+?>
+--EXPECT--
+string(7) "a=1&c=3"
+string(0) ""
+string(5) "a=1&c"
+string(18) "a=1&b=2&<redacted>"
+string(3) "b=2"
+string(18) "a=1&<redacted>&c=3"
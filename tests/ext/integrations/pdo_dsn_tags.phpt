@@ -0,0 +1,71 @@
+--TEST--
+PDO DSNs are parsed into connection tags, which are added to spans
+--ENV--
+DD_TRACE_GENERATE_ROOT_SPAN=0
+--FILE--
+<?php
+
+use DDTrace\Integrations;
+
+var_dump(Integrations\parse_pdo_dsn("mysql:host=127.0.0.1;port=3306;dbname=test;charset=utf8;host=override"));
+var_dump(Integrations\parse_pdo_dsn("sqlite::memory:"));
+var_dump(Integrations\parse_pdo_dsn("custom:Server=a=b;=ignored;noequals"));
+
+// the cached result may be modified by the caller without affecting later calls
+$tags = Integrations\parse_pdo_dsn("pgsql:host=db");
+$tags["db.user"] = "root";
+var_dump(Integrations\parse_pdo_dsn("pgsql:host=db") === ["db.engine" => "pgsql", "db.system" => "postgresql", "out.host" => "db"]);
+
+$root = \DDTrace\start_span();
+$span = \DDTrace\start_span();
+$span->meta["out.host"] = "previous";
+$span->meta["span.kind"] = "client";
+Integrations\add_span_meta($span, $tags);
+ksort($span->meta);
+var_dump($span->meta);
+\DDTrace\close_span();
+\DDTrace\close_span();
+
+?>
+--EXPECT--
+array(6) {
+  ["db.engine"]=>
+  string(5) "mysql"
+  ["db.system"]=>
+  string(5) "mysql"
+  ["out.host"]=>
+  string(8) "override"
+  ["out.port"]=>
+  string(4) "3306"
+  ["db.name"]=>
+  string(4) "test"
+  ["db.charset"]=>
+  string(4) "utf8"
+}
+array(2) {
+  ["db.engine"]=>
+  string(6) "sqlite"
+  ["db.system"]=>
+  string(6) "sqlite"
+}
+array(3) {
+  ["db.engine"]=>
+  string(6) "custom"
+  ["db.system"]=>
+  string(9) "other_sql"
+  ["out.host"]=>
+  string(1) "a"
+}
+bool(true)
+array(5) {
+  ["db.engine"]=>
+  string(5) "pgsql"
+  ["db.system"]=>
+  string(10) "postgresql"
+  ["db.user"]=>
+  string(4) "root"
+  ["out.host"]=>
+  string(2) "db"
+  ["span.kind"]=>
+  string(6) "client"
+}
@@ -0,0 +1,73 @@
+--TEST--
+PDO calls are traced by native hooks, without loading the PHP integration
+--SKIPIF--
+<?php if (!extension_loaded('pdo_sqlite')) die('skip: pdo_sqlite extension required'); ?>
+--ENV--
+DD_TRACE_GENERATE_ROOT_SPAN=0
+DD_TRACE_PDO_ANALYTICS_ENABLED=1
+--FILE--
+<?php
+
+$pdo = new PDO("sqlite::memory:", null, null, [PDO::ATTR_ERRMODE => PDO::ERRMODE_SILENT]);
+$pdo->exec("CREATE TABLE bears (name TEXT)");
+$pdo->exec("INSERT INTO bears VALUES ('polar'), ('grizzly')");
+$stmt = $pdo->prepare("SELECT name FROM bears WHERE name = ?");
+$stmt->execute(["polar"]);
+$pdo->query("SELECT name FROM wolves");
+
+var_dump(class_exists('DDTrace\Integrations\PDO\PDOIntegration', false));
+
+$spans = dd_trace_serialize_closed_spans();
+usort($spans, function ($a, $b) { return $a["start"] <=> $b["start"]; });
+foreach ($spans as $span) {
+    ksort($span["meta"]);
+    echo "{$span["name"]} | {$span["resource"]} | {$span["service"]} | {$span["type"]}\n";
+    foreach ($span["meta"] + ($span["metrics"] ?? []) as $key => $value) {
+        if (preg_match('(^(component|span\.kind|db\.|error\.|_dd1\.sr\.eausr))', $key)) {
+            echo "  $key: $value\n";
+        }
+    }
+}
+
+?>
+--EXPECT--
+bool(false)
+PDO.__construct | PDO.__construct | pdo | sql
+  component: pdo
+  db.engine: sqlite
+  db.system: sqlite
+  span.kind: client
+PDO.exec | CREATE TABLE bears (name TEXT) | pdo | sql
+  component: pdo
+  db.engine: sqlite
+  db.system: sqlite
+  span.kind: client
+  _dd1.sr.eausr: 1
+  db.row_count: 0
+PDO.exec | INSERT INTO bears VALUES ('polar'), ('grizzly') | pdo | sql
+  component: pdo
+  db.engine: sqlite
+  db.system: sqlite
+  span.kind: client
+  _dd1.sr.eausr: 1
+  db.row_count: 2
+PDO.prepare | SELECT name FROM bears WHERE name = ? | pdo | sql
+  component: pdo
+  db.engine: sqlite
+  db.system: sqlite
+  span.kind: client
+PDOStatement.execute | SELECT name FROM bears WHERE name = ? | pdo | sql
+  component: pdo
+  db.engine: sqlite
+  db.system: sqlite
+  span.kind: client
+  _dd1.sr.eausr: 1
+  db.row_count: 0
+PDO.query | SELECT name FROM wolves | pdo | sql
+  component: pdo
+  db.engine: sqlite
+  db.system: sqlite
+  error.message: SQL error: HY000. Driver error: 1. Driver-specific error data: no such table: wolves
+  error.type: PDO error
+  span.kind: client
+  _dd1.sr.eausr: 1
@@ -0,0 +1,25 @@
+--TEST--
+The Database Monitoring comment is built natively, for the PHP integrations and the PDO hooks alike
+--ENV--
+DD_TRACE_GENERATE_ROOT_SPAN=0
+DD_DBM_PROPAGATION_MODE=full
+DD_ENV=envtest
+DD_SERVICE=app
+DD_VERSION=1.0
+--FILE--
+<?php
+
+var_dump(DDTrace\Integrations\dbm_propagation_mode("mysql") == DDTrace\DBM_PROPAGATION_FULL);
+var_dump(DDTrace\Integrations\dbm_propagation_mode("sqlsrv") == DDTrace\DBM_PROPAGATION_SERVICE);
+var_dump(DDTrace\Integrations\dbm_propagation_mode("sqlite") == DDTrace\DBM_PROPAGATION_DISABLED);
+
+var_dump(DDTrace\Integrations\propagate_via_sql_comments("SELECT 1", "db's", DDTrace\DBM_PROPAGATION_SERVICE));
+var_dump(DDTrace\Integrations\propagate_via_sql_comments("", "", DDTrace\DBM_PROPAGATION_SERVICE));
+
+?>
+--EXPECT--
+bool(true)
+bool(true)
+bool(true)
+string(63) "/*dddbs='db%27s',dde='envtest',ddps='app',ddpv='1.0'*/ SELECT 1"
+string(39) "/*dde='envtest',ddps='app',ddpv='1.0'*/"
@@ -0,0 +1,40 @@
+--TEST--
+Values are attached to objects via DDTrace\ObjectStore and dropped with them
+--FILE--
+<?php
+
+use DDTrace\ObjectStore;
+
+$connection = new stdClass;
+ObjectStore\put($connection, "tags", ["db.system" => "mysql"]);
+ObjectStore\put($connection, "null", null);
+ObjectStore\put("not an object", "tags", []);
+
+var_dump(ObjectStore\get($connection, "tags"));
+var_dump(ObjectStore\get($connection, "missing", "default"));
+var_dump(ObjectStore\get($connection, "null", "default"));
+var_dump(ObjectStore\get(null, "tags", "default"));
+
+$statement = new stdClass;
+ObjectStore\propagate($connection, $statement, "tags");
+ObjectStore\put($connection, "tags", ["db.system" => "pgsql"]);
+var_dump(ObjectStore\get($statement, "tags"));
+
+unset($statement);
+$other = new stdClass;
+var_dump(ObjectStore\get($other, "tags", "not inherited"));
+
+?>
+--EXPECT--
+array(1) {
+  ["db.system"]=>
+  string(5) "mysql"
+}
+string(7) "default"
+string(7) "default"
+string(7) "default"
+array(1) {
+  ["db.system"]=>
+  string(5) "mysql"
+}
+string(13) "not inherited"
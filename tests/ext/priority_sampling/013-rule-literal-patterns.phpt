@@ -0,0 +1,47 @@
+--TEST--
+priority_sampling rules with literal, anchored and regex patterns, changed at runtime
+--ENV--
+DD_TRACE_SAMPLING_RULES=[{"sample_rate": 0.1, "name": "^request$"}, {"sample_rate": 0.2, "name": "^cli"}, {"sample_rate": 0.3, "service": "db$"}, {"sample_rate": 0.4, "service": "cache"}, {"name": "never applies"}, {"sample_rate": 0.5, "name": "[0-9]+"}, {"sample_rate": 0.6}]
+DD_TRACE_GENERATE_ROOT_SPAN=0
+--SKIPIF--
+<?php
+if (getenv("USE_ZEND_ALLOC") === "0") {
+    die("skip: test will show memory errors under valgrind where PCRE is built without valgrind support");
+}
+?>
+--FILE--
+<?php
+function rule_psr($name, $service) {
+    $root = \DDTrace\start_trace_span();
+    $root->name = $name;
+    $root->service = $service;
+    \DDTrace\get_priority_sampling();
+    $psr = $root->metrics["_dd.rule_psr"];
+    \DDTrace\close_span();
+    return $psr;
+}
+
+var_dump(rule_psr("request", "app"));
+var_dump(rule_psr("request_sub", "app"));
+var_dump(rule_psr("cli.command", "app"));
+var_dump(rule_psr("some.cli", "mysql-db"));
+var_dump(rule_psr("some.cli", "mysql-db.replica"));
+var_dump(rule_psr("never applies", "redis-cache-1"));
+var_dump(rule_psr("span.42", "app"));
+var_dump(rule_psr("other", "app"));
+
+ini_set("datadog.trace.sampling_rules", '[{"sample_rate": 0.9, "service": "app"}]');
+var_dump(rule_psr("web.request", "app"));
+var_dump(rule_psr("web.request", "other"));
+?>
+--EXPECT--
+float(0.1)
+float(0.6)
+float(0.2)
+float(0.3)
+float(0.6)
+float(0.4)
+float(0.5)
+float(0.6)
+float(0.9)
+float(1)
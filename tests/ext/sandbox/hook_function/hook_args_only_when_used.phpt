@@ -0,0 +1,42 @@
+--TEST--
+DDTrace\hook_function and DDTrace\trace_function pass the arguments to closures declaring or reading them
+--FILE--
+<?php
+
+namespace Foo;
+
+function without_args($greeting, $name) {}
+function declared($greeting, $name) {}
+function read_args($greeting, $name) {}
+function traced_without_args($greeting, $name) {}
+function traced_variadic($greeting, $name) {}
+
+\DDTrace\hook_function('Foo\without_args', function () {
+    echo "without args: ", func_num_args(), "\n";
+});
+\DDTrace\hook_function('Foo\declared', function ($args) {
+    echo "declared: ", implode(", ", $args), "\n";
+});
+\DDTrace\hook_function('Foo\read_args', null, function () {
+    echo "func_get_args: ", implode(", ", func_get_args()[0]), "\n";
+});
+\DDTrace\trace_function('Foo\traced_without_args', function (\DDTrace\SpanData $span) {
+    echo "tracing without args\n";
+});
+\DDTrace\trace_function('Foo\traced_variadic', function (\DDTrace\SpanData $span, ...$rest) {
+    echo "tracing variadic: ", implode(", ", $rest[0]), "\n";
+});
+
+without_args("Hello", "Datadog");
+declared("Hello", "Datadog");
+read_args("Hello", "Datadog");
+traced_without_args("Hello", "Datadog");
+traced_variadic("Hello", "Datadog");
+
+?>
+--EXPECT--
+without args: 3
+declared: Hello, Datadog
+func_get_args: Hello, Datadog
+tracing without args
+tracing variadic: Hello, Datadog
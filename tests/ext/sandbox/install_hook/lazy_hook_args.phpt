@@ -0,0 +1,43 @@
+--TEST--
+HookData::$args is collected on access and keeps the arguments as passed
+--SKIPIF--
+<?php if (PHP_VERSION_ID < 80000) die('skip: arguments are always collected eagerly pre-PHP 8'); ?>
+--FILE--
+<?php
+
+function foo($a, $b) {
+    $a = "changed";
+    return func_get_args();
+}
+
+DDTrace\install_hook("foo", function($hook) {
+    echo "begin: ", implode(", ", $hook->args), "\n";
+    $hook->overrideArguments(["x", "y"]);
+    echo "begin after override: ", implode(", ", $hook->args), "\n";
+});
+DDTrace\install_hook("foo", null, function($hook) {
+    echo "end: ", implode(", ", $hook->args), "\n";
+});
+DDTrace\install_hook("foo", null, function($hook) {
+    var_dump($hook->args);
+}, DDTrace\HOOK_ARGS_BEGIN_ONLY);
+
+$retained = [];
+DDTrace\install_hook("foo", function($hook) use (&$retained) {
+    $retained[] = $hook;
+    $retained[] = clone $hook;
+});
+
+echo "returned: ", implode(", ", foo(1, 2, 3)), "\n";
+var_dump($retained[0]->args === ["x", "y"], $retained[1]->args === ["x", "y"]);
+
+?>
+--EXPECT--
+begin: 1, 2, 3
+begin after override: 1, 2, 3
+array(0) {
+}
+end: x, y
+returned: changed, y
+bool(true)
+bool(true)
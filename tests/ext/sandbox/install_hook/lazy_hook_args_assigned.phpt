@@ -0,0 +1,25 @@
+--TEST--
+HookData::$args assigned by the begin hook is kept for the end hook
+--SKIPIF--
+<?php if (PHP_VERSION_ID < 80000) die('skip: arguments are always collected eagerly pre-PHP 8'); ?>
+--FILE--
+<?php
+
+function foo($a) {
+    return $a;
+}
+
+DDTrace\install_hook("foo", function($hook) {
+    $hook->args = ["assigned", $hook->id];
+}, function($hook) {
+    echo "end: ", $hook->args[0], "\n";
+});
+
+// the second call runs with the property cache slots already warm
+foo(1);
+foo(2);
+
+?>
+--EXPECT--
+end: assigned
+end: assigned
@@ -18,6 +18,8 @@ $tests = [
     ["a*a*b", "aaaacaab"],
     ["a*a*b", "aaabbb"],
     ["a*a*b?", "aaaacaab"],
+    ["*b?d", "abcde"],
+    ["a*c*c", "abcd"],
 ];
 
 foreach ($tests as list($pattern, $service)) {
@@ -60,3 +62,7 @@ a*a*b matches aaabbb (service): bool(true)
 a*a*b matches aaabbb (name): bool(true)
 a*a*b? matches aaaacaab (service): bool(false)
 a*a*b? matches aaaacaab (name): bool(false)
+*b?d matches abcde (service): bool(true)
+*b?d matches abcde (name): bool(true)
+a*c*c matches abcd (service): bool(false)
+a*c*c matches abcd (name): bool(false)
@@ -0,0 +1,52 @@
+--TEST--
+Tags set by the tracer are visible through the meta property of spans
+--ENV--
+DD_ENV=inline-env
+DD_VERSION=1.2.3
+DD_TRACE_GENERATE_ROOT_SPAN=0
+--FILE--
+<?php
+
+$root = \DDTrace\start_span();
+$child = \DDTrace\start_span();
+$clone = clone $child;
+var_dump($clone->meta);
+var_dump(isset($child->meta["version"]), $child->meta["env"]);
+$child->meta["custom"] = "tag";
+unset($child->meta["env"]);
+var_dump($child->meta);
+\DDTrace\close_span();
+
+$other = \DDTrace\start_span();
+$other->meta = ["replaced" => "meta"];
+var_dump($other->meta);
+\DDTrace\close_span();
+
+$last = \DDTrace\start_span();
+var_dump(((array)$last)["meta"] === ["version" => "1.2.3", "env" => "inline-env"], $last->meta["version"]);
+\DDTrace\close_span();
+
+\DDTrace\close_span();
+
+?>
+--EXPECT--
+array(2) {
+  ["version"]=>
+  string(5) "1.2.3"
+  ["env"]=>
+  string(10) "inline-env"
+}
+bool(true)
+string(10) "inline-env"
+array(2) {
+  ["version"]=>
+  string(5) "1.2.3"
+  ["custom"]=>
+  string(3) "tag"
+}
+array(1) {
+  ["replaced"]=>
+  string(4) "meta"
+}
+bool(true)
+string(5) "1.2.3"
@@ -0,0 +1,68 @@
+--TEST--
+The statements of sql spans are quantized when serialized with DD_TRACE_SQL_QUANTIZATION_ENABLED
+--ENV--
+DD_TRACE_GENERATE_ROOT_SPAN=0
+DD_TRACE_SQL_QUANTIZATION_ENABLED=1
+--FILE--
+<?php
+
+function sql_span($query, $type = "sql") {
+    $span = \DDTrace\start_span();
+    $span->name = "PDO.query";
+    $span->type = $type;
+    $span->resource = $query;
+    $span->meta["db.statement"] = $query;
+    \DDTrace\close_span();
+}
+
+$root = \DDTrace\start_span();
+sql_span("SELECT *\n  FROM users WHERE id IN (1, 2, 3) -- comment");
+sql_span("SELECT * FROM users WHERE id IN (4,5)");
+sql_span("INSERT INTO t (a, b) VALUES (1, 'it''s'), (2, 'b')");
+sql_span("GET key:1", "redis");
+// too long to be cached
+sql_span("INSERT INTO t (a) VALUES " . implode(", ", array_fill(0, 1000, "(12345)")));
+\DDTrace\close_span();
+
+function dump_statements() {
+    $statements = [];
+    foreach (dd_trace_serialize_closed_spans() as $span) {
+        if (isset($span["type"])) {
+            $statements[] = $span["resource"] . " | " . $span["meta"]["db.statement"];
+        }
+    }
+    sort($statements);
+    echo implode("\n", $statements), "\n";
+}
+
+dump_statements();
+
+ini_set("datadog.trace.sql_quantization_enabled", "0");
+$root = \DDTrace\start_span();
+sql_span("SELECT * FROM users WHERE id = 1");
+\DDTrace\close_span();
+dump_statements();
+
+// the span meta is left as is, even when referenced
+ini_set("datadog.trace.sql_quantization_enabled", "1");
+$root = \DDTrace\start_span();
+$span = \DDTrace\start_span();
+$span->type = "sql";
+$span->resource = "SELECT 1";
+$meta = &$span->meta;
+$meta["db.statement"] = "SELECT 1";
+\DDTrace\close_span();
+\DDTrace\close_span();
+dump_statements();
+echo $meta["db.statement"], "\n";
+
+?>
+--EXPECT--
+GET key:1 | GET key:1
+INSERT INTO t (a) VALUES (?) | INSERT INTO t (a) VALUES (?)
+INSERT INTO t (a, b) VALUES (?) | INSERT INTO t (a, b) VALUES (?)
+SELECT * FROM users WHERE id IN (?) | SELECT * FROM users WHERE id IN (?)
+SELECT * FROM users WHERE id IN (?) | SELECT * FROM users WHERE id IN (?)
+SELECT * FROM users WHERE id = 1 | SELECT * FROM users WHERE id = 1
+SELECT ? | SELECT ?
+SELECT 1
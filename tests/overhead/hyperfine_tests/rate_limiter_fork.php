@@ -0,0 +1,33 @@
+<?php
+
+// Forks a number of workers which all make sampling decisions against the rate limiter shared between the forks, and
+// reports the aggregated throughput. Run it with the limiter enabled and without root span generation, e.g.:
+//   DD_TRACE_RATE_LIMIT=100 DD_TRACE_GENERATE_ROOT_SPAN=0 php -dextension=ddtrace.so rate_limiter_fork.php 16
+
+$workers = (int)($argv[1] ?? 8);
+$decisionsPerWorker = (int)($argv[2] ?? 100000);
+
+$start = hrtime(true);
+$pids = [];
+for ($w = 0; $w < $workers; $w++) {
+    $pid = pcntl_fork();
+    if ($pid === 0) {
+        for ($i = 0; $i < $decisionsPerWorker; $i++) {
+            \DDTrace\start_trace_span();
+            \DDTrace\get_priority_sampling();
+            \DDTrace\close_span();
+            if ($i % 1000 === 999) {
+                dd_trace_serialize_closed_spans();
+            }
+        }
+        exit(0);
+    }
+    $pids[] = $pid;
+}
+foreach ($pids as $pid) {
+    pcntl_waitpid($pid, $status);
+}
+$elapsed = hrtime(true) - $start;
+
+$decisions = $workers * $decisionsPerWorker;
+printf("%d workers, %d decisions, %.0f decisions/s\n", $workers, $decisions, $decisions / ($elapsed / 1e9));
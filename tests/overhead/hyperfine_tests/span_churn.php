@@ -0,0 +1,24 @@
+<?php
+
+// Opens and closes 100k spans, in traces of 100 spans which are flushed as soon as they are closed, and reports the
+// cost per span. Run it with auto-flushing and without root span generation, e.g.:
+//   DD_TRACE_AUTO_FLUSH_ENABLED=1 DD_TRACE_GENERATE_ROOT_SPAN=0 php -dextension=ddtrace.so span_churn.php
+
+$traces = 1000;
+$spansPerTrace = 100;
+
+$start = hrtime(true);
+for ($i = 0; $i < $traces; $i++) {
+    $root = \DDTrace\start_span();
+    $root->name = "root";
+    for ($j = 1; $j < $spansPerTrace; $j++) {
+        $span = \DDTrace\start_span();
+        $span->name = "child";
+        $span->meta["db.system"] = "mysql";
+        \DDTrace\close_span();
+    }
+    \DDTrace\close_span();
+}
+$elapsed = hrtime(true) - $start;
+
+printf("%d spans, %.1f ns/span\n", $traces * $spansPerTrace, $elapsed / ($traces * $spansPerTrace));
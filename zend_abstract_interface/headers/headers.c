@@ -3,12 +3,8 @@
 #include <php.h>
 #include <zai_assert/zai_assert.h>
 
-zai_header_result zai_read_header(zai_string_view uppercase_header_name, zend_string **header_value) {
-    if (!zai_string_stuffed(uppercase_header_name) || !header_value) return ZAI_HEADER_ERROR;
-
-    zai_assert_is_upper(uppercase_header_name.ptr, "Header names must be uppercase.");
-
-    if (!PG(modules_activated) && !PG(during_request_startup)) return ZAI_HEADER_NOT_READY;
+static zend_array *zai_server_array(void) {
+    if (!PG(modules_activated) && !PG(during_request_startup)) return NULL;
 
     if (PG(auto_globals_jit)) {
         // !!!
@@ -26,7 +22,7 @@ zai_header_result zai_read_header(zai_string_view uppercase_header_name, zend_st
 
     zval *server_var = &PG(http_globals)[TRACK_VARS_SERVER];
     if (Z_TYPE_P(server_var) != IS_ARRAY) {
-        return ZAI_HEADER_NOT_READY;  // should be impossible to reach
+        return NULL;  // should be impossible to reach
     }
 
     // note that ext/filter stores a raw (unfiltered, unmangled) version of the headers in IF_G(server_array)
@@ -34,6 +30,31 @@ zai_header_result zai_read_header(zai_string_view uppercase_header_name, zend_st
     // array, which may have been tampered with from user side, if called after RINIT, or also by ext/filter if there
     // is a default filter configured via ini. This should not impact us, but if it turns out to, we may have to
     // optionally access filter globals in a best-effort attempt at getting the original raw headers.
+    return Z_ARR_P(server_var);
+}
+
+static zai_header_result zai_find_server_header(zend_array *server, zend_string *server_var_name,
+                                                zend_string **header_value) {
+    zval *header_zv = zend_hash_find(server, server_var_name);
+
+    if (!header_zv || Z_TYPE_P(header_zv) != IS_STRING) {
+        return ZAI_HEADER_NOT_SET;
+    }
+
+    *header_value = Z_STR_P(header_zv);
+
+    return ZAI_HEADER_SUCCESS;
+}
+
+zai_header_result zai_read_header(zai_string_view uppercase_header_name, zend_string **header_value) {
+    if (!zai_string_stuffed(uppercase_header_name) || !header_value) return ZAI_HEADER_ERROR;
+
+    zai_assert_is_upper(uppercase_header_name.ptr, "Header names must be uppercase.");
+
+    zend_array *server = zai_server_array();
+    if (!server) {
+        return ZAI_HEADER_NOT_READY;
+    }
 
     // headers are present in HTTP_HEADERNAME from in the _SERVER array
     ALLOCA_FLAG(use_heap)
@@ -44,15 +65,20 @@ zai_header_result zai_read_header(zai_string_view uppercase_header_name, zend_st
     memcpy(ZSTR_VAL(var_name) + 5, uppercase_header_name.ptr, uppercase_header_name.len);
     ZSTR_VAL(var_name)[var_len] = 0;
 
-    zval *header_zv = zend_hash_find(Z_ARR_P(server_var), var_name);
+    zai_header_result result = zai_find_server_header(server, var_name, header_value);
 
     ZSTR_ALLOCA_FREE(var_name, use_heap);
 
-    if (!header_zv || Z_TYPE_P(header_zv) != IS_STRING) {
-        return ZAI_HEADER_NOT_SET;
-    }
+    return result;
+}
 
-    *header_value = Z_STR_P(header_zv);
+zai_header_result zai_read_server_header(zend_string *server_var_name, zend_string **header_value) {
+    if (!server_var_name || !header_value) return ZAI_HEADER_ERROR;
 
-    return ZAI_HEADER_SUCCESS;
+    zend_array *server = zai_server_array();
+    if (!server) {
+        return ZAI_HEADER_NOT_READY;
+    }
+
+    return zai_find_server_header(server, server_var_name, header_value);
 }
@@ -17,6 +17,10 @@ typedef enum {
 
 zai_header_result zai_read_header(zai_string_view uppercase_header_name, zend_string **header_value);
 
+/* Like zai_read_header(), but takes the full name of the _SERVER entry (e.g. "HTTP_X_FOO"). Callers reading the same
+ * headers on every request can pass interned names to skip building and hashing the name on each lookup. */
+zai_header_result zai_read_server_header(zend_string *server_var_name, zend_string **header_value);
+
 #define zai_read_header_literal(uppercase_header_name, header_value) \
     zai_read_header(ZAI_STRL_VIEW(uppercase_header_name), header_value)
 
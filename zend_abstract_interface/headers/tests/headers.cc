@@ -39,6 +39,22 @@ TEA_TEST_CASE_WITH_PROLOGUE("headers", "reading undefined header value", {
     REQUIRE(zai_read_header_literal("NOT_MY_HEADER", &header) == ZAI_HEADER_NOT_SET);
 })
 
+TEA_TEST_CASE_WITH_PROLOGUE("headers", "reading header value by its server variable name", {
+    tea_sapi_register_custom_server_variables = define_server_value;
+},{
+    zend_string *name = zend_string_init_interned(ZEND_STRL("HTTP_MY_HEADER"), 0);
+    zend_string *missing = zend_string_init_interned(ZEND_STRL("HTTP_NOT_MY_HEADER"), 0);
+
+    zend_string *header;
+    REQUIRE(zai_read_server_header(name, &header) == ZAI_HEADER_SUCCESS);
+    REQUIRE(zend_string_equals_literal(header, "Datadog"));
+    REQUIRE(zai_read_server_header(missing, &header) == ZAI_HEADER_NOT_SET);
+    REQUIRE(zai_read_server_header(nullptr, &header) == ZAI_HEADER_ERROR);
+
+    zend_string_release(missing);
+    zend_string_release(name);
+})
+
 TEA_TEST_CASE("headers", "erroneous read_header input", {
     zend_string *header;
     REQUIRE(zai_read_header({ 1, nullptr }, &header) == ZAI_HEADER_ERROR);
@@ -19,9 +19,21 @@ typedef struct {
     int refcount; // one ref held by the existence in the array, one ref held by each frame
 } zai_hook_t; /* }}} */
 
+// The hooks applying to a call, flattened from zai_hooks_entry.hooks, so that zai_hook_continue() neither iterates the hashtable nor checks scopes
+// It is rebuilt whenever any hook table changed (i.e. zai_hook_tls->generation was bumped) or the function is called on another scope
+typedef struct {
+    zend_ulong generation;
+    zend_class_entry *called_scope;
+    uint32_t count;
+    uint32_t size;
+    size_t dynamic;
+    zai_hook_t **hooks;
+} zai_hook_dispatch;
+
 typedef struct _zai_hooks_entry {
     HashTable hooks;
     size_t dynamic;
+    zai_hook_dispatch dispatch;
 #if PHP_VERSION_ID >= 80000
     // Note: there may be multiple Closures pointing to the same opcodes. These Closures may have different lifetimes and potentially ZEND_ACC_HEAP_RT_CACHE.
     // But to ensure consistency between existence of hooks and Closure actually being hooked, we need to keep track of the run_time_cache, so that we eventually may remove the hook again.
@@ -43,10 +55,27 @@ typedef struct {
     size_t dynamic_offset;
 } zai_hook_info;
 
+typedef struct {
+    zend_function *function; // NULL if not defined at activation
+    zend_class_entry *ce;
+    bool lookup; // not an internal symbol, it must be looked up again on every activation
+} zai_hook_static_resolution;
+
+// The result of looking up the targets of zai_hook_static at activation, in iteration order of zai_hook_static
+// At activation only persistent symbols exist, so this is identical for every request, as long as neither the static hooks nor the symbol tables changed
+typedef struct {
+    zend_ulong static_generation;
+    uint32_t classes;
+    uint32_t functions;
+    zai_hook_static_resolution resolutions[];
+} zai_hook_static_index;
+
 /* {{{ private tables */
 ZEND_TLS struct {
     zend_ulong invocation;
     zend_ulong id;
+    // bumped on every change to hooks of any zai_hooks_entry, invalidating all zai_hook_dispatch
+    zend_ulong generation;
     // zai_hook_tls->request_functions is a map name -> array<zai_hook_t>
     HashTable request_functions;
     // zai_hook_tls->request_classes is a map class name -> map function name -> array<zai_hook_t>
@@ -55,11 +84,15 @@ ZEND_TLS struct {
     zai_hooks_entry request_files;
     // zai_hook_tls->inheritors is a map of class entries (interfaces and abstract classes) to a list of class entries
     HashTable inheritors;
+    // zai_hook_tls->static_index is persistently allocated and kept across requests
+    zai_hook_static_index *static_index;
 } *zai_hook_tls;
 
 // zai_hook_static is a simple array of persistently allocated zai_hook_t
 // these persistently allocated zai_hook_t are always duplicated (with is_global = true) into zai_hook_request_* on request start
 static HashTable zai_hook_static;
+// bumped on every install into and removal from zai_hook_static, invalidating all zai_hook_static_index
+static zend_ulong zai_hook_static_generation = 1;
 
 // zai_hook_resolved is a map op_array/internal_function -> array<zai_hook_t>
 // if indirect, then it's pointing to some hashtable in zai_hook_tls->request_functions/classes
@@ -111,6 +144,7 @@ static void zai_hook_data_dtor(zai_hook_t *hook) {
 
 static void zai_hook_static_destroy(zval *zv) {
     zai_hook_t *hook = Z_PTR_P(zv);
+    ++zai_hook_static_generation;
     zai_hook_data_dtor(hook);
     pefree(hook, 1);
 }
@@ -193,7 +227,11 @@ static void zai_hook_entries_destroy(zai_hooks_entry *hooks, zend_ulong install_
 
     zend_hash_iterators_remove(&hooks->hooks);
     zend_hash_destroy(&hooks->hooks);
+    ++zai_hook_tls->generation;
 
+    if (hooks->dispatch.hooks) {
+        efree(hooks->dispatch.hooks);
+    }
     efree(hooks);
 }
 
@@ -332,6 +370,7 @@ static zend_long zai_hook_add_entry(zai_hooks_entry *hooks, zai_hook_t *hook) {
     }
 
     hooks->dynamic += hook->dynamic;
+    ++zai_hook_tls->generation;
 
     return (zend_long)index;
 }
@@ -339,6 +378,7 @@ static zend_long zai_hook_add_entry(zai_hooks_entry *hooks, zai_hook_t *hook) {
 static zai_hooks_entry *zai_hook_alloc_hooks_entry(void) {
     zai_hooks_entry *hooks = emalloc(sizeof(*hooks));
     hooks->dynamic = 0;
+    hooks->dispatch = (zai_hook_dispatch){0};
     hooks->resolved = NULL;
 #if PHP_VERSION_ID >= 80000
     hooks->run_time_cache = NULL;
@@ -428,6 +468,7 @@ static inline void zai_hook_resolved_install_shared_hook(zai_hook_t *hook, zend_
         }
 
         hooks->dynamic += hook->dynamic;
+        ++zai_hook_tls->generation;
     }
 }
 
@@ -478,20 +519,13 @@ static zend_long zai_hook_resolved_install(zai_hook_t *hook, zend_function *reso
     return index;
 }
 
-static zend_long zai_hook_request_install(zai_hook_t *hook) {
-    if (!hook->function) {
-        return zai_hook_add_entry(&zai_hook_tls->request_files, hook);
-    }
-
-    zend_class_entry *ce = NULL;
-    zai_string_view scope = hook->scope ? ZAI_STRING_FROM_ZSTR(hook->scope) : ZAI_STRING_EMPTY;
-    zend_function *function = zai_hook_lookup_function(scope, ZAI_STRING_FROM_ZSTR(hook->function), &ce);
-    if (function) {
-        hook->resolved_scope = ce;
-        hook->is_abstract = (function->common.fn_flags & ZEND_ACC_ABSTRACT) != 0;
-        return zai_hook_resolved_install(hook, function, ce);
-    }
+static zend_long zai_hook_request_install_resolved(zai_hook_t *hook, zend_function *function, zend_class_entry *ce) {
+    hook->resolved_scope = ce;
+    hook->is_abstract = (function->common.fn_flags & ZEND_ACC_ABSTRACT) != 0;
+    return zai_hook_resolved_install(hook, function, ce);
+}
 
+static zend_long zai_hook_request_install_pending(zai_hook_t *hook) {
     HashTable *funcs;
     if (hook->scope) {
         funcs = zend_hash_find_ptr(&zai_hook_tls->request_classes, hook->scope);
@@ -513,6 +547,25 @@ static zend_long zai_hook_request_install(zai_hook_t *hook) {
     return zai_hook_add_entry(hooks, hook);
 }
 
+static inline zend_function *zai_hook_lookup_hook_function(zai_hook_t *hook, zend_class_entry **ce) {
+    zai_string_view scope = hook->scope ? ZAI_STRING_FROM_ZSTR(hook->scope) : ZAI_STRING_EMPTY;
+    return zai_hook_lookup_function(scope, ZAI_STRING_FROM_ZSTR(hook->function), ce);
+}
+
+static zend_long zai_hook_request_install(zai_hook_t *hook) {
+    if (!hook->function) {
+        return zai_hook_add_entry(&zai_hook_tls->request_files, hook);
+    }
+
+    zend_class_entry *ce = NULL;
+    zend_function *function = zai_hook_lookup_hook_function(hook, &ce);
+    if (function) {
+        return zai_hook_request_install_resolved(hook, function, ce);
+    }
+
+    return zai_hook_request_install_pending(hook);
+}
+
 static inline void zai_hook_register_inheritor(zend_class_entry *child, zend_class_entry *parent, bool persistent) {
     const size_t min_size = 7;
 
@@ -568,6 +621,7 @@ static inline void zai_hook_merge_inherited_hooks(zai_hooks_entry **hooks_entry,
                 hooks->dynamic += hook->dynamic;
                 Z_TYPE_INFO_P(hook_zv) = ZAI_IS_SHARED_HOOK_PTR;
                 zai_hook_sort_newest(hooks);
+                ++zai_hook_tls->generation;
             }
         } ZEND_HASH_FOREACH_END();
     }
@@ -690,6 +744,7 @@ static inline void zai_hook_resolve(HashTable *base_ht, zend_class_entry *ce, ze
                 zend_hash_index_add_new(&existingHooks->hooks, index, hook_zv);
                 zai_hook_sort_newest(existingHooks);
             } ZEND_HASH_FOREACH_END();
+            ++zai_hook_tls->generation;
 
             // we remove the whole zai_hooks_entry, excluding the individual zai_hook_t which we moved
             hooks->hooks.pDestructor = NULL;
@@ -786,6 +841,7 @@ static inline void zai_hook_remove_shared_hook(zend_function *func, zend_ulong h
     // Ensure hooks are only removed once.
     if (hooks && hooks != base_hooks) {
         zend_hash_index_del(&hooks->hooks, hook_id);
+        ++zai_hook_tls->generation;
         if (zend_hash_num_elements(&hooks->hooks) == 0) {
             zai_hook_entries_remove_resolved(addr);
         }
@@ -834,6 +890,7 @@ static bool zai_hook_remove_from_entry(zai_hooks_entry *hooks, zend_ulong index)
     }
 
     hooks->dynamic -= hook->dynamic;
+    ++zai_hook_tls->generation;
     if (!--hook->refcount) {
         // abstract and internal functions are never temporary, hence access to resolved is allowed here
         if (hook->is_abstract) {
@@ -849,31 +906,74 @@ static bool zai_hook_remove_from_entry(zai_hooks_entry *hooks, zend_ulong index)
     return true;
 }
 
-/* {{{ */
-zai_hook_continued zai_hook_continue(zend_execute_data *ex, zai_hook_memory_t *memory) {
-    zai_hooks_entry *hooks;
+static void zai_hook_dispatch_build(zai_hooks_entry *hooks, zend_class_entry *called_scope) {
+    zai_hook_dispatch *dispatch = &hooks->dispatch;
 
-    if (!zai_hook_table_find(&zai_hook_resolved, zai_hook_frame_address(ex), (void**)&hooks)) {
-        return ZAI_HOOK_SKIP;
+    uint32_t hook_count = zend_hash_num_elements(&hooks->hooks);
+    if (hook_count > dispatch->size) {
+        dispatch->hooks = erealloc(dispatch->hooks, hook_count * sizeof(zai_hook_t *));
+        dispatch->size = hook_count;
     }
 
-    uint32_t allocated_hook_count = zend_hash_num_elements(&hooks->hooks);
-    if (allocated_hook_count == 0) {
-        return ZAI_HOOK_SKIP;
+    dispatch->count = 0;
+    dispatch->dynamic = 0;
+
+    zai_hook_t *hook;
+    ZEND_HASH_FOREACH_PTR(&hooks->hooks, hook) {
+        if (hook->id < 0) {
+            continue;
+        }
+
+        if (called_scope && !(hook->resolved_scope->ce_flags & ZEND_ACC_TRAIT) && !instanceof_function(called_scope, hook->resolved_scope)) {
+            continue;
+        }
+
+        dispatch->hooks[dispatch->count++] = hook;
+        dispatch->dynamic += hook->dynamic;
+    } ZEND_HASH_FOREACH_END();
+
+    dispatch->called_scope = called_scope;
+    dispatch->generation = zai_hook_tls->generation;
+}
+
+static bool zai_hook_already_begun(zai_hook_memory_t *memory, uint32_t hook_num, zai_hook_t *hook) {
+    for (zai_hook_info *hook_info = memory->dynamic, *hook_end = hook_info + hook_num; hook_info < hook_end; ++hook_info) {
+        if (hook_info->hook == hook) {
+            return true;
+        }
     }
+    return false;
+}
 
-    size_t hook_info_size = allocated_hook_count * sizeof(zai_hook_info);
-    size_t dynamic_size = hooks->dynamic + hook_info_size;
-    // a vector of first N hook_info entries, then N entries of variable size (as much memory as the individual hooks require)
-    memory->dynamic = ecalloc(1, dynamic_size);
-    memory->invocation = ++zai_hook_tls->invocation;
+// Slow path of zai_hook_continue(), once a begin hook added or removed hooks: continue on the hashtable itself after the last begun hook
+static zai_hook_continued zai_hook_continue_changed(zend_execute_data *ex, zai_hook_memory_t *memory, zai_hook_t *last_hook,
+        uint32_t hook_num, uint32_t allocated_hook_count, size_t dynamic_offset, size_t dynamic_size) {
+    zai_hooks_entry *hooks;
 
-    // iterate the array in a safe way, i.e. handling possible updates at runtime
+    if (!zai_hook_table_find(&zai_hook_resolved, zai_hook_frame_address(ex), (void**)&hooks)) {
+        memory->hook_count = (zend_ulong)hook_num;
+        return ZAI_HOOK_CONTINUED;
+    }
+
+    zend_ulong last_index = (zend_ulong)(last_hook->id < 0 ? -last_hook->id : last_hook->id), index;
+    bool restarted = true;
     HashPosition pos;
     zend_hash_internal_pointer_reset_ex(&hooks->hooks, &pos);
+    while (zend_hash_get_current_key_ex(&hooks->hooks, NULL, &index, &pos) != HASH_KEY_NON_EXISTENT) {
+        zend_hash_move_forward_ex(&hooks->hooks, &pos);
+        if (index == last_index) {
+            restarted = false;
+            break;
+        }
+    }
+    if (restarted) {
+        // the last begun hook is gone, start over, but do not begin any hook twice
+        zend_hash_internal_pointer_reset_ex(&hooks->hooks, &pos);
+    }
+
+    // iterate the array in a safe way, i.e. handling possible updates at runtime
     uint32_t ht_iter = zend_hash_iterator_add(&hooks->hooks, pos);
-    uint32_t hook_num = 0;
-    size_t dynamic_offset = hook_info_size;
+    size_t hook_info_size = allocated_hook_count * sizeof(zai_hook_info);
     bool check_scope = ex->func->common.scope != NULL && ex->func->common.function_name != NULL;
 
     for (zai_hook_t *hook; (hook = zend_hash_get_current_data_ptr_ex(&hooks->hooks, &pos));) {
@@ -889,6 +989,10 @@ zai_hook_continued zai_hook_continue(zend_execute_data *ex, zai_hook_memory_t *m
             }
         }
 
+        if (UNEXPECTED(restarted) && zai_hook_already_begun(memory, hook_num, hook)) {
+            continue;
+        }
+
         // increase dynamic memory if new hooks get added during iteration
         if (UNEXPECTED(dynamic_offset + hook->dynamic > dynamic_size || allocated_hook_count <= hook_num)) {
             for (uint32_t i = 0; i < hook_num; ++i) {
@@ -937,6 +1041,7 @@ zai_hook_continued zai_hook_continue(zend_execute_data *ex, zai_hook_memory_t *m
             zend_hash_iterator_del(ht_iter);
             zend_hash_internal_pointer_reset_ex(&hooks->hooks, &pos);
             ht_iter = zend_hash_iterator_add(&hooks->hooks, pos);
+            restarted = true;
         }
         pos = zend_hash_iterator_pos(ht_iter, &hooks->hooks);
 
@@ -947,6 +1052,71 @@ zai_hook_continued zai_hook_continue(zend_execute_data *ex, zai_hook_memory_t *m
 
     memory->hook_count = (zend_ulong)hook_num;
     return ZAI_HOOK_CONTINUED;
+}
+
+/* {{{ */
+zai_hook_continued zai_hook_continue(zend_execute_data *ex, zai_hook_memory_t *memory) {
+    zai_hooks_entry *hooks;
+
+    if (!zai_hook_table_find(&zai_hook_resolved, zai_hook_frame_address(ex), (void**)&hooks)) {
+        return ZAI_HOOK_SKIP;
+    }
+
+    if (zend_hash_num_elements(&hooks->hooks) == 0) {
+        return ZAI_HOOK_SKIP;
+    }
+
+    bool check_scope = ex->func->common.scope != NULL && ex->func->common.function_name != NULL;
+    zend_class_entry *called_scope = check_scope ? zend_get_called_scope(ex) : NULL;
+
+    zai_hook_dispatch *dispatch = &hooks->dispatch;
+    if (dispatch->generation != zai_hook_tls->generation || dispatch->called_scope != called_scope) {
+        zai_hook_dispatch_build(hooks, called_scope);
+    }
+
+    uint32_t hook_count = dispatch->count;
+    if (hook_count == 0) {
+        return ZAI_HOOK_SKIP;
+    }
+
+    size_t hook_info_size = hook_count * sizeof(zai_hook_info);
+    size_t dynamic_size = dispatch->dynamic + hook_info_size;
+    // a vector of first N hook_info entries, then N entries of variable size (as much memory as the individual hooks require)
+    memory->dynamic = ecalloc(1, dynamic_size);
+    memory->invocation = ++zai_hook_tls->invocation;
+
+    zend_ulong generation = zai_hook_tls->generation;
+    size_t dynamic_offset = hook_info_size;
+
+    for (uint32_t hook_num = 0; hook_num < hook_count;) {
+        zai_hook_t *hook = dispatch->hooks[hook_num];
+
+        ((zai_hook_info *)memory->dynamic)[hook_num++] = (zai_hook_info){ .hook = hook, .dynamic_offset = dynamic_offset };
+
+        ++hook->refcount;
+        if (hook->begin) {
+            if (!hook->begin(memory->invocation, ex, hook->aux.data, memory->dynamic + dynamic_offset)) {
+                memory->hook_count = (zend_ulong)hook_num;
+                zai_hook_finish(ex, NULL, memory);
+                return ZAI_HOOK_BAILOUT;
+            }
+
+            if (UNEXPECTED(generation != zai_hook_tls->generation)) {
+                // the dispatch list and even hooks itself may be stale now
+                return zai_hook_continue_changed(ex, memory, hook, hook_num, hook_count, dynamic_offset + hook->dynamic, dynamic_size);
+            }
+
+            if (UNEXPECTED(dispatch->called_scope != called_scope)) {
+                // a nested call on another scope rebuilt it, with the hooks unchanged this yields the very same list again
+                zai_hook_dispatch_build(hooks, called_scope);
+            }
+        }
+
+        dynamic_offset += hook->dynamic;
+    }
+
+    memory->hook_count = (zend_ulong)hook_count;
+    return ZAI_HOOK_CONTINUED;
 } /* }}} */
 
 void zai_hook_generator_resumption(zend_execute_data *ex, zval *sent, zai_hook_memory_t *memory) {
@@ -1002,6 +1172,7 @@ void zai_hook_finish(zend_execute_data *ex, zval *rv, zai_hook_memory_t *memory)
                     address = zai_hook_install_address(hooks->resolved);
                 }
                 zend_hash_index_del(&hooks->hooks, (zend_ulong) -hook->id);
+                ++zai_hook_tls->generation;
                 if (zend_hash_num_elements(&hooks->hooks) == 0) {
                     zai_hook_entries_remove_resolved(address);
                 }
@@ -1024,12 +1195,15 @@ bool zai_hook_minit(void) {
 
 bool zai_hook_ginit(void) {
     zai_hook_tls = calloc(1, sizeof(*zai_hook_tls));
+    // a zeroed zai_hook_dispatch must never be valid
+    zai_hook_tls->generation = 1;
     return true;
 }
 
 bool zai_hook_rinit(void) {
     zend_hash_init(&zai_hook_tls->inheritors, 8, NULL, zai_hook_inheritors_destroy, 0);
     zend_hash_init(&zai_hook_tls->request_files.hooks, 8, NULL, zai_hook_destroy, 0);
+    zai_hook_tls->request_files.dispatch = (zai_hook_dispatch){0};
     zend_hash_init(&zai_hook_tls->request_functions, 8, NULL, zai_hook_hash_destroy, 0);
     zend_hash_init(&zai_hook_tls->request_classes, 8, NULL, zai_hook_hash_destroy, 0);
     zend_hash_init(&zai_hook_resolved, 8, NULL, NULL, 0);
@@ -1075,16 +1249,67 @@ void zai_hook_post_startup(void) {
     } ZEND_HASH_FOREACH_END();
 }
 
+static zai_hook_static_index *zai_hook_static_index_get(void) {
+    zai_hook_static_index *index = zai_hook_tls->static_index;
+    if (index
+     && index->static_generation == zai_hook_static_generation
+     && index->classes == zend_hash_num_elements(CG(class_table))
+     && index->functions == zend_hash_num_elements(CG(function_table))) {
+        return index;
+    }
+
+    free(index);
+    index = malloc(sizeof(*index) + zend_hash_num_elements(&zai_hook_static) * sizeof(zai_hook_static_resolution));
+    if (!index) {
+        return zai_hook_tls->static_index = NULL;
+    }
+    index->static_generation = zai_hook_static_generation;
+    index->classes = zend_hash_num_elements(CG(class_table));
+    index->functions = zend_hash_num_elements(CG(function_table));
+
+    zai_hook_static_resolution *resolution = index->resolutions;
+    zai_hook_t *hook;
+    ZEND_HASH_FOREACH_PTR(&zai_hook_static, hook) {
+        resolution->function = NULL;
+        resolution->ce = NULL;
+        resolution->lookup = false;
+        if (hook->function) {
+            resolution->function = zai_hook_lookup_hook_function(hook, &resolution->ce);
+            // preloaded user code is persistent too, but we don't rely on it and just look it up again
+            resolution->lookup = (resolution->function && resolution->function->type != ZEND_INTERNAL_FUNCTION)
+                              || (resolution->ce && resolution->ce->type != ZEND_INTERNAL_CLASS);
+        }
+        ++resolution;
+    } ZEND_HASH_FOREACH_END();
+
+    return zai_hook_tls->static_index = index;
+}
+
 void zai_hook_activate(void) {
     zend_ulong current_hook_id = zai_hook_tls->id;
     zai_hook_tls->id = 0;
 
+    // without an index every hook is looked up like a request hook
+    zai_hook_static_index *index = zai_hook_static_index_get();
+    zai_hook_static_resolution *resolution = index ? index->resolutions : NULL;
     zai_hook_t *hook;
     ZEND_HASH_FOREACH_PTR(&zai_hook_static, hook) {
         zai_hook_t *copy = emalloc(sizeof(*copy));
         *copy = *hook;
         copy->is_global = true;
-        zai_hook_request_install(copy);
+
+        if (!copy->function) {
+            zai_hook_add_entry(&zai_hook_tls->request_files, copy);
+        } else if (!resolution || resolution->lookup) {
+            zai_hook_request_install(copy);
+        } else if (resolution->function) {
+            zai_hook_request_install_resolved(copy, resolution->function, resolution->ce);
+        } else {
+            zai_hook_request_install_pending(copy);
+        }
+        if (resolution) {
+            ++resolution;
+        }
     } ZEND_HASH_FOREACH_END();
 
     zai_hook_tls->id = current_hook_id;
@@ -1108,10 +1333,17 @@ void zai_hook_rshutdown(void) {
         zend_hash_destroy(&zai_hook_tls->request_classes);
         zend_hash_destroy(&zai_hook_tls->request_files.hooks);
         zend_hash_destroy(&zai_function_location_map);
+
+        if (zai_hook_tls->request_files.dispatch.hooks) {
+            efree(zai_hook_tls->request_files.dispatch.hooks);
+        }
     }
 }
 
-void zai_hook_gshutdown(void) { free(zai_hook_tls); }
+void zai_hook_gshutdown(void) {
+    free(zai_hook_tls->static_index);
+    free(zai_hook_tls);
+}
 
 void zai_hook_mshutdown(void) { zend_hash_destroy(&zai_hook_static); } /* }}} */
 
@@ -1184,6 +1416,7 @@ zend_long zai_hook_install_generator(zai_string_view scope, zai_string_view func
 
     if (persistent) {
         zend_hash_next_index_insert_ptr(&zai_hook_static, hook);
+        ++zai_hook_static_generation;
         return hook->id = zai_hook_static.nNextFreeElement - 1;
     } else {
         return hook->id = zai_hook_request_install(hook);
@@ -1260,6 +1493,7 @@ void zai_hook_clean(void) {
     zend_hash_iterators_remove(&zai_hook_tls->request_files.hooks);
     zend_hash_clean(&zai_hook_tls->request_files.hooks);
     zai_hook_tls->request_files.dynamic = 0;
+    ++zai_hook_tls->generation;
 
     zend_hash_clean(&zai_function_location_map);
 }
@@ -403,3 +403,58 @@ HOOK_TEST_CASE("hook add during begin", {
 
     zval_ptr_dtor(&result);
 });
+
+extern "C" {
+    static zend_long zai_hook_remove_test_index;
+
+    static bool zai_hook_test_hook_remove_begin(zend_ulong invocation, zend_execute_data *ex, zai_hook_test_fixed_t *fixed, zai_hook_test_dynamic_t *dynamic) {
+        if (zai_hook_remove_test_index != -1) {
+            REQUIRE(zai_hook_remove(ZAI_STRING_EMPTY, zai_hook_test_target, zai_hook_remove_test_index));
+            zai_hook_remove_test_index = -1;
+        }
+
+        zai_hook_test_begin_check++;
+        return true;
+    }
+}
+
+HOOK_TEST_CASE("hook removal during begin", {
+    zai_hook_test_reset(true);
+}, {
+    zai_hook_test_index = zai_hook_install(
+        ZAI_STRING_EMPTY,
+        zai_hook_test_target,
+        zai_hook_test_hook_remove_begin,
+        zai_hook_test_end,
+        ZAI_HOOK_AUX(&zai_hook_test_fixed_first, NULL),
+        sizeof(zai_hook_test_dynamic_t));
+
+    REQUIRE(zai_hook_test_index != -1);
+
+    zai_hook_remove_test_index = zai_hook_install(
+        ZAI_STRING_EMPTY,
+        zai_hook_test_target,
+        zai_hook_test_begin,
+        zai_hook_test_end,
+        ZAI_HOOK_AUX(&zai_hook_test_fixed_second, NULL),
+        sizeof(zai_hook_test_dynamic_t));
+
+    REQUIRE(zai_hook_remove_test_index != -1);
+}, {
+    zval result;
+
+    // the removed hook must not begin anymore, neither in the running call nor in later ones
+    for (int i = 0; i < 2; ++i) {
+        CHECK(zai_symbol_call(
+            ZAI_SYMBOL_SCOPE_GLOBAL, NULL,
+            ZAI_SYMBOL_FUNCTION_NAMED, &zai_hook_test_target,
+            &result, 0));
+
+        zval_ptr_dtor(&result);
+    }
+
+    CHECK(zai_hook_test_begin_check == 2);
+    CHECK(zai_hook_test_end_check == 2);
+
+    CHECK(zai_hook_test_end_fixed == &zai_hook_test_fixed_first);
+});
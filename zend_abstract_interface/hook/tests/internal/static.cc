@@ -200,3 +200,51 @@ HOOK_TEST_CASE("multiple stop", {
 
     zval_ptr_dtor(&result);
 });
+
+TEA_TEST_CASE_BARE("hook/internal/static", "continue across requests", {
+    REQUIRE(tea_sapi_sinit());
+    REQUIRE(tea_sapi_minit());
+    REQUIRE(zai_hook_minit());
+    REQUIRE(zai_hook_ginit());
+    zend_execute_internal_function = zend_execute_internal;
+    if (!zend_execute_internal_function) {
+        zend_execute_internal_function = execute_internal;
+    }
+    zend_execute_internal = zai_hook_test_execute_internal;
+
+    zai_hook_test_reset(true);
+
+    REQUIRE(zai_hook_install(
+        ZAI_STRING_EMPTY,
+        zai_hook_test_target,
+        zai_hook_test_begin,
+        zai_hook_test_end,
+        ZAI_HOOK_AUX(&zai_hook_test_fixed_first, NULL),
+        sizeof(zai_hook_test_dynamic_t)) != -1);
+
+    for (int request = 1; request <= 2; ++request) {
+        REQUIRE(tea_sapi_rinit());
+        REQUIRE(zai_hook_rinit());
+        zai_hook_activate();
+        TEA_TEST_CASE_WITHOUT_BAILOUT_BEGIN()
+        zval result;
+
+        CHECK(zai_symbol_call(
+            ZAI_SYMBOL_SCOPE_GLOBAL, NULL,
+            ZAI_SYMBOL_FUNCTION_NAMED, &zai_hook_test_target,
+            &result, 0));
+
+        CHECK(zai_hook_test_begin_check == request);
+        CHECK(zai_hook_test_end_check == request);
+
+        zval_ptr_dtor(&result);
+        TEA_TEST_CASE_WITHOUT_BAILOUT_END()
+        zai_hook_rshutdown();
+        tea_sapi_rshutdown();
+    }
+
+    zai_hook_gshutdown();
+    zai_hook_mshutdown();
+    tea_sapi_mshutdown();
+    tea_sapi_sshutdown();
+})
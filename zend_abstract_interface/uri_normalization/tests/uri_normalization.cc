@@ -56,6 +56,8 @@ TEST_URI_NORMALIZATION("default replacement test: starts_with_uuid_no_dash", "/b
 TEST_URI_NORMALIZATION("default replacement test: ends_with_uuid_no_dash", "/path/b968fb042be9494b8b26efb8a816e7a5", "/path/?", {})
 TEST_URI_NORMALIZATION("default replacement test: has_uuid_no_dash", "/before/b968fb042be9494b8b26efb8a816e7a5/path", "/before/?/path", {})
 TEST_URI_NORMALIZATION("default replacement test: multiple_patterns", "/int/1/uuid/b968fb042be9494b8b26efb8a816e7a5/int/2", "/int/?/uuid/?/int/?", {})
+TEST_URI_NORMALIZATION("default replacement test: uuid_invalid_version", "/b968fb04-2be9-694b-8b26-efb8a816e7a5", "/b968fb04-2be9-694b-8b26-efb8a816e7a5", {})
+TEST_URI_NORMALIZATION("default replacement test: uuid_invalid_variant", "/b968fb04-2be9-494b-cb26-efb8a816e7a5/path", "/b968fb04-2be9-494b-cb26-efb8a816e7a5/path", {})
 TEST_URI_NORMALIZATION("default replacement test: hex_case_insensitive", "/some/path/b968Fb04-2bE9-494B-8b26-Efb8A816e7a5/after", "/some/path/?/after", {})
 TEST_URI_NORMALIZATION("default replacement test: uuid_case_insensitive", "/some/path/0123456789AbCdEf/after", "/some/path/?/after", {})
 
@@ -85,6 +87,15 @@ TEST_URI_NORMALIZATION("pattern mapping: partial matching", "/int/123/path/one/t
 TEST_URI_NORMALIZATION("pattern mapping: matching is case sensititve", "/int/123/nested/some", "/int/?/nested/some", {
     add_assoc_null(&mapping, "nEsTeD/*");
 })
+TEST_URI_NORMALIZATION("pattern mapping: adjacent matches", "/a/b/c", "/?/?/c", {
+    add_assoc_null(&mapping, "*/");
+})
+TEST_URI_NORMALIZATION("pattern mapping: star backtracks to match the rest of the pattern", "/one-two-three/x", "/?-three/x", {
+    add_assoc_null(&mapping, "*-three");
+})
+TEST_URI_NORMALIZATION("pattern mapping: consecutive stars", "/int/123/name/abc", "/int/?/name/??", {
+    add_assoc_null(&mapping, "name/**");
+})
 
 TEST_URI_NORMALIZATION("pattern mapping & fragment regexes: working with http URLs", "http://example.com/int/123/path/abc/nested/some", "http://example.com/int/?/path/?/nested/?", {
     add_assoc_null(&mapping, "nested/*");
@@ -99,6 +110,55 @@ TEST_URI_NORMALIZATION("pattern mapping & fragment regexes: working with full UR
     add_assoc_null(&fragment_regex, "^abc$");
 })
 
+TEA_TEST_CASE("uri_normalization", "compiled normalizer: applied to multiple paths", {
+    zval fragment_regex, mapping;
+    array_init(&fragment_regex);
+    array_init(&mapping);
+    add_assoc_null(&fragment_regex, "^abc$");
+    add_assoc_null(&mapping, "nested/*");
+
+    zai_uri_normalizer *normalizer = zai_uri_normalizer_compile(Z_ARRVAL(fragment_regex), Z_ARRVAL(mapping), false);
+    zval_dtor(&mapping);
+    zval_dtor(&fragment_regex);
+
+    zend_string *path = zend_string_init(ZEND_STRL("/int/123/abc/nested/some?query"), 0);
+    for (int i = 0; i < 2; ++i) {
+        zend_string *res = zai_uri_normalizer_apply(normalizer, path);
+        REQUIRE(zend_string_equals_literal(res, "/int/?/?/nested/?"));
+        zend_string_release(res);
+    }
+    REQUIRE(zend_string_equals_literal(path, "/int/123/abc/nested/some?query"));
+
+    zend_string *unchanged = zend_string_init(ZEND_STRL("/path/unchanged"), 0);
+    zend_string *res = zai_uri_normalizer_apply(normalizer, unchanged);
+    REQUIRE(zend_string_equals_literal(res, "/path/unchanged"));
+    zend_string_release(res);
+    zend_string_release(unchanged);
+
+    zend_string_release(path);
+    zai_uri_normalizer_free(normalizer);
+})
+
+TEA_TEST_CASE("uri_normalization", "compiled normalizer: persistent copy outlives the config", {
+    zval fragment_regex, mapping;
+    array_init(&fragment_regex);
+    array_init(&mapping);
+    add_assoc_null(&fragment_regex, "^abc$");
+    add_assoc_null(&mapping, " nested/* ");
+
+    zai_uri_normalizer *normalizer = zai_uri_normalizer_compile(Z_ARRVAL(fragment_regex), Z_ARRVAL(mapping), true);
+    zval_dtor(&mapping);
+    zval_dtor(&fragment_regex);
+
+    zend_string *path = zend_string_init(ZEND_STRL("/int/123/abc/nested/some"), 0);
+    zend_string *res = zai_uri_normalizer_apply(normalizer, path);
+    REQUIRE(zend_string_equals_literal(res, "/int/?/?/nested/?"));
+    zend_string_release(res);
+    zend_string_release(path);
+
+    zai_uri_normalizer_free(normalizer);
+})
+
 #undef TEST_BODY
 #define TEST_BODY(output, query_string, ...)          \
 {                                                     \
@@ -165,3 +225,50 @@ TEST_QUERY_STRING("obfuscate: no obfuscation on whitelist", "a=1&b=2&c=3", "c=3"
     add_assoc_null(&whitelist, "c");
     regex = zend_string_init(ZEND_STRL("c=[0-9]"), 0);
 });
+
+TEST_QUERY_STRING("obfuscate: empty regex does not redact", "a=1&b=2", "a=1&b=2", {
+    add_assoc_null(&whitelist, "*");
+    regex = zend_string_init(ZEND_STRL(""), 0);
+});
+
+TEST_QUERY_STRING("obfuscate: invalid regex does not redact", "a=1&b=2", "a=1&b=2", {
+    add_assoc_null(&whitelist, "*");
+    regex = zend_string_init(ZEND_STRL("(((]]]"), 0);
+});
+
+TEA_TEST_CASE("query_string", "compiled filter: applied to multiple query strings", {
+    zval whitelist;
+    array_init(&whitelist);
+    add_assoc_null(&whitelist, "*");
+    zend_string *regex = zend_string_init(ZEND_STRL("c=[0-9]"), 0);
+
+    zai_query_string_filter *filter = zai_query_string_filter_compile(Z_ARRVAL(whitelist), regex, false);
+    zend_string_release(regex);
+
+    zend_string *res = zai_query_string_filter_apply(filter, ZAI_STRL_VIEW("a=1&c=3"));
+    REQUIRE(zend_string_equals_literal(res, "a=1&<redacted>"));
+    zend_string_release(res);
+
+    res = zai_query_string_filter_apply(filter, ZAI_STRL_VIEW("c=4&b"));
+    REQUIRE(zend_string_equals_literal(res, "<redacted>&b"));
+    zend_string_release(res);
+
+    zai_query_string_filter_free(filter);
+    zval_dtor(&whitelist);
+})
+
+TEA_TEST_CASE("query_string", "compiled filter: persistent copy outlives the whitelist", {
+    zval whitelist;
+    array_init(&whitelist);
+    add_assoc_null(&whitelist, "a");
+    add_assoc_null(&whitelist, "c");
+
+    zai_query_string_filter *filter = zai_query_string_filter_compile(Z_ARRVAL(whitelist), NULL, true);
+    zval_dtor(&whitelist);
+
+    zend_string *res = zai_query_string_filter_apply(filter, ZAI_STRL_VIEW("a=1&b=2&c"));
+    REQUIRE(zend_string_equals_literal(res, "a=1&c"));
+    zend_string_release(res);
+
+    zai_query_string_filter_free(filter);
+})
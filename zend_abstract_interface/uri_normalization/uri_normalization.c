@@ -22,12 +22,12 @@ static inline zend_string *zai_php_pcre_replace(zend_string *regex, zend_string
     php_pcre_replace(regex, subj, subjstr, subjlen, replace, limit, (int *)replacements)
 #endif
 
-static zend_bool zai_starts_with_protocol(zend_string *str) {
+static zend_bool zai_starts_with_protocol(const char *str, size_t len) {
     // See: https://tools.ietf.org/html/rfc3986#page-17
-    if (ZSTR_VAL(str)[0] < 'a' || ZSTR_VAL(str)[0] > 'z') {
+    if (str[0] < 'a' || str[0] > 'z') {
         return false;
     }
-    for (char *ptr = ZSTR_VAL(str) + 1, *end = ZSTR_VAL(str) + ZSTR_LEN(str) - 2; ptr < end; ++ptr) {
+    for (const char *ptr = str + 1, *end = str + len - 2; ptr < end; ++ptr) {
         if (ptr[0] == ':' && ptr[1] == '/' && ptr[2] == '/') {
             return true;
         }
@@ -39,136 +39,400 @@ static zend_bool zai_starts_with_protocol(zend_string *str) {
     return false;
 }
 
-static void zai_apply_fragment_regex(zend_string **path, char *fragment_regex, int fragment_len) {
+typedef struct {
+    zend_string *pattern;      // '*' matches one or more characters within a path segment
+    zend_string *replacement;  // the pattern with every '*' replaced by '?'
+} zai_uri_mapping;
+
+struct zai_uri_normalizer {
+    bool persistent;
+    uint32_t mappings_count;
+    uint32_t fragment_regexes_count;
+    zai_uri_mapping *mappings;
+    zend_string **fragment_regexes;  // already wrapped to only apply to whole path segments
+};
+
+static zend_string *zai_wrap_fragment_regex(const char *fragment_regex, int fragment_len) {
     // limit regex to only apply between two slashes (or slash and end)
     bool start_anchor = fragment_regex[0] == '^', end_anchor = fragment_regex[fragment_len - 1] == '$';
-    zend_string *regex = zend_strpprintf(0, "((?<=/)(?=[^/]++(.*$))%s%.*s%s(?=\\1))", start_anchor ? "" : "[^/]*",
-                                         fragment_len - start_anchor - end_anchor, fragment_regex + start_anchor,
-                                         end_anchor ? "(?=/|$)" : "[^/]*");
-    size_t replacements;
-    zend_string *question_mark = ZSTR_CHAR('?');
-    zend_string *substituted_path =
-        php_pcre_replace(regex, *path, ZSTR_VAL(*path), ZSTR_LEN(*path), question_mark, -1, &replacements);
-    if (substituted_path) {  // NULL on invalid regex
-        zend_string_release(*path);
-        *path = substituted_path;
-    }
-    zend_string_release(question_mark);
-    zend_string_release(regex);
+    return zend_strpprintf(0, "((?<=/)(?=[^/]++(.*$))%s%.*s%s(?=\\1))", start_anchor ? "" : "[^/]*",
+                           fragment_len - start_anchor - end_anchor, fragment_regex + start_anchor,
+                           end_anchor ? "(?=/|$)" : "[^/]*");
 }
 
-zend_string *zai_uri_normalize_path(zend_string *path, zend_array *fragmentRegex, zend_array *mapping) {
+// Request allocated strings are replaced by a persistent copy when the result must outlive the request
+static zend_string *zai_uri_string_persist(zend_string *str, bool persistent) {
+    if (!persistent || (GC_FLAGS(str) & IS_STR_PERSISTENT)) {
+        return str;
+    }
+    zend_string *copy = zend_string_init(ZSTR_VAL(str), ZSTR_LEN(str), 1);
+    zend_string_release(str);
+    return copy;
+}
+
+zai_uri_normalizer *zai_uri_normalizer_compile(zend_array *fragmentRegex, zend_array *mapping, bool persistent) {
+    zai_uri_normalizer *normalizer = pemalloc(sizeof(*normalizer), persistent);
+    normalizer->persistent = persistent;
+    normalizer->mappings_count = 0;
+    normalizer->fragment_regexes_count = 0;
+    normalizer->mappings = safe_pemalloc(zend_hash_num_elements(mapping), sizeof(zai_uri_mapping), 0, persistent);
+    normalizer->fragment_regexes =
+        safe_pemalloc(zend_hash_num_elements(fragmentRegex), sizeof(zend_string *), 0, persistent);
+
+    zend_string *pattern;
+    ZEND_HASH_FOREACH_STR_KEY(mapping, pattern) {
+        pattern = php_trim(pattern, NULL, 0, 3);
+        if (!ZSTR_LEN(pattern)) {
+            zend_string_release(pattern);
+            continue;
+        }
+        pattern = zai_uri_string_persist(pattern, persistent);
+        zend_string *replacement = zend_string_init(ZSTR_VAL(pattern), ZSTR_LEN(pattern), persistent);
+        for (char *ptr = ZSTR_VAL(replacement), *end = ptr + ZSTR_LEN(replacement); ptr < end; ++ptr) {
+            if (*ptr == '*') {
+                *ptr = '?';
+            }
+        }
+        normalizer->mappings[normalizer->mappings_count++] = (zai_uri_mapping){pattern, replacement};
+    }
+    ZEND_HASH_FOREACH_END();
+
+    zend_string *fragment_regex;
+    ZEND_HASH_FOREACH_STR_KEY(fragmentRegex, fragment_regex) {
+        zend_string *trimmed_regex = php_trim(fragment_regex, ZEND_STRL(" \t\n\r\v\0/"), 3);
+        if (ZSTR_LEN(trimmed_regex)) {
+            zend_string *regex = zai_wrap_fragment_regex(ZSTR_VAL(trimmed_regex), ZSTR_LEN(trimmed_regex));
+            if (pcre_get_compiled_regex_cache(regex)) {
+                normalizer->fragment_regexes[normalizer->fragment_regexes_count++] =
+                    zai_uri_string_persist(regex, persistent);
+            } else {  // invalid regexes are ignored
+                zend_string_release(regex);
+            }
+        }
+        zend_string_release(trimmed_regex);
+    }
+    ZEND_HASH_FOREACH_END();
+
+    return normalizer;
+}
+
+void zai_uri_normalizer_free(zai_uri_normalizer *normalizer) {
+    for (uint32_t i = 0; i < normalizer->mappings_count; ++i) {
+        zend_string_release(normalizer->mappings[i].pattern);
+        zend_string_release(normalizer->mappings[i].replacement);
+    }
+    for (uint32_t i = 0; i < normalizer->fragment_regexes_count; ++i) {
+        zend_string_release(normalizer->fragment_regexes[i]);
+    }
+    pefree(normalizer->mappings, normalizer->persistent);
+    pefree(normalizer->fragment_regexes, normalizer->persistent);
+    pefree(normalizer, normalizer->persistent);
+}
+
+// Returns the end of the match of the pattern at subject or NULL. A '*' matches greedily, backtracking if needed.
+static const char *zai_uri_mapping_match(const char *pattern, const char *pattern_end, const char *subject,
+                                         const char *subject_end) {
+    while (pattern < pattern_end && *pattern != '*') {
+        if (subject == subject_end || *subject != *pattern) {
+            return NULL;
+        }
+        ++pattern, ++subject;
+    }
+    if (pattern == pattern_end) {
+        return subject;
+    }
+
+    // consecutive stars match at least one character each, like a single star with a minimum length
+    size_t stars = 0;
+    while (pattern < pattern_end && *pattern == '*') {
+        ++pattern, ++stars;
+    }
+
+    const char *segment_end = subject;
+    while (segment_end < subject_end && *segment_end != '/') {
+        ++segment_end;
+    }
+    for (; segment_end >= subject + stars; --segment_end) {
+        const char *match_end = zai_uri_mapping_match(pattern, pattern_end, segment_end, subject_end);
+        if (match_end) {
+            return match_end;
+        }
+    }
+    return NULL;
+}
+
+// Replaces all non-overlapping matches of the mapping starting right after a slash, from left to right.
+static zend_string *zai_uri_apply_mapping(zend_string *path, zai_uri_mapping *mapping) {
+    const char *pattern = ZSTR_VAL(mapping->pattern), *pattern_end = pattern + ZSTR_LEN(mapping->pattern);
+    const char *copied = ZSTR_VAL(path), *end = copied + ZSTR_LEN(path);
+    smart_str substituted = {0};
+
+    const char *slash = memchr(copied, '/', end - copied);
+    while (slash && slash + 1 < end) {
+        const char *ptr = slash + 1, *match_end = zai_uri_mapping_match(pattern, pattern_end, ptr, end);
+        if (match_end) {
+            smart_str_appendl(&substituted, copied, ptr - copied);
+            smart_str_append(&substituted, mapping->replacement);
+            copied = ptr = match_end;
+            if (match_end[-1] == '/') {  // the next match may start right away
+                slash = match_end - 1;
+                continue;
+            }
+        }
+        slash = memchr(ptr, '/', end - ptr);
+    }
+
+    if (!substituted.s) {
+        return path;
+    }
+    smart_str_appendl(&substituted, copied, end - copied);
+    smart_str_0(&substituted);
+    zend_string_release(path);
+    return substituted.s;
+}
+
+static inline bool zai_is_hex(char c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+// ^\d+$
+static bool zai_uri_segment_is_int(const char *segment, size_t len) {
+    for (const char *end = segment + len; segment < end; ++segment) {
+        if (*segment < '0' || *segment > '9') {
+            return false;
+        }
+    }
+    return true;
+}
+
+// ^[0-9a-fA-F]{8}-?[0-9a-fA-F]{4}-?[1-5][0-9a-fA-F]{3}-?[89abAB][0-9a-fA-F]{3}-?[0-9a-fA-F]{12}$
+static bool zai_uri_segment_is_uuid(const char *segment, size_t len) {
+    static const uint8_t group_lengths[] = {8, 4, 4, 4, 12};
+    const char *end = segment + len;
+    for (int group = 0; group < 5; ++group) {
+        if (group > 0 && segment < end && *segment == '-') {
+            ++segment;
+        }
+        if (end - segment < group_lengths[group]) {
+            return false;
+        }
+        if (group == 2 && (*segment < '1' || *segment > '5')) {
+            return false;
+        }
+        if (group == 3 && *segment != '8' && *segment != '9' && *segment != 'a' && *segment != 'b' &&
+            *segment != 'A' && *segment != 'B') {
+            return false;
+        }
+        for (const char *group_end = segment + group_lengths[group]; segment < group_end; ++segment) {
+            if (!zai_is_hex(*segment)) {
+                return false;
+            }
+        }
+    }
+    return segment == end;
+}
+
+// ^[0-9a-fA-F]{8,128}$
+static bool zai_uri_segment_is_hex(const char *segment, size_t len) {
+    if (len < 8 || len > 128) {
+        return false;
+    }
+    for (const char *end = segment + len; segment < end; ++segment) {
+        if (!zai_is_hex(*segment)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool zai_uri_segment_is_id(const char *segment, size_t len) {
+    return len && (zai_uri_segment_is_int(segment, len) || zai_uri_segment_is_uuid(segment, len) ||
+                   zai_uri_segment_is_hex(segment, len));
+}
+
+// Replaces path segments looking like ids by '?', in place, as the path only ever shrinks.
+static zend_string *zai_uri_replace_id_segments(zend_string *path) {
+    size_t len = ZSTR_LEN(path), written = 0, copied = 0;
+    bool replaced = false;
+
+    // Like .*$ in PCRE, only segments followed by no newline but possibly a terminating one are considered
+    size_t pos = 0;
+    for (char *newline = memchr(ZSTR_VAL(path), '\n', len - 1); newline;) {
+        pos = newline + 1 - ZSTR_VAL(path);
+        newline = memchr(ZSTR_VAL(path) + pos, '\n', len - 1 - pos);
+    }
+
+    while (pos < len) {
+        char *val = ZSTR_VAL(path), *slash = memchr(val + pos, '/', len - pos);
+        if (!slash) {
+            break;
+        }
+        size_t segment = slash + 1 - val;
+        char *next_slash = memchr(val + segment, '/', len - segment);
+        size_t segment_end = next_slash ? (size_t)(next_slash - val) : len;
+        pos = segment_end;
+
+        size_t id_len = segment_end - segment;
+        if (!zai_uri_segment_is_id(val + segment, id_len)) {
+            // PCRE $ also matches before a newline terminating the subject
+            if (segment_end != len || id_len < 2 || val[segment_end - 1] != '\n' ||
+                !zai_uri_segment_is_id(val + segment, --id_len)) {
+                continue;
+            }
+        }
+
+        if (!replaced) {
+            if (ZSTR_IS_INTERNED(path) || GC_REFCOUNT(path) > 1) {
+                zend_string *separated = zend_string_init(val, len, 0);
+                zend_string_release(path);
+                path = separated;
+            }
+            replaced = true;
+            written = segment;
+        } else {
+            memmove(ZSTR_VAL(path) + written, ZSTR_VAL(path) + copied, segment - copied);
+            written += segment - copied;
+        }
+        ZSTR_VAL(path)[written++] = '?';
+        copied = segment + id_len;
+    }
+
+    if (replaced) {
+        memmove(ZSTR_VAL(path) + written, ZSTR_VAL(path) + copied, len - copied);
+        written += len - copied;
+        ZSTR_LEN(path) = written;
+        ZSTR_VAL(path)[written] = 0;
+        zend_string_forget_hash_val(path);
+    }
+    return path;
+}
+
+zend_string *zai_uri_normalizer_apply(zai_uri_normalizer *normalizer, zend_string *path) {
     if (path == NULL || ZSTR_LEN(path) == 0 || (ZSTR_LEN(path) == 1 && ZSTR_VAL(path)[0] == '/') ||
         ZSTR_VAL(path)[0] == '?') {
         return ZSTR_CHAR('/');
     }
 
-    path = zend_string_copy(path);
-
     // Removing query string
     char *query_str = strchr(ZSTR_VAL(path), '?');
-    if (query_str) {
-        size_t new_len = query_str - ZSTR_VAL(path);
-        path = zend_string_truncate(path, new_len, 0);
-        ZSTR_VAL(path)[new_len] = 0;
-    }
+    size_t len = query_str ? (size_t)(query_str - ZSTR_VAL(path)) : ZSTR_LEN(path);
 
     // We always expect leading slash if it is a pure path, while urls with RFC3986 complaint schemes are preserved.
-    if (ZSTR_VAL(path)[0] != '/' && !zai_starts_with_protocol(path)) {
-        path = zend_string_realloc(path, ZSTR_LEN(path) + 1, 0);
-        memmove(ZSTR_VAL(path) + 1, ZSTR_VAL(path), ZSTR_LEN(path));  // incl. trailing 0 byte
-        ZSTR_VAL(path)[0] = '/';
+    if (ZSTR_VAL(path)[0] != '/' && !zai_starts_with_protocol(ZSTR_VAL(path), len)) {
+        zend_string *prefixed = zend_string_alloc(len + 1, 0);
+        ZSTR_VAL(prefixed)[0] = '/';
+        memcpy(ZSTR_VAL(prefixed) + 1, ZSTR_VAL(path), len);
+        ZSTR_VAL(prefixed)[len + 1] = 0;
+        path = prefixed;
+    } else if (len != ZSTR_LEN(path)) {
+        path = zend_string_init(ZSTR_VAL(path), len, 0);
+    } else {
+        path = zend_string_copy(path);
     }
 
-    zend_string *pattern;
-    ZEND_HASH_FOREACH_STR_KEY(mapping, pattern) {
-        pattern = php_trim(pattern, NULL, 0, 3);
-        if (ZSTR_LEN(pattern)) {
-            // build a regex starting with a /, properly escaped and * replaced by [^/]+
-            smart_str regex = {0}, replacement = {0};
-            smart_str_alloc(&regex, ZSTR_LEN(pattern) * 4 + 10, 0);
-            smart_str_alloc(&replacement, ZSTR_LEN(pattern), 0);
-            smart_str_appends(&regex, "((?<=/)");
-            for (char *ptr = ZSTR_VAL(pattern), *end = ZSTR_VAL(pattern) + ZSTR_LEN(pattern); ptr < end; ++ptr) {
-                if (*ptr == '*') {
-                    smart_str_appends(&regex, "[^/]+");
-                    smart_str_appendc(&replacement, '?');
-                } else {
-                    if (strchr(".\\+?[^]$(){}=!><|:-#", *ptr)) {
-                        smart_str_appendc(&regex, '\\');
-                    }
-                    smart_str_appendc(&regex, *ptr);
-                    smart_str_appendc(&replacement, *ptr);
-                }
-            }
-            smart_str_appendc(&regex, ')');
-            smart_str_0(&regex);
-            smart_str_0(&replacement);
+    for (uint32_t i = 0; i < normalizer->mappings_count; ++i) {
+        path = zai_uri_apply_mapping(path, &normalizer->mappings[i]);
+    }
 
+    path = zai_uri_replace_id_segments(path);
+
+    if (normalizer->fragment_regexes_count) {
+        zend_string *question_mark = ZSTR_CHAR('?');
+        for (uint32_t i = 0; i < normalizer->fragment_regexes_count; ++i) {
             size_t replacements;
-            zend_string *substituted_path =
-                php_pcre_replace(regex.s, path, ZSTR_VAL(path), ZSTR_LEN(path), replacement.s, -1, &replacements);
-            zend_string_release(path);
-            path = substituted_path;
+            zend_string *substituted_path = php_pcre_replace(normalizer->fragment_regexes[i], path, ZSTR_VAL(path),
+                                                             ZSTR_LEN(path), question_mark, -1, &replacements);
+            if (substituted_path) {
+                zend_string_release(path);
+                path = substituted_path;
+            }
+        }
+        zend_string_release(question_mark);
+    }
 
-            smart_str_free(&regex);
-            smart_str_free(&replacement);
+    return path;
+}
+
+zend_string *zai_uri_normalize_path(zend_string *path, zend_array *fragmentRegex, zend_array *mapping) {
+    zai_uri_normalizer *normalizer = zai_uri_normalizer_compile(fragmentRegex, mapping, false);
+    zend_string *normalized = zai_uri_normalizer_apply(normalizer, path);
+    zai_uri_normalizer_free(normalizer);
+    return normalized;
+}
+
+struct zai_query_string_filter {
+    bool persistent;
+    bool allow_all;
+    HashTable whitelist;             // a copy of the allowed keys, mapped to null
+    zend_string *obfuscation_regex;  // NULL if there is none or it is invalid
+};
+
+zai_query_string_filter *zai_query_string_filter_compile(zend_array *whitelist, zend_string *pattern,
+                                                         bool persistent) {
+    zai_query_string_filter *filter = pemalloc(sizeof(*filter), persistent);
+    filter->persistent = persistent;
+    filter->allow_all = false;
+    filter->obfuscation_regex = NULL;
+
+    zend_hash_init(&filter->whitelist, zend_hash_num_elements(whitelist), NULL, NULL, persistent);
+    zend_string *key;
+    ZEND_HASH_FOREACH_STR_KEY(whitelist, key) {
+        if (key) {
+            zend_hash_str_add_empty_element(&filter->whitelist, ZSTR_VAL(key), ZSTR_LEN(key));
         }
-        zend_string_release(pattern);
     }
     ZEND_HASH_FOREACH_END();
 
-    zai_apply_fragment_regex(&path, ZEND_STRL("^\\d+$"));
-    zai_apply_fragment_regex(
-        &path,
-        ZEND_STRL("^[0-9a-fA-F]{8}-?[0-9a-fA-F]{4}-?[1-5][0-9a-fA-F]{3}-?[89abAB][0-9a-fA-F]{3}-?[0-9a-fA-F]{12}$"));
-    zai_apply_fragment_regex(&path, ZEND_STRL("^[0-9a-fA-F]{8,128}$"));
+    if (zend_hash_num_elements(&filter->whitelist) == 1) {  // * is wildcard
+        filter->allow_all = zend_hash_str_exists(&filter->whitelist, ZEND_STRL("*"));
+    }
 
-    zend_string *fragment_regex;
-    ZEND_HASH_FOREACH_STR_KEY(fragmentRegex, fragment_regex) {
-        zend_string *trimmed_regex = php_trim(fragment_regex, ZEND_STRL(" \t\n\r\v\0/"), 3);
-        if (ZSTR_LEN(trimmed_regex)) {
-            zai_apply_fragment_regex(&path, ZSTR_VAL(trimmed_regex), ZSTR_LEN(trimmed_regex));
+    // the regex is only used when everything is allowed, other values are not kept anyway
+    if (filter->allow_all && pattern && ZSTR_LEN(pattern)) {
+        zend_string *regex = zend_strpprintf(0, "(%.*s)", (int)ZSTR_LEN(pattern), ZSTR_VAL(pattern));
+        if (pcre_get_compiled_regex_cache(regex)) {
+            filter->obfuscation_regex = zai_uri_string_persist(regex, persistent);
+        } else {  // invalid regexes do not redact anything
+            zend_string_release(regex);
         }
-        zend_string_release(trimmed_regex);
     }
-    ZEND_HASH_FOREACH_END();
 
-    return path;
+    return filter;
 }
 
-zend_string *zai_filter_query_string(zai_string_view queryString, zend_array *whitelist, zend_string *pattern) {
+void zai_query_string_filter_free(zai_query_string_filter *filter) {
+    if (filter->obfuscation_regex) {
+        zend_string_release(filter->obfuscation_regex);
+    }
+    zend_hash_destroy(&filter->whitelist);
+    pefree(filter, filter->persistent);
+}
+
+zend_string *zai_query_string_filter_apply(zai_query_string_filter *filter, zai_string_view queryString) {
+    zend_array *whitelist = &filter->whitelist;
     if (zend_hash_num_elements(whitelist) == 0) {
         return ZSTR_EMPTY_ALLOC();
     }
-    if (zend_hash_num_elements(whitelist) == 1) {  // * is wildcard
-        zend_string *str;
-        zend_ulong numkey;
-        zend_hash_get_current_key(whitelist, &str, &numkey);
-        if (zend_string_equals_literal(str, "*")) {
-            zend_string *qs = zend_string_init(queryString.ptr, queryString.len, 0);
-            if (pattern) {
-                zend_string *replacement = zend_string_init(ZEND_STRL("<redacted>"), 0);
-                zend_string *regex = zend_strpprintf(0, "(%.*s)", (int)ZSTR_LEN(pattern), ZSTR_VAL(pattern));
+    if (filter->allow_all) {
+        zend_string *qs = zend_string_init(queryString.ptr, queryString.len, 0);
+        if (filter->obfuscation_regex) {
+            zend_string *replacement = zend_string_init(ZEND_STRL("<redacted>"), 0);
+            zend_string *redacted_qs =
+                php_pcre_replace(filter->obfuscation_regex, qs, ZSTR_VAL(qs), ZSTR_LEN(qs), replacement, -1, NULL);
+            zend_string_release(replacement);
 
-                zend_string *redacted_qs =
-                    php_pcre_replace(regex, qs, ZSTR_VAL(qs), ZSTR_LEN(qs), replacement, -1, NULL);
-
-                zend_string_release(regex);
-                zend_string_release(replacement);
-
-                if (redacted_qs) {
-                    zend_string_release(qs);
-                    return redacted_qs;
-                }
+            if (redacted_qs) {
+                zend_string_release(qs);
+                return redacted_qs;
             }
-            return qs;
         }
+        return qs;
     }
 
     smart_str filtered = {0};
 
-    for (const char *start = queryString.ptr, *ptr = start, *end = ptr + queryString.len; ptr < end; ++ptr) {
+    const char *start = queryString.ptr, *end = start + queryString.len;
+    for (const char *ptr = start; ptr < end; ++ptr) {
         if (*ptr == '&') {
             if (ptr != start && zend_hash_str_exists(whitelist, start, ptr - start)) {
             add_str:
@@ -190,6 +454,14 @@ zend_string *zai_filter_query_string(zai_string_view queryString, zend_array *wh
         }
     }
 
+    // a trailing key without value is not terminated by '&'
+    if (start < end && zend_hash_str_exists(whitelist, start, end - start)) {
+        if (filtered.s) {
+            smart_str_appendc(&filtered, '&');
+        }
+        smart_str_appendl(&filtered, start, end - start);
+    }
+
     if (filtered.s) {
         smart_str_0(&filtered);
         return filtered.s;
@@ -197,6 +469,13 @@ zend_string *zai_filter_query_string(zai_string_view queryString, zend_array *wh
     return ZSTR_EMPTY_ALLOC();
 }
 
+zend_string *zai_filter_query_string(zai_string_view queryString, zend_array *whitelist, zend_string *pattern) {
+    zai_query_string_filter *filter = zai_query_string_filter_compile(whitelist, pattern, false);
+    zend_string *filtered = zai_query_string_filter_apply(filter, queryString);
+    zai_query_string_filter_free(filter);
+    return filtered;
+}
+
 bool zai_match_regex(zend_string *pattern, zend_string *subject) {
     if (ZSTR_LEN(pattern) == 0) {
         return false;
@@ -10,6 +10,27 @@
  * Note: it also accepts full urls which are preserved: http://example.com/int/123 ---> http://example.com/int/?
  */
 zend_string *zai_uri_normalize_path(zend_string *path, zend_array *fragmentRegex, zend_array *mapping);
+
+/*
+ * The same normalization, with the fragment regexes and mappings compiled once upfront, to be applied to many paths.
+ * Path segments are checked for ids in a single pass, mappings are matched without going through PCRE.
+ * A persistent normalizer copies everything it needs and may be kept across requests.
+ */
+typedef struct zai_uri_normalizer zai_uri_normalizer;
+zai_uri_normalizer *zai_uri_normalizer_compile(zend_array *fragmentRegex, zend_array *mapping, bool persistent);
+zend_string *zai_uri_normalizer_apply(zai_uri_normalizer *normalizer, zend_string *path);
+void zai_uri_normalizer_free(zai_uri_normalizer *normalizer);
+
 zend_string *zai_filter_query_string(zai_string_view queryString, zend_array *whitelist, zend_string *pattern);
+
+/*
+ * The same filtering, with the obfuscation regex wrapped and validated once, to be applied to many query strings.
+ * The allowed keys are copied, a persistent filter may be kept across requests.
+ */
+typedef struct zai_query_string_filter zai_query_string_filter;
+zai_query_string_filter *zai_query_string_filter_compile(zend_array *whitelist, zend_string *pattern, bool persistent);
+zend_string *zai_query_string_filter_apply(zai_query_string_filter *filter, zai_string_view queryString);
+void zai_query_string_filter_free(zai_query_string_filter *filter);
+
 bool zai_match_regex(zend_string *pattern, zend_string *subject);
 #endif  // ZAI_URI_NORMALIZATION_H